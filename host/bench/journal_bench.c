@@ -0,0 +1,217 @@
+/* Event journal against the NOR flash model in host_flash.c.
+ *
+ * Throughput: events arrive in bursts, as from the pgpemu task, and the
+ * journal task writes each burst; reported per second of flash time.
+ * Recovery: power is cut at a random program or erase, the journal is
+ * brought up again and must rebuild exactly the counters of the events up
+ * to the last sequence number it recovered, lose nothing it had reported
+ * written and carry on numbering without a gap. Wear: erases per sector
+ * and what they mean against the flash's erase budget.
+ *
+ *   journal_bench                  # 50000 events, 200 power cuts
+ *   journal_bench --events N --cuts N --per-day N */
+#include "journal.h"
+#include "host_sim.h"
+#include "esp_partition.h"
+#include "esp_timer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FLASH_CYCLES    100000.0
+#define MAX_BURST       8
+
+static uint8_t *shadow;
+static uint32_t shadow_len;
+static uint32_t next_seq;
+static int failures;
+
+static journal_event_t random_event(void) {
+    int r = rand() % 100;
+    if (r < 40) {
+        return JOURNAL_EV_CAUGHT;
+    }
+    if (r < 70) {
+        return JOURNAL_EV_SPUN;
+    }
+    if (r < 85) {
+        return JOURNAL_EV_FLED;
+    }
+    return r < 93 ? JOURNAL_EV_CONNECT : JOURNAL_EV_DISCONNECT;
+}
+
+static void append(journal_event_t type) {
+    if (next_seq < shadow_len) {
+        shadow[next_seq] = (uint8_t)type;
+    }
+    next_seq++;
+    journal_append(type, (uint8_t)(rand() % 3), (uint16_t)(rand() % 400));
+}
+
+static uint32_t burst(void) {
+    uint32_t n = 1 + (uint32_t)(rand() % MAX_BURST);
+    for (uint32_t i = 0; i < n; i++) {
+        append(random_event());
+    }
+    journal_service();
+    return n;
+}
+
+static journal_counters_t expected(uint32_t last_seq) {
+    journal_counters_t c = { 0 };
+    for (uint32_t s = 1; s <= last_seq && s < shadow_len; s++) {
+        switch (shadow[s]) {
+            case JOURNAL_EV_BOOT: c.boots++; break;
+            case JOURNAL_EV_CAUGHT: c.caught++; break;
+            case JOURNAL_EV_FLED: c.fled++; break;
+            case JOURNAL_EV_SPUN: c.spun++; break;
+            case JOURNAL_EV_CONNECT: c.connects++; break;
+            default: break;
+        }
+    }
+    return c;
+}
+
+/* Brings the journal up as app_main does, boot record included, and
+ * checks the recovered state against what was appended. */
+static void boot(const journal_stats_t *before, const char *when) {
+    const journal_counters_t zero = { 0 };
+    if (journal_init(&zero) != ESP_OK) {
+        fprintf(stderr, "%s: journal_init failed\n", when);
+        failures++;
+        return;
+    }
+    journal_stats_t js;
+    journal_get_stats(&js);
+    journal_counters_t got, want = expected(js.last_seq);
+    journal_get_counters(&got);
+    if (js.last_seq < before->last_seq || js.last_seq >= next_seq) {
+        fprintf(stderr, "%s: recovered seq %lu, written %lu, appended %lu\n", when, (unsigned long)js.last_seq,
+                (unsigned long)before->last_seq, (unsigned long)(next_seq - 1));
+        failures++;
+    }
+    if (memcmp(&got, &want, sizeof(got)) != 0) {
+        fprintf(stderr, "%s: counters at seq %lu: %lu/%lu caught %lu/%lu spun %lu/%lu boots\n", when,
+                (unsigned long)js.last_seq, (unsigned long)got.caught, (unsigned long)want.caught,
+                (unsigned long)got.spun, (unsigned long)want.spun, (unsigned long)got.boots,
+                (unsigned long)want.boots);
+        failures++;
+    }
+    next_seq = js.last_seq + 1;
+    append(JOURNAL_EV_BOOT);
+    uint32_t n = 1 + burst();
+    journal_get_stats(&js);
+    if (js.last_seq != next_seq - 1) {
+        fprintf(stderr, "%s: seq %lu after %lu events, want %lu\n", when, (unsigned long)js.last_seq,
+                (unsigned long)n, (unsigned long)(next_seq - 1));
+        failures++;
+    }
+}
+
+int main(int argc, char **argv) {
+    uint32_t events = 50000;
+    int cuts = 200;
+    uint32_t per_day = 2000;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--events") == 0 && i + 1 < argc) {
+            events = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--cuts") == 0 && i + 1 < argc) {
+            cuts = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--per-day") == 0 && i + 1 < argc) {
+            per_day = (uint32_t)atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [--events N] [--cuts N] [--per-day N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    srand(24);
+    host_clock_set_manual(true);
+    host_flash_reset();
+    shadow_len = events + (uint32_t)cuts * (MAX_BURST + 2) * 80 + 16;
+    shadow = calloc(shadow_len, 1);
+    if (shadow == NULL) {
+        return 1;
+    }
+    next_seq = 1;
+
+    /* Throughput and wear from a clean partition. */
+    journal_stats_t js = { 0 };
+    boot(&js, "first boot");
+    host_flash_reset_stats();
+    uint32_t appended = 0;
+    while (appended < events) {
+        appended += burst();
+    }
+    host_flash_stats_t fs;
+    host_flash_get_stats("journal", &fs);
+    journal_get_stats(&js);
+    printf("append: %lu events in %lu batches, %lu dropped, queue max %lu, batch max %lu us\n",
+           (unsigned long)js.appended, (unsigned long)js.batches, (unsigned long)js.dropped,
+           (unsigned long)js.queue_max, (unsigned long)js.write_us_max);
+    printf("flash: %lu programs %llu bytes, %lu erases, next sector readied %lu times, busy %.2f s, "
+           "%.0f events/s\n",
+           (unsigned long)fs.writes, (unsigned long long)fs.write_bytes, (unsigned long)fs.erases,
+           (unsigned long)js.preerases, fs.busy_us / 1e6, fs.busy_us ? appended * 1e6 / fs.busy_us : 0.0);
+    uint32_t min_erases = UINT32_MAX;
+    for (uint32_t s = 0; s < fs.sectors; s++) {
+        if (fs.erases_per_sector[s] < min_erases) {
+            min_erases = fs.erases_per_sector[s];
+        }
+    }
+    double erases_per_day = fs.erases ? (double)per_day * fs.erases / appended / fs.sectors : 0.0;
+    printf("wear: %lu sectors, erases per sector %lu..%lu, %.1f events per erase; at %lu events/day "
+           "%.3f erases/sector/day, %.0f years to %.0f cycles\n", (unsigned long)fs.sectors,
+           (unsigned long)min_erases, (unsigned long)fs.max_sector_erases,
+           fs.erases ? (double)appended / fs.erases : 0.0, (unsigned long)per_day, erases_per_day,
+           erases_per_day > 0 ? FLASH_CYCLES / erases_per_day / 365.0 : 0.0, FLASH_CYCLES);
+
+    /* Power cuts at random programs and erases. */
+    uint32_t scan_us_max = 0, scan_reads_max = 0, torn = 0;
+    uint64_t scan_us_total = 0;
+    for (int c = 0; c < cuts; c++) {
+        host_flash_cut_after(1 + (uint32_t)(rand() % 40));
+        while (host_flash_powered()) {
+            burst();
+        }
+        journal_get_stats(&js);
+        host_flash_power_on();
+        char when[32];
+        snprintf(when, sizeof(when), "cut %d", c + 1);
+        boot(&js, when);
+        journal_stats_t after;
+        journal_get_stats(&after);
+        scan_us_total += after.scan_us;
+        torn += after.torn;
+        if (after.scan_us > scan_us_max) {
+            scan_us_max = after.scan_us;
+        }
+        if (after.scan_reads > scan_reads_max) {
+            scan_reads_max = after.scan_reads;
+        }
+    }
+    if (cuts > 0) {
+        host_flash_stats_t before_full, after_full;
+        host_flash_get_stats("journal", &before_full);
+        const esp_partition_t *p = esp_partition_find_first((esp_partition_type_t)0x40,
+                                                            ESP_PARTITION_SUBTYPE_ANY, "journal");
+        static uint8_t buf[512];
+        for (size_t off = 0; off < p->size; off += sizeof(buf)) {
+            esp_partition_read(p, off, buf, sizeof(buf));
+        }
+        host_flash_get_stats("journal", &after_full);
+        printf("recovery: %d power cuts, %lu torn records skipped over all boots, scan avg %llu us max %lu us "
+               "in %lu reads (reading all %lu KB: %llu us)\n", cuts, (unsigned long)torn,
+               (unsigned long long)(scan_us_total / (uint64_t)cuts), (unsigned long)scan_us_max,
+               (unsigned long)scan_reads_max, (unsigned long)(p->size / 1024),
+               (unsigned long long)(after_full.busy_us - before_full.busy_us));
+    }
+
+    free(shadow);
+    if (failures) {
+        fprintf(stderr, "journal_bench: %d check(s) failed\n", failures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,130 @@
+/* Simulated day of play against the persistence layer and the NVS wear
+ * model: three play sessions with catches and spins at app-like intervals,
+ * a disconnect after each. Reports the flash traffic the batching policy
+ * produces and what it means for the settings partition's erase budget.
+ * Pages are only erased once the partition has wrapped, so the wear rate is
+ * measured from the day that happened; a run too short to wrap reports a
+ * projection from the entry rate instead.
+ *
+ *   persist_bench                  # Kconfig defaults, one day
+ *   persist_bench --days 60        # long enough to wrap and measure wear
+ *   persist_bench --batch 1        # write on every change, for comparison */
+#include "persist.h"
+#include "host_sim.h"
+#include "esp_timer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SEC             1000000LL
+#define FLASH_CYCLES    100000.0
+#define PAGE_ENTRIES    126         /* 32-byte entries per 4 KB NVS page */
+
+typedef struct {
+    int start_h;
+    int hours;
+} session_t;
+
+static const session_t sessions[] = { { 8, 1 }, { 12, 1 }, { 18, 3 } };
+
+static uint32_t rand_between(uint32_t lo, uint32_t hi) {
+    return lo + (uint32_t)(rand() % (int)(hi - lo + 1));
+}
+
+static void advance(int64_t us) {
+    host_clock_advance_us(us);
+    persist_service();
+}
+
+int main(int argc, char **argv) {
+    persist_config_t cfg = PERSIST_CONFIG_DEFAULT();
+    int days = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+            cfg.batch_changes = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--period") == 0 && i + 1 < argc) {
+            cfg.period_ms = (uint32_t)atoi(argv[++i]) * 1000;
+        } else if (strcmp(argv[i], "--days") == 0 && i + 1 < argc) {
+            days = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [--batch N] [--period S] [--days N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    srand(9);
+    host_clock_set_manual(true);
+    if (persist_init(&cfg) != ESP_OK) {
+        return 1;
+    }
+
+    uint32_t caught = 0, spun = 0;
+    int wrap_day = -1;
+    host_nvs_stats_t ns;
+    int64_t day0 = esp_timer_get_time();
+    for (int d = 0; d < days; d++) {
+        for (size_t s = 0; s < sizeof(sessions) / sizeof(sessions[0]); s++) {
+            int64_t start = day0 + (d * 24LL + sessions[s].start_h) * 3600 * SEC;
+            int64_t end = start + sessions[s].hours * 3600LL * SEC;
+            if (start > esp_timer_get_time()) {
+                advance(start - esp_timer_get_time());
+            }
+            int64_t next_catch = start + rand_between(20, 90) * SEC;
+            int64_t next_spin = start + rand_between(60, 180) * SEC;
+            while (1) {
+                int64_t next = next_catch < next_spin ? next_catch : next_spin;
+                if (next >= end) {
+                    break;
+                }
+                advance(next - esp_timer_get_time());
+                if (next == next_catch) {
+                    caught++;
+                    next_catch += rand_between(20, 90) * SEC;
+                } else {
+                    spun++;
+                    next_spin += rand_between(60, 180) * SEC;
+                }
+                persist_set_counters(caught, spun);
+            }
+            advance(end - esp_timer_get_time());
+            persist_request_flush();    /* disconnect */
+            persist_service();
+        }
+        host_nvs_get_stats("settings", &ns);
+        if (wrap_day < 0 && ns.page_erases > 0) {
+            wrap_day = d;
+        }
+    }
+    advance(day0 + days * 24LL * 3600 * SEC - esp_timer_get_time());
+
+    persist_stats_t ps;
+    persist_get_stats(&ps);
+    host_nvs_get_stats("settings", &ns);
+
+    double payload = (double)ps.changes * 4;
+    printf("persist: batch %lu, period %lu s, %d day(s)\n", (unsigned long)cfg.batch_changes,
+           (unsigned long)(cfg.period_ms / 1000), days);
+    printf("  changes %lu -> %lu commits, %lu keys, commit avg %llu us max %lu us\n",
+           (unsigned long)ps.changes, (unsigned long)ps.commits, (unsigned long)ps.keys_written,
+           (unsigned long long)(ps.commits ? ps.commit_us_total / ps.commits : 0), (unsigned long)ps.commit_us_max);
+    printf("  nvs: %lu entries, %llu bytes, write amplification %.1fx\n", (unsigned long)ns.entry_writes,
+           (unsigned long long)ns.bytes_written, payload > 0 ? (double)ns.bytes_written / payload : 0.0);
+    if (wrap_day >= 0) {
+        double per_day_erases = (double)ns.max_page_erases / (days - wrap_day);
+        printf("  wear: wrapped on day %d, %lu page erases over %lu pages, worst page %lu "
+               "(%.2f/day since, ~%.0f years to %.0fk cycles)\n", wrap_day + 1, (unsigned long)ns.page_erases,
+               (unsigned long)ns.pages, (unsigned long)ns.max_page_erases, per_day_erases,
+               FLASH_CYCLES / per_day_erases / 365.0, FLASH_CYCLES / 1000);
+    } else {
+        /* Once wrapped, every PAGE_ENTRIES entries written cost one erase. */
+        double entries_per_day = (double)ns.entry_writes / days;
+        double wrap_days = entries_per_day > 0 ? (double)ns.pages * PAGE_ENTRIES / entries_per_day : 0;
+        double per_page_day = entries_per_day / PAGE_ENTRIES / ns.pages;
+        printf("  wear: not wrapped, projected: wraps after ~%.0f days, then %.2f erases/page/day if even "
+               "(~%.0f years to %.0fk cycles); use --days for the worst page\n", wrap_days, per_page_day,
+               per_page_day > 0 ? FLASH_CYCLES / per_page_day / 365.0 : 0, FLASH_CYCLES / 1000);
+    }
+    printf("  flash busy %llu ms\n", (unsigned long long)(ns.busy_us / 1000));
+    return 0;
+}
@@ -0,0 +1,220 @@
+/* Replays a PGP LED write trace through the protocol state machine on the
+ * virtual clock, the way pgpemu_task drives it on the device: sleep until the
+ * next LED write or press deadline, whichever is first.
+ *
+ * Reports the response latency from LED write to button press, how many
+ * presses landed inside the LED window the app gave us, the outcome counters
+ * and the host CPU time spent per LED write in the decoder. */
+#include "pgp_proto.h"
+#include "host_sim.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_PRESSES     4096
+
+typedef struct {
+    int64_t time_us;
+    enum { REC_CONNECT, REC_DISCONNECT, REC_LED } kind;
+    uint8_t data[PGP_LED_MAX_LEN];
+    size_t len;
+} trace_rec_t;
+
+static uint32_t latencies[MAX_PRESSES];
+static int presses_in_window, presses_late;
+
+static int64_t cpu_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static bool parse_line(char *line, trace_rec_t *rec) {
+    char *p = line;
+    while (*p == ' ' || *p == '\t') {
+        p++;
+    }
+    if (*p == '#' || *p == '\n' || *p == '\0') {
+        return false;
+    }
+    char *end;
+    long ms = strtol(p, &end, 10);
+    if (end == p) {
+        return false;
+    }
+    rec->time_us = (int64_t)ms * 1000;
+    p = end + strspn(end, " \t");
+    if (strncmp(p, "connect", 7) == 0) {
+        rec->kind = REC_CONNECT;
+    } else if (strncmp(p, "disconnect", 10) == 0) {
+        rec->kind = REC_DISCONNECT;
+    } else if (strncmp(p, "led", 3) == 0) {
+        rec->kind = REC_LED;
+        rec->len = 0;
+        p += 3;
+        while (rec->len < sizeof(rec->data)) {
+            unsigned long v = strtoul(p, &end, 16);
+            if (end == p) {
+                break;
+            }
+            rec->data[rec->len++] = (uint8_t)v;
+            p = end;
+        }
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/* Total time the encounter pattern stays lit, i.e. how long the app waits
+ * for a press before it gives up on this notification. */
+static int64_t led_window_us(const uint8_t *data, size_t len) {
+    pgp_led_t led;
+    int64_t total = 0;
+    if (!pgp_led_parse(data, len, &led)) {
+        return 0;
+    }
+    for (int i = 0; i < led.count; i++) {
+        total += (int64_t)led.patterns[i].duration * 50000;
+    }
+    return total;
+}
+
+static void run_until(pgp_conn_t *conn, int64_t target_us, int64_t window_end_us, int *npress) {
+    for (;;) {
+        int64_t deadline = pgp_conn_next_deadline(conn);
+        if (deadline == PGP_NO_DEADLINE || deadline > target_us) {
+            break;
+        }
+        if (deadline > esp_timer_get_time()) {
+            host_clock_advance_us(deadline - esp_timer_get_time());
+        }
+        int64_t now = esp_timer_get_time();
+        if (pgp_conn_poll(conn, now)) {
+            pgp_conn_press_sent(conn, now);
+            if (*npress < MAX_PRESSES) {
+                latencies[(*npress)++] = conn->stats.latency_us_last;
+            }
+            if (now <= window_end_us) {
+                presses_in_window++;
+            } else {
+                presses_late++;
+            }
+        }
+    }
+    if (target_us > esp_timer_get_time()) {
+        host_clock_advance_us(target_us - esp_timer_get_time());
+    }
+}
+
+static int cmp_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void usage(const char *argv0) {
+    fprintf(stderr, "usage: %s TRACE [--delay-ms N] [--max-p95-us N]\n", argv0);
+}
+
+int main(int argc, char **argv) {
+    const char *path = NULL;
+    uint32_t delay_ms = CONFIG_PGPEMU_PRESS_DELAY_MS;
+    long max_p95_us = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--delay-ms") == 0 && i + 1 < argc) {
+            delay_ms = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--max-p95-us") == 0 && i + 1 < argc) {
+            max_p95_us = atol(argv[++i]);
+        } else if (path == NULL && argv[i][0] != '-') {
+            path = argv[i];
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (path == NULL) {
+        usage(argv[0]);
+        return 2;
+    }
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        perror(path);
+        return 2;
+    }
+
+    host_clock_set_manual(true);
+    int64_t origin = esp_timer_get_time();
+    pgp_conn_t conn;
+    pgp_conn_init(&conn, delay_ms);
+
+    char line[1024];
+    trace_rec_t rec;
+    bool connected = false;
+    int npress = 0, led_writes = 0;
+    int64_t window_end = 0, decode_ns = 0;
+
+    while (fgets(line, sizeof(line), f)) {
+        if (!parse_line(line, &rec)) {
+            continue;
+        }
+        int64_t at = origin + rec.time_us;
+        if (connected) {
+            run_until(&conn, at, window_end, &npress);
+        } else if (at > esp_timer_get_time()) {
+            host_clock_advance_us(at - esp_timer_get_time());
+        }
+
+        switch (rec.kind) {
+            case REC_CONNECT:
+                connected = true;
+                break;
+            case REC_DISCONNECT:
+                connected = false;
+                break;
+            case REC_LED: {
+                pgp_state_t prev = conn.state;
+                int64_t t0 = cpu_ns();
+                pgp_conn_on_led(&conn, rec.data, rec.len, esp_timer_get_time());
+                decode_ns += cpu_ns() - t0;
+                led_writes++;
+                if (prev != PGP_ST_PRESS_PENDING && conn.state == PGP_ST_PRESS_PENDING) {
+                    window_end = esp_timer_get_time() + led_window_us(rec.data, rec.len);
+                }
+                break;
+            }
+        }
+    }
+    fclose(f);
+
+    if (npress == 0) {
+        fprintf(stderr, "%s: no presses\n", path);
+        return 1;
+    }
+    qsort(latencies, (size_t)npress, sizeof(latencies[0]), cmp_u32);
+    uint32_t p50 = latencies[npress / 2];
+    uint32_t p95 = latencies[npress * 95 / 100];
+
+    printf("pgp replay: %d LED writes, %d presses (delay %lu ms)\n", led_writes, npress, (unsigned long)delay_ms);
+    printf("  latency: p50 %lu us, p95 %lu us, max %lu us\n", (unsigned long)p50, (unsigned long)p95,
+           (unsigned long)latencies[npress - 1]);
+    printf("  window:  %d in time, %d late\n", presses_in_window, presses_late);
+    printf("  result:  %lu caught, %lu fled, %lu spun, %lu failed, %lu ignored\n",
+           (unsigned long)conn.stats.caught, (unsigned long)conn.stats.fled, (unsigned long)conn.stats.spun,
+           (unsigned long)conn.stats.failed, (unsigned long)conn.stats.ignored);
+    printf("  decode:  %.0f ns per LED write\n", (double)decode_ns / led_writes);
+
+    int rc = 0;
+    if (presses_late) {
+        fprintf(stderr, "%d press(es) landed after the LED window\n", presses_late);
+        rc = 1;
+    }
+    if (max_p95_us > 0 && (long)p95 > max_p95_us) {
+        fprintf(stderr, "p95 latency %lu us exceeds %ld us\n", (unsigned long)p95, max_p95_us);
+        rc = 1;
+    }
+    return rc;
+}
@@ -0,0 +1,421 @@
+/* The portal handlers behind a plain POSIX HTTP/1.1 server on a local
+ * socket. Like the httpd task on the device it serves one connection at a
+ * time from one static response buffer and hands the metrics stream to a
+ * second thread, so what it measures is the handlers and their buffer
+ * discipline, not the socket layer.
+ *
+ *   portal_bench                       # built-in load: 4 clients, 2000 requests
+ *   portal_bench --clients 8 --requests 20000
+ *   portal_bench --serve 8080          # stay up for curl, ab or wrk */
+#define _GNU_SOURCE
+#include "portal.h"
+#include "persist.h"
+#include "pgp_link.h"
+#include "stats_history.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define REQ_HEAD_MAX    1024
+#define MAX_CLIENTS     32
+#define STREAM_EVENTS   5
+
+static char req_buf[REQ_HEAD_MAX + PORTAL_BODY_MAX];
+static char resp_buf[PORTAL_RESP_MAX];
+static char event_buf[PORTAL_EVENT_MAX];
+static uint32_t stream_ms = 50;
+static atomic_bool streaming;
+static int stream_fd = -1;
+static pthread_mutex_t stream_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t stream_cond = PTHREAD_COND_INITIALIZER;
+
+/* Two phones' worth of link state for the stats and metrics pages. */
+static pgp_links_t links;
+
+static void fake_pgp_stats(pgp_stats_t *out) {
+    memset(out, 0, sizeof(*out));
+    for (int i = 0; i < PGP_LINK_MAX; i++) {
+        const pgp_stats_t *s = &links.link[i].conn.stats;
+        out->presses += s->presses;
+        out->caught += s->caught;
+        out->latency_us_total += s->latency_us_total;
+        if (s->latency_us_max > out->latency_us_max) {
+            out->latency_us_max = s->latency_us_max;
+        }
+    }
+}
+
+static uint8_t fake_accounts(pgp_account_t *out, uint8_t max) {
+    return pgp_links_snapshot(&links, out, max);
+}
+
+static void setup_links(void) {
+    static const uint8_t led_pokemon[] = { 0, 0, 0, 0x02, 0x05, 0xf0, 0x80, 0x05, 0x00, 0x80 };
+    static const uint8_t led_success[] = { 0, 0, 0, 0x03, 0x03, 0x0f, 0x80, 0x03, 0xf0, 0x80, 0x03, 0x00, 0x8f };
+    pgp_links_init(&links, CONFIG_PGPEMU_PRESS_DELAY_MS, 20000);
+    for (uint8_t id = 1; id <= 2 && id <= PGP_LINK_MAX; id++) {
+        uint8_t addr[PGP_LINK_ADDR_LEN] = { 0xC0, 0, 0, 0, 0, id };
+        int slot = pgp_links_connect(&links, id, addr, 0);
+        int64_t t = 1000000 * id;
+        pgp_links_on_led(&links, slot, led_pokemon, sizeof(led_pokemon), t);
+        t += CONFIG_PGPEMU_PRESS_DELAY_MS * 1000 + 400 * id;
+        pgp_links_press_sent(&links, slot, t);
+        pgp_links_on_led(&links, slot, led_success, sizeof(led_success), t + 1500000);
+    }
+}
+
+static bool write_all(int fd, const char *p, size_t n) {
+    while (n > 0) {
+        ssize_t w = send(fd, p, n, MSG_NOSIGNAL);
+        if (w <= 0) {
+            return false;
+        }
+        p += w;
+        n -= (size_t)w;
+    }
+    return true;
+}
+
+static void send_response(int fd, uint16_t status, const char *type, const char *body, size_t len) {
+    char head[256];
+    int n = snprintf(head, sizeof(head),
+                     "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\n"
+                     "Cache-Control: no-store\r\nConnection: close\r\n\r\n",
+                     portal_status_line(status), type, len);
+    if (write_all(fd, head, (size_t)n)) {
+        write_all(fd, body, len);
+    }
+}
+
+/* The stream thread: one client at a time, chunked server-sent events
+ * until the client goes away. */
+static void *stream_thread(void *arg) {
+    while (1) {
+        pthread_mutex_lock(&stream_lock);
+        while (stream_fd < 0) {
+            pthread_cond_wait(&stream_cond, &stream_lock);
+        }
+        int fd = stream_fd;
+        pthread_mutex_unlock(&stream_lock);
+
+        static const char head[] = "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\n"
+                                   "Cache-Control: no-store\r\nTransfer-Encoding: chunked\r\n\r\n";
+        bool ok = write_all(fd, head, sizeof(head) - 1);
+        while (ok) {
+            size_t n = portal_metrics_event(event_buf, sizeof(event_buf));
+            char size[16];
+            int sn = snprintf(size, sizeof(size), "%zx\r\n", n);
+            ok = n > 0 && write_all(fd, size, (size_t)sn) && write_all(fd, event_buf, n) && write_all(fd, "\r\n", 2);
+            usleep(stream_ms * 1000);
+        }
+        close(fd);
+        pthread_mutex_lock(&stream_lock);
+        stream_fd = -1;
+        pthread_mutex_unlock(&stream_lock);
+        atomic_store(&streaming, false);
+    }
+    return NULL;
+}
+
+/* Reads one request: headers, then a body of Content-Length bytes when it
+ * fits. Returns the body length announced, or -1. */
+static long read_request(int fd, char **body) {
+    size_t got = 0;
+    char *end = NULL;
+    while (end == NULL) {
+        if (got == REQ_HEAD_MAX) {
+            return -1;
+        }
+        ssize_t r = recv(fd, req_buf + got, REQ_HEAD_MAX - got, 0);
+        if (r <= 0) {
+            return -1;
+        }
+        got += (size_t)r;
+        req_buf[got] = '\0';
+        end = strstr(req_buf, "\r\n\r\n");
+    }
+    *end = '\0';
+    long len = 0;
+    const char *cl = strcasestr(req_buf, "\r\ncontent-length:");
+    if (cl) {
+        len = strtol(cl + 17, NULL, 10);
+    }
+    *body = end + 4;
+    size_t have = got - (size_t)(*body - req_buf);
+    if (len < 0 || len > PORTAL_BODY_MAX) {
+        return len < 0 ? -1 : len;
+    }
+    while (have < (size_t)len) {
+        ssize_t r = recv(fd, *body + have, (size_t)len - have, 0);
+        if (r <= 0) {
+            return -1;
+        }
+        have += (size_t)r;
+    }
+    return len;
+}
+
+static void serve_one(int fd) {
+    char *body = NULL;
+    long len = read_request(fd, &body);
+    if (len < 0) {
+        close(fd);
+        return;
+    }
+    char *sp1 = strchr(req_buf, ' ');
+    char *sp2 = sp1 ? strchr(sp1 + 1, ' ') : NULL;
+    if (sp2 == NULL) {
+        close(fd);
+        return;
+    }
+    *sp1 = *sp2 = '\0';
+    portal_method_t method = strcmp(req_buf, "GET") == 0 ? PORTAL_GET
+                           : strcmp(req_buf, "POST") == 0 ? PORTAL_POST : PORTAL_OTHER;
+    portal_resp_t resp;
+    portal_handle(method, sp1 + 1, len <= PORTAL_BODY_MAX ? body : NULL, (size_t)len, resp_buf, sizeof(resp_buf),
+                  &resp);
+    if (resp.stream) {
+        if (atomic_exchange(&streaming, true)) {
+            static const char busy[] = "{\"error\":\"stream busy\"}";
+            send_response(fd, 503, "application/json", busy, sizeof(busy) - 1);
+            close(fd);
+            return;
+        }
+        pthread_mutex_lock(&stream_lock);
+        stream_fd = fd;
+        pthread_cond_signal(&stream_cond);
+        pthread_mutex_unlock(&stream_lock);
+        return;
+    }
+    send_response(fd, resp.status, resp.type, resp.body, resp.len);
+    shutdown(fd, SHUT_WR);
+    close(fd);
+}
+
+static void *server_thread(void *arg) {
+    int lfd = *(int *)arg;
+    while (1) {
+        int fd = accept(lfd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        serve_one(fd);
+    }
+    return NULL;
+}
+
+static int listen_on(uint16_t port, uint16_t *bound) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in sa = { .sin_family = AF_INET, .sin_port = htons(port) };
+    sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t sl = sizeof(sa);
+    if (bind(fd, (struct sockaddr *)&sa, sl) != 0 || listen(fd, 64) != 0 ||
+        getsockname(fd, (struct sockaddr *)&sa, &sl) != 0) {
+        perror("listen");
+        return -1;
+    }
+    *bound = ntohs(sa.sin_port);
+    return fd;
+}
+
+/* The load side. Each client thread opens a connection per request, like
+ * a browser polling the page, and records the round trip. */
+typedef struct {
+    uint16_t port;
+    int requests;
+    int seed;
+    uint32_t *lat_us;
+    int done;
+    int failed;
+    size_t bytes_max;
+} client_t;
+
+static int connect_to(uint16_t port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in sa = { .sin_family = AF_INET, .sin_port = htons(port) };
+    sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, (struct sockaddr *)&sa, sizeof(sa)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* Sends one request and reads the reply to EOF. Returns the status code. */
+static int round_trip(uint16_t port, const char *req, char *reply, size_t cap, size_t *len) {
+    int fd = connect_to(port);
+    if (fd < 0 || !write_all(fd, req, strlen(req))) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    size_t got = 0;
+    ssize_t r;
+    while (got + 1 < cap && (r = recv(fd, reply + got, cap - 1 - got, 0)) > 0) {
+        got += (size_t)r;
+    }
+    close(fd);
+    reply[got] = '\0';
+    *len = got;
+    int status = -1;
+    sscanf(reply, "HTTP/1.1 %d", &status);
+    return status;
+}
+
+static void *client_thread(void *arg) {
+    client_t *c = arg;
+    char req[512], reply[PORTAL_RESP_MAX + 512];
+    unsigned seed = (unsigned)c->seed;
+    for (int i = 0; i < c->requests; i++) {
+        int pick = rand_r(&seed) % 10;
+        if (pick < 4) {
+            snprintf(req, sizeof(req), "GET /api/metrics HTTP/1.1\r\nHost: x\r\n\r\n");
+        } else if (pick < 7) {
+            snprintf(req, sizeof(req), "GET /api/stats HTTP/1.1\r\nHost: x\r\n\r\n");
+        } else if (pick < 9) {
+            snprintf(req, sizeof(req), "GET /api/settings HTTP/1.1\r\nHost: x\r\n\r\n");
+        } else {
+            char form[64];
+            int n = snprintf(form, sizeof(form), "autocatch=%d&dim_s=%d&off_s=120", i & 1, 10 + i % 50);
+            snprintf(req, sizeof(req), "POST /api/settings HTTP/1.1\r\nHost: x\r\nContent-Length: %d\r\n"
+                     "Content-Type: application/x-www-form-urlencoded\r\n\r\n%s", n, form);
+        }
+        size_t len = 0;
+        int64_t t0 = esp_timer_get_time();
+        int status = round_trip(c->port, req, reply, sizeof(reply), &len);
+        c->lat_us[c->done++] = (uint32_t)(esp_timer_get_time() - t0);
+        c->failed += status != 200;
+        if (len > c->bytes_max) {
+            c->bytes_max = len;
+        }
+    }
+    return NULL;
+}
+
+/* Reads STREAM_EVENTS events off the metrics stream, then hangs up. */
+static int read_stream(uint16_t port) {
+    int fd = connect_to(port);
+    const char *req = "GET /api/metrics/stream HTTP/1.1\r\nHost: x\r\n\r\n";
+    if (fd < 0 || !write_all(fd, req, strlen(req))) {
+        return 0;
+    }
+    char buf[STREAM_EVENTS * PORTAL_EVENT_MAX + 512];
+    int events = 0;
+    size_t got = 0, scan = 0;
+    while (events < STREAM_EVENTS && got + 1 < sizeof(buf)) {
+        ssize_t r = recv(fd, buf + got, sizeof(buf) - 1 - got, 0);
+        if (r <= 0) {
+            break;
+        }
+        got += (size_t)r;
+        buf[got] = '\0';
+        char *p;
+        while ((p = strstr(buf + scan, "\n\n")) != NULL) {
+            events++;
+            scan = (size_t)(p + 2 - buf);
+        }
+    }
+    close(fd);
+    return events;
+}
+
+static int cmp_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+int main(int argc, char **argv) {
+    int serve_port = -1, clients = 4, requests = 2000;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--serve") == 0 && i + 1 < argc) {
+            serve_port = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--clients") == 0 && i + 1 < argc) {
+            clients = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--requests") == 0 && i + 1 < argc) {
+            requests = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [--serve PORT] [--clients N] [--requests N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (clients < 1 || clients > MAX_CLIENTS || requests < clients) {
+        fprintf(stderr, "need 1..%d clients and at least one request each\n", MAX_CLIENTS);
+        return 2;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    persist_config_t pcfg = PERSIST_CONFIG_DEFAULT();
+    if (persist_init(&pcfg) != ESP_OK) {
+        return 1;
+    }
+    stats_history_init(esp_timer_get_time());
+    setup_links();
+    portal_set_pgp_cbs(fake_pgp_stats, fake_accounts);
+
+    uint16_t port = 0;
+    int lfd = listen_on(serve_port > 0 ? (uint16_t)serve_port : 0, &port);
+    if (lfd < 0) {
+        return 1;
+    }
+    pthread_t server, streamer;
+    pthread_create(&streamer, NULL, stream_thread, NULL);
+    if (serve_port > 0) {
+        stream_ms = CONFIG_PGPEMU_PORTAL_STREAM_MS;
+        printf("portal on http://127.0.0.1:%u/\n", port);
+        fflush(stdout);
+        server_thread(&lfd);
+        return 0;
+    }
+    esp_log_level_set("*", ESP_LOG_WARN);
+    pthread_create(&server, NULL, server_thread, &lfd);
+
+    client_t c[MAX_CLIENTS];
+    pthread_t t[MAX_CLIENTS];
+    uint32_t *lat = calloc((size_t)requests, sizeof(uint32_t));
+    int per = requests / clients;
+    int64_t t0 = esp_timer_get_time();
+    for (int i = 0; i < clients; i++) {
+        c[i] = (client_t){ .port = port, .requests = per, .seed = i + 1, .lat_us = lat + i * per };
+        pthread_create(&t[i], NULL, client_thread, &c[i]);
+    }
+    int events = read_stream(port);
+    int done = 0, failed = 0;
+    size_t bytes_max = 0;
+    for (int i = 0; i < clients; i++) {
+        pthread_join(t[i], NULL);
+        done += c[i].done;
+        failed += c[i].failed;
+        bytes_max = c[i].bytes_max > bytes_max ? c[i].bytes_max : bytes_max;
+    }
+    int64_t elapsed = esp_timer_get_time() - t0;
+
+    qsort(lat, (size_t)done, sizeof(uint32_t), cmp_u32);
+    portal_stats_t ps;
+    portal_get_stats(&ps);
+    printf("portal: %d clients, %d requests in %lld ms, %lld req/s, %d failed\n", clients, done,
+           (long long)(elapsed / 1000), (long long)done * 1000000 / (elapsed ? elapsed : 1), failed);
+    printf("latency: p50 %lu us, p99 %lu us, max %lu us\n", (unsigned long)lat[done / 2],
+           (unsigned long)lat[done * 99 / 100], (unsigned long)lat[done - 1]);
+    printf("handlers: build max %lu us, largest body %lu of %u bytes (reply %zu), %lu overflows, "
+           "%lu settings writes, %d/%d stream events\n", (unsigned long)ps.build_us_max,
+           (unsigned long)ps.resp_bytes_max, PORTAL_RESP_MAX, bytes_max, (unsigned long)ps.overflows,
+           (unsigned long)ps.settings_writes, events, STREAM_EVENTS);
+    free(lat);
+    return failed || ps.overflows || events < STREAM_EVENTS ? 1 : 0;
+}
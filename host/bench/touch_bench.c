@@ -0,0 +1,145 @@
+/* Touch input benchmark against the simulated CST816.
+ *
+ * Measures how many I2C reads an idle screen costs, and for a burst of
+ * simulated taps and drags the latency from the INT edge to the sample being
+ * handed to LVGL, plus heap allocations per touch report. A run of swipes
+ * then measures finger-up to transition start and the SPI bytes one wipe
+ * costs, half of them tagged by the controller's gesture register and half
+ * left to the software recognizer. */
+#include "display_port.h"
+#include "display_ui.h"
+#include "lvgl_sched.h"
+#include "cst816_touch.h"
+#include "cst816_sim.h"
+#include "lcd_flush.h"
+#include "host_sim.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SIM_INT_GPIO    0
+
+static void bench_events(uint32_t events) {
+    if (events & LVGL_SCHED_EVT_TOUCH) {
+        display_port_touch_event();
+    }
+    if (events & LVGL_SCHED_EVT_UI) {
+        ui_apply_pending();
+    }
+}
+
+static void report(uint16_t x, uint16_t y, bool release) {
+    if (release) {
+        cst816_sim_release();
+    } else {
+        cst816_sim_press(x, y);
+    }
+    lvgl_sched_step(LVGL_SCHED_EVT_TOUCH);
+}
+
+/* Runs on the real clock: the latency being measured is host CPU time
+ * spent between the lift report and the wipe starting. */
+static int run_swipes(int swipes) {
+    lcd_flush_reset_stats();
+    int misrouted = 0;
+    for (int n = 0; n < swipes; n++) {
+        bool left = (n & 1) == 0;
+        uint16_t x = left ? 200 : 60;
+        for (int i = 0; i < 5; i++) {
+            report((uint16_t)(left ? x - i * 35 : x + i * 35), 120, false);
+        }
+        if (n & 2) {
+            cst816_sim_gesture(left ? GESTURE_SWIPE_LEFT : GESTURE_SWIPE_RIGHT);
+        }
+        report(0, 0, true);
+        int64_t end = esp_timer_get_time() + (CONFIG_PGPEMU_UI_WIPE_MS + 50) * 1000;
+        while (esp_timer_get_time() < end) {
+            lvgl_sched_step(0);
+        }
+        if (ui_get_screen() != (left ? UI_SCREEN_SETTINGS : UI_SCREEN_MAIN)) {
+            misrouted++;
+        }
+    }
+
+    ui_nav_stats_t nav;
+    swipe_stats_t sw;
+    lcd_flush_stats_t fs;
+    ui_get_nav_stats(&nav);
+    swipe_get_stats(&sw);
+    lcd_flush_get_stats(&fs);
+    uint32_t frame_bytes = LCD_H_RES * LCD_V_RES * 2;
+    printf("%d swipes: %lu by gesture register, %lu by recognizer, %d misrouted\n", swipes,
+           (unsigned long)sw.hw, (unsigned long)sw.sw, misrouted);
+    printf("lift->transition: last %lu us, max %lu us (target %d ms, %lu over)\n",
+           (unsigned long)nav.latency_us_last, (unsigned long)nav.latency_us_max, CONFIG_PGPEMU_SWIPE_LATENCY_MS,
+           (unsigned long)nav.over_target);
+    printf("wipe: %llu bytes/transition in %.1f flushes (%.2f full frames)\n",
+           (unsigned long long)(swipes ? fs.bytes / swipes : 0), swipes ? (double)fs.flushes / swipes : 0.0,
+           swipes ? (double)fs.bytes / swipes / frame_bytes : 0.0);
+    return misrouted == 0 && nav.over_target == 0 ? 0 : 1;
+}
+
+int main(int argc, char **argv) {
+    int gestures = 200;
+    int swipes = 20;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--gestures") == 0 && i + 1 < argc) {
+            gestures = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--swipes") == 0 && i + 1 < argc) {
+            swipes = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [--gestures N] [--swipes N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    cst816_sim_attach(SIM_INT_GPIO);
+    display_port_init();
+    display_port_init_touch();
+    ui_init();
+    lvgl_sched_set_event_cb(bench_events);
+    lvgl_sched_step(LVGL_SCHED_EVT_UI);
+
+    host_clock_set_manual(true);
+    lvgl_sched_stats_t st0, st1;
+    lvgl_sched_get_stats(&st0);
+    uint32_t reads0 = cst816_sim_reads();
+    int64_t end = esp_timer_get_time() + 10 * 1000000;
+    while (esp_timer_get_time() < end) {
+        host_clock_advance_us((int64_t)lvgl_sched_step(0) * 1000);
+    }
+    lvgl_sched_get_stats(&st1);
+    printf("idle 10 s: %lu I2C touch reads, %lu scheduler wakeups\n",
+           (unsigned long)(cst816_sim_reads() - reads0), (unsigned long)(st1.wakeups - st0.wakeups));
+    host_clock_set_manual(false);
+
+    cst816_stats_t before, after;
+    cst816_get_stats(&before);
+    uint32_t allocs0 = host_heap_alloc_count();
+    for (int g = 0; g < gestures; g++) {
+        uint16_t x = (uint16_t)(40 + (g * 37) % 160);
+        uint16_t y = (uint16_t)(40 + (g * 53) % 160);
+        report(x, y, false);
+        for (int i = 1; i <= 4; i++) {
+            report((uint16_t)(x + i * 3), y, false);
+        }
+        report(0, 0, true);
+    }
+    cst816_get_stats(&after);
+    uint32_t samples = after.samples - before.samples;
+    uint32_t allocs = host_heap_alloc_count() - allocs0;
+
+    printf("%d gestures, %lu reports: %.2f heap allocs/report (%lu total incl. LVGL)\n", gestures,
+           (unsigned long)samples, samples ? (double)allocs / samples : 0.0, (unsigned long)allocs);
+    printf("INT->LVGL latency: avg %.1f us, max %lu us; dropped %lu, read errors %lu\n",
+           samples ? (double)(after.latency_us_total - before.latency_us_total) / samples : 0.0,
+           (unsigned long)after.latency_us_max, (unsigned long)(after.dropped - before.dropped),
+           (unsigned long)(after.read_errors - before.read_errors));
+
+    display_port_set_swipe_cb(ui_navigate);
+    ui_switch_screen(UI_SCREEN_MAIN);
+    int rc = run_swipes(swipes);
+    return after.dropped == before.dropped ? rc : 1;
+}
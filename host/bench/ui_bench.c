@@ -0,0 +1,359 @@
+/* Frame-time benchmark for the LVGL path on the host framebuffer backend.
+ *
+ * Drives the public ui_* entry points the firmware tasks use, forces one
+ * refresh per step and reports render time, the area LVGL redrew and the
+ * bytes that would have gone over SPI to the GC9A01. --buf picks the LVGL
+ * draw buffer strategy for the run, so the same scenarios can be compared
+ * across them; --no-round-clip sends the invisible corners of the round
+ * panel too, for comparison with the clipped flush. --no-assets builds the
+ * ring and counter digits in the heap at boot instead of drawing them from
+ * the converted images in flash, as before the asset step. */
+#include "display_port.h"
+#include "display_ui.h"
+#include "lvgl_sched.h"
+#include "lcd_flush.h"
+#include "trace.h"
+#include "stats_history.h"
+#include "ui_cache.h"
+#include "ui_assets.h"
+#include "ui_anim.h"
+#include "host_sim.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SPI_CLOCK_HZ    40000000ULL
+#define WIPE_FRAME_MS   30
+#define WIPE_PERIOD     8
+#define ANIM_PERIOD     20
+
+typedef struct {
+    int64_t render_us;
+    uint32_t inv_px;
+    uint32_t flush_calls;
+    uint64_t flush_bytes;
+} frame_sample_t;
+
+typedef struct {
+    const char *name;
+    void (*step)(int i);
+    ui_render_mode_t mode;
+} scenario_t;
+
+static uint32_t monitor_px;
+static FILE *csv;
+
+static void bench_monitor_cb(lv_disp_drv_t *drv, uint32_t time, uint32_t px) {
+    (void)drv;
+    (void)time;
+    monitor_px += px;
+}
+
+static void step_stats(int i) {
+    ui_update_stats(UI_SRC_PGPEMU, (uint32_t)i, (uint32_t)i / 3);
+    ui_update_battery(UI_SRC_BATTERY, (uint8_t)(100 - (i / 50) % 100));
+}
+
+static void step_status(int i) {
+    ui_update_status(UI_SRC_BUTTON, i & 1, false, false);
+}
+
+static void step_switch(int i) {
+    static const ui_screen_t order[] = { UI_SCREEN_SETTINGS, UI_SCREEN_STATS, UI_SCREEN_MAIN };
+    ui_switch_screen(order[i % 3]);
+}
+
+/* One catch as pgpemu_task reports it: the animation flag and the counters
+ * change together, so the count label, battery label and highlight are all
+ * dirty in the same frame. */
+static void step_catch(int i) {
+    ui_update_stats(UI_SRC_PGPEMU, (uint32_t)i, (uint32_t)i / 3);
+    ui_update_battery(UI_SRC_BATTERY, (uint8_t)(95 - i % 2));
+    ui_show_catch_animation(UI_SRC_PGPEMU, i & 1);
+}
+
+/* A catch landing on the open stats screen, 20 s of virtual time apart, so
+ * the bar for the current minute grows and every third frame starts a new
+ * bucket. Only that bar, the "now" marker and the total labels should be
+ * redrawn. */
+static void step_history(int i) {
+    if (ui_get_screen() != UI_SCREEN_STATS) {
+        ui_switch_screen(UI_SCREEN_STATS);
+    }
+    stats_history_record(STATS_EV_CAUGHT, esp_timer_get_time() + (int64_t)i * 20000000);
+    ui_notify_history(UI_SRC_PGPEMU);
+}
+
+/* The -direct rows repeat the counter scenarios with the arc and labels
+ * drawn by LVGL every frame, as the "before" figure for the cached layer. */
+/* A swipe every WIPE_PERIOD frames, alternating direction, with the
+ * animation clock stepped one display refresh per frame so each sample is
+ * one band of the wipe. Every band is a tall narrow window, which is where
+ * the buffer strategies differ most. */
+static void step_wipe(int i) {
+    if (i % WIPE_PERIOD == 1) {
+        ui_navigate((i / WIPE_PERIOD) & 1 ? SWIPE_RIGHT : SWIPE_LEFT, esp_timer_get_time());
+    }
+    lv_tick_inc(WIPE_FRAME_MS);
+    lv_anim_refr_now();
+}
+
+/* Catch, flee and spin events ANIM_PERIOD frames apart on the animation
+ * clock. The catch runs longer than the gap, so every third event also
+ * cancels the one before it. */
+static void step_anim(int i) {
+    if (i % ANIM_PERIOD == 1) {
+        switch ((i / ANIM_PERIOD) % 3) {
+            case 0:
+                ui_show_catch_animation(UI_SRC_PGPEMU, true);
+                break;
+            case 1:
+                ui_show_catch_animation(UI_SRC_PGPEMU, false);
+                break;
+            default:
+                ui_show_spin_animation(UI_SRC_PGPEMU);
+                break;
+        }
+    }
+    lv_tick_inc(WIPE_FRAME_MS);
+    lv_anim_refr_now();
+}
+
+static const scenario_t scenarios[] = {
+    { "stats-direct", step_stats, UI_RENDER_DIRECT },
+    { "catch-direct", step_catch, UI_RENDER_DIRECT },
+    { "stats", step_stats, UI_RENDER_CACHED },
+    { "catch", step_catch, UI_RENDER_CACHED },
+    { "status", step_status, UI_RENDER_CACHED },
+    { "switch", step_switch, UI_RENDER_CACHED },
+    { "history", step_history, UI_RENDER_CACHED },
+    { "wipe", step_wipe, UI_RENDER_CACHED },
+    { "anim", step_anim, UI_RENDER_CACHED },
+};
+
+static frame_sample_t run_frame(const scenario_t *sc, int i) {
+    frame_sample_t s = { 0 };
+    host_lcd_stats_t before, after;
+
+    sc->step(i);
+    ui_apply_pending();
+    host_lcd_get_stats(&before);
+    monitor_px = 0;
+    int64_t t0 = esp_timer_get_time();
+    lcd_flush_refresh_now();
+    s.render_us = esp_timer_get_time() - t0;
+    host_lcd_get_stats(&after);
+
+    s.inv_px = monitor_px;
+    s.flush_calls = after.draw_calls - before.draw_calls;
+    s.flush_bytes = after.bytes - before.bytes;
+    return s;
+}
+
+static int cmp_i64(const void *a, const void *b) {
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static int64_t run_scenario(const scenario_t *sc, int frames) {
+    int64_t *times = calloc((size_t)frames, sizeof(*times));
+    uint64_t inv_total = 0, bytes_total = 0, calls_total = 0;
+    int64_t render_total = 0;
+
+    ui_set_render_mode(sc->mode);
+    ui_switch_screen(UI_SCREEN_MAIN);
+    lv_refr_now(NULL);
+    lcd_flush_reset_stats();
+    ui_anim_reset_stats();
+
+    for (int i = 0; i < frames; i++) {
+        frame_sample_t s = run_frame(sc, i + 1);
+        times[i] = s.render_us;
+        render_total += s.render_us;
+        inv_total += s.inv_px;
+        bytes_total += s.flush_bytes;
+        calls_total += s.flush_calls;
+        if (csv) {
+            fprintf(csv, "%s,%d,%lld,%u,%u,%llu\n", sc->name, i, (long long)s.render_us,
+                    (unsigned)s.inv_px, (unsigned)s.flush_calls, (unsigned long long)s.flush_bytes);
+        }
+    }
+
+    qsort(times, (size_t)frames, sizeof(*times), cmp_i64);
+    int64_t avg = render_total / frames;
+    double spi_us = (double)bytes_total * 8.0 * 1e6 / (double)SPI_CLOCK_HZ / frames;
+    printf("%-12s %6d %9lld %9lld %9lld %10llu %8.1f %11llu %9.0f\n", sc->name, frames,
+           (long long)avg, (long long)times[frames * 95 / 100], (long long)times[frames - 1],
+           (unsigned long long)(inv_total / frames), (double)calls_total / frames,
+           (unsigned long long)(bytes_total / frames), spi_us);
+
+    lcd_flush_stats_t fs;
+    lcd_flush_get_stats(&fs);
+    if (fs.flushes) {
+        printf("%-12s flush: %llu px/flush, swap %llu us/frame (%lu overlapped), %lu areas merged\n", "",
+               (unsigned long long)(fs.pixels / fs.flushes), (unsigned long long)(fs.swap_us / frames),
+               (unsigned long)fs.swaps_overlapped, (unsigned long)fs.areas_merged);
+        printf("%-12s round clip: %llu bytes/frame not sent, %.1f windows/frame\n", "",
+               (unsigned long long)(fs.clipped_px * sizeof(lv_color_t) / frames), (double)fs.windows / frames);
+    }
+    ui_anim_stats_t as;
+    ui_anim_get_stats(&as);
+    if (as.started) {
+        printf("%-12s anim: %lu started, %lu completed, %lu cancelled, %lu frames (%lu capped, %lu late), "
+               "%lu fps last, max gap %lu ms\n", "", (unsigned long)as.started, (unsigned long)as.completed,
+               (unsigned long)as.cancelled, (unsigned long)as.frames, (unsigned long)as.frames_capped,
+               (unsigned long)as.late_frames, (unsigned long)as.fps_last, (unsigned long)as.gap_ms_max);
+    }
+    free(times);
+    return avg;
+}
+
+/* Lets the scheduler run a static screen for a stretch of virtual time and
+ * reports how often it woke up, which is the idle duty-cycle figure. */
+static void run_idle(int seconds) {
+    lvgl_sched_stats_t st;
+    host_clock_set_manual(true);
+    lvgl_sched_get_stats(&st);
+    uint32_t start_wakeups = st.wakeups;
+    int64_t end = esp_timer_get_time() + (int64_t)seconds * 1000000;
+    while (esp_timer_get_time() < end) {
+        uint32_t sleep_ms = lvgl_sched_step(0);
+        host_clock_advance_us((int64_t)sleep_ms * 1000);
+    }
+    lvgl_sched_get_stats(&st);
+    host_clock_set_manual(false);
+    printf("idle: %d s static screen, %lu wakeups (%.1f/s), last sleep %lu ms\n", seconds,
+           (unsigned long)(st.wakeups - start_wakeups), (double)(st.wakeups - start_wakeups) / seconds,
+           (unsigned long)st.last_sleep_ms);
+}
+
+static void usage(const char *argv0) {
+    fprintf(stderr, "usage: %s [--frames N] [--buf full|double|single] [--lines N] [--csv FILE] [--ppm FILE]\n"
+                    "          [--no-round-clip] [--no-assets] [--trace FILE] [--max-avg-us N]\n", argv0);
+}
+
+int main(int argc, char **argv) {
+    int frames = 100;
+    long max_avg_us = 0;
+    const char *ppm_path = NULL;
+    const char *trace_path = NULL;
+    display_buf_mode_t buf_mode = display_port_get_buf_mode();
+    int buf_lines = CONFIG_PGPEMU_DRAW_BUF_LINES;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frames = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--buf") == 0 && i + 1 < argc) {
+            const char *m = argv[++i];
+            if (strcmp(m, "full") == 0) {
+                buf_mode = DISPLAY_BUF_FULL;
+            } else if (strcmp(m, "double") == 0) {
+                buf_mode = DISPLAY_BUF_DOUBLE;
+            } else if (strcmp(m, "single") == 0) {
+                buf_mode = DISPLAY_BUF_SINGLE;
+            } else {
+                usage(argv[0]);
+                return 2;
+            }
+        } else if (strcmp(argv[i], "--lines") == 0 && i + 1 < argc) {
+            buf_lines = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--no-round-clip") == 0) {
+            lcd_flush_set_round_clip(false);
+        } else if (strcmp(argv[i], "--no-assets") == 0) {
+            ui_set_flash_images(false);
+        } else if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc) {
+            csv = fopen(argv[++i], "w");
+        } else if (strcmp(argv[i], "--ppm") == 0 && i + 1 < argc) {
+            ppm_path = argv[++i];
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            trace_path = argv[++i];
+        } else if (strcmp(argv[i], "--max-avg-us") == 0 && i + 1 < argc) {
+            max_avg_us = atol(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (frames <= 0 || display_port_set_buf_mode(buf_mode, (uint16_t)buf_lines) != ESP_OK) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (csv) {
+        fprintf(csv, "scenario,frame,render_us,inv_px,flush_calls,flush_bytes\n");
+    }
+
+    stats_history_init(esp_timer_get_time());
+    display_port_init();
+    int64_t t_init = esp_timer_get_time();
+    ui_init();
+    lv_disp_get_default()->driver->monitor_cb = bench_monitor_cb;
+    ui_update_stats(UI_SRC_SYSTEM, 0, 0);
+    ui_update_battery(UI_SRC_BATTERY, 100);
+    ui_update_status(UI_SRC_SYSTEM, false, false, false);
+    ui_apply_pending();
+    int64_t t_built = esp_timer_get_time();
+    lv_refr_now(NULL);
+    int64_t t_frame = esp_timer_get_time();
+
+    ui_mem_stats_t mem;
+    ui_get_mem_stats(&mem);
+    printf("boot: ui_init %lld us, first frame %lld us, LVGL heap %lu used, %lu peak, %u screen(s)\n",
+           (long long)(t_built - t_init), (long long)(t_frame - t_built), (unsigned long)mem.used,
+           (unsigned long)mem.peak, (unsigned)mem.screens);
+
+    printf("draw buffer: %s\n", display_buf_mode_name(buf_mode));
+    printf("%-12s %6s %9s %9s %9s %10s %8s %11s %9s\n", "scenario", "frames", "avg_us", "p95_us",
+           "max_us", "inv_px", "flushes", "bytes", "spi_us");
+
+    int rc = 0;
+    for (size_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++) {
+        int64_t avg = run_scenario(&scenarios[i], frames);
+        if (max_avg_us > 0 && avg > max_avg_us) {
+            fprintf(stderr, "%s: average render time %lld us exceeds budget %ld us\n",
+                    scenarios[i].name, (long long)avg, max_avg_us);
+            rc = 1;
+        }
+    }
+
+    ui_switch_screen(UI_SCREEN_MAIN);
+    lv_refr_now(NULL);
+    run_idle(10);
+
+    printf("stats history: %u bytes fixed\n", (unsigned)stats_history_footprint());
+    printf("ui cache: %u bytes heap\n", (unsigned)ui_cache_bytes());
+    printf("ui assets: %u bytes flash\n", (unsigned)UI_ASSETS_FLASH_BYTES);
+    ui_get_mem_stats(&mem);
+    printf("LVGL heap: %lu used, %lu peak of %lu, %u screen(s) built\n", (unsigned long)mem.used,
+           (unsigned long)mem.peak, (unsigned long)mem.total, (unsigned)mem.screens);
+
+    ui_queue_stats_t qs;
+    ui_queue_get_stats(&qs);
+    printf("ui queue: %lu submitted, %lu drained, %lu applied\n", (unsigned long)qs.submitted,
+           (unsigned long)qs.drained, (unsigned long)qs.applied);
+
+    if (ppm_path && host_fb_write_ppm(ppm_path) != 0) {
+        fprintf(stderr, "failed to write %s\n", ppm_path);
+        rc = 1;
+    }
+    if (trace_path) {
+#if CONFIG_PGPEMU_TRACE
+        FILE *tf = fopen(trace_path, "w");
+        if (tf) {
+            trace_dump(tf);
+            fclose(tf);
+        } else {
+            fprintf(stderr, "failed to write %s\n", trace_path);
+            rc = 1;
+        }
+#else
+        fprintf(stderr, "--trace needs a build with -DPGPEMU_TRACE=ON\n");
+        rc = 1;
+#endif
+    }
+    if (csv) {
+        fclose(csv);
+    }
+    return rc;
+}
@@ -0,0 +1,17 @@
+/* The firmware's LVGL component takes its settings from Kconfig
+ * (CONFIG_LV_CONF_SKIP), so these mirror the CONFIG_LV_* lines in
+ * sdkconfig.defaults and must change together with them. Only Montserrat
+ * 14, the theme default, is built in; the UI's other sizes are subsets
+ * converted from main/assets/assets.txt. */
+#ifndef LV_CONF_H
+#define LV_CONF_H
+#define LV_COLOR_DEPTH 16
+#define LV_COLOR_16_SWAP 0
+#define LV_MEM_SIZE (48U * 1024U)
+#define LV_FONT_MONTSERRAT_12 0
+#define LV_FONT_MONTSERRAT_14 1
+#define LV_FONT_MONTSERRAT_16 0
+#define LV_FONT_MONTSERRAT_20 0
+#define LV_USE_LOG 1
+#define LV_LOG_LEVEL LV_LOG_LEVEL_WARN
+#endif
@@ -0,0 +1,131 @@
+/* Register-level model of the CST816 touch controller on the host I2C bus.
+ * Reports are latched into the register map and announced with a low pulse on
+ * the INT line, like the real part; a controller in deep sleep NACKs until
+ * its reset line is pulsed, and so does one held in reset. */
+#include "cst816_sim.h"
+#include "host_sim.h"
+#include <string.h>
+
+#define SIM_ADDR            0x15
+#define REG_GESTURE         0x01
+#define REG_FINGER_NUM      0x02
+#define REG_XPOS_H          0x03
+#define REG_XPOS_L          0x04
+#define REG_YPOS_H          0x05
+#define REG_YPOS_L          0x06
+#define REG_CHIP_ID         0xA7
+#define REG_SLEEP           0xE5
+
+#define EVT_DOWN            0
+#define EVT_UP              1
+#define EVT_CONTACT         2
+
+static uint8_t regs[256];
+static uint8_t reg_ptr;
+static int int_pin = -1;
+static bool finger_down;
+static bool sleeping;
+static bool in_reset;
+static uint32_t reads;
+
+static int sim_write(void *ctx, const uint8_t *data, size_t len) {
+    (void)ctx;
+    if (sleeping || in_reset) {
+        return -1;
+    }
+    reg_ptr = data[0];
+    for (size_t i = 1; i < len; i++) {
+        uint8_t reg = (uint8_t)(reg_ptr + i - 1);
+        regs[reg] = data[i];
+        if (reg == REG_SLEEP && data[i] == 0x03) {
+            sleeping = true;
+        }
+    }
+    return 0;
+}
+
+static int sim_read(void *ctx, uint8_t *data, size_t len) {
+    (void)ctx;
+    if (sleeping || in_reset) {
+        return -1;
+    }
+    for (size_t i = 0; i < len; i++) {
+        data[i] = regs[reg_ptr++];
+    }
+    if (len > 1) {
+        reads++;
+    }
+    return 0;
+}
+
+static void pulse_int(void) {
+    if (int_pin >= 0 && !sleeping) {
+        host_gpio_set_input(int_pin, 0);
+        host_gpio_set_input(int_pin, 1);
+    }
+}
+
+static void latch(uint8_t event, uint8_t fingers, uint16_t x, uint16_t y) {
+    regs[REG_FINGER_NUM] = fingers;
+    regs[REG_XPOS_H] = (uint8_t)((event << 6) | ((x >> 8) & 0x0F));
+    regs[REG_XPOS_L] = (uint8_t)x;
+    regs[REG_YPOS_H] = (uint8_t)((y >> 8) & 0x0F);
+    regs[REG_YPOS_L] = (uint8_t)y;
+}
+
+void cst816_sim_attach(int int_gpio) {
+    memset(regs, 0, sizeof(regs));
+    regs[REG_CHIP_ID] = 0xB5;
+    int_pin = int_gpio;
+    if (int_pin >= 0) {
+        host_gpio_set_input(int_pin, 1);
+    }
+    host_i2c_device_t dev = {
+        .addr = SIM_ADDR,
+        .write = sim_write,
+        .read = sim_read,
+    };
+    host_i2c_attach(&dev);
+}
+
+static void on_reset(int gpio, int level) {
+    (void)gpio;
+    in_reset = level == 0;
+    if (level == 0) {
+        sleeping = false;
+        finger_down = false;
+        latch(EVT_UP, 0, 0, 0);
+        regs[REG_SLEEP] = 0;
+    }
+}
+
+void cst816_sim_attach_reset(int rst_gpio) {
+    host_gpio_watch(rst_gpio, on_reset);
+}
+
+void cst816_sim_press(uint16_t x, uint16_t y) {
+    latch(finger_down ? EVT_CONTACT : EVT_DOWN, 1, x, y);
+    regs[REG_GESTURE] = 0;
+    finger_down = true;
+    pulse_int();
+}
+
+void cst816_sim_release(void) {
+    uint16_t x = (uint16_t)(((regs[REG_XPOS_H] & 0x0F) << 8) | regs[REG_XPOS_L]);
+    uint16_t y = (uint16_t)(((regs[REG_YPOS_H] & 0x0F) << 8) | regs[REG_YPOS_L]);
+    latch(EVT_UP, 0, x, y);
+    finger_down = false;
+    pulse_int();
+}
+
+void cst816_sim_gesture(uint8_t gesture) {
+    regs[REG_GESTURE] = gesture;
+}
+
+uint32_t cst816_sim_reads(void) {
+    return reads;
+}
+
+bool cst816_sim_sleeping(void) {
+    return sleeping;
+}
@@ -0,0 +1,12 @@
+#ifndef CST816_SIM_H
+#define CST816_SIM_H
+#include <stdbool.h>
+#include <stdint.h>
+void cst816_sim_attach(int int_gpio);
+void cst816_sim_attach_reset(int rst_gpio);
+void cst816_sim_press(uint16_t x, uint16_t y);
+void cst816_sim_release(void);
+void cst816_sim_gesture(uint8_t gesture);
+uint32_t cst816_sim_reads(void);
+bool cst816_sim_sleeping(void);
+#endif
@@ -0,0 +1,200 @@
+/* esp_partition stand-in over RAM with NOR flash semantics.
+ *
+ * Only the raw partitions from partitions.csv that code opens through
+ * esp_partition are modelled (the NVS ones have their own model in
+ * host_nvs.c). Erase sets a 4 KB sector to 0xff; a program can only clear
+ * bits, so writing over data that was not erased ANDs into it as on the
+ * real part. Every read, program and erase is counted, erases per sector,
+ * and with the manual clock on each one advances virtual time by a typical
+ * C3 flash cost.
+ *
+ * host_flash_cut_after(n) pulls the power during the nth program or erase
+ * from then on: a program stops part-way through, its last byte only
+ * partly programmed, and an erase stops part-way through the sector. Every
+ * operation then fails until host_flash_power_on(). */
+#include "host_sim.h"
+#include "esp_partition.h"
+#include "esp_timer.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define FLASH_SECTOR            4096
+#define FLASH_READ_SETUP_US     5
+#define FLASH_READ_BYTES_PER_US 10
+#define FLASH_PROGRAM_SETUP_US  40
+#define FLASH_PROGRAM_NS_BYTE   1400
+#define FLASH_ERASE_US          25000
+
+typedef struct {
+    esp_partition_t part;
+    uint8_t *data;
+    host_flash_stats_t stats;
+} flash_part_t;
+
+static flash_part_t parts[] = {
+    { .part = { .type = (esp_partition_type_t)0x40, .subtype = (esp_partition_subtype_t)0x00,
+                .address = 0x1E0000, .size = 0x10000, .erase_size = FLASH_SECTOR, .label = "journal" } },
+};
+
+#define PART_COUNT ((int)(sizeof(parts) / sizeof(parts[0])))
+
+static uint32_t cut_countdown;
+static bool powered = true;
+
+static void spend_us(flash_part_t *p, uint32_t us) {
+    p->stats.busy_us += us;
+    if (host_clock_is_manual()) {
+        host_clock_advance_us(us);
+    }
+}
+
+static flash_part_t *lookup(const esp_partition_t *partition) {
+    for (int i = 0; i < PART_COUNT; i++) {
+        if (partition == &parts[i].part) {
+            return &parts[i];
+        }
+    }
+    return NULL;
+}
+
+static uint8_t *backing(flash_part_t *p) {
+    if (p->data == NULL) {
+        p->data = malloc(p->part.size);
+        if (p->data) {
+            memset(p->data, 0xff, p->part.size);
+        }
+    }
+    return p->data;
+}
+
+/* True when this program or erase is the one the power cut lands in. */
+static bool cut_now(void) {
+    if (cut_countdown == 0 || --cut_countdown > 0) {
+        return false;
+    }
+    powered = false;
+    return true;
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char *label) {
+    for (int i = 0; i < PART_COUNT; i++) {
+        const esp_partition_t *p = &parts[i].part;
+        if ((type == ESP_PARTITION_TYPE_ANY || p->type == type) &&
+            (subtype == ESP_PARTITION_SUBTYPE_ANY || p->subtype == subtype) &&
+            (label == NULL || strcmp(p->label, label) == 0)) {
+            return p;
+        }
+    }
+    return NULL;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size) {
+    flash_part_t *p = lookup(partition);
+    if (p == NULL || src_offset + size > partition->size) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!powered || backing(p) == NULL) {
+        return ESP_FAIL;
+    }
+    memcpy(dst, p->data + src_offset, size);
+    p->stats.reads++;
+    p->stats.read_bytes += size;
+    spend_us(p, FLASH_READ_SETUP_US + (uint32_t)(size / FLASH_READ_BYTES_PER_US));
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offset, const void *src, size_t size) {
+    flash_part_t *p = lookup(partition);
+    if (p == NULL || dst_offset + size > partition->size) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!powered || backing(p) == NULL) {
+        return ESP_FAIL;
+    }
+    if (size == 0) {
+        return ESP_OK;
+    }
+    const uint8_t *in = src;
+    size_t n = size;
+    bool torn = cut_now();
+    if (torn) {
+        n = (size_t)rand() % size;
+        p->data[dst_offset + n] &= (uint8_t)(in[n] | rand());
+        p->stats.torn++;
+    }
+    for (size_t i = 0; i < n; i++) {
+        p->data[dst_offset + i] &= in[i];
+    }
+    p->stats.writes++;
+    p->stats.write_bytes += n;
+    spend_us(p, FLASH_PROGRAM_SETUP_US + (uint32_t)(n * FLASH_PROGRAM_NS_BYTE / 1000));
+    return torn ? ESP_FAIL : ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size) {
+    flash_part_t *p = lookup(partition);
+    if (p == NULL || offset % FLASH_SECTOR || size % FLASH_SECTOR || offset + size > partition->size) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!powered || backing(p) == NULL) {
+        return ESP_FAIL;
+    }
+    for (size_t s = offset / FLASH_SECTOR; s < (offset + size) / FLASH_SECTOR; s++) {
+        size_t n = FLASH_SECTOR;
+        bool torn = cut_now();
+        if (torn) {
+            n = (size_t)rand() % FLASH_SECTOR;
+            p->stats.torn++;
+        }
+        memset(p->data + s * FLASH_SECTOR, 0xff, n);
+        p->stats.erases++;
+        p->stats.erases_per_sector[s]++;
+        if (p->stats.erases_per_sector[s] > p->stats.max_sector_erases) {
+            p->stats.max_sector_erases = p->stats.erases_per_sector[s];
+        }
+        spend_us(p, FLASH_ERASE_US);
+        if (torn) {
+            return ESP_FAIL;
+        }
+    }
+    return ESP_OK;
+}
+
+void host_flash_cut_after(uint32_t ops) {
+    cut_countdown = ops;
+}
+
+bool host_flash_powered(void) {
+    return powered;
+}
+
+void host_flash_power_on(void) {
+    powered = true;
+    cut_countdown = 0;
+}
+
+void host_flash_get_stats(const char *label, host_flash_stats_t *stats) {
+    memset(stats, 0, sizeof(*stats));
+    for (int i = 0; i < PART_COUNT; i++) {
+        if (strcmp(parts[i].part.label, label) == 0) {
+            *stats = parts[i].stats;
+            stats->sectors = parts[i].part.size / FLASH_SECTOR;
+        }
+    }
+}
+
+void host_flash_reset_stats(void) {
+    for (int i = 0; i < PART_COUNT; i++) {
+        memset(&parts[i].stats, 0, sizeof(parts[i].stats));
+    }
+}
+
+void host_flash_reset(void) {
+    for (int i = 0; i < PART_COUNT; i++) {
+        free(parts[i].data);
+        parts[i].data = NULL;
+        memset(&parts[i].stats, 0, sizeof(parts[i].stats));
+    }
+    host_flash_power_on();
+}
@@ -0,0 +1,140 @@
+#include "host_sim.h"
+#include "driver/spi_master.h"
+#include "esp_lcd_panel_io.h"
+#include "esp_lcd_panel_vendor.h"
+#include "esp_lcd_panel_ops.h"
+#include <stdio.h>
+#include <string.h>
+
+struct esp_lcd_panel_io_t {
+    esp_lcd_panel_io_color_trans_done_cb_t on_color_trans_done;
+    void *user_ctx;
+};
+
+struct esp_lcd_panel_t {
+    esp_lcd_panel_io_handle_t io;
+};
+
+static struct esp_lcd_panel_io_t panel_io;
+static struct esp_lcd_panel_t panel;
+static uint8_t framebuffer[HOST_FB_WIDTH * HOST_FB_HEIGHT * 2];
+static host_lcd_stats_t lcd_stats;
+static bool display_on;
+static bool display_asleep;
+
+esp_err_t spi_bus_initialize(spi_host_device_t host_id, const spi_bus_config_t *bus_config, spi_dma_chan_t dma_chan) {
+    (void)host_id;
+    (void)bus_config;
+    (void)dma_chan;
+    return ESP_OK;
+}
+
+esp_err_t esp_lcd_new_panel_io_spi(esp_lcd_spi_bus_handle_t bus, const esp_lcd_panel_io_spi_config_t *io_config,
+                                   esp_lcd_panel_io_handle_t *ret_io) {
+    (void)bus;
+    panel_io.on_color_trans_done = io_config->on_color_trans_done;
+    panel_io.user_ctx = io_config->user_ctx;
+    *ret_io = &panel_io;
+    return ESP_OK;
+}
+
+esp_err_t esp_lcd_new_panel_gc9a01(esp_lcd_panel_io_handle_t io, const esp_lcd_panel_dev_config_t *panel_dev_config,
+                                   esp_lcd_panel_handle_t *ret_panel) {
+    if (panel_dev_config->bits_per_pixel != 16) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    panel.io = io;
+    *ret_panel = &panel;
+    return ESP_OK;
+}
+
+esp_err_t esp_lcd_panel_reset(esp_lcd_panel_handle_t p) {
+    (void)p;
+    memset(framebuffer, 0, sizeof(framebuffer));
+    return ESP_OK;
+}
+
+esp_err_t esp_lcd_panel_init(esp_lcd_panel_handle_t p) {
+    (void)p;
+    return ESP_OK;
+}
+
+esp_err_t esp_lcd_panel_disp_on_off(esp_lcd_panel_handle_t p, bool on_off) {
+    (void)p;
+    display_on = on_off;
+    return ESP_OK;
+}
+
+esp_err_t esp_lcd_panel_disp_sleep(esp_lcd_panel_handle_t p, bool sleep) {
+    (void)p;
+    display_asleep = sleep;
+    return ESP_OK;
+}
+
+/* Pixels are stored exactly as they would be clocked out over SPI; the
+ * GC9A01 interprets each 16-bit pixel MSB first. */
+esp_err_t esp_lcd_panel_draw_bitmap(esp_lcd_panel_handle_t p, int x_start, int y_start, int x_end, int y_end,
+                                    const void *color_data) {
+    if (x_start < 0 || y_start < 0 || x_end > HOST_FB_WIDTH || y_end > HOST_FB_HEIGHT ||
+        x_start >= x_end || y_start >= y_end) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const uint8_t *src = color_data;
+    size_t row_bytes = (size_t)(x_end - x_start) * 2;
+    for (int y = y_start; y < y_end; y++) {
+        memcpy(&framebuffer[(y * HOST_FB_WIDTH + x_start) * 2], src, row_bytes);
+        src += row_bytes;
+    }
+    uint32_t px = (uint32_t)(x_end - x_start) * (uint32_t)(y_end - y_start);
+    lcd_stats.draw_calls++;
+    lcd_stats.pixels += px;
+    lcd_stats.bytes += (uint64_t)px * 2;
+
+    if (p->io->on_color_trans_done) {
+        host_isr_enter();
+        p->io->on_color_trans_done(p->io, NULL, p->io->user_ctx);
+        host_isr_exit();
+    }
+    return ESP_OK;
+}
+
+uint16_t host_fb_get_pixel(int x, int y) {
+    const uint8_t *px = &framebuffer[(y * HOST_FB_WIDTH + x) * 2];
+    return (uint16_t)((px[0] << 8) | px[1]);
+}
+
+int host_fb_write_ppm(const char *path) {
+    FILE *f = fopen(path, "wb");
+    if (f == NULL) {
+        return -1;
+    }
+    fprintf(f, "P6\n%d %d\n255\n", HOST_FB_WIDTH, HOST_FB_HEIGHT);
+    for (int y = 0; y < HOST_FB_HEIGHT; y++) {
+        for (int x = 0; x < HOST_FB_WIDTH; x++) {
+            uint16_t c = host_fb_get_pixel(x, y);
+            uint8_t rgb[3] = {
+                (uint8_t)(((c >> 11) & 0x1F) * 255 / 31),
+                (uint8_t)(((c >> 5) & 0x3F) * 255 / 63),
+                (uint8_t)((c & 0x1F) * 255 / 31),
+            };
+            fwrite(rgb, 1, sizeof(rgb), f);
+        }
+    }
+    return fclose(f);
+}
+
+void host_lcd_get_stats(host_lcd_stats_t *stats) {
+    *stats = lcd_stats;
+}
+
+void host_lcd_reset_stats(void) {
+    memset(&lcd_stats, 0, sizeof(lcd_stats));
+}
+
+bool host_lcd_is_on(void) {
+    return display_on;
+}
+
+bool host_lcd_is_asleep(void) {
+    return display_asleep;
+}
@@ -0,0 +1,366 @@
+/* NVS stand-in with a flash wear model.
+ *
+ * Values live in a plain key table; alongside it each partition is modelled
+ * the way ESP-IDF NVS lays it out: 4 KB pages of 126 32-byte entries, every
+ * set appends a new entry and retires the old one, a full page moves writing
+ * to the next free page, and when only the reserved spare page is left the
+ * page with the most retired entries is compacted into it and erased. Setting
+ * a key to the value it already holds writes nothing, as on the target.
+ *
+ * With the manual clock on, each program and erase also advances virtual
+ * time by a typical C3 flash cost so callers measure realistic blocking. */
+#include "host_sim.h"
+#include "nvs.h"
+#include "nvs_flash.h"
+#include "esp_timer.h"
+#include <string.h>
+
+#define NVS_PAGE_ENTRIES    126
+#define NVS_ENTRY_BYTES     32
+#define NVS_MAX_PAGES       64
+#define NVS_MAX_KEYS        64
+#define NVS_MAX_HANDLES     8
+#define NVS_PROGRAM_US      60
+#define NVS_ERASE_US        25000
+
+typedef struct {
+    bool used;
+    int part;
+    char ns[16];
+    char key[16];
+    uint32_t value;
+    int page;
+} nvs_key_t;
+
+typedef struct {
+    char label[17];
+    bool initialized;
+    int pages;
+    int active;
+    uint16_t used[NVS_MAX_PAGES];
+    uint16_t live[NVS_MAX_PAGES];
+    host_nvs_stats_t stats;
+} nvs_part_t;
+
+typedef struct {
+    bool open;
+    int part;
+    char ns[16];
+} nvs_open_t;
+
+static nvs_part_t parts[4];
+static int part_count;
+static nvs_key_t keys[NVS_MAX_KEYS];
+static nvs_open_t handles[NVS_MAX_HANDLES];
+
+static void spend_us(nvs_part_t *p, uint32_t us) {
+    p->stats.busy_us += us;
+    if (host_clock_is_manual()) {
+        host_clock_advance_us(us);
+    }
+}
+
+/* Sizes from partitions.csv; anything else gets 4 pages. */
+static int default_pages(const char *label) {
+    if (strcmp(label, "settings") == 0) {
+        return 0xF000 / 4096;
+    }
+    return 0x4000 / 4096;
+}
+
+static int find_part(const char *label, bool create) {
+    for (int i = 0; i < part_count; i++) {
+        if (strcmp(parts[i].label, label) == 0) {
+            return i;
+        }
+    }
+    if (!create || part_count == (int)(sizeof(parts) / sizeof(parts[0]))) {
+        return -1;
+    }
+    nvs_part_t *p = &parts[part_count];
+    memset(p, 0, sizeof(*p));
+    strncpy(p->label, label, sizeof(p->label) - 1);
+    p->pages = default_pages(label);
+    return part_count++;
+}
+
+void host_nvs_set_size(const char *label, size_t bytes) {
+    int i = find_part(label, true);
+    if (i >= 0) {
+        int pages = (int)(bytes / 4096);
+        parts[i].pages = pages > NVS_MAX_PAGES ? NVS_MAX_PAGES : pages;
+    }
+}
+
+static bool page_free(const nvs_part_t *p, int page) {
+    return p->used[page] == 0;
+}
+
+static int count_free(const nvs_part_t *p) {
+    int n = 0;
+    for (int i = 0; i < p->pages; i++) {
+        n += page_free(p, i) && i != p->active;
+    }
+    return n;
+}
+
+static void erase_page(nvs_part_t *p, int page) {
+    p->used[page] = 0;
+    p->live[page] = 0;
+    p->stats.page_erases++;
+    p->stats.erases_per_page[page]++;
+    if (p->stats.erases_per_page[page] > p->stats.max_page_erases) {
+        p->stats.max_page_erases = p->stats.erases_per_page[page];
+    }
+    spend_us(p, NVS_ERASE_US);
+}
+
+static void program_entry(nvs_part_t *p) {
+    p->stats.entry_writes++;
+    p->stats.bytes_written += NVS_ENTRY_BYTES;
+    spend_us(p, NVS_PROGRAM_US);
+}
+
+static int next_free_page(const nvs_part_t *p) {
+    for (int n = 1; n <= p->pages; n++) {
+        int i = (p->active + n) % p->pages;
+        if (page_free(p, i)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void append_entry(int part_idx, nvs_key_t *k);
+
+/* Keeps one page free as NVS does: when writing would consume it, the page
+ * holding the fewest live entries is copied forward and erased. */
+static void collect(int part_idx) {
+    nvs_part_t *p = &parts[part_idx];
+    int victim = -1;
+    for (int i = 0; i < p->pages; i++) {
+        if (i == p->active || page_free(p, i)) {
+            continue;
+        }
+        if (victim < 0 || p->live[i] < p->live[victim]) {
+            victim = i;
+        }
+    }
+    if (victim < 0) {
+        return;
+    }
+    p->stats.gc_runs++;
+    for (int k = 0; k < NVS_MAX_KEYS; k++) {
+        if (keys[k].used && keys[k].part == part_idx && keys[k].page == victim) {
+            p->live[victim]--;
+            append_entry(part_idx, &keys[k]);
+        }
+    }
+    erase_page(p, victim);
+}
+
+static void append_entry(int part_idx, nvs_key_t *k) {
+    nvs_part_t *p = &parts[part_idx];
+    if (p->used[p->active] == NVS_PAGE_ENTRIES) {
+        int next = next_free_page(p);
+        if (next < 0) {
+            return;
+        }
+        p->active = next;
+        if (count_free(p) < 1) {
+            collect(part_idx);
+        }
+    }
+    p->used[p->active]++;
+    p->live[p->active]++;
+    k->page = p->active;
+    program_entry(p);
+}
+
+static nvs_key_t *lookup(nvs_handle_t h, const char *key, bool create) {
+    nvs_open_t *o = &handles[h - 1];
+    for (int i = 0; i < NVS_MAX_KEYS; i++) {
+        if (keys[i].used && keys[i].part == o->part && strcmp(keys[i].ns, o->ns) == 0 &&
+            strcmp(keys[i].key, key) == 0) {
+            return &keys[i];
+        }
+    }
+    if (!create) {
+        return NULL;
+    }
+    for (int i = 0; i < NVS_MAX_KEYS; i++) {
+        if (!keys[i].used) {
+            memset(&keys[i], 0, sizeof(keys[i]));
+            keys[i].used = true;
+            keys[i].part = o->part;
+            keys[i].page = -1;
+            strncpy(keys[i].ns, o->ns, sizeof(keys[i].ns) - 1);
+            strncpy(keys[i].key, key, sizeof(keys[i].key) - 1);
+            return &keys[i];
+        }
+    }
+    return NULL;
+}
+
+static bool valid_handle(nvs_handle_t h) {
+    return h >= 1 && h <= NVS_MAX_HANDLES && handles[h - 1].open;
+}
+
+static esp_err_t set_value(nvs_handle_t h, const char *key, uint32_t value) {
+    if (!valid_handle(h)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    nvs_key_t *k = lookup(h, key, true);
+    if (k == NULL) {
+        return ESP_ERR_NVS_NO_FREE_PAGES;
+    }
+    nvs_part_t *p = &parts[handles[h - 1].part];
+    p->stats.sets++;
+    if (k->page >= 0 && k->value == value) {
+        return ESP_OK;
+    }
+    if (k->page >= 0) {
+        p->live[k->page]--;
+    }
+    k->value = value;
+    append_entry(handles[h - 1].part, k);
+    return ESP_OK;
+}
+
+static esp_err_t get_value(nvs_handle_t h, const char *key, uint32_t *value) {
+    if (!valid_handle(h)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    nvs_key_t *k = lookup(h, key, false);
+    if (k == NULL) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    *value = k->value;
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_init(void) {
+    return nvs_flash_init_partition("nvs");
+}
+
+esp_err_t nvs_flash_erase(void) {
+    return nvs_flash_erase_partition("nvs");
+}
+
+esp_err_t nvs_flash_init_partition(const char *label) {
+    int i = find_part(label, true);
+    if (i < 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    parts[i].initialized = true;
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase_partition(const char *label) {
+    int i = find_part(label, true);
+    if (i < 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    for (int k = 0; k < NVS_MAX_KEYS; k++) {
+        if (keys[k].used && keys[k].part == i) {
+            keys[k].used = false;
+        }
+    }
+    for (int pg = 0; pg < parts[i].pages; pg++) {
+        if (!page_free(&parts[i], pg)) {
+            erase_page(&parts[i], pg);
+        }
+    }
+    parts[i].active = 0;
+    return ESP_OK;
+}
+
+esp_err_t nvs_open_from_partition(const char *part_name, const char *name, nvs_open_mode_t open_mode,
+                                  nvs_handle_t *out_handle) {
+    int part = find_part(part_name, false);
+    if (part < 0 || !parts[part].initialized) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+    for (int i = 0; i < NVS_MAX_HANDLES; i++) {
+        if (!handles[i].open) {
+            handles[i].open = true;
+            handles[i].part = part;
+            strncpy(handles[i].ns, name, sizeof(handles[i].ns) - 1);
+            *out_handle = (nvs_handle_t)(i + 1);
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+esp_err_t nvs_open(const char *name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle) {
+    return nvs_open_from_partition("nvs", name, open_mode, out_handle);
+}
+
+void nvs_close(nvs_handle_t handle) {
+    if (valid_handle(handle)) {
+        handles[handle - 1].open = false;
+    }
+}
+
+esp_err_t nvs_set_u8(nvs_handle_t handle, const char *key, uint8_t value) {
+    return set_value(handle, key, value);
+}
+
+esp_err_t nvs_get_u8(nvs_handle_t handle, const char *key, uint8_t *out_value) {
+    uint32_t v;
+    esp_err_t err = get_value(handle, key, &v);
+    if (err == ESP_OK) {
+        *out_value = (uint8_t)v;
+    }
+    return err;
+}
+
+esp_err_t nvs_set_u32(nvs_handle_t handle, const char *key, uint32_t value) {
+    return set_value(handle, key, value);
+}
+
+esp_err_t nvs_get_u32(nvs_handle_t handle, const char *key, uint32_t *out_value) {
+    return get_value(handle, key, out_value);
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key) {
+    if (!valid_handle(handle)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    nvs_key_t *k = lookup(handle, key, false);
+    if (k == NULL) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    if (k->page >= 0) {
+        parts[k->part].live[k->page]--;
+    }
+    k->used = false;
+    return ESP_OK;
+}
+
+/* Entries are programmed by the set calls; commit only counts. */
+esp_err_t nvs_commit(nvs_handle_t handle) {
+    if (!valid_handle(handle)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    parts[handles[handle - 1].part].stats.commits++;
+    return ESP_OK;
+}
+
+void host_nvs_get_stats(const char *label, host_nvs_stats_t *stats) {
+    int i = find_part(label, false);
+    if (i < 0) {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+    *stats = parts[i].stats;
+    stats->pages = (uint32_t)parts[i].pages;
+}
+
+void host_nvs_reset(void) {
+    memset(parts, 0, sizeof(parts));
+    memset(keys, 0, sizeof(keys));
+    memset(handles, 0, sizeof(handles));
+    part_count = 0;
+}
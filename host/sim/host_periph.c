@@ -0,0 +1,405 @@
+#include "host_sim.h"
+#include "driver/gpio.h"
+#include "driver/i2c.h"
+#include "driver/ledc.h"
+#include "esp_heap_caps.h"
+#include "esp_sleep.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define HOST_I2C_MAX_DEVICES    4
+#define HOST_I2C_MAX_OPS        16
+
+typedef struct {
+    gpio_mode_t mode;
+    gpio_int_type_t intr_type;
+    bool intr_enabled;
+    bool pull_up;
+    bool driven;
+    int level;
+    gpio_isr_t isr;
+    void *isr_arg;
+    host_gpio_watch_cb_t watch;
+} host_gpio_t;
+
+typedef enum { OP_START, OP_WRITE, OP_READ, OP_STOP } i2c_op_kind_t;
+
+typedef struct {
+    i2c_op_kind_t kind;
+    const uint8_t *wdata;
+    uint8_t wbyte;
+    uint8_t *rdata;
+    size_t len;
+} i2c_op_t;
+
+typedef struct {
+    i2c_op_t ops[HOST_I2C_MAX_OPS];
+    int count;
+} i2c_link_t;
+
+static host_gpio_t gpios[GPIO_NUM_MAX];
+static bool isr_service_installed;
+static host_i2c_device_t i2c_devices[HOST_I2C_MAX_DEVICES];
+static int i2c_device_count;
+
+static bool valid_gpio(gpio_num_t gpio_num) {
+    return gpio_num >= 0 && gpio_num < GPIO_NUM_MAX;
+}
+
+esp_err_t gpio_config(const gpio_config_t *cfg) {
+    for (int i = 0; i < GPIO_NUM_MAX; i++) {
+        if (cfg->pin_bit_mask & (1ULL << i)) {
+            gpios[i].mode = cfg->mode;
+            gpios[i].intr_type = cfg->intr_type;
+            gpios[i].intr_enabled = cfg->intr_type != GPIO_INTR_DISABLE;
+            gpios[i].pull_up = cfg->pull_up_en;
+            if (cfg->pull_up_en && !(cfg->mode & GPIO_MODE_OUTPUT) && !gpios[i].driven) {
+                gpios[i].level = 1;
+            }
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t gpio_reset_pin(gpio_num_t gpio_num) {
+    if (!valid_gpio(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(&gpios[gpio_num], 0, sizeof(gpios[gpio_num]));
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_direction(gpio_num_t gpio_num, gpio_mode_t mode) {
+    if (!valid_gpio(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    gpios[gpio_num].mode = mode;
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level) {
+    if (!valid_gpio(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    host_gpio_t *g = &gpios[gpio_num];
+    int old = g->level;
+    g->level = level ? 1 : 0;
+    if (g->watch && old != g->level) {
+        g->watch(gpio_num, g->level);
+    }
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio_num) {
+    return valid_gpio(gpio_num) ? gpios[gpio_num].level : 0;
+}
+
+esp_err_t gpio_set_intr_type(gpio_num_t gpio_num, gpio_int_type_t intr_type) {
+    if (!valid_gpio(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    gpios[gpio_num].intr_type = intr_type;
+    return ESP_OK;
+}
+
+esp_err_t gpio_intr_enable(gpio_num_t gpio_num) {
+    if (!valid_gpio(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    gpios[gpio_num].intr_enabled = true;
+    return ESP_OK;
+}
+
+esp_err_t gpio_intr_disable(gpio_num_t gpio_num) {
+    if (!valid_gpio(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    gpios[gpio_num].intr_enabled = false;
+    return ESP_OK;
+}
+
+esp_err_t gpio_install_isr_service(int intr_alloc_flags) {
+    (void)intr_alloc_flags;
+    if (isr_service_installed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    isr_service_installed = true;
+    return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_add(gpio_num_t gpio_num, gpio_isr_t isr_handler, void *args) {
+    if (!valid_gpio(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!isr_service_installed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    gpios[gpio_num].isr = isr_handler;
+    gpios[gpio_num].isr_arg = args;
+    return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_remove(gpio_num_t gpio_num) {
+    if (!valid_gpio(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    gpios[gpio_num].isr = NULL;
+    return ESP_OK;
+}
+
+/* As on the chip, a wakeup level replaces the pin's interrupt type. */
+esp_err_t gpio_wakeup_enable(gpio_num_t gpio_num, gpio_int_type_t intr_type) {
+    if (!valid_gpio(gpio_num) || (intr_type != GPIO_INTR_LOW_LEVEL && intr_type != GPIO_INTR_HIGH_LEVEL)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    gpios[gpio_num].intr_type = intr_type;
+    return ESP_OK;
+}
+
+esp_err_t gpio_wakeup_disable(gpio_num_t gpio_num) {
+    return valid_gpio(gpio_num) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t esp_sleep_enable_gpio_wakeup(void) {
+    return ESP_OK;
+}
+
+void host_gpio_set_input(int gpio, int level) {
+    host_gpio_t *g = &gpios[gpio];
+    int old = g->level;
+    g->driven = true;
+    g->level = level ? 1 : 0;
+    if (!g->intr_enabled || g->isr == NULL) {
+        return;
+    }
+    bool fire = false;
+    switch (g->intr_type) {
+        case GPIO_INTR_POSEDGE: fire = !old && g->level; break;
+        case GPIO_INTR_NEGEDGE: fire = old && !g->level; break;
+        case GPIO_INTR_ANYEDGE: fire = old != g->level; break;
+        case GPIO_INTR_LOW_LEVEL: fire = !g->level; break;
+        case GPIO_INTR_HIGH_LEVEL: fire = g->level; break;
+        default: break;
+    }
+    if (fire) {
+        host_isr_enter();
+        g->isr(g->isr_arg);
+        host_isr_exit();
+    }
+}
+
+int host_gpio_get_output(int gpio) {
+    return gpios[gpio].level;
+}
+
+/* Lets a device model see the firmware drive one of its input pins. */
+void host_gpio_watch(int gpio, host_gpio_watch_cb_t cb) {
+    gpios[gpio].watch = cb;
+}
+
+void host_i2c_attach(const host_i2c_device_t *dev) {
+    if (i2c_device_count < HOST_I2C_MAX_DEVICES) {
+        i2c_devices[i2c_device_count++] = *dev;
+    }
+}
+
+static host_i2c_device_t *find_device(uint8_t addr) {
+    for (int i = 0; i < i2c_device_count; i++) {
+        if (i2c_devices[i].addr == addr) {
+            return &i2c_devices[i];
+        }
+    }
+    return NULL;
+}
+
+esp_err_t i2c_param_config(i2c_port_t i2c_num, const i2c_config_t *conf) {
+    (void)conf;
+    return i2c_num < I2C_NUM_MAX ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t i2c_driver_install(i2c_port_t i2c_num, i2c_mode_t mode, size_t slv_rx_buf_len,
+                             size_t slv_tx_buf_len, int intr_alloc_flags) {
+    (void)mode;
+    (void)slv_rx_buf_len;
+    (void)slv_tx_buf_len;
+    (void)intr_alloc_flags;
+    return i2c_num < I2C_NUM_MAX ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+/* Command links are heap allocated, as in the real driver, so the number of
+ * links built per transaction shows up in host_heap_alloc_count(). */
+i2c_cmd_handle_t i2c_cmd_link_create(void) {
+    return heap_caps_calloc(1, sizeof(i2c_link_t), MALLOC_CAP_DEFAULT);
+}
+
+void i2c_cmd_link_delete(i2c_cmd_handle_t cmd_handle) {
+    heap_caps_free(cmd_handle);
+}
+
+i2c_cmd_handle_t i2c_cmd_link_create_static(uint8_t *buffer, uint32_t size) {
+    if (buffer == NULL || size < sizeof(i2c_link_t)) {
+        return NULL;
+    }
+    memset(buffer, 0, sizeof(i2c_link_t));
+    return buffer;
+}
+
+void i2c_cmd_link_delete_static(i2c_cmd_handle_t cmd_handle) {
+    (void)cmd_handle;
+}
+
+static esp_err_t push_op(i2c_cmd_handle_t cmd_handle, i2c_op_t op) {
+    i2c_link_t *link = cmd_handle;
+    if (link == NULL || link->count >= HOST_I2C_MAX_OPS) {
+        return ESP_ERR_NO_MEM;
+    }
+    link->ops[link->count++] = op;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_start(i2c_cmd_handle_t cmd_handle) {
+    return push_op(cmd_handle, (i2c_op_t) { .kind = OP_START });
+}
+
+esp_err_t i2c_master_write_byte(i2c_cmd_handle_t cmd_handle, uint8_t data, bool ack_en) {
+    (void)ack_en;
+    return push_op(cmd_handle, (i2c_op_t) { .kind = OP_WRITE, .wbyte = data, .len = 1 });
+}
+
+esp_err_t i2c_master_write(i2c_cmd_handle_t cmd_handle, const uint8_t *data, size_t data_len, bool ack_en) {
+    (void)ack_en;
+    return push_op(cmd_handle, (i2c_op_t) { .kind = OP_WRITE, .wdata = data, .len = data_len });
+}
+
+esp_err_t i2c_master_read_byte(i2c_cmd_handle_t cmd_handle, uint8_t *data, i2c_ack_type_t ack) {
+    (void)ack;
+    return push_op(cmd_handle, (i2c_op_t) { .kind = OP_READ, .rdata = data, .len = 1 });
+}
+
+esp_err_t i2c_master_read(i2c_cmd_handle_t cmd_handle, uint8_t *data, size_t data_len, i2c_ack_type_t ack) {
+    (void)ack;
+    return push_op(cmd_handle, (i2c_op_t) { .kind = OP_READ, .rdata = data, .len = data_len });
+}
+
+esp_err_t i2c_master_stop(i2c_cmd_handle_t cmd_handle) {
+    return push_op(cmd_handle, (i2c_op_t) { .kind = OP_STOP });
+}
+
+/* Replays the queued link against the attached device models. The first byte
+ * after each START is the address phase; a missing device NACKs it. */
+esp_err_t i2c_master_cmd_begin(i2c_port_t i2c_num, i2c_cmd_handle_t cmd_handle, TickType_t ticks_to_wait) {
+    (void)ticks_to_wait;
+    if (i2c_num >= I2C_NUM_MAX || cmd_handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    i2c_link_t *link = cmd_handle;
+    host_i2c_device_t *dev = NULL;
+    bool expect_addr = false;
+    uint8_t wbuf[32];
+    size_t wlen = 0;
+
+    for (int i = 0; i < link->count; i++) {
+        i2c_op_t *op = &link->ops[i];
+        switch (op->kind) {
+            case OP_START:
+            case OP_STOP:
+                if (dev && wlen && dev->write(dev->ctx, wbuf, wlen) != 0) {
+                    return ESP_FAIL;
+                }
+                wlen = 0;
+                expect_addr = op->kind == OP_START;
+                break;
+            case OP_WRITE:
+                for (size_t j = 0; j < op->len; j++) {
+                    uint8_t b = op->wdata ? op->wdata[j] : op->wbyte;
+                    if (expect_addr) {
+                        dev = find_device(b >> 1);
+                        if (dev == NULL) {
+                            return ESP_FAIL;
+                        }
+                        expect_addr = false;
+                    } else if (wlen < sizeof(wbuf)) {
+                        wbuf[wlen++] = b;
+                    }
+                }
+                break;
+            case OP_READ:
+                if (dev == NULL || dev->read(dev->ctx, op->rdata, op->len) != 0) {
+                    return ESP_FAIL;
+                }
+                break;
+        }
+    }
+    return ESP_OK;
+}
+
+/* LEDC channels hold a duty value and nothing else. A fade lands on its
+ * target when started; the time it would take is charged to the virtual
+ * clock only when the caller waits for it. */
+static uint32_t ledc_duty[LEDC_CHANNEL_MAX];
+static uint32_t ledc_target[LEDC_CHANNEL_MAX];
+static int ledc_fade_ms[LEDC_CHANNEL_MAX];
+
+esp_err_t ledc_timer_config(const ledc_timer_config_t *timer_conf) {
+    return timer_conf->timer_num < LEDC_TIMER_MAX ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t ledc_channel_config(const ledc_channel_config_t *ledc_conf) {
+    if (ledc_conf->channel >= LEDC_CHANNEL_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    ledc_duty[ledc_conf->channel] = ledc_conf->duty;
+    ledc_target[ledc_conf->channel] = ledc_conf->duty;
+    return ESP_OK;
+}
+
+esp_err_t ledc_fade_func_install(int intr_alloc_flags) {
+    (void)intr_alloc_flags;
+    return ESP_OK;
+}
+
+esp_err_t ledc_set_fade_with_time(ledc_mode_t speed_mode, ledc_channel_t channel, uint32_t target_duty,
+                                  int max_fade_time_ms) {
+    (void)speed_mode;
+    if (channel >= LEDC_CHANNEL_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    ledc_target[channel] = target_duty;
+    ledc_fade_ms[channel] = max_fade_time_ms;
+    return ESP_OK;
+}
+
+esp_err_t ledc_fade_start(ledc_mode_t speed_mode, ledc_channel_t channel, ledc_fade_mode_t fade_mode) {
+    (void)speed_mode;
+    if (channel >= LEDC_CHANNEL_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    ledc_duty[channel] = ledc_target[channel];
+    if (fade_mode == LEDC_FADE_WAIT_DONE && host_clock_is_manual()) {
+        host_clock_advance_us((int64_t)ledc_fade_ms[channel] * 1000);
+    }
+    return ESP_OK;
+}
+
+esp_err_t ledc_set_duty(ledc_mode_t speed_mode, ledc_channel_t channel, uint32_t duty) {
+    (void)speed_mode;
+    if (channel >= LEDC_CHANNEL_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    ledc_target[channel] = duty;
+    return ESP_OK;
+}
+
+esp_err_t ledc_update_duty(ledc_mode_t speed_mode, ledc_channel_t channel) {
+    (void)speed_mode;
+    if (channel >= LEDC_CHANNEL_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    ledc_duty[channel] = ledc_target[channel];
+    return ESP_OK;
+}
+
+uint32_t ledc_get_duty(ledc_mode_t speed_mode, ledc_channel_t channel) {
+    (void)speed_mode;
+    return channel < LEDC_CHANNEL_MAX ? ledc_duty[channel] : 0;
+}
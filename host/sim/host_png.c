@@ -0,0 +1,210 @@
+/* PNG snapshots of the host framebuffer for golden-image tests.
+ *
+ * Writes 8-bit RGB with zlib doing the deflate. The reader takes the 8-bit
+ * RGB and RGBA non-interlaced files any image editor saves, so a golden
+ * that was touched up and re-exported still loads. */
+#include "host_sim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+static const uint8_t png_sig[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+static void put_be32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+static uint32_t get_be32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static void write_chunk(FILE *f, const char *type, const uint8_t *data, uint32_t len) {
+    uint8_t hdr[8];
+    put_be32(hdr, len);
+    memcpy(hdr + 4, type, 4);
+    fwrite(hdr, 1, sizeof(hdr), f);
+    if (len) {
+        fwrite(data, 1, len, f);
+    }
+    uLong crc = crc32(0, hdr + 4, 4);
+    crc = crc32(crc, data, len);
+    uint8_t tail[4];
+    put_be32(tail, (uint32_t)crc);
+    fwrite(tail, 1, sizeof(tail), f);
+}
+
+static void fb_rgb(int x, int y, uint8_t rgb[3]) {
+    uint16_t c = host_fb_get_pixel(x, y);
+    rgb[0] = (uint8_t)(((c >> 11) & 0x1F) * 255 / 31);
+    rgb[1] = (uint8_t)(((c >> 5) & 0x3F) * 255 / 63);
+    rgb[2] = (uint8_t)((c & 0x1F) * 255 / 31);
+}
+
+int host_fb_write_png(const char *path) {
+    const size_t stride = 1 + HOST_FB_WIDTH * 3;
+    size_t raw_len = stride * HOST_FB_HEIGHT;
+    uint8_t *raw = malloc(raw_len);
+    uLongf z_len = compressBound(raw_len);
+    uint8_t *z = malloc(z_len);
+    if (raw == NULL || z == NULL) {
+        free(raw);
+        free(z);
+        return -1;
+    }
+    for (int y = 0; y < HOST_FB_HEIGHT; y++) {
+        uint8_t *row = raw + stride * y;
+        row[0] = 0;
+        for (int x = 0; x < HOST_FB_WIDTH; x++) {
+            fb_rgb(x, y, row + 1 + x * 3);
+        }
+    }
+    int ret = -1;
+    FILE *f = NULL;
+    if (compress2(z, &z_len, raw, raw_len, Z_BEST_COMPRESSION) == Z_OK && (f = fopen(path, "wb")) != NULL) {
+        uint8_t ihdr[13] = { 0 };
+        put_be32(ihdr, HOST_FB_WIDTH);
+        put_be32(ihdr + 4, HOST_FB_HEIGHT);
+        ihdr[8] = 8;
+        ihdr[9] = 2;
+        fwrite(png_sig, 1, sizeof(png_sig), f);
+        write_chunk(f, "IHDR", ihdr, sizeof(ihdr));
+        write_chunk(f, "IDAT", z, (uint32_t)z_len);
+        write_chunk(f, "IEND", NULL, 0);
+        ret = fclose(f);
+    }
+    free(raw);
+    free(z);
+    return ret;
+}
+
+static uint8_t paeth(uint8_t a, uint8_t b, uint8_t c) {
+    int p = a + b - c;
+    int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+    if (pa <= pb && pa <= pc) {
+        return a;
+    }
+    return pb <= pc ? b : c;
+}
+
+/* Undoes the per-row filters in place; bpp is bytes per pixel. */
+static int unfilter(uint8_t *raw, int w, int h, int bpp) {
+    size_t stride = (size_t)w * bpp;
+    uint8_t *prev = NULL;
+    for (int y = 0; y < h; y++) {
+        uint8_t *row = raw + y * (stride + 1);
+        uint8_t type = row[0];
+        uint8_t *px = row + 1;
+        for (size_t i = 0; i < stride; i++) {
+            uint8_t a = i >= (size_t)bpp ? px[i - bpp] : 0;
+            uint8_t b = prev ? prev[i] : 0;
+            uint8_t c = prev && i >= (size_t)bpp ? prev[i - bpp] : 0;
+            switch (type) {
+                case 0: break;
+                case 1: px[i] += a; break;
+                case 2: px[i] += b; break;
+                case 3: px[i] += (uint8_t)((a + b) / 2); break;
+                case 4: px[i] += paeth(a, b, c); break;
+                default: return -1;
+            }
+        }
+        prev = px;
+    }
+    return 0;
+}
+
+/* Loads a framebuffer-sized PNG as packed RGB, or NULL. */
+static uint8_t *read_png_rgb(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *file = size > 0 ? malloc((size_t)size) : NULL;
+    if (file == NULL || fread(file, 1, (size_t)size, f) != (size_t)size) {
+        fclose(f);
+        free(file);
+        return NULL;
+    }
+    fclose(f);
+
+    uint8_t *z = malloc((size_t)size), *raw = NULL, *rgb = NULL;
+    size_t z_len = 0;
+    int bpp = 0;
+    long pos = sizeof(png_sig);
+    if (z == NULL || size < pos || memcmp(file, png_sig, sizeof(png_sig)) != 0) {
+        goto out;
+    }
+    while (pos + 12 <= size) {
+        uint32_t len = get_be32(file + pos);
+        const uint8_t *type = file + pos + 4, *data = file + pos + 8;
+        if (len > (uint32_t)(size - pos - 12)) {
+            goto out;
+        }
+        if (memcmp(type, "IHDR", 4) == 0) {
+            if (len != 13 || get_be32(data) != HOST_FB_WIDTH || get_be32(data + 4) != HOST_FB_HEIGHT ||
+                data[8] != 8 || (data[9] != 2 && data[9] != 6) || data[12] != 0) {
+                goto out;
+            }
+            bpp = data[9] == 6 ? 4 : 3;
+        } else if (memcmp(type, "IDAT", 4) == 0) {
+            memcpy(z + z_len, data, len);
+            z_len += len;
+        } else if (memcmp(type, "IEND", 4) == 0) {
+            break;
+        }
+        pos += 12 + (long)len;
+    }
+    if (bpp == 0) {
+        goto out;
+    }
+
+    uLongf raw_len = (uLongf)(1 + HOST_FB_WIDTH * bpp) * HOST_FB_HEIGHT;
+    uLongf got = raw_len;
+    raw = malloc(raw_len);
+    if (raw == NULL || uncompress(raw, &got, z, z_len) != Z_OK || got != raw_len ||
+        unfilter(raw, HOST_FB_WIDTH, HOST_FB_HEIGHT, bpp) != 0) {
+        goto out;
+    }
+    rgb = malloc(HOST_FB_WIDTH * HOST_FB_HEIGHT * 3);
+    if (rgb == NULL) {
+        goto out;
+    }
+    for (int y = 0; y < HOST_FB_HEIGHT; y++) {
+        const uint8_t *row = raw + y * (1 + HOST_FB_WIDTH * bpp) + 1;
+        for (int x = 0; x < HOST_FB_WIDTH; x++) {
+            memcpy(rgb + (y * HOST_FB_WIDTH + x) * 3, row + x * bpp, 3);
+        }
+    }
+out:
+    free(file);
+    free(z);
+    free(raw);
+    return rgb;
+}
+
+int host_fb_diff_png(const char *path, int tolerance) {
+    uint8_t *golden = read_png_rgb(path);
+    if (golden == NULL) {
+        return -1;
+    }
+    int diff = 0;
+    for (int y = 0; y < HOST_FB_HEIGHT; y++) {
+        for (int x = 0; x < HOST_FB_WIDTH; x++) {
+            uint8_t rgb[3];
+            const uint8_t *g = golden + (y * HOST_FB_WIDTH + x) * 3;
+            fb_rgb(x, y, rgb);
+            if (abs(rgb[0] - g[0]) > tolerance || abs(rgb[1] - g[1]) > tolerance ||
+                abs(rgb[2] - g[2]) > tolerance) {
+                diff++;
+            }
+        }
+    }
+    free(golden);
+    return diff;
+}
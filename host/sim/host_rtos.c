@@ -0,0 +1,460 @@
+#include "host_sim.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/queue.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define HOST_MAX_TIMERS 32
+#define HOST_MAX_TASKS  16
+
+struct esp_timer {
+    esp_timer_cb_t callback;
+    void *arg;
+    const char *name;
+    bool used;
+    bool active;
+    uint64_t period_us;
+    int64_t due_us;
+};
+
+struct host_task {
+    const char *name;
+    uint32_t stack_depth;
+    UBaseType_t priority;
+    uint32_t notify_value;
+    bool notify_pending;
+};
+
+struct host_sem {
+    int count;
+};
+
+struct host_queue {
+    uint8_t *items;
+    UBaseType_t length;
+    UBaseType_t item_size;
+    UBaseType_t head;
+    UBaseType_t count;
+};
+
+esp_log_level_t host_log_level = ESP_LOG_WARN;
+
+static struct esp_timer timers[HOST_MAX_TIMERS];
+static struct host_task tasks[HOST_MAX_TASKS];
+static struct host_task main_task = { .name = "main" };
+static int task_count;
+static bool clock_manual;
+static int64_t manual_now_us;
+static int64_t real_origin_us = -1;
+static uint32_t heap_allocs;
+
+static int64_t real_clock_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    int64_t now = (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    if (real_origin_us < 0) {
+        real_origin_us = now;
+    }
+    return now - real_origin_us;
+}
+
+int64_t esp_timer_get_time(void) {
+    return clock_manual ? manual_now_us : real_clock_us();
+}
+
+void host_clock_set_manual(bool manual) {
+    if (manual && !clock_manual) {
+        manual_now_us = real_clock_us();
+    }
+    clock_manual = manual;
+}
+
+bool host_clock_is_manual(void) {
+    return clock_manual;
+}
+
+static struct esp_timer *next_due(int64_t limit_us) {
+    struct esp_timer *best = NULL;
+    for (int i = 0; i < HOST_MAX_TIMERS; i++) {
+        struct esp_timer *t = &timers[i];
+        if (t->used && t->active && t->due_us <= limit_us && (best == NULL || t->due_us < best->due_us)) {
+            best = t;
+        }
+    }
+    return best;
+}
+
+static void fire(struct esp_timer *t) {
+    if (t->period_us) {
+        t->due_us += (int64_t)t->period_us;
+    } else {
+        t->active = false;
+    }
+    t->callback(t->arg);
+}
+
+void host_clock_advance_us(int64_t us) {
+    if (!clock_manual) {
+        host_timers_run_due();
+        return;
+    }
+    int64_t target = manual_now_us + us;
+    struct esp_timer *t;
+    while ((t = next_due(target)) != NULL) {
+        if (t->due_us > manual_now_us) {
+            manual_now_us = t->due_us;
+        }
+        fire(t);
+    }
+    manual_now_us = target;
+}
+
+void host_timers_run_due(void) {
+    int64_t now = esp_timer_get_time();
+    struct esp_timer *t;
+    while ((t = next_due(now)) != NULL) {
+        fire(t);
+    }
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle) {
+    if (create_args == NULL || create_args->callback == NULL || out_handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (int i = 0; i < HOST_MAX_TIMERS; i++) {
+        if (!timers[i].used) {
+            timers[i] = (struct esp_timer) {
+                .callback = create_args->callback,
+                .arg = create_args->arg,
+                .name = create_args->name,
+                .used = true,
+            };
+            *out_handle = &timers[i];
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) {
+    if (timer->active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->period_us = 0;
+    timer->due_us = esp_timer_get_time() + (int64_t)timeout_us;
+    timer->active = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period) {
+    if (timer->active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->period_us = period;
+    timer->due_us = esp_timer_get_time() + (int64_t)period;
+    timer->active = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+    if (!timer->active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->active = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+    if (timer->active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->used = false;
+    return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer) {
+    return timer->active;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack_depth,
+                       void *arg, UBaseType_t priority, TaskHandle_t *out_handle) {
+    (void)fn;
+    (void)arg;
+    if (task_count >= HOST_MAX_TASKS) {
+        return pdFAIL;
+    }
+    struct host_task *t = &tasks[task_count++];
+    t->name = name;
+    t->stack_depth = stack_depth;
+    t->priority = priority;
+    if (out_handle) {
+        *out_handle = t;
+    }
+    return pdPASS;
+}
+
+/* Host tasks never run, so the stack is only recorded. */
+TaskHandle_t xTaskCreateStatic(TaskFunction_t fn, const char *name, uint32_t stack_depth, void *arg,
+                               UBaseType_t priority, StackType_t *stack, StaticTask_t *tcb) {
+    (void)stack;
+    (void)tcb;
+    TaskHandle_t handle = NULL;
+    xTaskCreate(fn, name, stack_depth, arg, priority, &handle);
+    return handle;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+    return task ? task->stack_depth : 0;
+}
+
+void vTaskDelay(TickType_t ticks) {
+    if (clock_manual) {
+        host_clock_advance_us((int64_t)ticks * 1000 * portTICK_PERIOD_MS);
+    }
+}
+
+TickType_t xTaskGetTickCount(void) {
+    return (TickType_t)(esp_timer_get_time() / (1000 * portTICK_PERIOD_MS));
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+    return &main_task;
+}
+
+char *pcTaskGetName(TaskHandle_t task) {
+    return (char *)(task ? task : &main_task)->name;
+}
+
+/* GPIO ISRs and the LCD transfer-done callback run inline
+ * on the host; they bracket themselves with these so code that checks
+ * xPortInIsrContext() sees the same context it would on the target. */
+static int isr_depth;
+
+void host_isr_enter(void) {
+    isr_depth++;
+}
+
+void host_isr_exit(void) {
+    isr_depth--;
+}
+
+BaseType_t xPortInIsrContext(void) {
+    return isr_depth > 0;
+}
+
+static void notify(TaskHandle_t task, uint32_t value, eNotifyAction action) {
+    switch (action) {
+        case eSetBits: task->notify_value |= value; break;
+        case eIncrement: task->notify_value++; break;
+        case eSetValueWithOverwrite:
+        case eSetValueWithoutOverwrite: task->notify_value = value; break;
+        default: break;
+    }
+    task->notify_pending = true;
+}
+
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action) {
+    notify(task, value, action);
+    return pdPASS;
+}
+
+BaseType_t xTaskNotifyFromISR(TaskHandle_t task, uint32_t value, eNotifyAction action, BaseType_t *woken) {
+    notify(task, value, action);
+    if (woken) {
+        *woken = pdFALSE;
+    }
+    return pdPASS;
+}
+
+/* Host code runs on a single thread, so a wait never blocks: it consumes a
+ * pending notification or lets the (manual) clock run out the timeout. */
+BaseType_t xTaskNotifyWait(uint32_t clear_on_entry, uint32_t clear_on_exit, uint32_t *value, TickType_t ticks) {
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    self->notify_value &= ~clear_on_entry;
+    if (!self->notify_pending) {
+        if (ticks != portMAX_DELAY) {
+            vTaskDelay(ticks);
+        }
+        return pdFALSE;
+    }
+    if (value) {
+        *value = self->notify_value;
+    }
+    self->notify_value &= ~clear_on_exit;
+    self->notify_pending = false;
+    return pdTRUE;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+    struct host_sem *s = calloc(1, sizeof(*s));
+    if (s) {
+        s->count = 1;
+    }
+    return s;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks) {
+    (void)ticks;
+    if (sem->count == 0) {
+        return pdFALSE;
+    }
+    sem->count--;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+    sem->count++;
+    return pdTRUE;
+}
+
+/* Queues never block: a receive on an empty queue lets the virtual clock run
+ * for the timeout instead (which may fire timers that fill it), mirroring
+ * xTaskNotifyWait above. */
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+    struct host_queue *q = calloc(1, sizeof(*q));
+    if (q == NULL) {
+        return NULL;
+    }
+    q->items = calloc(length, item_size);
+    if (q->items == NULL) {
+        free(q);
+        return NULL;
+    }
+    q->length = length;
+    q->item_size = item_size;
+    return q;
+}
+
+void vQueueDelete(QueueHandle_t queue) {
+    if (queue) {
+        free(queue->items);
+        free(queue);
+    }
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks) {
+    (void)ticks;
+    if (queue->count == queue->length) {
+        return pdFALSE;
+    }
+    UBaseType_t slot = (queue->head + queue->count) % queue->length;
+    memcpy(queue->items + slot * queue->item_size, item, queue->item_size);
+    queue->count++;
+    return pdTRUE;
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void *item, BaseType_t *woken) {
+    if (woken) {
+        *woken = pdFALSE;
+    }
+    return xQueueSend(queue, item, 0);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks) {
+    if (queue->count == 0 && ticks != 0 && ticks != portMAX_DELAY) {
+        vTaskDelay(ticks);
+    }
+    if (queue->count == 0) {
+        return pdFALSE;
+    }
+    memcpy(item, queue->items + queue->head * queue->item_size, queue->item_size);
+    queue->head = (queue->head + 1) % queue->length;
+    queue->count--;
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    return queue->count;
+}
+
+void *heap_caps_malloc(size_t size, uint32_t caps) {
+    (void)caps;
+    heap_allocs++;
+    return malloc(size);
+}
+
+void *heap_caps_calloc(size_t n, size_t size, uint32_t caps) {
+    (void)caps;
+    heap_allocs++;
+    return calloc(n, size);
+}
+
+void heap_caps_free(void *ptr) {
+    free(ptr);
+}
+
+/* The host heap is the process heap; there is nothing meaningful to report. */
+size_t heap_caps_get_free_size(uint32_t caps) {
+    (void)caps;
+    return 0;
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps) {
+    (void)caps;
+    return 0;
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps) {
+    (void)caps;
+    return 0;
+}
+
+uint32_t host_heap_alloc_count(void) {
+    return heap_allocs;
+}
+
+uint32_t esp_get_free_heap_size(void) {
+    return 0;
+}
+
+#define HOST_MAX_SHUTDOWN_HANDLERS 8
+static shutdown_handler_t shutdown_handlers[HOST_MAX_SHUTDOWN_HANDLERS];
+
+esp_err_t esp_register_shutdown_handler(shutdown_handler_t handle) {
+    for (int i = 0; i < HOST_MAX_SHUTDOWN_HANDLERS; i++) {
+        if (shutdown_handlers[i] == NULL) {
+            shutdown_handlers[i] = handle;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+void esp_restart(void) {
+    for (int i = HOST_MAX_SHUTDOWN_HANDLERS - 1; i >= 0; i--) {
+        if (shutdown_handlers[i]) {
+            shutdown_handlers[i]();
+        }
+    }
+    fprintf(stderr, "esp_restart() called on host\n");
+    exit(1);
+}
+
+void esp_log_level_set(const char *tag, esp_log_level_t level) {
+    (void)tag;
+    host_log_level = level;
+}
+
+const char *esp_err_to_name(esp_err_t code) {
+    switch (code) {
+        case ESP_OK: return "ESP_OK";
+        case ESP_FAIL: return "ESP_FAIL";
+        case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+        case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+        case ESP_ERR_TIMEOUT: return "ESP_ERR_TIMEOUT";
+        case ESP_ERR_INVALID_CRC: return "ESP_ERR_INVALID_CRC";
+        default: return "UNKNOWN";
+    }
+}
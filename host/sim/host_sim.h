@@ -0,0 +1,85 @@
+#ifndef HOST_SIM_H
+#define HOST_SIM_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define HOST_FB_WIDTH   240
+#define HOST_FB_HEIGHT  240
+
+typedef struct {
+    uint32_t draw_calls;
+    uint64_t pixels;
+    uint64_t bytes;
+} host_lcd_stats_t;
+
+void host_clock_set_manual(bool manual);
+bool host_clock_is_manual(void);
+void host_clock_advance_us(int64_t us);
+void host_timers_run_due(void);
+void host_isr_enter(void);
+void host_isr_exit(void);
+
+uint16_t host_fb_get_pixel(int x, int y);
+int host_fb_write_ppm(const char *path);
+int host_fb_write_png(const char *path);
+int host_fb_diff_png(const char *path, int tolerance);
+void host_lcd_get_stats(host_lcd_stats_t *stats);
+void host_lcd_reset_stats(void);
+bool host_lcd_is_on(void);
+bool host_lcd_is_asleep(void);
+
+uint32_t host_heap_alloc_count(void);
+
+void host_gpio_set_input(int gpio, int level);
+int host_gpio_get_output(int gpio);
+typedef void (*host_gpio_watch_cb_t)(int gpio, int level);
+void host_gpio_watch(int gpio, host_gpio_watch_cb_t cb);
+
+typedef struct {
+    uint8_t addr;
+    void *ctx;
+    int (*write)(void *ctx, const uint8_t *data, size_t len);
+    int (*read)(void *ctx, uint8_t *data, size_t len);
+} host_i2c_device_t;
+
+void host_i2c_attach(const host_i2c_device_t *dev);
+
+typedef struct {
+    uint32_t pages;
+    uint32_t sets;
+    uint32_t commits;
+    uint32_t entry_writes;
+    uint64_t bytes_written;
+    uint32_t page_erases;
+    uint32_t max_page_erases;
+    uint32_t erases_per_page[64];
+    uint32_t gc_runs;
+    uint64_t busy_us;
+} host_nvs_stats_t;
+
+void host_nvs_set_size(const char *label, size_t bytes);
+void host_nvs_get_stats(const char *label, host_nvs_stats_t *stats);
+void host_nvs_reset(void);
+
+typedef struct {
+    uint32_t sectors;
+    uint32_t reads;
+    uint64_t read_bytes;
+    uint32_t writes;
+    uint64_t write_bytes;
+    uint32_t erases;
+    uint32_t max_sector_erases;
+    uint32_t erases_per_sector[64];
+    uint32_t torn;
+    uint64_t busy_us;
+} host_flash_stats_t;
+
+void host_flash_cut_after(uint32_t ops);
+bool host_flash_powered(void);
+void host_flash_power_on(void);
+void host_flash_get_stats(const char *label, host_flash_stats_t *stats);
+void host_flash_reset_stats(void);
+void host_flash_reset(void);
+
+#endif
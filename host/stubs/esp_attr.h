@@ -0,0 +1,7 @@
+#ifndef HOST_ESP_ATTR_H
+#define HOST_ESP_ATTR_H
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define DMA_ATTR
+#define RTC_NOINIT_ATTR
+#endif
@@ -0,0 +1,12 @@
+#ifndef HOST_ESP_LCD_PANEL_VENDOR_H
+#define HOST_ESP_LCD_PANEL_VENDOR_H
+#include "esp_err.h"
+#include "esp_lcd_types.h"
+typedef struct {
+    int reset_gpio_num;
+    lcd_rgb_endian_t rgb_endian;
+    unsigned int bits_per_pixel;
+} esp_lcd_panel_dev_config_t;
+esp_err_t esp_lcd_new_panel_gc9a01(esp_lcd_panel_io_handle_t io, const esp_lcd_panel_dev_config_t *panel_dev_config,
+                                   esp_lcd_panel_handle_t *ret_panel);
+#endif
@@ -0,0 +1,7 @@
+#ifndef HOST_ESP_LCD_TYPES_H
+#define HOST_ESP_LCD_TYPES_H
+typedef struct esp_lcd_panel_io_t *esp_lcd_panel_io_handle_t;
+typedef struct esp_lcd_panel_t *esp_lcd_panel_handle_t;
+typedef void *esp_lcd_spi_bus_handle_t;
+typedef enum { LCD_RGB_ENDIAN_RGB = 0, LCD_RGB_ENDIAN_BGR } lcd_rgb_endian_t;
+#endif
@@ -0,0 +1,5 @@
+#ifndef HOST_ESP_SLEEP_H
+#define HOST_ESP_SLEEP_H
+#include "esp_err.h"
+esp_err_t esp_sleep_enable_gpio_wakeup(void);
+#endif
@@ -0,0 +1,10 @@
+#ifndef HOST_ESP_SYSTEM_H
+#define HOST_ESP_SYSTEM_H
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_attr.h"
+typedef void (*shutdown_handler_t)(void);
+void esp_restart(void);
+esp_err_t esp_register_shutdown_handler(shutdown_handler_t handle);
+uint32_t esp_get_free_heap_size(void);
+#endif
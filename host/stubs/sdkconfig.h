@@ -0,0 +1,70 @@
+#ifndef HOST_SDKCONFIG_H
+#define HOST_SDKCONFIG_H
+/* Host builds take project options from CMake (-DPGPEMU_TRACE=ON) instead of
+ * menuconfig; anything not set there keeps the Kconfig default. */
+#ifndef CONFIG_PGPEMU_PRESS_DELAY_MS
+#define CONFIG_PGPEMU_PRESS_DELAY_MS 300
+#endif
+#ifndef CONFIG_PGPEMU_MAX_LINKS
+#define CONFIG_PGPEMU_MAX_LINKS 3
+#endif
+#ifndef CONFIG_PGPEMU_PERSIST_BATCH
+#define CONFIG_PGPEMU_PERSIST_BATCH 16
+#endif
+#ifndef CONFIG_PGPEMU_PERSIST_PERIOD_S
+#define CONFIG_PGPEMU_PERSIST_PERIOD_S 120
+#endif
+#ifndef CONFIG_PGPEMU_UI_CACHED_RENDER
+#define CONFIG_PGPEMU_UI_CACHED_RENDER 1
+#endif
+#ifndef CONFIG_PGPEMU_UI_FREE_HIDDEN_SCREENS
+#define CONFIG_PGPEMU_UI_FREE_HIDDEN_SCREENS 1
+#endif
+#ifndef CONFIG_PGPEMU_DRAW_BUF_LINES
+#define CONFIG_PGPEMU_DRAW_BUF_LINES 40
+#endif
+#ifndef CONFIG_PGPEMU_LCD_ROUND_CLIP
+#define CONFIG_PGPEMU_LCD_ROUND_CLIP 1
+#endif
+#ifndef CONFIG_PGPEMU_MEM_REPORT_S
+#define CONFIG_PGPEMU_MEM_REPORT_S 300
+#endif
+#ifndef CONFIG_PGPEMU_UI_WIPE_MS
+#define CONFIG_PGPEMU_UI_WIPE_MS 200
+#endif
+#ifndef CONFIG_PGPEMU_UI_ANIM_FPS
+#define CONFIG_PGPEMU_UI_ANIM_FPS 30
+#endif
+#ifndef CONFIG_PGPEMU_SWIPE_LATENCY_MS
+#define CONFIG_PGPEMU_SWIPE_LATENCY_MS 50
+#endif
+#ifndef CONFIG_PGPEMU_TRACE
+#define CONFIG_PGPEMU_TRACE 0
+#endif
+#ifndef CONFIG_PGPEMU_DIM_TIMEOUT_S
+#define CONFIG_PGPEMU_DIM_TIMEOUT_S 20
+#endif
+#ifndef CONFIG_PGPEMU_SLEEP_TIMEOUT_S
+#define CONFIG_PGPEMU_SLEEP_TIMEOUT_S 60
+#endif
+#ifndef CONFIG_PGPEMU_BACKLIGHT_PERCENT
+#define CONFIG_PGPEMU_BACKLIGHT_PERCENT 100
+#endif
+#ifndef CONFIG_PGPEMU_BACKLIGHT_DIM_PERCENT
+#define CONFIG_PGPEMU_BACKLIGHT_DIM_PERCENT 20
+#endif
+/* The simulated board in cst816_sim.c has the touch INT and RST lines wired,
+ * unlike the Kconfig defaults. */
+#ifndef CONFIG_PGPEMU_TOUCH_INT_GPIO
+#define CONFIG_PGPEMU_TOUCH_INT_GPIO 0
+#endif
+#ifndef CONFIG_PGPEMU_TOUCH_RST_GPIO
+#define CONFIG_PGPEMU_TOUCH_RST_GPIO 1
+#endif
+#ifndef CONFIG_PGPEMU_PORTAL_STREAM_MS
+#define CONFIG_PGPEMU_PORTAL_STREAM_MS 1000
+#endif
+#if CONFIG_PGPEMU_TRACE && !defined(CONFIG_PGPEMU_TRACE_RING_SIZE)
+#define CONFIG_PGPEMU_TRACE_RING_SIZE 512
+#endif
+#endif
@@ -0,0 +1,173 @@
+/* Battery telemetry: the discharge curve, the median/IIR filter and the
+ * time-to-empty fit, then a recorded discharge trace through the same
+ * path the sample timer feeds on the device. */
+#include "battery.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TRACE_MAX       4096
+#define TTE_SETTLE_S    (45 * 60)
+#define TTE_TOLERANCE   15
+
+static int failures;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        failures++; \
+    } \
+} while (0)
+
+static uint32_t trace_t[TRACE_MAX];
+static uint16_t trace_mv[TRACE_MAX];
+static int trace_len;
+static uint32_t trace_empty_s;
+
+static uint8_t published[TRACE_MAX];
+static int publish_count;
+
+static void on_publish(uint8_t percent) {
+    if (publish_count < TRACE_MAX) {
+        published[publish_count++] = percent;
+    }
+}
+
+/* "time_s mV" per line; "# empty_s N" gives when the cell runs flat. */
+static int load_trace(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        perror(path);
+        return -1;
+    }
+    char line[128];
+    while (fgets(line, sizeof(line), f) && trace_len < TRACE_MAX) {
+        unsigned long t, mv;
+        if (sscanf(line, "# empty_s %lu", &t) == 1) {
+            trace_empty_s = (uint32_t)t;
+        } else if (line[0] != '#' && sscanf(line, "%lu %lu", &t, &mv) == 2) {
+            trace_t[trace_len] = (uint32_t)t;
+            trace_mv[trace_len] = (uint16_t)mv;
+            trace_len++;
+        }
+    }
+    fclose(f);
+    return trace_len > 0 ? 0 : -1;
+}
+
+static void test_curve(void) {
+    CHECK(battery_permille_from_mv(4300) == 1000);
+    CHECK(battery_permille_from_mv(4200) == 1000);
+    CHECK(battery_permille_from_mv(3845) == 525);
+    CHECK(battery_permille_from_mv(3270) == 0);
+    CHECK(battery_permille_from_mv(2900) == 0);
+    uint16_t prev = 0;
+    for (uint16_t mv = 3000; mv <= 4300; mv++) {
+        uint16_t pm = battery_permille_from_mv(mv);
+        CHECK(pm >= prev);
+        prev = pm;
+    }
+}
+
+static void test_filter(void) {
+    battery_filter_t f;
+    battery_filter_init(&f, 3);
+    CHECK(battery_filter_step(&f, 3800) == 3800);
+    for (int i = 0; i < 10; i++) {
+        CHECK(battery_filter_step(&f, 3800) == 3800);
+    }
+    /* Isolated sags never reach the output; two in a row still don't. */
+    CHECK(battery_filter_step(&f, 3700) == 3800);
+    CHECK(battery_filter_step(&f, 3720) == 3800);
+    CHECK(battery_filter_step(&f, 3800) == 3800);
+    /* A real step gets there within a few time constants. */
+    uint16_t out = 0;
+    for (int i = 0; i < 60; i++) {
+        out = battery_filter_step(&f, 3900);
+    }
+    CHECK(out == 3900);
+}
+
+static void test_tte(void) {
+    battery_tte_t t;
+    battery_tte_init(&t);
+    CHECK(battery_tte_minutes(&t) == BATTERY_TTE_UNKNOWN);
+    /* 1 permille a minute from 600: 600 minutes left at the start. */
+    for (uint32_t s = 0; s <= 20 * 60; s += 10) {
+        battery_tte_add(&t, s, (uint16_t)(600 - s / 60));
+    }
+    CHECK(t.count == 21);
+    CHECK(battery_tte_minutes(&t) == 580);
+    /* Flat or charging has no estimate. */
+    battery_tte_init(&t);
+    for (uint32_t s = 0; s <= 20 * 60; s += 60) {
+        battery_tte_add(&t, s, (uint16_t)(500 + s / 120));
+    }
+    CHECK(battery_tte_minutes(&t) == BATTERY_TTE_UNKNOWN);
+}
+
+static void test_trace(const char *path) {
+    if (load_trace(path) != 0 || trace_empty_s == 0) {
+        fprintf(stderr, "%s: no usable trace\n", path);
+        failures++;
+        return;
+    }
+    battery_reset();
+    battery_set_cb(on_publish);
+    battery_state_t st;
+    uint16_t floor_mv = UINT16_MAX;
+    int rise_max = 0, tte_err_max = 0;
+    for (int i = 0; i < trace_len; i++) {
+        battery_feed_mv(trace_t[i], trace_mv[i]);
+        battery_get(&st);
+        if (i >= BATTERY_MEDIAN_LEN) {
+            if (st.filtered_mv < floor_mv) {
+                floor_mv = st.filtered_mv;
+            } else if (st.filtered_mv - floor_mv > rise_max) {
+                rise_max = st.filtered_mv - floor_mv;
+            }
+        }
+        if (trace_t[i] >= TTE_SETTLE_S && trace_t[i] < trace_empty_s) {
+            CHECK(st.tte_min != BATTERY_TTE_UNKNOWN);
+            int left_min = (int)(trace_empty_s - trace_t[i]) / 60;
+            int err_pct = abs((int)st.tte_min - left_min) * 100 / (left_min > 30 ? left_min : 30);
+            if (err_pct > tte_err_max) {
+                tte_err_max = err_pct;
+            }
+        }
+    }
+    battery_set_cb(NULL);
+
+    /* Noise and sags must not make the level bounce back up. */
+    CHECK(rise_max <= 3);
+    /* Published percentages only go down, a step of about one at a time. */
+    CHECK(publish_count == (int)st.published);
+    int drop = publish_count ? published[0] - published[publish_count - 1] : 0;
+    for (int i = 1; i < publish_count; i++) {
+        CHECK(published[i] <= published[i - 1]);
+        CHECK(published[i - 1] - published[i] <= 2);
+    }
+    CHECK(publish_count <= drop + drop / 4 + 1);
+    CHECK(tte_err_max <= TTE_TOLERANCE);
+
+    printf("battery: %d samples, %d published (%u%% -> %u%%), filtered rise max %d mV, "
+           "tte error max %d%%\n", trace_len, publish_count, publish_count ? published[0] : 0,
+           publish_count ? published[publish_count - 1] : 0, rise_max, tte_err_max);
+}
+
+int main(int argc, char **argv) {
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s TRACE\n", argv[0]);
+        return 2;
+    }
+    test_curve();
+    test_filter();
+    test_tte();
+    test_trace(argv[1]);
+    if (failures) {
+        fprintf(stderr, "battery_test: %d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("battery_test: ok\n");
+    return 0;
+}
@@ -0,0 +1,176 @@
+/* Button debouncer and gesture timing against the simulated GPIO and the
+ * manual virtual clock. Every press is fed with contact bounce so the
+ * debounce path is exercised along with the gesture state machine. */
+#include "button.h"
+#include "host_sim.h"
+#include "esp_timer.h"
+#include <stdio.h>
+
+#define PIN     GPIO_NUM_9
+
+static int failures;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        failures++; \
+    } \
+} while (0)
+
+static void advance_ms(int ms) {
+    host_clock_advance_us((int64_t)ms * 1000);
+}
+
+/* Drives the pin to level with a few 300 us bounces first. */
+static void bouncy_edge(int level) {
+    for (int i = 0; i < 3; i++) {
+        host_gpio_set_input(PIN, level);
+        host_clock_advance_us(300);
+        host_gpio_set_input(PIN, !level);
+        host_clock_advance_us(300);
+    }
+    host_gpio_set_input(PIN, level);
+}
+
+static void press(int hold_ms) {
+    bouncy_edge(0);
+    advance_ms(hold_ms);
+    bouncy_edge(1);
+}
+
+static int drain(button_event_t *last) {
+    int n = 0;
+    button_event_t evt;
+    while (button_get_event(&evt, 0)) {
+        *last = evt;
+        n++;
+    }
+    return n;
+}
+
+static void test_boot_hold(void) {
+    button_event_t evt;
+    advance_ms(2100);
+    CHECK(drain(&evt) == 1);
+    CHECK(evt.type == BUTTON_EVT_BOOT_HOLD);
+    CHECK(evt.held_ms >= 2000);
+
+    bouncy_edge(1);
+    advance_ms(500);
+    CHECK(drain(&evt) == 0);
+    CHECK(!button_is_pressed());
+}
+
+/* Still inside the boot window: a hold shorter than boot_hold_ms is a long
+ * press reported on release, a longer one the boot hold. */
+static void test_boot_window(void) {
+    button_event_t evt;
+    bouncy_edge(0);
+    advance_ms(1200);
+    CHECK(drain(&evt) == 0);
+    bouncy_edge(1);
+    advance_ms(30);
+    CHECK(drain(&evt) == 1);
+    CHECK(evt.type == BUTTON_EVT_LONG_PRESS);
+    CHECK(evt.held_ms >= 1200);
+
+    bouncy_edge(0);
+    advance_ms(2100);
+    CHECK(drain(&evt) == 1);
+    CHECK(evt.type == BUTTON_EVT_BOOT_HOLD);
+    bouncy_edge(1);
+    advance_ms(500);
+    CHECK(drain(&evt) == 0);
+}
+
+static void test_click(void) {
+    button_event_t evt;
+    int64_t t0 = esp_timer_get_time();
+    press(80);
+    int64_t released = esp_timer_get_time();
+
+    advance_ms(200);
+    CHECK(drain(&evt) == 0);    /* still inside the double-click window */
+    advance_ms(100);
+    CHECK(drain(&evt) == 1);
+    CHECK(evt.type == BUTTON_EVT_CLICK);
+    CHECK(evt.press_time_us >= t0 && evt.press_time_us < t0 + 1000);
+    /* Reported no later than debounce + double-click window after release. */
+    CHECK(esp_timer_get_time() - released <= (20 + 250 + 40) * 1000);
+}
+
+static void test_double_click(void) {
+    button_event_t evt;
+    press(60);
+    advance_ms(100);
+    press(60);
+    advance_ms(30);
+    CHECK(drain(&evt) == 1);
+    CHECK(evt.type == BUTTON_EVT_DOUBLE_CLICK);
+    advance_ms(500);
+    CHECK(drain(&evt) == 0);
+}
+
+static void test_long_press(void) {
+    button_event_t evt;
+    bouncy_edge(0);
+    advance_ms(700);
+    CHECK(drain(&evt) == 0);
+    advance_ms(150);
+    CHECK(drain(&evt) == 1);
+    CHECK(evt.type == BUTTON_EVT_LONG_PRESS);
+    CHECK(evt.held_ms >= 800);
+    advance_ms(1000);
+    bouncy_edge(1);
+    advance_ms(500);
+    CHECK(drain(&evt) == 0);
+}
+
+static void test_glitch(void) {
+    button_event_t evt;
+    button_stats_t before, after;
+    button_get_stats(&before);
+    host_gpio_set_input(PIN, 0);
+    host_clock_advance_us(1000);
+    host_gpio_set_input(PIN, 1);
+    advance_ms(500);
+    button_get_stats(&after);
+    CHECK(drain(&evt) == 0);
+    CHECK(after.bounces == before.bounces + 1);
+}
+
+static void test_idle_costs_nothing(void) {
+    button_stats_t before, after;
+    button_get_stats(&before);
+    advance_ms(10000);
+    button_get_stats(&after);
+    CHECK(after.edges == before.edges);
+    CHECK(after.events == before.events);
+}
+
+int main(void) {
+    host_clock_set_manual(true);
+
+    /* Pressed at init, inside the boot window: the boot-hold gesture. */
+    host_gpio_set_input(PIN, 0);
+    button_config_t cfg = BUTTON_CONFIG_DEFAULT(PIN);
+    CHECK(button_init(&cfg) == ESP_OK);
+    CHECK(button_is_pressed());
+
+    test_boot_hold();
+    test_boot_window();
+    /* Past the boot window every hold is a plain long press. */
+    advance_ms(5000);
+    test_click();
+    test_double_click();
+    test_long_press();
+    test_glitch();
+    test_idle_costs_nothing();
+
+    if (failures) {
+        fprintf(stderr, "button_test: %d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("button_test: ok\n");
+    return 0;
+}
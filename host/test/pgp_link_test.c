@@ -0,0 +1,240 @@
+/* The link table against a set of simulated centrals: account slots across
+ * reconnects, per-account flags, and press scheduling when several phones
+ * want a press at the same moment. Time is a plain microsecond counter
+ * stepped the way pgpemu_task sleeps, one millisecond at a time. */
+#include "pgp_link.h"
+#include <stdio.h>
+#include <string.h>
+
+#define DELAY_MS        300
+#define GAP_US          20000
+#define RESULT_MS       1500
+#define LED_WINDOW_MS   3000
+#define MAX_CENTRALS    PGP_LINK_MAX
+
+static int failures;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        failures++; \
+    } \
+} while (0)
+
+static const uint8_t led_pokemon[] = { 0, 0, 0, 0x02, 0x05, 0xf0, 0x80, 0x05, 0x00, 0x80 };
+static const uint8_t led_pokestop[] = { 0, 0, 0, 0x02, 0x05, 0x00, 0x0f, 0x05, 0x00, 0x00 };
+static const uint8_t led_success[] = { 0, 0, 0, 0x03, 0x03, 0x0f, 0x80, 0x03, 0xf0, 0x80, 0x03, 0x00, 0x8f };
+
+/* A phone running the app: it lights the LED for an encounter on its own
+ * schedule and, when the press comes back inside the LED window, reports
+ * a catch RESULT_MS later. */
+typedef struct {
+    uint8_t addr[PGP_LINK_ADDR_LEN];
+    uint16_t conn_id;
+    int slot;
+    int64_t first_us;
+    int64_t period_us;
+    int64_t next_led_us;
+    int64_t led_us;
+    int64_t result_us;
+    bool answers;
+    uint32_t encounters;
+    uint32_t presses;
+    uint32_t late;
+    uint32_t latency_us_max;
+} central_t;
+
+static void central_init(central_t *c, uint8_t id, int64_t first_ms, int64_t period_ms, bool answers) {
+    memset(c, 0, sizeof(*c));
+    c->addr[0] = 0xC0;
+    c->addr[5] = id;
+    c->conn_id = id;
+    c->first_us = first_ms * 1000;
+    c->period_us = period_ms * 1000;
+    c->next_led_us = c->first_us;
+    c->led_us = -1;
+    c->result_us = -1;
+    c->answers = answers;
+}
+
+static void connect_all(pgp_links_t *t, central_t *c, int n, int64_t now) {
+    for (int i = 0; i < n; i++) {
+        c[i].slot = pgp_links_connect(t, c[i].conn_id, c[i].addr, now);
+        CHECK(c[i].slot >= 0);
+    }
+}
+
+static central_t *by_slot(central_t *c, int n, int slot) {
+    for (int i = 0; i < n; i++) {
+        if (c[i].slot == slot) {
+            return &c[i];
+        }
+    }
+    return NULL;
+}
+
+/* Runs the centrals and the emulator side by side until end_us. */
+static void run(pgp_links_t *t, central_t *c, int n, int64_t end_us) {
+    for (int64_t now = 0; now <= end_us; now += 1000) {
+        for (int i = 0; i < n; i++) {
+            if (c[i].result_us >= 0 && now >= c[i].result_us) {
+                c[i].result_us = -1;
+                pgp_links_on_led(t, c[i].slot, led_success, sizeof(led_success), now);
+            }
+            if (c[i].period_us > 0 && now >= c[i].next_led_us) {
+                c[i].next_led_us += c[i].period_us;
+                c[i].led_us = now;
+                c[i].encounters++;
+                pgp_links_on_led(t, c[i].slot, led_pokemon, sizeof(led_pokemon), now);
+            }
+        }
+        int slot;
+        while ((slot = pgp_links_poll(t, now)) >= 0) {
+            central_t *p = by_slot(c, n, slot);
+            pgp_links_press_sent(t, slot, now);
+            if (p == NULL || p->led_us < 0) {
+                continue;
+            }
+            uint32_t latency = (uint32_t)(now - p->led_us);
+            p->presses++;
+            p->late += latency > LED_WINDOW_MS * 1000;
+            if (latency > p->latency_us_max) {
+                p->latency_us_max = latency;
+            }
+            p->led_us = -1;
+            if (p->answers) {
+                p->result_us = now + RESULT_MS * 1000;
+            }
+        }
+        /* What pgpemu_task would sleep on must never lie in the past while
+         * a press is still waiting. */
+        int64_t next = pgp_links_next_deadline(t);
+        CHECK(next == PGP_NO_DEADLINE || next > now || pgp_links_poll(t, now) < 0);
+    }
+}
+
+/* Every phone sees an encounter at the same instant; each still gets its
+ * press and its catch, at most one press gap per other phone late. */
+static void test_simultaneous(void) {
+    pgp_links_t t;
+    central_t c[MAX_CENTRALS];
+    pgp_links_init(&t, DELAY_MS, GAP_US);
+    for (int i = 0; i < MAX_CENTRALS; i++) {
+        central_init(&c[i], (uint8_t)(i + 1), 1000, 10000, true);
+    }
+    connect_all(&t, c, MAX_CENTRALS, 0);
+    run(&t, c, MAX_CENTRALS, 60500000);
+
+    pgp_account_t acc[PGP_LINK_MAX];
+    CHECK(pgp_links_snapshot(&t, acc, PGP_LINK_MAX) == MAX_CENTRALS);
+    uint32_t bound = DELAY_MS * 1000 + (MAX_CENTRALS - 1) * GAP_US;
+    for (int i = 0; i < MAX_CENTRALS; i++) {
+        CHECK(c[i].encounters == 6);
+        CHECK(c[i].presses == c[i].encounters);
+        CHECK(c[i].latency_us_max <= bound);
+        CHECK(acc[c[i].slot].caught == c[i].encounters);
+    }
+    CHECK(t.stats.presses == 6 * MAX_CENTRALS);
+    CHECK(MAX_CENTRALS == 1 || (t.stats.deferred > 0 && t.stats.defer_us_max <= (MAX_CENTRALS - 1) * GAP_US));
+    printf("simultaneous: %d links, %lu presses, %lu deferred, latency max %lu us (bound %lu)\n",
+           MAX_CENTRALS, (unsigned long)t.stats.presses, (unsigned long)t.stats.deferred,
+           (unsigned long)c[MAX_CENTRALS - 1].latency_us_max, (unsigned long)bound);
+}
+
+/* One phone re-lights the LED every millisecond and never reports a
+ * result, so it has a press due every 301 ms. A second phone's encounter
+ * lands on exactly the same deadline as one of those; it loses the tie but
+ * goes out one press gap later, and the busy phone never shuts it out. */
+static void test_flood(void) {
+    if (MAX_CENTRALS < 2) {
+        return;
+    }
+    pgp_links_t t;
+    central_t c[2];
+    pgp_links_init(&t, DELAY_MS, GAP_US);
+    central_init(&c[0], 1, 0, 1, false);
+    central_init(&c[1], 2, 17 * (DELAY_MS + 1), 60000, true);
+    connect_all(&t, c, 2, 0);
+    run(&t, c, 2, 10000000);
+
+    CHECK(c[1].encounters == 1);
+    CHECK(c[1].presses == 1);
+    CHECK(c[1].latency_us_max == DELAY_MS * 1000 + GAP_US);
+    CHECK(c[0].presses > 30);
+    printf("flood: busy link %lu presses, quiet link latency %lu us\n", (unsigned long)c[0].presses,
+           (unsigned long)c[1].latency_us_max);
+}
+
+static void test_accounts(void) {
+    pgp_links_t t;
+    pgp_links_init(&t, DELAY_MS, GAP_US);
+    uint8_t addr[PGP_LINK_MAX + 1][PGP_LINK_ADDR_LEN];
+    for (int i = 0; i <= PGP_LINK_MAX; i++) {
+        memset(addr[i], 0, PGP_LINK_ADDR_LEN);
+        addr[i][5] = (uint8_t)(0x10 + i);
+    }
+    for (int i = 0; i < PGP_LINK_MAX; i++) {
+        CHECK(pgp_links_connect(&t, (uint16_t)i, addr[i], i) == i);
+    }
+    CHECK(pgp_links_connected(&t) == PGP_LINK_MAX);
+    CHECK(pgp_links_connect(&t, 99, addr[PGP_LINK_MAX], 10) == -1);
+    CHECK(t.stats.refused == 1);
+
+    /* A catch on slot 0 stays with slot 0 across a reconnect under a new
+     * conn_id. */
+    pgp_links_on_led(&t, 0, led_pokemon, sizeof(led_pokemon), 100);
+    CHECK(pgp_links_poll(&t, 100 + DELAY_MS * 1000) == 0);
+    pgp_links_press_sent(&t, 0, 100 + DELAY_MS * 1000);
+    CHECK(pgp_links_on_led(&t, 0, led_success, sizeof(led_success), 2000000) == PGP_RESULT_CAUGHT);
+    CHECK(pgp_links_disconnect(&t, 0, 3000000) == 0);
+    CHECK(pgp_links_find(&t, 0) == -1);
+    CHECK(pgp_links_connect(&t, 40, addr[0], 4000000) == 0);
+    CHECK(t.link[0].conn.stats.caught == 1);
+    for (int i = 1; i < PGP_LINK_MAX; i++) {
+        CHECK(t.link[i].conn.stats.caught == 0);
+    }
+
+    /* A new phone takes the slot disconnected longest. */
+    if (PGP_LINK_MAX >= 2) {
+        CHECK(pgp_links_disconnect(&t, 1, 5000000) == 1);
+        CHECK(pgp_links_disconnect(&t, 40, 6000000) == 0);
+        CHECK(pgp_links_connect(&t, 50, addr[PGP_LINK_MAX], 7000000) == 1);
+        CHECK(t.stats.recycled == 1);
+        CHECK(t.link[1].conn.stats.caught == 0);
+        CHECK(pgp_links_connect(&t, 51, addr[0], 8000000) == 0);
+        CHECK(t.link[0].conn.stats.caught == 1);
+    }
+
+    /* Account flags sit under the global toggles. */
+    int64_t now = 10000000;
+    CHECK(pgp_links_set_account_flags(&t, 0, false, true));
+    pgp_links_on_led(&t, 0, led_pokemon, sizeof(led_pokemon), now);
+    CHECK(t.link[0].conn.state == PGP_ST_IDLE);
+    pgp_links_on_led(&t, 0, led_pokestop, sizeof(led_pokestop), now);
+    CHECK(t.link[0].conn.state == PGP_ST_PRESS_PENDING);
+    pgp_links_cancel_press(&t, 0);
+    pgp_links_set_flags(&t, true, false);
+    pgp_links_on_led(&t, 0, led_pokestop, sizeof(led_pokestop), now);
+    CHECK(t.link[0].conn.state == PGP_ST_IDLE);
+    if (PGP_LINK_MAX >= 2) {
+        pgp_links_on_led(&t, 1, led_pokemon, sizeof(led_pokemon), now);
+        CHECK(t.link[1].conn.state == PGP_ST_PRESS_PENDING);
+    }
+    CHECK(!pgp_links_set_account_flags(&t, PGP_LINK_MAX, true, true));
+
+    /* LED writes on a link that is gone are dropped. */
+    CHECK(pgp_links_disconnect(&t, t.link[0].conn_id, now) == 0);
+    CHECK(pgp_links_on_led(&t, 0, led_success, sizeof(led_success), now) == PGP_RESULT_NONE);
+}
+
+int main(void) {
+    test_accounts();
+    test_simultaneous();
+    test_flood();
+    if (failures) {
+        fprintf(stderr, "pgp_link_test: %d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("pgp_link_test: ok\n");
+    return 0;
+}
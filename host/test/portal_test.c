@@ -0,0 +1,121 @@
+/* Portal handlers without a socket: the settings form parser, routing, and
+ * what happens when a response does not fit the caller's buffer. */
+#include "portal.h"
+#include "persist.h"
+#include "stats_history.h"
+#include "ui_queue.h"
+#include "esp_timer.h"
+#include <stdio.h>
+#include <string.h>
+
+static int failures;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        failures++; \
+    } \
+} while (0)
+
+static bool parse(const char *body, persist_state_t *s) {
+    const char *error = NULL;
+    bool ok = portal_parse_settings(body, strlen(body), s, &error);
+    CHECK(ok || error != NULL);
+    return ok;
+}
+
+static void test_parse(void) {
+    const persist_state_t base = { .autocatch = true, .autospin = true, .dim_s = 20, .off_s = 60 };
+    persist_state_t s = base;
+
+    CHECK(parse("", &s) && memcmp(&s, &base, sizeof(s)) == 0);
+    CHECK(parse("autocatch=0", &s) && !s.autocatch && s.autospin && s.dim_s == 20);
+    CHECK(parse("autocatch=on&autospin=false&dim_s=45&off_s=600", &s));
+    CHECK(s.autocatch && !s.autospin && s.dim_s == 45 && s.off_s == 600);
+
+    /* A rejected body leaves every field as it was. */
+    persist_state_t before = s;
+    CHECK(!parse("autospin=1&dim_s=0", &s));
+    CHECK(!parse("dim_s=3601", &s));
+    CHECK(!parse("off_s=12a", &s));
+    CHECK(!parse("off_s=30", &s));
+    CHECK(!parse("autocatch", &s));
+    CHECK(!parse("autocatch=yes", &s));
+    CHECK(!parse("volume=3", &s));
+    CHECK(memcmp(&s, &before, sizeof(s)) == 0);
+}
+
+static void test_routes(void) {
+    static char buf[PORTAL_RESP_MAX];
+    portal_resp_t r;
+
+    portal_handle(PORTAL_GET, "/", NULL, 0, buf, sizeof(buf), &r);
+    CHECK(r.status == 200 && strcmp(r.type, "text/html") == 0 && r.len > 0);
+    portal_handle(PORTAL_GET, "/api/settings?t=1", NULL, 0, buf, sizeof(buf), &r);
+    CHECK(r.status == 200 && r.body == buf);
+    portal_handle(PORTAL_GET, "/api/metrics/stream", NULL, 0, buf, sizeof(buf), &r);
+    CHECK(r.status == 200 && r.stream);
+    portal_handle(PORTAL_GET, "/api/nothing", NULL, 0, buf, sizeof(buf), &r);
+    CHECK(r.status == 404);
+    portal_handle(PORTAL_POST, "/api/metrics", NULL, 0, buf, sizeof(buf), &r);
+    CHECK(r.status == 405);
+    portal_handle(PORTAL_POST, "/api/settings", NULL, PORTAL_BODY_MAX + 1, buf, sizeof(buf), &r);
+    CHECK(r.status == 413);
+
+    /* A POST goes to persist and, through the portal's own mailbox, to the
+     * toggles on screen. */
+    ui_queue_batch_t batch;
+    while (ui_queue_drain(&batch)) {
+    }
+    const char *form = "autocatch=0&autospin=1&dim_s=15&off_s=45";
+    portal_handle(PORTAL_POST, "/api/settings", form, strlen(form), buf, sizeof(buf), &r);
+    CHECK(r.status == 200);
+    persist_state_t ps;
+    persist_get(&ps);
+    CHECK(!ps.autocatch && ps.autospin && ps.dim_s == 15 && ps.off_s == 45);
+    CHECK(ui_queue_drain(&batch) && (batch.mask & (1UL << UI_FIELD_SETTINGS)));
+    CHECK((batch.value[UI_FIELD_SETTINGS] & 3) == 2);
+
+    portal_stats_t st;
+    portal_get_stats(&st);
+    CHECK(st.requests == 7 && st.errors == 3 && st.settings_writes == 1);
+}
+
+/* Responses that do not fit become a fixed error and never write past the
+ * buffer the caller passed in. */
+static void test_overflow(void) {
+    char buf[64 + 8];
+    portal_resp_t r;
+    memset(buf, 0x5a, sizeof(buf));
+    portal_handle(PORTAL_GET, "/api/metrics", NULL, 0, buf, 64, &r);
+    CHECK(r.status == 500 && r.body != buf);
+    for (size_t i = 64; i < sizeof(buf); i++) {
+        CHECK(buf[i] == 0x5a);
+    }
+    CHECK(portal_metrics_event(buf, 64) == 0);
+
+    static char event[PORTAL_EVENT_MAX];
+    size_t n = portal_metrics_event(event, sizeof(event));
+    CHECK(n > 0 && strncmp(event, "data: {", 7) == 0 && strcmp(event + n - 3, "}\n\n") == 0);
+
+    portal_stats_t st;
+    portal_get_stats(&st);
+    CHECK(st.overflows == 2 && st.events == 1);
+}
+
+int main(void) {
+    persist_config_t cfg = PERSIST_CONFIG_DEFAULT();
+    if (persist_init(&cfg) != ESP_OK) {
+        return 1;
+    }
+    stats_history_init(esp_timer_get_time());
+    test_parse();
+    test_routes();
+    test_overflow();
+    if (failures) {
+        fprintf(stderr, "portal_test: %d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("portal_test: ok\n");
+    return 0;
+}
@@ -0,0 +1,116 @@
+/* Idle power policy against the simulated panel, backlight and touch
+ * controller on the manual virtual clock: dim, sleep, the wake sources and
+ * the residency accounting. */
+#include "power.h"
+#include "display_port.h"
+#include "lvgl_sched.h"
+#include "cst816_touch.h"
+#include "cst816_sim.h"
+#include "host_sim.h"
+#include "driver/ledc.h"
+#include "esp_timer.h"
+#include <stdio.h>
+
+#define DIM_MS          2000
+#define OFF_MS          5000
+
+static int failures;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        failures++; \
+    } \
+} while (0)
+
+static void advance_ms(int ms) {
+    host_clock_advance_us((int64_t)ms * 1000);
+}
+
+static uint32_t backlight(void) {
+    return ledc_get_duty(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL_0);
+}
+
+int main(void) {
+    host_clock_set_manual(true);
+    cst816_sim_attach(CONFIG_PGPEMU_TOUCH_INT_GPIO);
+    cst816_sim_attach_reset(CONFIG_PGPEMU_TOUCH_RST_GPIO);
+    display_port_init();
+    display_port_init_touch();
+
+    power_config_t cfg = POWER_CONFIG_DEFAULT();
+    cfg.dim_ms = DIM_MS;
+    cfg.off_ms = OFF_MS;
+    CHECK(power_init(&cfg) == ESP_OK);
+    int64_t start = esp_timer_get_time();
+    uint32_t full = backlight();
+    CHECK(full > 0);
+
+    /* Activity before the dim timeout pushes it back. */
+    advance_ms(DIM_MS - 500);
+    power_activity(POWER_SRC_TOUCH);
+    advance_ms(1000);
+    power_service();
+    CHECK(power_get_state() == POWER_STATE_ACTIVE);
+
+    advance_ms(DIM_MS);
+    power_service();
+    CHECK(power_get_state() == POWER_STATE_DIM);
+    CHECK(backlight() > 0 && backlight() < full);
+    CHECK(host_lcd_is_on());
+
+    /* Touch still works while dim and brings the backlight back. */
+    power_activity(POWER_SRC_TOUCH);
+    power_service();
+    CHECK(power_get_state() == POWER_STATE_ACTIVE);
+    CHECK(backlight() == full);
+
+    advance_ms(OFF_MS + 10);
+    power_service();
+    CHECK(power_get_state() == POWER_STATE_OFF);
+    CHECK(backlight() == 0);
+    CHECK(!host_lcd_is_on());
+    CHECK(host_lcd_is_asleep());
+    CHECK(cst816_sim_sleeping());
+    CHECK(lvgl_sched_is_suspended());
+    CHECK(lvgl_sched_step(0) == LVGL_SCHED_SLEEP_FOREVER);
+
+    /* Nothing happens while dark until a wake source fires. */
+    advance_ms(60000);
+    power_service();
+    CHECK(power_get_state() == POWER_STATE_OFF);
+
+    power_activity(POWER_SRC_BUTTON);
+    power_service();
+    CHECK(power_get_state() == POWER_STATE_ACTIVE);
+    CHECK(host_lcd_is_on());
+    CHECK(!host_lcd_is_asleep());
+    CHECK(!cst816_sim_sleeping());
+    CHECK(!lvgl_sched_is_suspended());
+    CHECK(lvgl_sched_step(0) != LVGL_SCHED_SLEEP_FOREVER);
+    CHECK(backlight() == full);
+
+    power_stats_t st;
+    power_get_stats(&st);
+    uint64_t total = 0;
+    for (int i = 0; i < POWER_STATE_COUNT; i++) {
+        total += st.residency_us[i];
+    }
+    CHECK(total == (uint64_t)(esp_timer_get_time() - start));
+    CHECK(st.residency_us[POWER_STATE_OFF] >= 60000000ULL);
+    CHECK(st.wakes[POWER_SRC_TOUCH] == 1);
+    CHECK(st.wakes[POWER_SRC_BUTTON] == 1);
+    CHECK(st.entries[POWER_STATE_OFF] == 1);
+    CHECK(st.touch_sleeps == 1);
+
+    printf("power: active %llu ms, dim %llu ms, off %llu ms, wake %lu us\n",
+           (unsigned long long)(st.residency_us[POWER_STATE_ACTIVE] / 1000),
+           (unsigned long long)(st.residency_us[POWER_STATE_DIM] / 1000),
+           (unsigned long long)(st.residency_us[POWER_STATE_OFF] / 1000), (unsigned long)st.wake_us_last);
+    if (failures) {
+        fprintf(stderr, "power_test: %d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("power_test: ok\n");
+    return 0;
+}
@@ -0,0 +1,386 @@
+/* Scripted UI test: replays touches, button edges and PGP events against the
+ * real display_ui on the headless backend, on the manual virtual clock.
+ *
+ * Script lines are "<ms> <command> [args]", times from the start of the run:
+ *
+ *   touch X Y               finger down or moved to X,Y
+ *   gesture left|right|up|down   controller gesture code for the next release
+ *   release                 finger up
+ *   button down|up          BOOT button edge (GPIO9, active low)
+ *   connect | disconnect    BLE link to the app
+ *   led <hex bytes>         LED characteristic write, as in pgp_replay traces
+ *   stats CAUGHT SPUN BATT  counters as restored from NVS at boot, battery %
+ *   budget US               fail any later LVGL step that takes longer (0: off)
+ *   screen main|settings|stats   fail unless that screen is showing
+ *   check NAME [TOL]        compare the panel with GOLDEN/NAME.png
+ *
+ * Between commands the LVGL scheduler runs the way lvgl_sched_task would,
+ * sleeping as long as it asks, and button events are dispatched like the
+ * button task does. Step times are host CPU time, so budgets are a
+ * regression gate rather than device numbers. A missing or mismatching
+ * golden fails the check and the frame is saved as NAME.actual.png in the
+ * working directory for review. --update writes every golden the script hits
+ * from the current frame instead. */
+#include "display_port.h"
+#include "display_ui.h"
+#include "lvgl_sched.h"
+#include "button.h"
+#include "cst816_touch.h"
+#include "cst816_sim.h"
+#include "pgp_proto.h"
+#include "stats_history.h"
+#include "host_sim.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#define BUTTON_PIN      GPIO_NUM_9
+#define MAX_SLICE_US    10000
+
+static const char *golden_dir = ".";
+static bool update_goldens;
+static bool timing = true;
+static const char *script_path;
+static int line_no;
+static int failures;
+
+static pgp_conn_t conn;
+static bool connected;
+static uint8_t pending_gesture;
+static uint32_t budget_us;
+
+static struct {
+    uint32_t steps;
+    uint32_t over_budget;
+    uint64_t total_us;
+    uint32_t max_us;
+} timing_stats;
+
+static void fail(const char *fmt, const char *arg) {
+    fprintf(stderr, "%s:%d: ", script_path, line_no);
+    fprintf(stderr, fmt, arg);
+    fputc('\n', stderr);
+    failures++;
+}
+
+static int64_t cpu_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void script_events(uint32_t events) {
+    if (events & LVGL_SCHED_EVT_TOUCH) {
+        display_port_touch_event();
+    }
+    if (events & LVGL_SCHED_EVT_UI) {
+        ui_apply_pending();
+    }
+}
+
+static uint32_t step(uint32_t events) {
+    int64_t t0 = cpu_us();
+    uint32_t sleep_ms = lvgl_sched_step(events);
+    uint32_t us = (uint32_t)(cpu_us() - t0);
+    timing_stats.steps++;
+    timing_stats.total_us += us;
+    if (us > timing_stats.max_us) {
+        timing_stats.max_us = us;
+    }
+    if (timing && budget_us && us > budget_us) {
+        char msg[64];
+        snprintf(msg, sizeof(msg), "%lu us > %lu us", (unsigned long)us, (unsigned long)budget_us);
+        fail("LVGL step over budget: %s", msg);
+        timing_stats.over_budget++;
+    }
+    return sleep_ms;
+}
+
+/* Mirrors button_task in main.c. */
+static void dispatch_buttons(void) {
+    button_event_t evt;
+    while (button_get_event(&evt, 0)) {
+        switch (evt.type) {
+            case BUTTON_EVT_CLICK:
+                /* A manual PGP press goes out over BLE; nothing on screen. */
+                break;
+            case BUTTON_EVT_DOUBLE_CLICK:
+                ui_switch_screen((ui_get_screen() + 1) % (UI_SCREEN_STATS + 1));
+                break;
+            case BUTTON_EVT_LONG_PRESS:
+                ui_switch_screen(UI_SCREEN_MAIN);
+                break;
+            case BUTTON_EVT_BOOT_HOLD:
+                ui_update_connection_status(UI_SRC_BUTTON, "WiFi AP Mode");
+                break;
+        }
+        step(LVGL_SCHED_EVT_UI);
+    }
+}
+
+/* Runs the scheduler, the button task and the PGP press deadline until the
+ * virtual clock reaches at_us. */
+static void run_until(int64_t at_us) {
+    for (;;) {
+        dispatch_buttons();
+        int64_t now = esp_timer_get_time();
+        if (connected && pgp_conn_poll(&conn, now)) {
+            pgp_conn_press_sent(&conn, now);
+        }
+        uint32_t sleep_ms = step(0);
+        if (now >= at_us) {
+            break;
+        }
+        int64_t slice = sleep_ms == LVGL_SCHED_SLEEP_FOREVER ? MAX_SLICE_US : (int64_t)sleep_ms * 1000;
+        int64_t deadline = connected ? pgp_conn_next_deadline(&conn) : PGP_NO_DEADLINE;
+        if (slice > MAX_SLICE_US) {
+            slice = MAX_SLICE_US;
+        }
+        if (deadline != PGP_NO_DEADLINE && deadline > now && deadline - now < slice) {
+            slice = deadline - now;
+        }
+        if (now + slice > at_us) {
+            slice = at_us - now;
+        }
+        host_clock_advance_us(slice);
+    }
+}
+
+/* Mirrors the LED branch of handle_event in pgpemu.c. */
+static void pgp_led(const uint8_t *data, size_t len) {
+    int64_t now = esp_timer_get_time();
+    conn.autocatch = ui_get_autocatch_enabled();
+    conn.autospin = ui_get_autospin_enabled();
+    pgp_result_t result = pgp_conn_on_led(&conn, data, len, now);
+    switch (result) {
+        case PGP_RESULT_CAUGHT:
+        case PGP_RESULT_SPUN:
+            stats_history_record(result == PGP_RESULT_CAUGHT ? STATS_EV_CAUGHT : STATS_EV_SPUN, now);
+            ui_notify_history(UI_SRC_PGPEMU);
+            ui_update_stats(UI_SRC_PGPEMU, conn.stats.caught, conn.stats.spun);
+            if (result == PGP_RESULT_CAUGHT) {
+                ui_show_catch_animation(UI_SRC_PGPEMU, true);
+            } else {
+                ui_show_spin_animation(UI_SRC_PGPEMU);
+            }
+            break;
+        case PGP_RESULT_FLED:
+            stats_history_record(STATS_EV_FLED, now);
+            ui_notify_history(UI_SRC_PGPEMU);
+            ui_show_catch_animation(UI_SRC_PGPEMU, false);
+            break;
+        default:
+            break;
+    }
+}
+
+static void check_frame(const char *name, int tol) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s.png", golden_dir, name);
+    if (update_goldens) {
+        if (host_fb_write_png(path) != 0) {
+            fail("cannot write %s", path);
+        } else {
+            printf("%s: wrote golden %s\n", script_path, path);
+        }
+        return;
+    }
+    char actual[512];
+    snprintf(actual, sizeof(actual), "%s.actual.png", name);
+    char msg[1100];
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        host_fb_write_png(actual);
+        snprintf(msg, sizeof(msg), "no golden %s, frame saved as %s; add it with --update", path, actual);
+        fail("%s", msg);
+        return;
+    }
+    int diff = host_fb_diff_png(path, tol);
+    if (diff < 0) {
+        fail("cannot read %s as a 240x240 PNG", path);
+    } else if (diff > 0) {
+        host_fb_write_png(actual);
+        snprintf(msg, sizeof(msg), "%d px differ from %s, frame saved as %s", diff, path, actual);
+        fail("%s", msg);
+    }
+}
+
+static int parse_screen(const char *s) {
+    static const char *const names[] = { "main", "settings", "stats" };
+    for (int i = 0; i < 3; i++) {
+        if (strcmp(s, names[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static uint8_t parse_gesture(const char *s) {
+    if (strcmp(s, "left") == 0) {
+        return GESTURE_SWIPE_LEFT;
+    } else if (strcmp(s, "right") == 0) {
+        return GESTURE_SWIPE_RIGHT;
+    } else if (strcmp(s, "up") == 0) {
+        return GESTURE_SWIPE_UP;
+    } else if (strcmp(s, "down") == 0) {
+        return GESTURE_SWIPE_DOWN;
+    }
+    return GESTURE_NONE;
+}
+
+static void run_command(char *cmd, char *args) {
+    char a[64] = "";
+    int x, y, z;
+    if (strcmp(cmd, "touch") == 0 && sscanf(args, "%d %d", &x, &y) == 2) {
+        cst816_sim_press((uint16_t)x, (uint16_t)y);
+        step(LVGL_SCHED_EVT_TOUCH);
+    } else if (strcmp(cmd, "gesture") == 0 && sscanf(args, "%63s", a) == 1 && parse_gesture(a) != GESTURE_NONE) {
+        pending_gesture = parse_gesture(a);
+    } else if (strcmp(cmd, "release") == 0) {
+        if (pending_gesture != GESTURE_NONE) {
+            cst816_sim_gesture(pending_gesture);
+            pending_gesture = GESTURE_NONE;
+        }
+        cst816_sim_release();
+        step(LVGL_SCHED_EVT_TOUCH);
+    } else if (strcmp(cmd, "button") == 0 && sscanf(args, "%63s", a) == 1 &&
+               (strcmp(a, "down") == 0 || strcmp(a, "up") == 0)) {
+        host_gpio_set_input(BUTTON_PIN, strcmp(a, "up") == 0);
+    } else if (strcmp(cmd, "connect") == 0) {
+        pgp_stats_t keep = conn.stats;
+        pgp_conn_init(&conn, CONFIG_PGPEMU_PRESS_DELAY_MS);
+        conn.stats = keep;
+        connected = true;
+        ui_update_status(UI_SRC_PGPEMU, true, false, false);
+        step(LVGL_SCHED_EVT_UI);
+    } else if (strcmp(cmd, "disconnect") == 0) {
+        if (connected) {
+            stats_history_record(STATS_EV_DROP, esp_timer_get_time());
+            ui_notify_history(UI_SRC_PGPEMU);
+        }
+        connected = false;
+        ui_update_status(UI_SRC_PGPEMU, false, false, false);
+        step(LVGL_SCHED_EVT_UI);
+    } else if (strcmp(cmd, "led") == 0) {
+        uint8_t data[PGP_LED_MAX_LEN];
+        size_t len = 0;
+        char *p = args, *end;
+        while (len < sizeof(data)) {
+            unsigned long v = strtoul(p, &end, 16);
+            if (end == p) {
+                break;
+            }
+            data[len++] = (uint8_t)v;
+            p = end;
+        }
+        if (connected) {
+            pgp_led(data, len);
+        }
+        step(LVGL_SCHED_EVT_UI);
+    } else if (strcmp(cmd, "stats") == 0 && sscanf(args, "%d %d %d", &x, &y, &z) == 3) {
+        conn.stats.caught = (uint32_t)x;
+        conn.stats.spun = (uint32_t)y;
+        ui_update_stats(UI_SRC_SYSTEM, (uint32_t)x, (uint32_t)y);
+        ui_update_battery(UI_SRC_BATTERY, (uint8_t)z);
+        step(LVGL_SCHED_EVT_UI);
+    } else if (strcmp(cmd, "budget") == 0 && sscanf(args, "%d", &x) == 1) {
+        budget_us = (uint32_t)x;
+    } else if (strcmp(cmd, "screen") == 0 && sscanf(args, "%63s", a) == 1 && parse_screen(a) >= 0) {
+        if ((int)ui_get_screen() != parse_screen(a)) {
+            fail("expected screen %s", a);
+        }
+    } else if (strcmp(cmd, "check") == 0 && sscanf(args, "%63s", a) == 1) {
+        int tol = 0;
+        sscanf(args, "%*s %d", &tol);
+        check_frame(a, tol);
+    } else {
+        fail("bad command: %s", cmd);
+    }
+}
+
+static void usage(const char *argv0) {
+    fprintf(stderr, "usage: %s SCRIPT [--golden DIR] [--update] [--no-timing]\n", argv0);
+}
+
+int main(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--golden") == 0 && i + 1 < argc) {
+            golden_dir = argv[++i];
+        } else if (strcmp(argv[i], "--update") == 0) {
+            update_goldens = true;
+        } else if (strcmp(argv[i], "--no-timing") == 0) {
+            timing = false;
+        } else if (script_path == NULL && argv[i][0] != '-') {
+            script_path = argv[i];
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (script_path == NULL) {
+        usage(argv[0]);
+        return 2;
+    }
+    FILE *f = fopen(script_path, "r");
+    if (f == NULL) {
+        perror(script_path);
+        return 2;
+    }
+    if (update_goldens && mkdir(golden_dir, 0755) != 0 && errno != EEXIST) {
+        perror(golden_dir);
+        return 2;
+    }
+
+    host_clock_set_manual(true);
+    int64_t origin = esp_timer_get_time();
+    cst816_sim_attach(CONFIG_PGPEMU_TOUCH_INT_GPIO);
+    cst816_sim_attach_reset(CONFIG_PGPEMU_TOUCH_RST_GPIO);
+    host_gpio_set_input(BUTTON_PIN, 1);
+    button_config_t button_cfg = BUTTON_CONFIG_DEFAULT(BUTTON_PIN);
+    button_init(&button_cfg);
+    pgp_conn_init(&conn, CONFIG_PGPEMU_PRESS_DELAY_MS);
+    stats_history_init(origin);
+
+    display_port_init();
+    display_port_init_touch();
+    display_port_set_swipe_cb(ui_navigate);
+    lvgl_sched_set_event_cb(script_events);
+    ui_set_settings(true, true);
+    ui_init();
+    ui_update_stats(UI_SRC_SYSTEM, 0, 0);
+    ui_update_battery(UI_SRC_BATTERY, 100);
+    ui_update_status(UI_SRC_SYSTEM, false, false, false);
+    step(LVGL_SCHED_EVT_UI);
+
+    char line[1024];
+    while (fgets(line, sizeof(line), f)) {
+        line_no++;
+        char *p = line + strspn(line, " \t");
+        if (*p == '#' || *p == '\n' || *p == '\0') {
+            continue;
+        }
+        char *end;
+        long ms = strtol(p, &end, 10);
+        char cmd[32];
+        int n = 0;
+        if (end == p || sscanf(end, " %31s %n", cmd, &n) != 1) {
+            fail("bad line: %s", line);
+            continue;
+        }
+        end[strcspn(end, "\n")] = '\0';
+        run_until(origin + (int64_t)ms * 1000);
+        run_command(cmd, end + n);
+    }
+    fclose(f);
+
+    printf("%s: %lu steps, avg %llu us, max %lu us, %lu over budget, %d failure(s)\n", script_path,
+           (unsigned long)timing_stats.steps,
+           (unsigned long long)(timing_stats.steps ? timing_stats.total_us / timing_stats.steps : 0),
+           (unsigned long)timing_stats.max_us, (unsigned long)timing_stats.over_budget, failures);
+    return failures ? 1 : 0;
+}
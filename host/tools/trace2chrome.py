@@ -0,0 +1,86 @@
+#!/usr/bin/env python3
+"""Convert a "trace dump" capture into Chrome trace JSON.
+
+The input is whatever the serial monitor (or ui_bench --trace) captured; log
+lines around the dump are ignored. Open the output in chrome://tracing or
+https://ui.perfetto.dev.
+
+    python3 host/tools/trace2chrome.py capture.txt -o trace.json
+"""
+import argparse
+import json
+import sys
+
+
+def parse(lines):
+    tasks, events, recs = {}, {}, []
+    inside = False
+    for line in lines:
+        # Strip anything the monitor put in front, e.g. a prompt or timestamp.
+        for key in ("trace begin", "trace end", "task ", "event ", "rec "):
+            pos = line.find(key)
+            if pos >= 0:
+                line = line[pos:]
+                break
+        parts = line.split()
+        if not parts:
+            continue
+        if line.startswith("trace begin"):
+            inside = True
+            tasks, events, recs = {}, {}, []
+        elif line.startswith("trace end"):
+            inside = False
+        elif not inside:
+            continue
+        elif parts[0] == "task" and len(parts) >= 3:
+            tasks[int(parts[1])] = " ".join(parts[2:])
+        elif parts[0] == "event" and len(parts) >= 3:
+            events[int(parts[1])] = parts[2]
+        elif parts[0] == "rec" and len(parts) == 6:
+            recs.append(tuple(int(p) for p in parts[1:]))
+    return tasks, events, recs
+
+
+def to_chrome(tasks, events, recs):
+    out = []
+    for tid, name in sorted(tasks.items()):
+        out.append({"ph": "M", "name": "thread_name", "pid": 0, "tid": tid, "args": {"name": name}})
+    # Timestamps are the low 32 bits of esp_timer_get_time(); unwrap them so a
+    # capture spanning a wrap (every ~71 minutes) stays monotonic.
+    base, last = 0, None
+    for ts, dur, task, ev, arg in recs:
+        if last is not None and ts + base < last - (1 << 31):
+            base += 1 << 32
+        last = ts + base
+        out.append({
+            "ph": "X",
+            "name": events.get(ev, "event%d" % ev),
+            "pid": 0,
+            "tid": task,
+            "ts": ts + base,
+            "dur": dur,
+            "args": {"arg": arg},
+        })
+    return {"traceEvents": out, "displayTimeUnit": "ms"}
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("input", nargs="?", help="capture file (default: stdin)")
+    ap.add_argument("-o", "--output", help="JSON file (default: stdout)")
+    args = ap.parse_args()
+
+    src = open(args.input, errors="replace") if args.input else sys.stdin
+    with src:
+        tasks, events, recs = parse(src)
+    if not recs:
+        sys.exit("no trace records found")
+
+    dst = open(args.output, "w") if args.output else sys.stdout
+    with dst:
+        json.dump(to_chrome(tasks, events, recs), dst)
+    print("%d records, %d tasks" % (len(recs), len(tasks)), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,592 @@
+#!/usr/bin/env python3
+"""Convert the UI assets listed in assets.txt into LVGL descriptors.
+
+Writes ui_assets.c and ui_assets.h into --out. Every table is const, so on
+the target it stays in flash and LVGL reads it in place through the cache;
+nothing is copied to RAM. A size report per asset is printed and written to
+ui_assets.txt next to them. Both the firmware and the host build run this
+as a build step:
+
+    python3 main/assets/mkassets.py main/assets/assets.txt \
+        --lvgl components/lvgl --out build/assets
+"""
+import argparse
+import math
+import os
+import re
+import shlex
+import struct
+import sys
+import zlib
+
+CF_TRUE_COLOR = "LV_IMG_CF_TRUE_COLOR"
+CF_TRUE_COLOR_ALPHA = "LV_IMG_CF_TRUE_COLOR_ALPHA"
+CF_ALPHA_4BIT = "LV_IMG_CF_ALPHA_4BIT"
+
+GLYPH_RE = re.compile(
+    r"\{\s*\.bitmap_index\s*=\s*(\d+)\s*,\s*\.adv_w\s*=\s*(\d+)\s*,\s*\.box_w\s*=\s*(\d+)\s*,"
+    r"\s*\.box_h\s*=\s*(\d+)\s*,\s*\.ofs_x\s*=\s*(-?\d+)\s*,\s*\.ofs_y\s*=\s*(-?\d+)\s*\}")
+
+
+class AssetError(Exception):
+    pass
+
+
+def strip_comments(text):
+    text = re.sub(r"/\*.*?\*/", " ", text, flags=re.S)
+    return re.sub(r"//[^\n]*", " ", text)
+
+
+def array_ints(code, name):
+    m = re.search(r"\b%s\s*\[\s*\]\s*=\s*\{(.*?)\}\s*;" % re.escape(name), code, re.S)
+    if not m:
+        raise AssetError("array %s not found" % name)
+    return [int(v, 0) for v in re.findall(r"-?(?:0x[0-9a-fA-F]+|\d+)", m.group(1))]
+
+
+def field(code, name, default=None):
+    m = re.search(r"\.%s\s*=\s*(-?\w+)" % name, code)
+    if not m:
+        if default is None:
+            raise AssetError("field .%s not found" % name)
+        return default
+    return m.group(1)
+
+
+def f32(x):
+    return struct.unpack("f", struct.pack("f", x))[0]
+
+
+class Font:
+    """Glyphs, character map and kerning of an lv_font_conv C font."""
+
+    def __init__(self, path):
+        self.path = path
+        code = strip_comments(open(path, encoding="utf-8").read())
+        self.bitmap = array_ints(code, "glyph_bitmap")
+        self.glyphs = [tuple(int(v) for v in g) for g in GLYPH_RE.findall(code)]
+        if not self.glyphs:
+            raise AssetError("%s: no glyph descriptors" % path)
+        self.bpp = int(field(code, "bpp"))
+        self.bitmap_format = int(field(code, "bitmap_format", "0"))
+        self.line_height = int(field(code, "line_height"))
+        self.base_line = int(field(code, "base_line"))
+        self.underline_position = int(field(code, "underline_position", "-1"))
+        self.underline_thickness = int(field(code, "underline_thickness", "1"))
+        self.kern_scale = int(field(code, "kern_scale", "16"))
+        self.cmap = self._parse_cmaps(code)
+        self.kern = None
+        if int(field(code, "kern_classes", "0")) == 1 and re.search(r"\.kern_dsc\s*=\s*&", code):
+            m = re.search(r"lv_font_fmt_txt_kern_classes_t\s+\w+\s*=\s*\{(.*?)\}\s*;", code, re.S)
+            if not m:
+                raise AssetError("%s: kerning classes not found" % path)
+            kc = m.group(1)
+            self.kern = {
+                "left": array_ints(code, field(kc, "left_class_mapping")),
+                "right": array_ints(code, field(kc, "right_class_mapping")),
+                "values": array_ints(code, field(kc, "class_pair_values")),
+                "right_cnt": int(field(kc, "right_class_cnt")),
+            }
+        elif re.search(r"\.kern_dsc\s*=\s*&", code):
+            print("mkassets: %s: kerning pairs are not carried over" % path, file=sys.stderr)
+        self.source_bytes = len(self.bitmap) + 8 * len(self.glyphs) + 2 * len(self.cmap)
+        if self.kern:
+            self.source_bytes += len(self.kern["left"]) + len(self.kern["right"]) + len(self.kern["values"])
+
+    def _parse_cmaps(self, code):
+        m = re.search(r"\bcmaps\s*\[\s*\]\s*=\s*\{(.*?)\}\s*;", code, re.S)
+        if not m:
+            raise AssetError("%s: cmaps not found" % self.path)
+        cmap = {}
+        for entry in re.findall(r"\{([^{}]*)\}", m.group(1)):
+            start = int(field(entry, "range_start"), 0)
+            length = int(field(entry, "range_length"), 0)
+            gid0 = int(field(entry, "glyph_id_start"), 0)
+            kind = field(entry, "type")
+            ulist = field(entry, "unicode_list", "NULL")
+            olist = field(entry, "glyph_id_ofs_list", "NULL")
+            if kind.endswith("FORMAT0_TINY"):
+                for i in range(length):
+                    cmap[start + i] = gid0 + i
+            elif kind.endswith("FORMAT0_FULL"):
+                for i, ofs in enumerate(array_ints(code, olist)[:length]):
+                    if ofs or i == 0:
+                        cmap[start + i] = gid0 + ofs
+            elif kind.endswith("SPARSE_TINY"):
+                for i, ofs in enumerate(array_ints(code, ulist)):
+                    cmap[start + ofs] = gid0 + i
+            elif kind.endswith("SPARSE_FULL"):
+                for ofs, gofs in zip(array_ints(code, ulist), array_ints(code, olist)):
+                    cmap[start + ofs] = gid0 + gofs
+            else:
+                raise AssetError("%s: unknown cmap type %s" % (self.path, kind))
+        return cmap
+
+    def glyph_bytes(self, gid):
+        start = self.glyphs[gid][0]
+        if self.bitmap_format == 0:
+            _, _, w, h, _, _ = self.glyphs[gid]
+            return self.bitmap[start:start + (w * h * self.bpp + 7) // 8]
+        later = [g[0] for g in self.glyphs if g[0] > start]
+        return self.bitmap[start:min(later) if later else len(self.bitmap)]
+
+
+class Subset:
+    """The glyphs of one font for a given set of characters, renumbered."""
+
+    def __init__(self, name, font, chars):
+        self.name = name
+        self.font = font
+        missing = sorted(c for c in chars if c not in font.cmap)
+        if missing:
+            raise AssetError("%s: %s has no glyph for %s" % (name, os.path.basename(font.path),
+                                                              ", ".join("U+%04X" % c for c in missing)))
+        self.codes = sorted(chars)
+        self.bitmap = []
+        self.glyphs = [(0, 0, 0, 0, 0, 0)]
+        self.by_code = {}
+        for code in self.codes:
+            gid = font.cmap[code]
+            _, adv_w, w, h, ox, oy = font.glyphs[gid]
+            data = font.glyph_bytes(gid)
+            self.by_code[code] = (adv_w, w, h, ox, oy, data)
+            self.glyphs.append((len(self.bitmap), adv_w, w, h, ox, oy))
+            self.bitmap.extend(data)
+        self.kern = None
+        if font.kern:
+            gids = [0] + [font.cmap[c] for c in self.codes]
+            left = [font.kern["left"][g] for g in gids]
+            right = [font.kern["right"][g] for g in gids]
+            lset = sorted(set(left) - {0})
+            rset = sorted(set(right) - {0})
+            if lset and rset:
+                lmap = {c: i + 1 for i, c in enumerate(lset)}
+                rmap = {c: i + 1 for i, c in enumerate(rset)}
+                rc = font.kern["right_cnt"]
+                values = [font.kern["values"][(lc - 1) * rc + (rr - 1)] for lc in lset for rr in rset]
+                if any(values):
+                    self.kern = {
+                        "left": [lmap.get(c, 0) for c in left],
+                        "right": [rmap.get(c, 0) for c in right],
+                        "values": values,
+                        "left_cnt": len(lset),
+                        "right_cnt": len(rset),
+                    }
+
+    def size(self):
+        n = len(self.bitmap) + 8 * len(self.glyphs) + 2 * len(self.codes) + 64
+        if self.kern:
+            n += len(self.kern["left"]) + len(self.kern["right"]) + len(self.kern["values"])
+        return n
+
+    def unpack(self, code):
+        """Glyph box as rows of alpha values, 0..255."""
+        adv_w, w, h, ox, oy, data = self.by_code[code]
+        if self.font.bitmap_format != 0:
+            raise AssetError("%s: compressed glyphs cannot be pre-rasterised" % self.name)
+        bpp = self.font.bpp
+        mask = (1 << bpp) - 1
+        rows = []
+        bit = 0
+        for _ in range(h):
+            row = []
+            for _ in range(w):
+                v = (data[bit // 8] >> (8 - bpp - bit % 8)) & mask
+                row.append(v * 255 // mask)
+                bit += bpp
+            rows.append(row)
+        return rows
+
+
+def parse_chars(tokens):
+    chars = set()
+    for tok in tokens:
+        m = re.fullmatch(r"(0x[0-9a-fA-F]+|U\+[0-9a-fA-F]+)(?:-(0x[0-9a-fA-F]+|U\+[0-9a-fA-F]+))?", tok)
+        if m:
+            lo = int(m.group(1).replace("U+", "0x"), 0)
+            hi = int((m.group(2) or m.group(1)).replace("U+", "0x"), 0)
+            chars.update(range(lo, hi + 1))
+        else:
+            chars.update(ord(c) for c in tok)
+    return chars
+
+
+def pack_a4(rows, w):
+    """Rows of 0..15, byte aligned, first pixel in the high nibble."""
+    out = []
+    for row in rows:
+        for x in range(0, w, 2):
+            hi = row[x]
+            lo = row[x + 1] if x + 1 < w else 0
+            out.append(hi << 4 | lo)
+    return out
+
+
+def color565(rgb):
+    r, g, b = rgb
+    return (r >> 3) << 11 | (g >> 2) << 5 | (b >> 3)
+
+
+def mix565(fg, bg, mix):
+    """lv_color_mix() for 16-bit colour: per channel, rounded, /255."""
+    out = 0
+    for shift, bits in ((11, 5), (5, 6), (0, 5)):
+        m = (1 << bits) - 1
+        c1 = (fg >> shift) & m
+        c2 = (bg >> shift) & m
+        out |= (((c1 * mix + c2 * (255 - mix) + 128) * 0x8081) >> 23) << shift
+    return out
+
+
+def ring_alpha(radius, width):
+    """Coverage of a ring, 0..15, computed in single precision exactly as
+    ui_cache_build_ring() does at run time."""
+    size = radius * 2
+    outer = f32(radius)
+    inner = f32(radius - width)
+    rows = []
+    for y in range(size):
+        dy = f32(f32(y + 0.5) - outer)
+        row = []
+        for x in range(size):
+            dx = f32(f32(x + 0.5) - outer)
+            d = f32(math.sqrt(f32(f32(dx * dx) + f32(dy * dy))))
+            cov = min(f32(f32(outer - d) + 0.5), f32(f32(d - inner) + 0.5))
+            if cov <= 0.0:
+                row.append(0)
+            else:
+                row.append(15 if cov >= 1.0 else int(f32(f32(cov * 15.0) + 0.5)))
+        rows.append(row)
+    return rows
+
+
+def read_png(path):
+    """8-bit, non-interlaced PNG as rows of (r, g, b, a)."""
+    data = open(path, "rb").read()
+    if data[:8] != b"\x89PNG\r\n\x1a\n":
+        raise AssetError("%s: not a PNG" % path)
+    pos, idat, palette, trns = 8, b"", None, None
+    while pos < len(data):
+        length, kind = struct.unpack(">I4s", data[pos:pos + 8])
+        chunk = data[pos + 8:pos + 8 + length]
+        pos += 12 + length
+        if kind == b"IHDR":
+            w, h, depth, ctype, _, _, interlace = struct.unpack(">IIBBBBB", chunk)
+        elif kind == b"PLTE":
+            palette = [tuple(chunk[i:i + 3]) for i in range(0, len(chunk), 3)]
+        elif kind == b"tRNS":
+            trns = chunk
+        elif kind == b"IDAT":
+            idat += chunk
+    channels = {0: 1, 2: 3, 3: 1, 4: 2, 6: 4}.get(ctype)
+    if depth != 8 or interlace or channels is None:
+        raise AssetError("%s: only 8-bit non-interlaced PNGs are supported" % path)
+    raw = zlib.decompress(idat)
+    stride = w * channels
+    prev = bytearray(stride)
+    rows = []
+    for y in range(h):
+        ftype = raw[y * (stride + 1)]
+        line = bytearray(raw[y * (stride + 1) + 1:(y + 1) * (stride + 1)])
+        for i in range(stride):
+            a = line[i - channels] if i >= channels else 0
+            b = prev[i]
+            c = prev[i - channels] if i >= channels else 0
+            if ftype == 1:
+                line[i] = (line[i] + a) & 0xff
+            elif ftype == 2:
+                line[i] = (line[i] + b) & 0xff
+            elif ftype == 3:
+                line[i] = (line[i] + (a + b) // 2) & 0xff
+            elif ftype == 4:
+                p = a + b - c
+                pa, pb, pc = abs(p - a), abs(p - b), abs(p - c)
+                pred = a if pa <= pb and pa <= pc else b if pb <= pc else c
+                line[i] = (line[i] + pred) & 0xff
+        prev = line
+        px = []
+        for x in range(w):
+            v = line[x * channels:(x + 1) * channels]
+            if ctype == 0:
+                px.append((v[0], v[0], v[0], 255))
+            elif ctype == 2:
+                px.append((v[0], v[1], v[2], 255))
+            elif ctype == 3:
+                alpha = trns[v[0]] if trns and v[0] < len(trns) else 255
+                px.append(palette[v[0]] + (alpha,))
+            elif ctype == 4:
+                px.append((v[0], v[0], v[0], v[1]))
+            else:
+                px.append(tuple(v))
+        rows.append(px)
+    return w, h, rows
+
+
+def parse_hex_color(tok):
+    v = int(tok.lstrip("#"), 16)
+    return (v >> 16 & 0xff, v >> 8 & 0xff, v & 0xff)
+
+
+class Output:
+    def __init__(self):
+        self.c = []
+        self.h = []
+        self.report = []
+        self.total = 0
+
+    def array(self, ctype, name, values, large=True):
+        attr = "LV_ATTRIBUTE_LARGE_CONST " if large else ""
+        self.c.append("static %sconst %s %s[] = {" % (attr, ctype, name))
+        for i in range(0, len(values), 16):
+            self.c.append("    " + ", ".join(fmt_int(v, ctype) for v in values[i:i + 16]) + ",")
+        self.c.append("};")
+
+    def note(self, name, kind, detail, nbytes):
+        self.report.append((name, kind, detail, nbytes))
+        self.total += nbytes
+
+
+def fmt_int(v, ctype):
+    return "0x%02x" % v if ctype == "uint8_t" else str(v)
+
+
+def emit_font(out, sub):
+    n = sub.name
+    f = sub.font
+    out.c.append("/* %s: %d of %d glyphs of %s */" % (n, len(sub.codes), len(f.cmap), os.path.basename(f.path)))
+    out.array("uint8_t", n + "_bitmap", sub.bitmap or [0])
+    out.c.append("static const lv_font_fmt_txt_glyph_dsc_t %s_glyphs[] = {" % n)
+    for g in sub.glyphs:
+        out.c.append("    {.bitmap_index = %d, .adv_w = %d, .box_w = %d, .box_h = %d, .ofs_x = %d, .ofs_y = %d}," % g)
+    out.c.append("};")
+    first, last = sub.codes[0], sub.codes[-1]
+    contiguous = last - first + 1 == len(sub.codes)
+    if not contiguous:
+        out.array("uint16_t", n + "_unicode", [c - first for c in sub.codes], large=False)
+    out.c.append("static const lv_font_fmt_txt_cmap_t %s_cmaps[] = {" % n)
+    out.c.append("    {")
+    out.c.append("        .range_start = %d, .range_length = %d, .glyph_id_start = 1," % (first, last - first + 1))
+    if contiguous:
+        out.c.append("        .unicode_list = NULL, .glyph_id_ofs_list = NULL, .list_length = 0,")
+        out.c.append("        .type = LV_FONT_FMT_TXT_CMAP_FORMAT0_TINY")
+    else:
+        out.c.append("        .unicode_list = %s_unicode, .glyph_id_ofs_list = NULL, .list_length = %d,"
+                     % (n, len(sub.codes)))
+        out.c.append("        .type = LV_FONT_FMT_TXT_CMAP_SPARSE_TINY")
+    out.c.append("    },")
+    out.c.append("};")
+    if sub.kern:
+        k = sub.kern
+        out.array("uint8_t", n + "_kern_left", k["left"], large=False)
+        out.array("uint8_t", n + "_kern_right", k["right"], large=False)
+        out.array("int8_t", n + "_kern_values", k["values"], large=False)
+        out.c.append("static const lv_font_fmt_txt_kern_classes_t %s_kern = {" % n)
+        out.c.append("    .class_pair_values = %s_kern_values," % n)
+        out.c.append("    .left_class_mapping = %s_kern_left," % n)
+        out.c.append("    .right_class_mapping = %s_kern_right," % n)
+        out.c.append("    .left_class_cnt = %d," % k["left_cnt"])
+        out.c.append("    .right_class_cnt = %d," % k["right_cnt"])
+        out.c.append("};")
+    out.c.append("static lv_font_fmt_txt_glyph_cache_t %s_cache;" % n)
+    out.c.append("static const lv_font_fmt_txt_dsc_t %s_dsc = {" % n)
+    out.c.append("    .glyph_bitmap = %s_bitmap," % n)
+    out.c.append("    .glyph_dsc = %s_glyphs," % n)
+    out.c.append("    .cmaps = %s_cmaps," % n)
+    out.c.append("    .kern_dsc = %s," % ("&%s_kern" % n if sub.kern else "NULL"))
+    out.c.append("    .kern_scale = %d," % f.kern_scale)
+    out.c.append("    .cmap_num = 1,")
+    out.c.append("    .bpp = %d," % f.bpp)
+    out.c.append("    .kern_classes = %d," % (1 if sub.kern else 0))
+    out.c.append("    .bitmap_format = %d," % f.bitmap_format)
+    out.c.append("    .cache = &%s_cache," % n)
+    out.c.append("};")
+    out.c.append("const lv_font_t %s = {" % n)
+    out.c.append("    .get_glyph_dsc = lv_font_get_glyph_dsc_fmt_txt,")
+    out.c.append("    .get_glyph_bitmap = lv_font_get_bitmap_fmt_txt,")
+    out.c.append("    .line_height = %d," % f.line_height)
+    out.c.append("    .base_line = %d," % f.base_line)
+    out.c.append("    .subpx = LV_FONT_SUBPX_NONE,")
+    out.c.append("    .underline_position = %d," % f.underline_position)
+    out.c.append("    .underline_thickness = %d," % f.underline_thickness)
+    out.c.append("    .dsc = &%s_dsc," % n)
+    out.c.append("};")
+    out.c.append("")
+    out.h.append("LV_FONT_DECLARE(%s)" % n)
+    out.note(n, "font", "%d glyphs, %d bpp, was %d bytes" % (len(sub.codes), f.bpp, f.source_bytes), sub.size())
+
+
+def emit_image(out, name, cf, w, h, data, detail):
+    out.array("uint8_t", name + "_map", data)
+    out.c.append("const lv_img_dsc_t %s = {" % name)
+    out.c.append("    .header.cf = %s," % cf)
+    out.c.append("    .header.always_zero = 0,")
+    out.c.append("    .header.w = %d," % w)
+    out.c.append("    .header.h = %d," % h)
+    out.c.append("    .data_size = %d," % len(data))
+    out.c.append("    .data = %s_map," % name)
+    out.c.append("};")
+    out.c.append("")
+    out.h.append("extern const lv_img_dsc_t %s;" % name)
+    out.note(name, "image", "%dx%d %s%s" % (w, h, cf[len("LV_IMG_CF_"):].lower(), detail), len(data) + 16)
+
+
+def emit_digits(out, name, sub):
+    """Digits 0-9 in fixed cells laid out as ui_cache_build_digits() lays
+    them out at run time, so either source draws the same pixels."""
+    f = sub.font
+    cell_w = max((sub.by_code[ord("0") + d][0] + 8) >> 4 for d in range(10))
+    cell_h = f.line_height
+    maps = []
+    for d in range(10):
+        adv_w, gw, gh, ox, oy, _ = sub.by_code[ord("0") + d]
+        alpha = sub.unpack(ord("0") + d)
+        rows = [[0] * cell_w for _ in range(cell_h)]
+        x0 = (cell_w - ((adv_w + 8) >> 4)) // 2 + ox
+        y0 = cell_h - f.base_line - gh - oy
+        for y in range(gh):
+            for x in range(gw):
+                px, py = x0 + x, y0 + y
+                a = alpha[y][x] * 15 // 255 if f.bpp != 8 else alpha[y][x] >> 4
+                if a and 0 <= px < cell_w and 0 <= py < cell_h:
+                    rows[py][px] |= a
+        maps.append(pack_a4(rows, cell_w))
+    size = len(maps[0])
+    out.array("uint8_t", name + "_map", [b for m in maps for b in m])
+    out.c.append("const lv_img_dsc_t %s[10] = {" % name)
+    for d in range(10):
+        out.c.append("    { .header.cf = %s, .header.w = %d, .header.h = %d, .data_size = %d, .data = %s_map + %d },"
+                     % (CF_ALPHA_4BIT, cell_w, cell_h, size, name, d * size))
+    out.c.append("};")
+    out.c.append("")
+    upper = name.upper()
+    out.h.append("extern const lv_img_dsc_t %s[10];" % name)
+    out.h.append("#define %s_CELL_W %d" % (upper, cell_w))
+    out.h.append("#define %s_CELL_H %d" % (upper, cell_h))
+    out.note(name, "digits", "10 cells %dx%d alpha_4bit from %s" % (cell_w, cell_h, sub.name), 10 * (size + 16))
+
+
+def emit_ring(out, name, radius, width, args):
+    alpha = ring_alpha(radius, width)
+    size = radius * 2
+    upper = name.upper()
+    out.h.append("#define %s_RADIUS %d" % (upper, radius))
+    out.h.append("#define %s_WIDTH %d" % (upper, width))
+    if not args or args[0] == "a4":
+        emit_image(out, name, CF_ALPHA_4BIT, size, size, pack_a4(alpha, size), ", recoloured when drawn")
+        return
+    if args[0] != "rgb565" or len(args) != 3:
+        raise AssetError("%s: ring format is a4 or rgb565 FG BG" % name)
+    fg, bg = parse_hex_color(args[1]), parse_hex_color(args[2])
+    cfg, cbg = color565(fg), color565(bg)
+    data = []
+    for row in alpha:
+        for a in row:
+            c = mix565(cfg, cbg, a * 17)
+            data += [c & 0xff, c >> 8]
+    out.h.append("#define %s_FG 0x%06x" % (upper, fg[0] << 16 | fg[1] << 8 | fg[2]))
+    out.h.append("#define %s_BG 0x%06x" % (upper, bg[0] << 16 | bg[1] << 8 | bg[2]))
+    emit_image(out, name, CF_TRUE_COLOR, size, size, data, ", opaque on %s" % args[2])
+
+
+def emit_png(out, name, path, fmt):
+    w, h, rows = read_png(path)
+    if fmt == "a4":
+        data = pack_a4([[(p[3] * 15 + 127) // 255 for p in row] for row in rows], w)
+        emit_image(out, name, CF_ALPHA_4BIT, w, h, data, "")
+    elif fmt == "rgb565":
+        data = []
+        for row in rows:
+            for p in row:
+                c = color565(p[:3])
+                data += [c & 0xff, c >> 8]
+        emit_image(out, name, CF_TRUE_COLOR, w, h, data, "")
+    elif fmt == "rgb565a8":
+        data = []
+        for row in rows:
+            for p in row:
+                c = color565(p[:3])
+                data += [c & 0xff, c >> 8, p[3]]
+        emit_image(out, name, CF_TRUE_COLOR_ALPHA, w, h, data, "")
+    else:
+        raise AssetError("%s: image format is a4, rgb565 or rgb565a8" % name)
+
+
+def build(manifest, lvgl_dir):
+    base = os.path.dirname(os.path.abspath(manifest))
+    out = Output()
+    fonts = {}
+    sources = {}
+    for lineno, line in enumerate(open(manifest, encoding="utf-8"), 1):
+        tokens = shlex.split(line, comments=True)
+        if not tokens:
+            continue
+        kind, args = tokens[0], tokens[1:]
+        try:
+            if kind == "font" and len(args) >= 3:
+                name, size = args[0], int(args[1])
+                path = os.path.join(lvgl_dir, "src", "font", "lv_font_montserrat_%d.c" % size)
+                if path not in sources:
+                    sources[path] = Font(path)
+                fonts[name] = Subset(name, sources[path], parse_chars(args[2:]))
+                emit_font(out, fonts[name])
+            elif kind == "digits" and len(args) == 2:
+                if args[1] not in fonts:
+                    raise AssetError("font %s is not defined above" % args[1])
+                emit_digits(out, args[0], fonts[args[1]])
+            elif kind == "ring" and len(args) >= 3:
+                emit_ring(out, args[0], int(args[1]), int(args[2]), args[3:])
+            elif kind == "image" and len(args) == 3:
+                emit_png(out, args[0], os.path.join(base, args[1]), args[2])
+            else:
+                raise AssetError("cannot parse \"%s\"" % line.strip())
+        except (AssetError, OSError, ValueError, KeyError) as e:
+            raise AssetError("%s:%d: %s" % (manifest, lineno, e))
+    return out
+
+
+def write_if_changed(path, text):
+    try:
+        if open(path, encoding="utf-8").read() == text:
+            return
+    except OSError:
+        pass
+    with open(path, "w", encoding="utf-8") as f:
+        f.write(text)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("manifest")
+    ap.add_argument("--lvgl", required=True, help="LVGL v8.3 source tree (for the Montserrat sources)")
+    ap.add_argument("--out", required=True, help="directory for ui_assets.c, ui_assets.h and ui_assets.txt")
+    args = ap.parse_args()
+
+    try:
+        out = build(args.manifest, args.lvgl)
+    except AssetError as e:
+        print("mkassets: %s" % e, file=sys.stderr)
+        return 1
+
+    header = "/* Generated by main/assets/mkassets.py from assets.txt; do not edit. */\n"
+    h = [header.rstrip(), "#ifndef UI_ASSETS_H", "#define UI_ASSETS_H", '#include "lvgl.h"']
+    h += out.h
+    h += ["#define UI_ASSETS_FLASH_BYTES %d" % out.total, "#endif", ""]
+    c = [header.rstrip(), '#include "ui_assets.h"', "",
+         "#if LV_COLOR_DEPTH != 16 || LV_COLOR_16_SWAP != 0",
+         "#error \"ui_assets.c holds RGB565 data for LV_COLOR_DEPTH 16 without byte swap\"",
+         "#endif", ""]
+    c += out.c
+    report = ["%-16s %-7s %8s" % ("asset", "kind", "bytes")]
+    report += ["%-16s %-7s %8d  %s" % (name, kind, nbytes, detail) for name, kind, detail, nbytes in out.report]
+    report.append("%-16s %-7s %8d" % ("total", "", out.total))
+
+    os.makedirs(args.out, exist_ok=True)
+    write_if_changed(os.path.join(args.out, "ui_assets.h"), "\n".join(h))
+    write_if_changed(os.path.join(args.out, "ui_assets.c"), "\n".join(c))
+    write_if_changed(os.path.join(args.out, "ui_assets.txt"), "\n".join(report) + "\n")
+    print("\n".join(report))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
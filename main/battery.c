@@ -0,0 +1,264 @@
+#include "battery.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <string.h>
+#if CONFIG_PGPEMU_BATTERY
+#include "esp_adc/adc_oneshot.h"
+#include "esp_adc/adc_cali.h"
+#include "esp_adc/adc_cali_scheme.h"
+#endif
+
+static const char *TAG = "BATTERY";
+
+/* Battery telemetry. A slow periodic timer oversamples the divider on one
+ * ADC1 channel, a median of the last few readings drops the sags of BLE
+ * transmit and backlight bursts and a first-order IIR smooths what is
+ * left. The level goes through a LiPo discharge curve to a state of
+ * charge, and the UI and the BLE battery service only hear about it when
+ * that moves by about a percent. The filter, curve and time-to-empty fit
+ * are plain functions so the host tests can run recorded traces through
+ * them. */
+
+#define BATTERY_FILTER_SHIFT        3
+#define BATTERY_PUBLISH_PERMILLE    8
+#define BATTERY_TTE_MIN_POINTS      5
+#define BATTERY_TTE_MIN_SPAN_S      (5 * 60)
+#define BATTERY_TTE_MAX_MIN         (7 * 24 * 60)
+
+/* Open-circuit-ish curve of a 1S LiPo at the light loads this board draws,
+ * highest voltage first. The flat stretch around 3.8 V is where most of
+ * the charge is, so the percentage moves slowly there and quickly near
+ * both ends. */
+static const struct {
+    uint16_t mv;
+    uint16_t permille;
+} curve[] = {
+    { 4200, 1000 }, { 4150, 950 }, { 4110, 900 }, { 4080, 850 }, { 4020, 800 },
+    { 3980, 750 },  { 3950, 700 }, { 3910, 650 }, { 3870, 600 }, { 3850, 550 },
+    { 3840, 500 },  { 3820, 450 }, { 3800, 400 }, { 3790, 350 }, { 3770, 300 },
+    { 3750, 250 },  { 3730, 200 }, { 3710, 150 }, { 3690, 100 }, { 3610, 50 },
+    { 3270, 0 },
+};
+#define CURVE_POINTS (sizeof(curve) / sizeof(curve[0]))
+
+void battery_filter_init(battery_filter_t *f, uint8_t shift) {
+    memset(f, 0, sizeof(*f));
+    f->shift = shift;
+}
+
+uint16_t battery_filter_step(battery_filter_t *f, uint16_t mv) {
+    f->window[f->next] = mv;
+    f->next = (f->next + 1) % BATTERY_MEDIAN_LEN;
+    if (f->count < BATTERY_MEDIAN_LEN) {
+        f->count++;
+    }
+    uint16_t sorted[BATTERY_MEDIAN_LEN];
+    memcpy(sorted, f->window, sizeof(sorted));
+    for (uint8_t i = 1; i < f->count; i++) {
+        uint16_t v = sorted[i];
+        uint8_t j = i;
+        for (; j > 0 && sorted[j - 1] > v; j--) {
+            sorted[j] = sorted[j - 1];
+        }
+        sorted[j] = v;
+    }
+    int32_t median_q4 = (int32_t)sorted[f->count / 2] << 4;
+    if (f->count == 1) {
+        f->level_q4 = median_q4;
+    } else {
+        f->level_q4 += (median_q4 - f->level_q4) >> f->shift;
+    }
+    return (uint16_t)((f->level_q4 + 8) >> 4);
+}
+
+uint16_t battery_permille_from_mv(uint16_t mv) {
+    if (mv >= curve[0].mv) {
+        return curve[0].permille;
+    }
+    for (size_t i = 1; i < CURVE_POINTS; i++) {
+        if (mv >= curve[i].mv) {
+            uint32_t span_mv = curve[i - 1].mv - curve[i].mv;
+            uint32_t span_pm = curve[i - 1].permille - curve[i].permille;
+            return (uint16_t)(curve[i].permille + ((mv - curve[i].mv) * span_pm + span_mv / 2) / span_mv);
+        }
+    }
+    return 0;
+}
+
+void battery_tte_init(battery_tte_t *t) {
+    memset(t, 0, sizeof(*t));
+}
+
+/* Keeps one point per BATTERY_TTE_STEP_S, so the fit spans half an hour
+ * no matter how often the caller samples. */
+void battery_tte_add(battery_tte_t *t, uint32_t time_s, uint16_t permille) {
+    if (t->count > 0) {
+        uint8_t last = (t->next + BATTERY_TTE_POINTS - 1) % BATTERY_TTE_POINTS;
+        if (time_s - t->time_s[last] < BATTERY_TTE_STEP_S) {
+            return;
+        }
+    }
+    t->time_s[t->next] = time_s;
+    t->permille[t->next] = permille;
+    t->next = (t->next + 1) % BATTERY_TTE_POINTS;
+    if (t->count < BATTERY_TTE_POINTS) {
+        t->count++;
+    }
+}
+
+/* Least-squares slope of the state of charge over the window, extended to
+ * zero from the newest point. Charging, a flat line or too short a window
+ * give BATTERY_TTE_UNKNOWN. */
+uint32_t battery_tte_minutes(const battery_tte_t *t) {
+    if (t->count < BATTERY_TTE_MIN_POINTS) {
+        return BATTERY_TTE_UNKNOWN;
+    }
+    uint8_t first = (t->next + BATTERY_TTE_POINTS - t->count) % BATTERY_TTE_POINTS;
+    uint8_t last = (t->next + BATTERY_TTE_POINTS - 1) % BATTERY_TTE_POINTS;
+    uint32_t t0 = t->time_s[first];
+    if (t->time_s[last] - t0 < BATTERY_TTE_MIN_SPAN_S) {
+        return BATTERY_TTE_UNKNOWN;
+    }
+    int64_t n = t->count, st = 0, sp = 0, stt = 0, stp = 0;
+    for (uint8_t k = 0; k < t->count; k++) {
+        uint8_t i = (first + k) % BATTERY_TTE_POINTS;
+        int64_t x = t->time_s[i] - t0, y = t->permille[i];
+        st += x;
+        sp += y;
+        stt += x * x;
+        stp += x * y;
+    }
+    int64_t num = n * stp - st * sp;
+    int64_t den = n * stt - st * st;
+    if (num >= 0 || den <= 0) {
+        return BATTERY_TTE_UNKNOWN;
+    }
+    int64_t minutes = (int64_t)t->permille[last] * den / -num / 60;
+    return minutes > BATTERY_TTE_MAX_MIN ? BATTERY_TTE_UNKNOWN : (uint32_t)minutes;
+}
+
+static battery_filter_t filter;
+static battery_tte_t tte;
+static battery_state_t state;
+static battery_cb_t publish_cb = NULL;
+static int32_t published_permille = -1;
+
+void battery_set_cb(battery_cb_t cb) {
+    publish_cb = cb;
+}
+
+void battery_reset(void) {
+    battery_filter_init(&filter, BATTERY_FILTER_SHIFT);
+    battery_tte_init(&tte);
+    memset(&state, 0, sizeof(state));
+    state.tte_min = BATTERY_TTE_UNKNOWN;
+    published_permille = -1;
+}
+
+/* One reading of the cell voltage, from the sample timer or a test. */
+void battery_feed_mv(uint32_t time_s, uint16_t mv) {
+    state.raw_mv = mv;
+    state.filtered_mv = battery_filter_step(&filter, mv);
+    state.permille = battery_permille_from_mv(state.filtered_mv);
+    battery_tte_add(&tte, time_s, state.permille);
+    state.tte_min = battery_tte_minutes(&tte);
+    state.samples++;
+    int32_t moved = (int32_t)state.permille - published_permille;
+    if (published_permille < 0 || moved >= BATTERY_PUBLISH_PERMILLE || moved <= -BATTERY_PUBLISH_PERMILLE) {
+        published_permille = state.permille;
+        state.percent = (uint8_t)((state.permille + 5) / 10);
+        state.published++;
+        if (publish_cb) {
+            publish_cb(state.percent);
+        }
+    }
+}
+
+void battery_get(battery_state_t *out) {
+    *out = state;
+}
+
+#if CONFIG_PGPEMU_BATTERY
+#define BATTERY_ADC_ATTEN   ADC_ATTEN_DB_12
+
+static adc_oneshot_unit_handle_t adc = NULL;
+static adc_cali_handle_t cali = NULL;
+static esp_timer_handle_t sample_timer = NULL;
+
+/* Runs in the esp_timer task every few seconds; the oversampled read is a
+ * few hundred microseconds and never touches the LVGL task. */
+static void sample_timer_cb(void *arg) {
+    int64_t start = esp_timer_get_time();
+    int32_t sum = 0;
+    for (int i = 0; i < CONFIG_PGPEMU_BATTERY_OVERSAMPLE; i++) {
+        int raw = 0;
+        if (adc_oneshot_read(adc, CONFIG_PGPEMU_BATTERY_ADC_CHANNEL, &raw) != ESP_OK) {
+            state.read_errors++;
+            return;
+        }
+        sum += raw;
+    }
+    int pin_mv = 0;
+    int raw_avg = (sum + CONFIG_PGPEMU_BATTERY_OVERSAMPLE / 2) / CONFIG_PGPEMU_BATTERY_OVERSAMPLE;
+    if (adc_cali_raw_to_voltage(cali, raw_avg, &pin_mv) != ESP_OK) {
+        state.read_errors++;
+        return;
+    }
+    uint32_t cell_mv = (uint32_t)pin_mv * CONFIG_PGPEMU_BATTERY_DIVIDER_X100 / 100;
+    battery_feed_mv((uint32_t)(start / 1000000), (uint16_t)(cell_mv > UINT16_MAX ? UINT16_MAX : cell_mv));
+    state.sample_us_last = (uint32_t)(esp_timer_get_time() - start);
+    if (state.sample_us_last > state.sample_us_max) {
+        state.sample_us_max = state.sample_us_last;
+    }
+}
+
+esp_err_t battery_init(void) {
+    battery_reset();
+    adc_oneshot_unit_init_cfg_t unit_cfg = {
+        .unit_id = ADC_UNIT_1,
+    };
+    esp_err_t err = adc_oneshot_new_unit(&unit_cfg, &adc);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "ADC unit unavailable: %s", esp_err_to_name(err));
+        return err;
+    }
+    adc_oneshot_chan_cfg_t chan_cfg = {
+        .atten = BATTERY_ADC_ATTEN,
+        .bitwidth = ADC_BITWIDTH_DEFAULT,
+    };
+    ESP_ERROR_CHECK(adc_oneshot_config_channel(adc, CONFIG_PGPEMU_BATTERY_ADC_CHANNEL, &chan_cfg));
+    adc_cali_curve_fitting_config_t cali_cfg = {
+        .unit_id = ADC_UNIT_1,
+        .chan = CONFIG_PGPEMU_BATTERY_ADC_CHANNEL,
+        .atten = BATTERY_ADC_ATTEN,
+        .bitwidth = ADC_BITWIDTH_DEFAULT,
+    };
+    err = adc_cali_create_scheme_curve_fitting(&cali_cfg, &cali);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "No ADC calibration in eFuse: %s", esp_err_to_name(err));
+        adc_oneshot_del_unit(adc);
+        adc = NULL;
+        return err;
+    }
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = sample_timer_cb,
+        .name = "battery",
+        .skip_unhandled_events = true,
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &sample_timer));
+    /* The first sample runs here, before the periodic timer is started, so
+     * the battery's UI mailbox never has two writers at once. */
+    sample_timer_cb(NULL);
+    ESP_ERROR_CHECK(esp_timer_start_periodic(sample_timer, CONFIG_PGPEMU_BATTERY_PERIOD_S * 1000000ULL));
+    ESP_LOGI(TAG, "ADC1 channel %d, %lu mV, %u%%", CONFIG_PGPEMU_BATTERY_ADC_CHANNEL,
+             (unsigned long)state.filtered_mv, state.percent);
+    return ESP_OK;
+}
+#else
+esp_err_t battery_init(void) {
+    battery_reset();
+    ESP_LOGI(TAG, "Battery sensing not configured");
+    return ESP_ERR_NOT_SUPPORTED;
+}
+#endif
@@ -0,0 +1,48 @@
+#ifndef BATTERY_H
+#define BATTERY_H
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+#define BATTERY_MEDIAN_LEN      5
+#define BATTERY_TTE_POINTS      30
+#define BATTERY_TTE_STEP_S      60
+#define BATTERY_TTE_UNKNOWN     UINT32_MAX
+typedef struct {
+    uint16_t window[BATTERY_MEDIAN_LEN];
+    uint8_t count;
+    uint8_t next;
+    uint8_t shift;
+    int32_t level_q4;
+} battery_filter_t;
+typedef struct {
+    uint32_t time_s[BATTERY_TTE_POINTS];
+    uint16_t permille[BATTERY_TTE_POINTS];
+    uint8_t count;
+    uint8_t next;
+} battery_tte_t;
+typedef struct {
+    uint16_t raw_mv;
+    uint16_t filtered_mv;
+    uint16_t permille;
+    uint8_t percent;
+    uint32_t tte_min;
+    uint32_t samples;
+    uint32_t published;
+    uint32_t read_errors;
+    uint32_t sample_us_last;
+    uint32_t sample_us_max;
+} battery_state_t;
+typedef void (*battery_cb_t)(uint8_t percent);
+void battery_filter_init(battery_filter_t *f, uint8_t shift);
+uint16_t battery_filter_step(battery_filter_t *f, uint16_t mv);
+uint16_t battery_permille_from_mv(uint16_t mv);
+void battery_tte_init(battery_tte_t *t);
+void battery_tte_add(battery_tte_t *t, uint32_t time_s, uint16_t permille);
+uint32_t battery_tte_minutes(const battery_tte_t *t);
+void battery_reset(void);
+void battery_feed_mv(uint32_t time_s, uint16_t mv);
+void battery_set_cb(battery_cb_t cb);
+esp_err_t battery_init(void);
+void battery_get(battery_state_t *state);
+#endif
@@ -0,0 +1,52 @@
+#include "boot_time.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "BOOT";
+
+/* esp_timer starts counting before app_main, so the marks are time since
+ * reset minus the ROM and second-stage bootloader. Zero means not reached. */
+static int64_t marks[BOOT_STAGE_COUNT];
+
+static const char *const stage_names[BOOT_STAGE_COUNT] = {
+    [BOOT_STAGE_APP_MAIN] = "app_main",
+    [BOOT_STAGE_NVS] = "nvs+persist",
+    [BOOT_STAGE_DISPLAY] = "display",
+    [BOOT_STAGE_UI] = "ui",
+    [BOOT_STAGE_BLE] = "ble",
+    [BOOT_STAGE_TASKS] = "tasks",
+    [BOOT_STAGE_FIRST_FLUSH] = "first flush",
+};
+
+/* Only the first mark of a stage counts. Safe from ISRs; the first flush is
+ * marked from the SPI done callback. */
+void IRAM_ATTR boot_time_mark(boot_stage_t stage) {
+    if (stage < BOOT_STAGE_COUNT && marks[stage] == 0) {
+        marks[stage] = esp_timer_get_time();
+    }
+}
+
+int64_t boot_time_us(boot_stage_t stage) {
+    return stage < BOOT_STAGE_COUNT ? marks[stage] : 0;
+}
+
+const char *boot_stage_name(boot_stage_t stage) {
+    return stage < BOOT_STAGE_COUNT ? stage_names[stage] : "?";
+}
+
+void boot_time_report(void) {
+    int64_t prev = 0;
+    for (int i = 0; i < BOOT_STAGE_COUNT; i++) {
+        if (marks[i] == 0) {
+            ESP_LOGI(TAG, "%-12s not reached", stage_names[i]);
+            continue;
+        }
+        ESP_LOGI(TAG, "%-12s %6lld us (+%lld us)", stage_names[i], (long long)marks[i],
+                 (long long)(prev ? marks[i] - prev : 0));
+        prev = marks[i];
+    }
+    if (marks[BOOT_STAGE_FIRST_FLUSH]) {
+        ESP_LOGI(TAG, "Time to first frame: %lld ms", (long long)(marks[BOOT_STAGE_FIRST_FLUSH] / 1000));
+    }
+}
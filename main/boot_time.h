@@ -0,0 +1,18 @@
+#ifndef BOOT_TIME_H
+#define BOOT_TIME_H
+#include <stdint.h>
+typedef enum {
+    BOOT_STAGE_APP_MAIN = 0,
+    BOOT_STAGE_NVS,
+    BOOT_STAGE_DISPLAY,
+    BOOT_STAGE_UI,
+    BOOT_STAGE_BLE,
+    BOOT_STAGE_TASKS,
+    BOOT_STAGE_FIRST_FLUSH,
+    BOOT_STAGE_COUNT
+} boot_stage_t;
+void boot_time_mark(boot_stage_t stage);
+int64_t boot_time_us(boot_stage_t stage);
+const char *boot_stage_name(boot_stage_t stage);
+void boot_time_report(void);
+#endif
@@ -0,0 +1,236 @@
+#include "button.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_sleep.h"
+#include "freertos/queue.h"
+
+static const char *TAG = "BUTTON";
+
+#define BUTTON_QUEUE_LEN    8
+
+/* Debounced gesture states. The edge ISR only masks the GPIO interrupt and
+ * arms the debounce timer; everything below runs in the esp_timer task.
+ *
+ * The boot hold is a press that starts within boot_window_ms of
+ * button_init() and lasts boot_hold_ms. It cannot be a button held through
+ * reset: on the C3 dev boards this is the BOOT button on GPIO9, a strapping
+ * pin, and holding it low through reset enters ROM download mode. */
+typedef enum {
+    ST_IDLE,
+    ST_PRESSED,         /* first press, waiting for release or long_press_ms */
+    ST_BOOT_HELD,       /* boot-window press past long_press_ms, waiting for boot_hold_ms */
+    ST_WAIT_SECOND,     /* released, waiting double_click_ms for another press */
+    ST_SECOND_PRESSED,  /* second press of a double click */
+    ST_HELD,            /* long press or boot hold reported, waiting for release */
+} button_state_t;
+
+static button_config_t cfg;
+static QueueHandle_t event_queue = NULL;
+static esp_timer_handle_t debounce_timer = NULL;
+static esp_timer_handle_t gesture_timer = NULL;
+static button_state_t state = ST_IDLE;
+static bool stable_pressed;
+static int64_t edge_time_us;
+static int64_t press_time_us;
+static int64_t init_time_us;
+static button_stats_t stats;
+
+static bool read_pressed(void) {
+    return gpio_get_level(cfg.gpio) == (cfg.active_low ? 0 : 1);
+}
+
+static void emit(button_event_type_t type) {
+    button_event_t evt = {
+        .type = type,
+        .press_time_us = press_time_us,
+        .held_ms = (uint32_t)((esp_timer_get_time() - press_time_us) / 1000),
+    };
+    if (xQueueSend(event_queue, &evt, 0) != pdTRUE) {
+        stats.dropped++;
+        return;
+    }
+    stats.events++;
+}
+
+static void arm_gesture_timer(uint32_t ms) {
+    esp_timer_stop(gesture_timer);
+    esp_timer_start_once(gesture_timer, (uint64_t)ms * 1000);
+}
+
+static bool in_boot_window(void) {
+    return press_time_us - init_time_us < (int64_t)cfg.boot_window_ms * 1000;
+}
+
+static void on_press(void) {
+    switch (state) {
+        case ST_IDLE:
+            press_time_us = edge_time_us;
+            state = ST_PRESSED;
+            arm_gesture_timer(cfg.long_press_ms);
+            break;
+        case ST_WAIT_SECOND:
+            esp_timer_stop(gesture_timer);
+            state = ST_SECOND_PRESSED;
+            break;
+        default:
+            break;
+    }
+}
+
+static void on_release(void) {
+    switch (state) {
+        case ST_BOOT_HELD:
+            /* Let go before boot_hold_ms: the long press it was held back. */
+            esp_timer_stop(gesture_timer);
+            emit(BUTTON_EVT_LONG_PRESS);
+            state = ST_IDLE;
+            break;
+        case ST_PRESSED:
+            if (cfg.double_click_ms == 0) {
+                esp_timer_stop(gesture_timer);
+                emit(BUTTON_EVT_CLICK);
+                state = ST_IDLE;
+            } else {
+                state = ST_WAIT_SECOND;
+                arm_gesture_timer(cfg.double_click_ms);
+            }
+            break;
+        case ST_SECOND_PRESSED:
+            emit(BUTTON_EVT_DOUBLE_CLICK);
+            state = ST_IDLE;
+            break;
+        case ST_HELD:
+            state = ST_IDLE;
+            break;
+        default:
+            break;
+    }
+}
+
+static void gesture_timeout_cb(void *arg) {
+    switch (state) {
+        case ST_BOOT_HELD:
+            emit(BUTTON_EVT_BOOT_HOLD);
+            state = ST_HELD;
+            break;
+        case ST_PRESSED:
+            if (in_boot_window() && cfg.boot_hold_ms > cfg.long_press_ms) {
+                state = ST_BOOT_HELD;
+                arm_gesture_timer(cfg.boot_hold_ms - cfg.long_press_ms);
+                break;
+            }
+            emit(BUTTON_EVT_LONG_PRESS);
+            state = ST_HELD;
+            break;
+        case ST_WAIT_SECOND:
+            emit(BUTTON_EVT_CLICK);
+            state = ST_IDLE;
+            break;
+        default:
+            break;
+    }
+}
+
+/* Runs debounce_ms after the first edge of a burst. If the level settled
+ * back where it was, the burst was contact bounce or a glitch. */
+static void debounce_cb(void *arg) {
+    bool pressed = read_pressed();
+    if (pressed == stable_pressed) {
+        stats.bounces++;
+    } else {
+        stable_pressed = pressed;
+        if (pressed) {
+            on_press();
+        } else {
+            on_release();
+        }
+    }
+    gpio_intr_enable(cfg.gpio);
+}
+
+static void IRAM_ATTR button_isr(void *arg) {
+    gpio_intr_disable(cfg.gpio);
+    edge_time_us = esp_timer_get_time();
+    stats.edges++;
+    esp_timer_start_once(debounce_timer, (uint64_t)cfg.debounce_ms * 1000);
+}
+
+esp_err_t button_init(const button_config_t *config) {
+    cfg = *config;
+    state = ST_IDLE;
+
+    event_queue = xQueueCreate(BUTTON_QUEUE_LEN, sizeof(button_event_t));
+    if (event_queue == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    const esp_timer_create_args_t debounce_args = {
+        .callback = debounce_cb,
+        .name = "btn_debounce",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&debounce_args, &debounce_timer));
+    const esp_timer_create_args_t gesture_args = {
+        .callback = gesture_timeout_cb,
+        .name = "btn_gesture",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&gesture_args, &gesture_timer));
+
+    gpio_config_t io_conf = {
+        .intr_type = GPIO_INTR_ANYEDGE,
+        .mode = GPIO_MODE_INPUT,
+        .pin_bit_mask = (1ULL << cfg.gpio),
+        .pull_down_en = cfg.active_low ? 0 : 1,
+        .pull_up_en = cfg.active_low ? 1 : 0,
+    };
+    ESP_ERROR_CHECK(gpio_config(&io_conf));
+
+    esp_err_t err = gpio_install_isr_service(0);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+        return err;
+    }
+
+    /* Sample the level before the ISR can run so a press that began after
+     * the ROM sampled the strapping pins still counts from here. */
+    init_time_us = esp_timer_get_time();
+    stable_pressed = read_pressed();
+    if (stable_pressed) {
+        press_time_us = init_time_us;
+        state = ST_PRESSED;
+        arm_gesture_timer(cfg.long_press_ms);
+        ESP_LOGI(TAG, "Button down at init");
+    }
+
+    err = gpio_isr_handler_add(cfg.gpio, button_isr, NULL);
+    if (err != ESP_OK) {
+        return err;
+    }
+    return gpio_intr_enable(cfg.gpio);
+}
+
+/* Light sleep is only left through a GPIO level, and arming the wakeup turns
+ * the pin's edge interrupt into a level one. While armed a held button
+ * re-triggers the debouncer every debounce_ms, which lasts only until the
+ * press has woken the display and the edge interrupt is restored. */
+esp_err_t button_set_wakeup(bool enable) {
+    if (!enable) {
+        gpio_wakeup_disable(cfg.gpio);
+        return gpio_set_intr_type(cfg.gpio, GPIO_INTR_ANYEDGE);
+    }
+    esp_err_t err = gpio_wakeup_enable(cfg.gpio, cfg.active_low ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL);
+    if (err != ESP_OK) {
+        return err;
+    }
+    return esp_sleep_enable_gpio_wakeup();
+}
+
+bool button_get_event(button_event_t *event, TickType_t wait) {
+    return event_queue && xQueueReceive(event_queue, event, wait) == pdTRUE;
+}
+
+bool button_is_pressed(void) {
+    return stable_pressed;
+}
+
+void button_get_stats(button_stats_t *out) {
+    *out = stats;
+}
@@ -0,0 +1,48 @@
+#ifndef BUTTON_H
+#define BUTTON_H
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "driver/gpio.h"
+#include "freertos/FreeRTOS.h"
+typedef enum {
+    BUTTON_EVT_CLICK = 0,
+    BUTTON_EVT_DOUBLE_CLICK,
+    BUTTON_EVT_LONG_PRESS,
+    BUTTON_EVT_BOOT_HOLD,
+} button_event_type_t;
+typedef struct {
+    button_event_type_t type;
+    int64_t press_time_us;
+    uint32_t held_ms;
+} button_event_t;
+typedef struct {
+    gpio_num_t gpio;
+    bool active_low;
+    uint32_t debounce_ms;
+    uint32_t double_click_ms;
+    uint32_t long_press_ms;
+    uint32_t boot_hold_ms;
+    uint32_t boot_window_ms;
+} button_config_t;
+typedef struct {
+    uint32_t edges;
+    uint32_t bounces;
+    uint32_t events;
+    uint32_t dropped;
+} button_stats_t;
+#define BUTTON_CONFIG_DEFAULT(pin) { \
+    .gpio = (pin), \
+    .active_low = true, \
+    .debounce_ms = 20, \
+    .double_click_ms = 250, \
+    .long_press_ms = 800, \
+    .boot_hold_ms = 2000, \
+    .boot_window_ms = 5000, \
+}
+esp_err_t button_init(const button_config_t *config);
+bool button_get_event(button_event_t *event, TickType_t wait);
+bool button_is_pressed(void);
+esp_err_t button_set_wakeup(bool enable);
+void button_get_stats(button_stats_t *stats);
+#endif
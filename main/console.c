@@ -0,0 +1,251 @@
+#include "console.h"
+#include "esp_console.h"
+#include "esp_log.h"
+#include "lvgl_sched.h"
+#include "lcd_flush.h"
+#include "ui_anim.h"
+#include "cst816_touch.h"
+#include "trace.h"
+#include "stats_history.h"
+#include "power.h"
+#include "mem_report.h"
+#include "battery.h"
+#include "portal.h"
+#include "journal.h"
+#include "wifi_portal.h"
+#include "pgpemu.h"
+#include "sdkconfig.h"
+#if CONFIG_PM_ENABLE
+#include "esp_pm.h"
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "CONSOLE";
+
+static int cmd_perf(int argc, char **argv) {
+    lvgl_sched_stats_t ss;
+    lcd_flush_stats_t fs;
+    cst816_stats_t ts;
+    lvgl_sched_get_stats(&ss);
+    lcd_flush_get_stats(&fs);
+    cst816_get_stats(&ts);
+    stats_summary_t hs;
+    stats_history_get_summary(&hs);
+    power_stats_t ps;
+    power_get_stats(&ps);
+
+    printf("lvgl: %lu wakeups (%lu event, %lu timeout), %lu/s, handler max %lu us\n",
+           (unsigned long)ss.wakeups, (unsigned long)ss.wakeups_event, (unsigned long)ss.wakeups_timeout,
+           (unsigned long)ss.wakeups_per_sec, (unsigned long)ss.handler_us_max);
+    printf("flush: %lu flushes, %llu bytes, dma last %lu us max %lu us, swap %llu us, %lu merged\n",
+           (unsigned long)fs.flushes, (unsigned long long)fs.bytes, (unsigned long)fs.last_us,
+           (unsigned long)fs.max_us, (unsigned long long)fs.swap_us, (unsigned long)fs.areas_merged);
+    printf("round clip: %llu bytes not sent, %lu windows\n",
+           (unsigned long long)(fs.clipped_px * sizeof(lv_color_t)), (unsigned long)fs.windows);
+    ui_anim_stats_t as;
+    ui_anim_get_stats(&as);
+    printf("anim: %lu started, %lu cancelled, %lu frames, %lu late, last %lu fps at %lu%% cpu\n",
+           (unsigned long)as.started, (unsigned long)as.cancelled, (unsigned long)as.frames,
+           (unsigned long)as.late_frames, (unsigned long)as.fps_last, (unsigned long)as.cpu_pct_last);
+    printf("touch: %lu irqs, %lu reads, %lu errors, %lu dropped, latency max %lu us\n",
+           (unsigned long)ts.irqs, (unsigned long)ts.reads, (unsigned long)ts.read_errors,
+           (unsigned long)ts.dropped, (unsigned long)ts.latency_us_max);
+    printf("history: %u bytes, 1h %lu caught %lu fled %lu spun, 24h %lu caught %lu drops\n",
+           (unsigned)stats_history_footprint(), (unsigned long)hs.last_hour[STATS_EV_CAUGHT],
+           (unsigned long)hs.last_hour[STATS_EV_FLED], (unsigned long)hs.last_hour[STATS_EV_SPUN],
+           (unsigned long)hs.last_day[STATS_EV_CAUGHT], (unsigned long)hs.last_day[STATS_EV_DROP]);
+    printf("power: %s, active %llu s dim %llu s off %llu s, wakes %lu touch %lu button %lu ble, "
+           "wake max %lu us\n", power_state_name(power_get_state()),
+           (unsigned long long)(ps.residency_us[POWER_STATE_ACTIVE] / 1000000),
+           (unsigned long long)(ps.residency_us[POWER_STATE_DIM] / 1000000),
+           (unsigned long long)(ps.residency_us[POWER_STATE_OFF] / 1000000),
+           (unsigned long)ps.wakes[POWER_SRC_TOUCH], (unsigned long)ps.wakes[POWER_SRC_BUTTON],
+           (unsigned long)ps.wakes[POWER_SRC_BLE], (unsigned long)ps.wake_us_max);
+    battery_state_t bs;
+    battery_get(&bs);
+    if (bs.samples) {
+        char tte[16] = "unknown";
+        if (bs.tte_min != BATTERY_TTE_UNKNOWN) {
+            snprintf(tte, sizeof(tte), "%lu min", (unsigned long)bs.tte_min);
+        }
+        printf("battery: %u mV (raw %u), %u%%, %s left, %lu samples, %lu published, %lu errors, "
+               "sample max %lu us\n", bs.filtered_mv, bs.raw_mv, bs.percent, tte, (unsigned long)bs.samples,
+               (unsigned long)bs.published, (unsigned long)bs.read_errors, (unsigned long)bs.sample_us_max);
+    }
+    if (wifi_portal_running()) {
+        portal_stats_t pos;
+        portal_get_stats(&pos);
+        printf("portal: %lu requests, %lu errors, %lu settings writes, %lu events, %lu overflows, "
+               "largest %lu bytes, build max %lu us\n", (unsigned long)pos.requests, (unsigned long)pos.errors,
+               (unsigned long)pos.settings_writes, (unsigned long)pos.events, (unsigned long)pos.overflows,
+               (unsigned long)pos.resp_bytes_max, (unsigned long)pos.build_us_max);
+    }
+    return 0;
+}
+
+/* "accounts" lists the link table; "accounts N catch|spin on|off" sets
+ * one account's flag, under the global toggles of the settings screen. */
+static int cmd_accounts(int argc, char **argv) {
+    pgp_account_t acc[PGP_LINK_MAX];
+    uint8_t n = pgpemu_get_accounts(acc, PGP_LINK_MAX);
+    if (argc == 4) {
+        int slot = atoi(argv[1]) - 1;
+        bool on = strcmp(argv[3], "on") == 0;
+        for (uint8_t i = 0; i < n; i++) {
+            if (acc[i].slot != slot) {
+                continue;
+            }
+            bool catch_on = acc[i].allow_catch, spin_on = acc[i].allow_spin;
+            if (strcmp(argv[2], "catch") == 0) {
+                catch_on = on;
+            } else if (strcmp(argv[2], "spin") == 0) {
+                spin_on = on;
+            } else {
+                break;
+            }
+            return pgpemu_set_account_flags((uint8_t)slot, catch_on, spin_on) == ESP_OK ? 0 : 1;
+        }
+        printf("usage: accounts [N catch|spin on|off]\n");
+        return 1;
+    }
+    for (uint8_t i = 0; i < n; i++) {
+        const pgp_account_t *a = &acc[i];
+        printf("%u %02x:%02x:%02x:%02x:%02x:%02x %-12s catch %-3s spin %-3s %lu caught %lu fled %lu spun, "
+               "%lu presses, latency max %lu us\n", a->slot + 1, a->addr[0], a->addr[1], a->addr[2], a->addr[3],
+               a->addr[4], a->addr[5], a->connected ? "connected" : "disconnected", a->allow_catch ? "on" : "off",
+               a->allow_spin ? "on" : "off", (unsigned long)a->caught, (unsigned long)a->fled,
+               (unsigned long)a->spun, (unsigned long)a->presses, (unsigned long)a->latency_us_max);
+    }
+    pgp_link_stats_t ls;
+    pgpemu_get_link_stats(&ls);
+    printf("links: %lu connects, %lu refused, %lu recycled, %lu presses, %lu deferred (max %lu us)\n",
+           (unsigned long)ls.connects, (unsigned long)ls.refused, (unsigned long)ls.recycled,
+           (unsigned long)ls.presses, (unsigned long)ls.deferred, (unsigned long)ls.defer_us_max);
+    return 0;
+}
+
+/* "journal" prints the last 20 records as CSV, "journal N" the last N,
+ * "journal all" everything still on flash. */
+static int cmd_journal(int argc, char **argv) {
+    uint32_t count = 20;
+    if (argc == 2) {
+        count = strcmp(argv[1], "all") == 0 ? 0 : (uint32_t)atoi(argv[1]);
+        if (count == 0 && strcmp(argv[1], "all") != 0) {
+            printf("usage: journal [N|all]\n");
+            return 1;
+        }
+    }
+    journal_stats_t js;
+    journal_get_stats(&js);
+    journal_counters_t jc;
+    journal_get_counters(&jc);
+    printf("# journal: seq %lu, sector %lu/%lu record %lu, %lu caught %lu fled %lu spun %lu connects %lu boots\n",
+           (unsigned long)js.last_seq, (unsigned long)js.sector, (unsigned long)js.sectors, (unsigned long)js.head,
+           (unsigned long)jc.caught, (unsigned long)jc.fled, (unsigned long)jc.spun, (unsigned long)jc.connects,
+           (unsigned long)jc.boots);
+    printf("# %lu written, %lu dropped, %lu lost, %lu rolls, %lu erases, boot scan %lu reads %lu us, "
+           "%lu replayed, %lu torn\n", (unsigned long)js.written, (unsigned long)js.dropped,
+           (unsigned long)js.lost, (unsigned long)js.rolls, (unsigned long)js.erases, (unsigned long)js.scan_reads,
+           (unsigned long)js.scan_us, (unsigned long)js.replayed, (unsigned long)js.torn);
+    journal_print(stdout, count);
+    return 0;
+}
+
+static int cmd_mem(int argc, char **argv) {
+    mem_report_print(stdout);
+    return 0;
+}
+
+#if CONFIG_PM_ENABLE
+/* With CONFIG_PGPEMU_PM_PROFILING the dump ends with the time spent in
+ * each power mode (light sleep, APB min, APB max, CPU max) since boot. */
+static int cmd_pm(int argc, char **argv) {
+    return esp_pm_dump_locks(stdout) == ESP_OK ? 0 : 1;
+}
+#endif
+
+#if CONFIG_PGPEMU_TRACE
+static int cmd_trace(int argc, char **argv) {
+    if (argc == 2 && strcmp(argv[1], "dump") == 0) {
+        trace_dump(stdout);
+        return 0;
+    }
+    if (argc == 2 && strcmp(argv[1], "clear") == 0) {
+        trace_clear();
+        return 0;
+    }
+    printf("usage: trace dump|clear\n");
+    return 1;
+}
+#endif
+
+esp_err_t console_init(void) {
+    esp_console_repl_t *repl = NULL;
+    esp_console_repl_config_t repl_config = ESP_CONSOLE_REPL_CONFIG_DEFAULT();
+    repl_config.prompt = "pgpemu>";
+    esp_console_dev_usb_serial_jtag_config_t hw_config = ESP_CONSOLE_DEV_USB_SERIAL_JTAG_CONFIG_DEFAULT();
+
+    esp_err_t err = esp_console_new_repl_usb_serial_jtag(&hw_config, &repl_config, &repl);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Console init failed: %s", esp_err_to_name(err));
+        return err;
+    }
+    esp_console_register_help_command();
+
+    const esp_console_cmd_t perf_cmd = {
+        .command = "perf",
+        .help = "Print LVGL scheduler, LCD flush and touch counters",
+        .func = cmd_perf,
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&perf_cmd));
+
+    const esp_console_cmd_t mem_cmd = {
+        .command = "mem",
+        .help = "Print task stack high-water marks, heap and LVGL pool use",
+        .func = cmd_mem,
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&mem_cmd));
+
+    const esp_console_cmd_t accounts_cmd = {
+        .command = "accounts",
+        .help = "List the phones served, or set one account's catch/spin flag",
+        .hint = "[N catch|spin on|off]",
+        .func = cmd_accounts,
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&accounts_cmd));
+
+    const esp_console_cmd_t journal_cmd = {
+        .command = "journal",
+        .help = "Export the event journal as CSV, the last N records or all of them",
+        .hint = "[N|all]",
+        .func = cmd_journal,
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&journal_cmd));
+
+#if CONFIG_PM_ENABLE
+    const esp_console_cmd_t pm_cmd = {
+        .command = "pm",
+#if CONFIG_PM_PROFILING
+        .help = "Print power management locks and time spent in each power mode",
+#else
+        .help = "Print power management locks",
+#endif
+        .func = cmd_pm,
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&pm_cmd));
+#endif
+
+#if CONFIG_PGPEMU_TRACE
+    const esp_console_cmd_t trace_cmd = {
+        .command = "trace",
+        .help = "Dump or clear the task timing trace ring",
+        .hint = "dump|clear",
+        .func = cmd_trace,
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&trace_cmd));
+#endif
+
+    return esp_console_start_repl(repl);
+}
@@ -1,6 +1,12 @@
 #include "cst816_touch.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "driver/i2c.h"
+#include "driver/gpio.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "trace.h"
+#include <stdatomic.h>
 #include <string.h>
 
 static const char *TAG = "CST816";
@@ -14,9 +20,37 @@ static i2c_port_t cst816_i2c_port = I2C_NUM_0;
 #define CST816_REG_YPOS_L       0x06
 #define CST816_REG_VERSION      0xA7
 #define CST816_REG_SLEEP        0xE5
+#define CST816_REG_IRQ_CTL      0xFA
 
-static esp_err_t cst816_read_reg(uint8_t reg, uint8_t *data, size_t len) {
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+#define CST816_IRQ_EN_TOUCH     0x40
+#define CST816_IRQ_EN_CHANGE    0x20
+#define CST816_IRQ_EN_MOTION    0x10
+
+#define CST816_TOUCH_LEN        6
+#define CST816_RESET_LOW_MS     10
+#define CST816_BOOT_MS          50
+
+/* Command links live in static storage so no transaction touches the heap.
+ * The touch read is built once and replayed; other register accesses reuse a
+ * scratch buffer (they only run from one task at a time). */
+static uint8_t touch_link_buf[I2C_LINK_RECOMMENDED_SIZE(3)];
+static uint8_t scratch_link_buf[I2C_LINK_RECOMMENDED_SIZE(3)];
+static i2c_cmd_handle_t touch_link = NULL;
+static uint8_t touch_raw[CST816_TOUCH_LEN];
+
+static gpio_num_t int_gpio = GPIO_NUM_NC;
+static gpio_num_t rst_gpio = GPIO_NUM_NC;
+static bool sleeping;
+static cst816_notify_cb_t int_notify = NULL;
+static atomic_bool int_pending;
+static volatile int64_t int_time_us;
+
+static cst816_sample_t ring[CST816_RING_SIZE];
+static atomic_uint ring_head;
+static atomic_uint ring_tail;
+static cst816_stats_t stats;
+
+static void build_read(i2c_cmd_handle_t cmd, uint8_t reg, uint8_t *data, size_t len) {
     i2c_master_start(cmd);
     i2c_master_write_byte(cmd, (CST816_I2C_ADDR << 1) | I2C_MASTER_WRITE, true);
     i2c_master_write_byte(cmd, reg, true);
@@ -27,23 +61,36 @@ static esp_err_t cst816_read_reg(uint8_t reg, uint8_t *data, size_t len) {
     }
     i2c_master_read_byte(cmd, data + len - 1, I2C_MASTER_NACK);
     i2c_master_stop(cmd);
+}
+
+static esp_err_t cst816_read_reg(uint8_t reg, uint8_t *data, size_t len) {
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create_static(scratch_link_buf, sizeof(scratch_link_buf));
+    build_read(cmd, reg, data, len);
     esp_err_t ret = i2c_master_cmd_begin(cst816_i2c_port, cmd, pdMS_TO_TICKS(100));
-    i2c_cmd_link_delete(cmd);
+    i2c_cmd_link_delete_static(cmd);
     return ret;
 }
 
 static esp_err_t cst816_write_reg(uint8_t reg, uint8_t data) {
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create_static(scratch_link_buf, sizeof(scratch_link_buf));
     i2c_master_start(cmd);
     i2c_master_write_byte(cmd, (CST816_I2C_ADDR << 1) | I2C_MASTER_WRITE, true);
     i2c_master_write_byte(cmd, reg, true);
     i2c_master_write_byte(cmd, data, true);
     i2c_master_stop(cmd);
     esp_err_t ret = i2c_master_cmd_begin(cst816_i2c_port, cmd, pdMS_TO_TICKS(100));
-    i2c_cmd_link_delete(cmd);
+    i2c_cmd_link_delete_static(cmd);
     return ret;
 }
 
+/* Without EnMotion the controller still latches swipes in the gesture
+ * register but does not raise INT for them, so a quick flick could be seen
+ * only as a press and a lift. A reset clears it, so it is set again after
+ * every reset pulse. */
+static esp_err_t enable_motion_irq(void) {
+    return cst816_write_reg(CST816_REG_IRQ_CTL, CST816_IRQ_EN_TOUCH | CST816_IRQ_EN_CHANGE | CST816_IRQ_EN_MOTION);
+}
+
 esp_err_t cst816_init(i2c_port_t i2c_num, gpio_num_t sda_pin, gpio_num_t scl_pin) {
     cst816_i2c_port = i2c_num;
     
@@ -67,6 +114,13 @@ esp_err_t cst816_init(i2c_port_t i2c_num, gpio_num_t sda_pin, gpio_num_t scl_pin
         ESP_LOGE(TAG, "I2C driver install failed");
         return ret;
     }
+
+    touch_link = i2c_cmd_link_create_static(touch_link_buf, sizeof(touch_link_buf));
+    if (touch_link == NULL) {
+        ESP_LOGE(TAG, "Touch command link does not fit its buffer");
+        return ESP_ERR_NO_MEM;
+    }
+    build_read(touch_link, CST816_REG_GESTURE, touch_raw, sizeof(touch_raw));
     
     uint8_t version;
     ret = cst816_get_version(&version);
@@ -75,20 +129,75 @@ esp_err_t cst816_init(i2c_port_t i2c_num, gpio_num_t sda_pin, gpio_num_t scl_pin
     } else {
         ESP_LOGW(TAG, "CST816 version read failed, but continuing...");
     }
+
+    if (enable_motion_irq() != ESP_OK) {
+        ESP_LOGW(TAG, "Gesture interrupt enable failed, swipes fall back to raw samples");
+    }
     
     return ESP_OK;
 }
 
+static void IRAM_ATTR cst816_isr(void *arg) {
+    int_time_us = esp_timer_get_time();
+    atomic_store_explicit(&int_pending, true, memory_order_release);
+    stats.irqs++;
+    if (int_notify) {
+        int_notify();
+    }
+}
+
+/* The controller pulls INT low whenever it has a new report (roughly every
+ * 10 ms while a finger is down, once on lift), so nothing is read over I2C
+ * while the glass is untouched. */
+esp_err_t cst816_enable_interrupt(gpio_num_t int_pin, cst816_notify_cb_t notify_from_isr) {
+    gpio_config_t io_conf = {
+        .intr_type = GPIO_INTR_NEGEDGE,
+        .mode = GPIO_MODE_INPUT,
+        .pin_bit_mask = (1ULL << int_pin),
+        .pull_down_en = 0,
+        .pull_up_en = 1,
+    };
+    esp_err_t ret = gpio_config(&io_conf);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    ret = gpio_install_isr_service(0);
+    if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) {
+        ESP_LOGE(TAG, "GPIO ISR service install failed");
+        return ret;
+    }
+
+    int_notify = notify_from_isr;
+    int_gpio = int_pin;
+    ret = gpio_isr_handler_add(int_pin, cst816_isr, NULL);
+    if (ret != ESP_OK) {
+        int_gpio = GPIO_NUM_NC;
+        return ret;
+    }
+    ESP_LOGI(TAG, "Touch interrupt on GPIO %d", int_pin);
+    return ESP_OK;
+}
+
+bool cst816_interrupt_enabled(void) {
+    return int_gpio != GPIO_NUM_NC;
+}
+
 esp_err_t cst816_read_touch(cst816_touch_data_t *touch_data) {
     if (touch_data == NULL) {
         return ESP_ERR_INVALID_ARG;
     }
+    if (touch_link == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
     
-    uint8_t data[6];
-    esp_err_t ret = cst816_read_reg(CST816_REG_GESTURE, data, sizeof(data));
+    stats.reads++;
+    esp_err_t ret = i2c_master_cmd_begin(cst816_i2c_port, touch_link, pdMS_TO_TICKS(100));
     if (ret != ESP_OK) {
+        stats.read_errors++;
         return ret;
     }
+    const uint8_t *data = touch_raw;
     
     touch_data->gesture = (cst816_gesture_t)data[0];
     uint8_t points = data[1] & 0x0F;
@@ -105,6 +214,67 @@ esp_err_t cst816_read_touch(cst816_touch_data_t *touch_data) {
     return ESP_OK;
 }
 
+/* Reads one report if the controller signalled one (or unconditionally when
+ * no INT line is wired) and queues it for cst816_pop_sample(). Returns the
+ * number of samples queued. */
+int cst816_service(void) {
+    int64_t t_irq;
+    if (cst816_interrupt_enabled()) {
+        if (!atomic_exchange_explicit(&int_pending, false, memory_order_acquire)) {
+            return 0;
+        }
+        t_irq = int_time_us;
+    } else {
+        t_irq = esp_timer_get_time();
+    }
+
+    cst816_sample_t sample = { .irq_time_us = t_irq };
+    TRACE_BEGIN(read);
+    esp_err_t err = cst816_read_touch(&sample.data);
+    TRACE_END(read, TRACE_EV_TOUCH_READ, err == ESP_OK);
+    if (err != ESP_OK) {
+        return 0;
+    }
+
+    unsigned head = atomic_load_explicit(&ring_head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&ring_tail, memory_order_acquire);
+    if (head - tail >= CST816_RING_SIZE) {
+        stats.dropped++;
+        return 0;
+    }
+    ring[head % CST816_RING_SIZE] = sample;
+    atomic_store_explicit(&ring_head, head + 1, memory_order_release);
+    return 1;
+}
+
+bool cst816_pop_sample(cst816_sample_t *sample) {
+    unsigned tail = atomic_load_explicit(&ring_tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&ring_head, memory_order_acquire);
+    if (tail == head) {
+        return false;
+    }
+    *sample = ring[tail % CST816_RING_SIZE];
+    atomic_store_explicit(&ring_tail, tail + 1, memory_order_release);
+
+    uint32_t latency = (uint32_t)(esp_timer_get_time() - sample->irq_time_us);
+    stats.samples++;
+    stats.latency_us_last = latency;
+    stats.latency_us_total += latency;
+    if (latency > stats.latency_us_max) {
+        stats.latency_us_max = latency;
+    }
+    return true;
+}
+
+unsigned cst816_samples_pending(void) {
+    return atomic_load_explicit(&ring_head, memory_order_acquire) -
+           atomic_load_explicit(&ring_tail, memory_order_relaxed);
+}
+
+void cst816_get_stats(cst816_stats_t *out) {
+    *out = stats;
+}
+
 esp_err_t cst816_get_version(uint8_t *version) {
     if (version == NULL) {
         return ESP_ERR_INVALID_ARG;
@@ -112,11 +282,66 @@ esp_err_t cst816_get_version(uint8_t *version) {
     return cst816_read_reg(CST816_REG_VERSION, version, 1);
 }
 
+/* A configured pin that is not actually wired to the controller would let
+ * cst816_sleep() put it out of reach until the next power cycle, so the
+ * line is proven before it is accepted: held low, the controller must stop
+ * answering on I2C, and released, it must answer again. */
+esp_err_t cst816_attach_reset(gpio_num_t rst_pin) {
+    gpio_config_t io_conf = {
+        .pin_bit_mask = 1ULL << rst_pin,
+        .mode = GPIO_MODE_OUTPUT,
+    };
+    esp_err_t ret = gpio_config(&io_conf);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    uint8_t version;
+    gpio_set_level(rst_pin, 0);
+    vTaskDelay(pdMS_TO_TICKS(CST816_RESET_LOW_MS));
+    bool held = cst816_get_version(&version) != ESP_OK;
+    gpio_set_level(rst_pin, 1);
+    vTaskDelay(pdMS_TO_TICKS(CST816_BOOT_MS));
+    if (!held || cst816_get_version(&version) != ESP_OK) {
+        ESP_LOGW(TAG, "CST816 does not follow reset on GPIO %d", rst_pin);
+        return ESP_ERR_NOT_FOUND;
+    }
+    enable_motion_irq();
+    rst_gpio = rst_pin;
+    return ESP_OK;
+}
+
+/* Deep sleep stops scanning and the controller stops answering on I2C; only
+ * a pulse on its reset line brings it back, so without one the request is
+ * refused rather than leaving the touch panel dead until power cycles. */
 esp_err_t cst816_sleep(void) {
-    return cst816_write_reg(CST816_REG_SLEEP, 0x03);
+    if (rst_gpio == GPIO_NUM_NC) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    if (sleeping) {
+        return ESP_OK;
+    }
+    esp_err_t ret = cst816_write_reg(CST816_REG_SLEEP, 0x03);
+    if (ret == ESP_OK) {
+        sleeping = true;
+    }
+    return ret;
 }
 
 esp_err_t cst816_wake(void) {
+    if (sleeping) {
+        gpio_set_level(rst_gpio, 0);
+        vTaskDelay(pdMS_TO_TICKS(CST816_RESET_LOW_MS));
+        gpio_set_level(rst_gpio, 1);
+        vTaskDelay(pdMS_TO_TICKS(CST816_BOOT_MS));
+        sleeping = false;
+        /* Anything latched before sleep is stale now. */
+        atomic_store_explicit(&int_pending, false, memory_order_relaxed);
+        return enable_motion_irq();
+    }
     uint8_t version;
     return cst816_get_version(&version);
 }
+
+bool cst816_is_sleeping(void) {
+    return sleeping;
+}
@@ -5,9 +5,23 @@
 #include "driver/i2c.h"
 #define CST816_I2C_ADDR 0x15
 typedef enum { TOUCH_EVENT_NONE=0, TOUCH_EVENT_DOWN=1, TOUCH_EVENT_UP=2, TOUCH_EVENT_CONTACT=3 } cst816_event_t;
-typedef enum { GESTURE_NONE=0x00, GESTURE_SWIPE_UP=0x01, GESTURE_SWIPE_DOWN=0x02 } cst816_gesture_t;
+typedef enum { GESTURE_NONE=0x00, GESTURE_SWIPE_UP=0x01, GESTURE_SWIPE_DOWN=0x02, GESTURE_SWIPE_LEFT=0x03, GESTURE_SWIPE_RIGHT=0x04, GESTURE_SINGLE_CLICK=0x05, GESTURE_DOUBLE_CLICK=0x0B, GESTURE_LONG_PRESS=0x0C } cst816_gesture_t;
 typedef struct { uint16_t x; uint16_t y; cst816_event_t event; cst816_gesture_t gesture; bool touched; } cst816_touch_data_t;
+typedef struct { cst816_touch_data_t data; int64_t irq_time_us; } cst816_sample_t;
+typedef struct { uint32_t irqs; uint32_t reads; uint32_t read_errors; uint32_t dropped; uint32_t latency_us_last; uint32_t latency_us_max; uint64_t latency_us_total; uint32_t samples; } cst816_stats_t;
+typedef void (*cst816_notify_cb_t)(void);
+#define CST816_RING_SIZE 8
 esp_err_t cst816_init(i2c_port_t i2c_num, gpio_num_t sda_pin, gpio_num_t scl_pin);
+esp_err_t cst816_enable_interrupt(gpio_num_t int_pin, cst816_notify_cb_t notify_from_isr);
 esp_err_t cst816_read_touch(cst816_touch_data_t *touch_data);
 esp_err_t cst816_get_version(uint8_t *version);
+esp_err_t cst816_attach_reset(gpio_num_t rst_pin);
+esp_err_t cst816_sleep(void);
+esp_err_t cst816_wake(void);
+bool cst816_is_sleeping(void);
+int cst816_service(void);
+bool cst816_pop_sample(cst816_sample_t *sample);
+unsigned cst816_samples_pending(void);
+bool cst816_interrupt_enabled(void);
+void cst816_get_stats(cst816_stats_t *stats);
 #endif
@@ -0,0 +1,357 @@
+#include "display_port.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_attr.h"
+#include "driver/gpio.h"
+#include "driver/spi_master.h"
+#include "driver/ledc.h"
+#include "esp_lcd_panel_io.h"
+#include "esp_lcd_panel_vendor.h"
+#include "esp_lcd_panel_ops.h"
+#include "cst816_touch.h"
+#include "swipe.h"
+#include "lvgl_sched.h"
+#include "lcd_flush.h"
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <assert.h>
+
+static const char *TAG = "DISP";
+
+#define LCD_HOST        SPI2_HOST
+#define LCD_PIXEL_CLK   40000000
+#define LCD_BK_LIGHT    GPIO_NUM_3
+#define LCD_PIN_MOSI    GPIO_NUM_7
+#define LCD_PIN_CLK     GPIO_NUM_6
+#define LCD_PIN_CS      GPIO_NUM_10
+#define LCD_PIN_DC      GPIO_NUM_2
+#define LCD_PIN_RST     GPIO_NUM_NC
+
+#define TOUCH_I2C_PORT  I2C_NUM_0
+#define TOUCH_PIN_SDA   GPIO_NUM_4
+#define TOUCH_PIN_SCL   GPIO_NUM_5
+#define TOUCH_PIN_INT   CONFIG_PGPEMU_TOUCH_INT_GPIO
+#define TOUCH_PIN_RST   CONFIG_PGPEMU_TOUCH_RST_GPIO
+
+#define BL_LEDC_MODE    LEDC_LOW_SPEED_MODE
+#define BL_LEDC_TIMER   LEDC_TIMER_0
+#define BL_LEDC_CHANNEL LEDC_CHANNEL_0
+#define BL_LEDC_BITS    LEDC_TIMER_10_BIT
+#define BL_LEDC_FREQ_HZ 5000
+#define BL_DUTY_MAX     ((1U << BL_LEDC_BITS) - 1)
+#define LCD_SLPOUT_MS   120
+
+#if CONFIG_PGPEMU_DRAW_BUF_FULL
+#define DRAW_BUF_MODE   DISPLAY_BUF_FULL
+#define DRAW_BUF_LINES  LCD_V_RES
+#define DRAW_BUF_COUNT  1
+#elif CONFIG_PGPEMU_DRAW_BUF_SINGLE
+#define DRAW_BUF_MODE   DISPLAY_BUF_SINGLE
+#define DRAW_BUF_LINES  CONFIG_PGPEMU_DRAW_BUF_LINES
+#define DRAW_BUF_COUNT  1
+#else
+#define DRAW_BUF_MODE   DISPLAY_BUF_DOUBLE
+#define DRAW_BUF_LINES  CONFIG_PGPEMU_DRAW_BUF_LINES
+#define DRAW_BUF_COUNT  2
+#endif
+
+/* Static mode leaves LVGL on its built-in pool, which is a static array in
+ * .bss; a custom allocator would put it back on the heap. */
+#if CONFIG_PGPEMU_STATIC_ALLOC && LV_MEM_CUSTOM
+#error "PGPEMU_STATIC_ALLOC needs LVGL's built-in memory pool (LV_MEM_CUSTOM=n)"
+#endif
+
+static lv_disp_draw_buf_t disp_buf;
+static lv_disp_drv_t disp_drv;
+static lv_color_t *buf1;
+static lv_color_t *buf2;
+#if CONFIG_PGPEMU_STATIC_ALLOC
+/* All internal RAM on the C3 is DMA capable; DMA_ATTR keeps it word
+ * aligned and out of any PSRAM placement. */
+DMA_ATTR static lv_color_t draw_mem[DRAW_BUF_COUNT * LCD_H_RES * DRAW_BUF_LINES];
+#endif
+static display_buf_mode_t buf_mode = DRAW_BUF_MODE;
+static uint16_t buf_lines = DRAW_BUF_LINES;
+static esp_lcd_panel_handle_t panel_handle = NULL;
+static lv_indev_t *touch_indev = NULL;
+static lv_indev_data_t touch_last = { .state = LV_INDEV_STATE_REL };
+static display_activity_cb_t activity_cb = NULL;
+static display_swipe_cb_t swipe_cb = NULL;
+static bool panel_asleep;
+
+/* Drains the sample ring filled by cst816_service(). Several reports can
+ * arrive between two LVGL input reads, so continue_reading asks LVGL to come
+ * back for the rest within the same cycle. With the INT line in use the read
+ * timer is parked once the finger is up and nothing is queued, and
+ * display_port_touch_event() wakes it on the next report.
+ *
+ * Every sample also goes through the swipe recognizer. When a lift ends a
+ * swipe, the indev is reset before LVGL sees the release, so the widget
+ * under the finger gets no click, and the swipe callback runs instead. */
+static void lvgl_touch_cb(lv_indev_drv_t *drv, lv_indev_data_t *data) {
+    cst816_sample_t sample;
+    swipe_dir_t swipe = SWIPE_NONE;
+
+    if (!cst816_interrupt_enabled()) {
+        cst816_service();
+    }
+    if (cst816_pop_sample(&sample)) {
+        if (activity_cb) {
+            activity_cb();
+        }
+        if (sample.data.touched) {
+            touch_last.point.x = sample.data.x;
+            touch_last.point.y = sample.data.y;
+            touch_last.state = LV_INDEV_STATE_PR;
+        } else {
+            touch_last.state = LV_INDEV_STATE_REL;
+        }
+        swipe = swipe_feed(&sample);
+    }
+    data->point = touch_last.point;
+    data->state = touch_last.state;
+    if (swipe != SWIPE_NONE && swipe_cb) {
+        lv_indev_reset(touch_indev, NULL);
+        swipe_cb(swipe, sample.irq_time_us);
+    }
+
+    data->continue_reading = cst816_samples_pending() > 0;
+    if (!data->continue_reading && touch_last.state == LV_INDEV_STATE_REL &&
+        cst816_interrupt_enabled() && drv->read_timer) {
+        lv_timer_pause(drv->read_timer);
+    }
+}
+
+static void IRAM_ATTR touch_notify_from_isr(void) {
+    lvgl_sched_notify_from_isr(LVGL_SCHED_EVT_TOUCH);
+}
+
+/* Perceived brightness is roughly quadratic in PWM duty, so percent is
+ * squared before scaling; 50 % then looks about half as bright. */
+static uint32_t backlight_duty(uint8_t percent) {
+    if (percent > 100) {
+        percent = 100;
+    }
+    return (uint32_t)percent * percent * BL_DUTY_MAX / 10000;
+}
+
+static void init_backlight(void) {
+    ledc_timer_config_t timer = {
+        .speed_mode = BL_LEDC_MODE,
+        .duty_resolution = BL_LEDC_BITS,
+        .timer_num = BL_LEDC_TIMER,
+        .freq_hz = BL_LEDC_FREQ_HZ,
+        .clk_cfg = LEDC_AUTO_CLK,
+    };
+    ESP_ERROR_CHECK(ledc_timer_config(&timer));
+
+    ledc_channel_config_t channel = {
+        .gpio_num = LCD_BK_LIGHT,
+        .speed_mode = BL_LEDC_MODE,
+        .channel = BL_LEDC_CHANNEL,
+        .timer_sel = BL_LEDC_TIMER,
+        .duty = backlight_duty(CONFIG_PGPEMU_BACKLIGHT_PERCENT),
+    };
+    ESP_ERROR_CHECK(ledc_channel_config(&channel));
+    ESP_ERROR_CHECK(ledc_fade_func_install(0));
+}
+
+static void init_lcd(void) {
+    ESP_LOGI(TAG, "Initialize LCD");
+
+    init_backlight();
+
+    spi_bus_config_t buscfg = {
+        .mosi_io_num = LCD_PIN_MOSI,
+        .miso_io_num = GPIO_NUM_NC,
+        .sclk_io_num = LCD_PIN_CLK,
+        .quadwp_io_num = GPIO_NUM_NC,
+        .quadhd_io_num = GPIO_NUM_NC,
+        .max_transfer_sz = LCD_H_RES * LCD_V_RES * sizeof(uint16_t),
+    };
+    ESP_ERROR_CHECK(spi_bus_initialize(LCD_HOST, &buscfg, SPI_DMA_CH_AUTO));
+
+    esp_lcd_panel_io_handle_t io_handle = NULL;
+    esp_lcd_panel_io_spi_config_t io_config = {
+        .dc_gpio_num = LCD_PIN_DC,
+        .cs_gpio_num = LCD_PIN_CS,
+        .pclk_hz = LCD_PIXEL_CLK,
+        .lcd_cmd_bits = 8,
+        .lcd_param_bits = 8,
+        .spi_mode = 0,
+        .trans_queue_depth = 10,
+        .on_color_trans_done = lcd_flush_trans_done,
+        .user_ctx = &disp_drv,
+    };
+    ESP_ERROR_CHECK(esp_lcd_new_panel_io_spi((esp_lcd_spi_bus_handle_t)LCD_HOST, &io_config, &io_handle));
+
+    esp_lcd_panel_dev_config_t panel_config = {
+        .reset_gpio_num = LCD_PIN_RST,
+        .rgb_endian = LCD_RGB_ENDIAN_RGB,
+        .bits_per_pixel = 16,
+    };
+    ESP_ERROR_CHECK(esp_lcd_new_panel_gc9a01(io_handle, &panel_config, &panel_handle));
+
+    ESP_ERROR_CHECK(esp_lcd_panel_reset(panel_handle));
+    ESP_ERROR_CHECK(esp_lcd_panel_init(panel_handle));
+    ESP_ERROR_CHECK(esp_lcd_panel_disp_on_off(panel_handle, true));
+
+    ESP_LOGI(TAG, "LCD initialized");
+}
+
+static void init_lvgl(void) {
+    ESP_LOGI(TAG, "Initialize LVGL");
+
+    lv_init();
+
+    uint32_t buf_px = LCD_H_RES * buf_lines;
+    bool two = buf_mode == DISPLAY_BUF_DOUBLE;
+#if CONFIG_PGPEMU_STATIC_ALLOC
+    buf1 = draw_mem;
+    buf2 = two ? draw_mem + buf_px : NULL;
+#else
+    buf1 = heap_caps_malloc(buf_px * sizeof(lv_color_t), MALLOC_CAP_DMA);
+    buf2 = two ? heap_caps_malloc(buf_px * sizeof(lv_color_t), MALLOC_CAP_DMA) : NULL;
+    assert(buf1 && (buf2 || !two));
+#endif
+
+    lv_disp_draw_buf_init(&disp_buf, buf1, buf2, buf_px);
+
+    lv_disp_drv_init(&disp_drv);
+    disp_drv.hor_res = LCD_H_RES;
+    disp_drv.ver_res = LCD_V_RES;
+    disp_drv.draw_buf = &disp_buf;
+    disp_drv.direct_mode = buf_mode == DISPLAY_BUF_FULL;
+    lcd_flush_attach(&disp_drv, panel_handle);
+    lcd_flush_install_refr_hook(lv_disp_drv_register(&disp_drv));
+
+    ESP_LOGI(TAG, "LVGL initialized, %s draw buffer, %u lines, %lu bytes", display_buf_mode_name(buf_mode),
+             (unsigned)buf_lines, (unsigned long)(buf_px * sizeof(lv_color_t) * (two ? 2 : 1)));
+}
+
+/* Overrides the Kconfig buffer strategy; call before display_port_init().
+ * The host bench uses it to run one binary under every strategy. In
+ * static mode only strategies that fit the static buffer are accepted. */
+esp_err_t display_port_set_buf_mode(display_buf_mode_t mode, uint16_t lines) {
+    if (mode == DISPLAY_BUF_FULL) {
+        lines = LCD_V_RES;
+    }
+    if (lines == 0 || lines > LCD_V_RES) {
+        return ESP_ERR_INVALID_ARG;
+    }
+#if CONFIG_PGPEMU_STATIC_ALLOC
+    uint32_t need = (mode == DISPLAY_BUF_DOUBLE ? 2U : 1U) * LCD_H_RES * lines;
+    if (need > sizeof(draw_mem) / sizeof(draw_mem[0])) {
+        return ESP_ERR_NO_MEM;
+    }
+#endif
+    buf_mode = mode;
+    buf_lines = lines;
+    return ESP_OK;
+}
+
+display_buf_mode_t display_port_get_buf_mode(void) {
+    return buf_mode;
+}
+
+const char *display_buf_mode_name(display_buf_mode_t mode) {
+    switch (mode) {
+        case DISPLAY_BUF_FULL:
+            return "full";
+        case DISPLAY_BUF_SINGLE:
+            return "single";
+        default:
+            return "double";
+    }
+}
+
+void display_port_init(void) {
+    init_lcd();
+    init_lvgl();
+}
+
+void display_port_init_touch(void) {
+    ESP_LOGI(TAG, "Initialize touch");
+
+    ESP_ERROR_CHECK(cst816_init(TOUCH_I2C_PORT, TOUCH_PIN_SDA, TOUCH_PIN_SCL));
+#if CONFIG_PGPEMU_TOUCH_INT_GPIO >= 0
+    if (cst816_enable_interrupt(TOUCH_PIN_INT, touch_notify_from_isr) != ESP_OK) {
+        ESP_LOGW(TAG, "Touch INT unavailable, falling back to polling");
+    }
+#endif
+#if CONFIG_PGPEMU_TOUCH_RST_GPIO >= 0
+    if (cst816_attach_reset(TOUCH_PIN_RST) != ESP_OK) {
+        ESP_LOGW(TAG, "Touch RST unavailable, touch will not sleep");
+    }
+#endif
+
+    swipe_config_t swipe_cfg = SWIPE_CONFIG_DEFAULT();
+    swipe_init(&swipe_cfg);
+
+    static lv_indev_drv_t indev_drv;
+    lv_indev_drv_init(&indev_drv);
+    indev_drv.type = LV_INDEV_TYPE_POINTER;
+    indev_drv.read_cb = lvgl_touch_cb;
+    touch_indev = lv_indev_drv_register(&indev_drv);
+    if (cst816_interrupt_enabled()) {
+        lv_timer_pause(indev_drv.read_timer);
+    }
+
+    ESP_LOGI(TAG, "Touch initialized");
+}
+
+/* Called in the LVGL task when the touch ISR signalled new data. */
+void display_port_touch_event(void) {
+    if (cst816_service() > 0 && touch_indev) {
+        lv_timer_resume(touch_indev->driver->read_timer);
+        lv_timer_ready(touch_indev->driver->read_timer);
+    }
+}
+
+void display_port_set_activity_cb(display_activity_cb_t cb) {
+    activity_cb = cb;
+}
+
+void display_port_set_swipe_cb(display_swipe_cb_t cb) {
+    swipe_cb = cb;
+}
+
+/* The fade runs in the LEDC hardware; wait only matters before the panel
+ * is switched off, so the screen goes dark smoothly instead of cutting. */
+void display_port_set_backlight(uint8_t percent, uint32_t fade_ms, bool wait) {
+    uint32_t duty = backlight_duty(percent);
+    if (fade_ms == 0) {
+        ledc_set_duty(BL_LEDC_MODE, BL_LEDC_CHANNEL, duty);
+        ledc_update_duty(BL_LEDC_MODE, BL_LEDC_CHANNEL);
+        return;
+    }
+    ledc_set_fade_with_time(BL_LEDC_MODE, BL_LEDC_CHANNEL, duty, (int)fade_ms);
+    ledc_fade_start(BL_LEDC_MODE, BL_LEDC_CHANNEL, wait ? LEDC_FADE_WAIT_DONE : LEDC_FADE_NO_WAIT);
+}
+
+/* Runs in the LVGL task. GRAM keeps its contents through sleep, so waking
+ * needs no redraw, only the sleep-out settling time the GC9A01 asks for. */
+void display_port_panel_sleep(bool sleep) {
+    if (sleep == panel_asleep) {
+        return;
+    }
+    if (sleep) {
+        lcd_flush_wait_idle();
+        ESP_ERROR_CHECK(esp_lcd_panel_disp_on_off(panel_handle, false));
+        esp_err_t ret = esp_lcd_panel_disp_sleep(panel_handle, true);
+        if (ret != ESP_OK) {
+            ESP_LOGD(TAG, "Panel sleep-in unsupported (%s), display off only", esp_err_to_name(ret));
+        }
+    } else {
+        if (esp_lcd_panel_disp_sleep(panel_handle, false) == ESP_OK) {
+            vTaskDelay(pdMS_TO_TICKS(LCD_SLPOUT_MS));
+        }
+        ESP_ERROR_CHECK(esp_lcd_panel_disp_on_off(panel_handle, true));
+    }
+    panel_asleep = sleep;
+}
+
+esp_err_t display_port_touch_sleep(bool sleep) {
+    return sleep ? cst816_sleep() : cst816_wake();
+}
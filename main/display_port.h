@@ -0,0 +1,23 @@
+#ifndef DISPLAY_PORT_H
+#define DISPLAY_PORT_H
+#include <stdbool.h>
+#include "lvgl.h"
+#include "esp_err.h"
+#include "swipe.h"
+#define LCD_H_RES       240
+#define LCD_V_RES       240
+typedef enum { DISPLAY_BUF_FULL, DISPLAY_BUF_DOUBLE, DISPLAY_BUF_SINGLE } display_buf_mode_t;
+esp_err_t display_port_set_buf_mode(display_buf_mode_t mode, uint16_t lines);
+display_buf_mode_t display_port_get_buf_mode(void);
+const char *display_buf_mode_name(display_buf_mode_t mode);
+void display_port_init(void);
+void display_port_init_touch(void);
+void display_port_touch_event(void);
+typedef void (*display_activity_cb_t)(void);
+void display_port_set_activity_cb(display_activity_cb_t cb);
+typedef void (*display_swipe_cb_t)(swipe_dir_t dir, int64_t lift_us);
+void display_port_set_swipe_cb(display_swipe_cb_t cb);
+void display_port_set_backlight(uint8_t percent, uint32_t fade_ms, bool wait);
+void display_port_panel_sleep(bool sleep);
+esp_err_t display_port_touch_sleep(bool sleep);
+#endif
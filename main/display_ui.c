@@ -1,9 +1,33 @@
 #include "display_ui.h"
+#include "lvgl_sched.h"
+#include "trace.h"
+#include "stats_history.h"
+#include "ui_cache.h"
+#include "ui_assets.h"
+#include "ui_anim.h"
+#include "sdkconfig.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
 
 static const char *TAG = "UI";
 
+#define STATS_CHART_W           180
+#define STATS_CHART_H           70
+#define STATS_CHART_MIN_RANGE   4
+#define COUNTER_CELLS           7
+#define UI_SCREEN_COUNT         (UI_SCREEN_STATS + 1)
+#define COLOR_COUNTER           0xFFFFFF
+#define COLOR_STOPS             0x00FF00
+#define COLOR_CATCH             0xFFFF00
+#define COLOR_FLEE              0xFF3030
+#define COLOR_SPIN              0x40A0FF
+#define ANIM_HOP_PX             8
+#define ANIM_SHAKE_PX           6
+#define ANIM_SHAKES             4
+
 static lv_obj_t *screen_main;
 static lv_obj_t *screen_settings;
 static lv_obj_t *screen_stats;
@@ -15,29 +39,68 @@ static lv_obj_t *btn_autocatch;
 static lv_obj_t *btn_autospin;
 static lv_obj_t *btn_settings;
 static lv_obj_t *arc_progress;
+static lv_obj_t *chart_minutes;
+static lv_chart_series_t *series_caught;
+static lv_obj_t *marker_now;
+static lv_obj_t *label_hour;
+static lv_obj_t *label_day;
+static lv_obj_t *label_accounts;
+static lv_timer_t *history_timer;
+static lv_coord_t chart_max = STATS_CHART_MIN_RANGE;
+static lv_obj_t *arc_track;
+static lv_obj_t *counter_box;
+static lv_obj_t *counter_cell[COUNTER_CELLS];
+static int8_t cell_digit[COUNTER_CELLS];
+static uint8_t cell_count;
+static ui_glyph_cache_t glyphs;
+static lv_img_dsc_t ring_img;
+static const lv_img_dsc_t *digit_img;
+static lv_coord_t digit_w;
+static lv_coord_t digit_h;
+static bool flash_images = true;
+static ui_render_mode_t render_mode = UI_RENDER_DIRECT;
 
 static bool autocatch_enabled = true;
 static bool autospin_enabled = true;
 static ui_screen_t current_screen = UI_SCREEN_MAIN;
+static ui_settings_cb_t settings_cb = NULL;
+static ui_accounts_cb_t accounts_cb = NULL;
+
+static uint32_t shown[UI_FIELD_COUNT];
+static uint32_t shown_valid;
+static atomic_uint anim_seq;
+static atomic_uint history_seq;
+static atomic_uint accounts_seq;
+static atomic_uint settings_seq;
+static swipe_dir_t wipe_dir;
+static int32_t wipe_done;
+static ui_nav_stats_t nav_stats;
 
 static void create_main_screen(void);
 static void create_settings_screen(void);
 static void create_stats_screen(void);
 
+static void show_autocatch(void) {
+    lv_label_set_text(lv_obj_get_child(btn_autocatch, 0), autocatch_enabled ? "Catch: ON" : "Catch: OFF");
+    lv_obj_set_style_bg_color(btn_autocatch,
+                              lv_palette_main(autocatch_enabled ? LV_PALETTE_GREEN : LV_PALETTE_RED), 0);
+}
+
+static void show_autospin(void) {
+    lv_label_set_text(lv_obj_get_child(btn_autospin, 0), autospin_enabled ? "Spin: ON" : "Spin: OFF");
+    lv_obj_set_style_bg_color(btn_autospin,
+                              lv_palette_main(autospin_enabled ? LV_PALETTE_BLUE : LV_PALETTE_RED), 0);
+}
+
 static void btn_autocatch_event_cb(lv_event_t *e) {
     lv_event_code_t code = lv_event_get_code(e);
     if (code == LV_EVENT_CLICKED) {
         autocatch_enabled = !autocatch_enabled;
-        lv_obj_t *btn = lv_event_get_target(e);
-        lv_obj_t *label = lv_obj_get_child(btn, 0);
-        lv_label_set_text(label, autocatch_enabled ? "Catch: ON" : "Catch: OFF");
-        
-        if (autocatch_enabled) {
-            lv_obj_set_style_bg_color(btn, lv_palette_main(LV_PALETTE_GREEN), 0);
-        } else {
-            lv_obj_set_style_bg_color(btn, lv_palette_main(LV_PALETTE_RED), 0);
-        }
+        show_autocatch();
         ESP_LOGI(TAG, "Autocatch %s", autocatch_enabled ? "enabled" : "disabled");
+        if (settings_cb) {
+            settings_cb(autocatch_enabled, autospin_enabled);
+        }
     }
 }
 
@@ -45,16 +108,11 @@ static void btn_autospin_event_cb(lv_event_t *e) {
     lv_event_code_t code = lv_event_get_code(e);
     if (code == LV_EVENT_CLICKED) {
         autospin_enabled = !autospin_enabled;
-        lv_obj_t *btn = lv_event_get_target(e);
-        lv_obj_t *label = lv_obj_get_child(btn, 0);
-        lv_label_set_text(label, autospin_enabled ? "Spin: ON" : "Spin: OFF");
-        
-        if (autospin_enabled) {
-            lv_obj_set_style_bg_color(btn, lv_palette_main(LV_PALETTE_BLUE), 0);
-        } else {
-            lv_obj_set_style_bg_color(btn, lv_palette_main(LV_PALETTE_RED), 0);
-        }
+        show_autospin();
         ESP_LOGI(TAG, "Autospin %s", autospin_enabled ? "enabled" : "disabled");
+        if (settings_cb) {
+            settings_cb(autocatch_enabled, autospin_enabled);
+        }
     }
 }
 
@@ -65,6 +123,12 @@ static void btn_settings_event_cb(lv_event_t *e) {
     }
 }
 
+static void label_count_event_cb(lv_event_t *e) {
+    if (lv_event_get_code(e) == LV_EVENT_CLICKED) {
+        ui_switch_screen(UI_SCREEN_STATS);
+    }
+}
+
 static void btn_back_event_cb(lv_event_t *e) {
     lv_event_code_t code = lv_event_get_code(e);
     if (code == LV_EVENT_CLICKED) {
@@ -89,41 +153,47 @@ static void create_main_screen(void) {
     lv_arc_set_value(arc_progress, 0);
     lv_obj_set_style_arc_color(arc_progress, lv_palette_main(LV_PALETTE_BLUE), LV_PART_INDICATOR);
     lv_obj_remove_style(arc_progress, NULL, LV_PART_KNOB);
+    lv_obj_clear_flag(arc_progress, LV_OBJ_FLAG_CLICKABLE);
     
     label_pokemon_count = lv_label_create(screen_main);
     lv_label_set_text(label_pokemon_count, "0");
-    lv_obj_set_style_text_font(label_pokemon_count, &lv_font_montserrat_16, 0);
-    lv_obj_set_style_text_color(label_pokemon_count, lv_color_hex(0xFFFFFF), 0);
+    lv_obj_set_style_text_font(label_pokemon_count, &ui_font_16, 0);
+    lv_obj_set_style_text_color(label_pokemon_count, lv_color_hex(COLOR_COUNTER), 0);
     lv_obj_align(label_pokemon_count, LV_ALIGN_CENTER, 0, -20);
+    lv_obj_add_flag(label_pokemon_count, LV_OBJ_FLAG_CLICKABLE);
+    lv_obj_set_ext_click_area(label_pokemon_count, 20);
+    lv_obj_add_event_cb(label_pokemon_count, label_count_event_cb, LV_EVENT_CLICKED, NULL);
     
     label_stops_count = lv_label_create(screen_main);
     lv_label_set_text(label_stops_count, "Stops: 0");
-    lv_obj_set_style_text_color(label_stops_count, lv_color_hex(0x00FF00), 0);
+    lv_obj_set_style_text_color(label_stops_count, lv_color_hex(COLOR_STOPS), 0);
     lv_obj_align(label_stops_count, LV_ALIGN_CENTER, 0, 10);
     
     label_battery = lv_label_create(screen_main);
-    lv_label_set_text(label_battery, "100%");
+    lv_label_set_text(label_battery, "--");
     lv_obj_set_style_text_color(label_battery, lv_color_hex(0x00FF00), 0);
     lv_obj_align(label_battery, LV_ALIGN_TOP_RIGHT, -10, 10);
     
     btn_autocatch = lv_btn_create(screen_main);
     lv_obj_set_size(btn_autocatch, 90, 35);
     lv_obj_align(btn_autocatch, LV_ALIGN_BOTTOM_LEFT, 10, -40);
-    lv_obj_set_style_bg_color(btn_autocatch, lv_palette_main(LV_PALETTE_GREEN), 0);
+    lv_obj_set_style_bg_color(btn_autocatch,
+                              lv_palette_main(autocatch_enabled ? LV_PALETTE_GREEN : LV_PALETTE_RED), 0);
     lv_obj_add_event_cb(btn_autocatch, btn_autocatch_event_cb, LV_EVENT_CLICKED, NULL);
     
     lv_obj_t *label_ac = lv_label_create(btn_autocatch);
-    lv_label_set_text(label_ac, "Catch: ON");
+    lv_label_set_text(label_ac, autocatch_enabled ? "Catch: ON" : "Catch: OFF");
     lv_obj_center(label_ac);
     
     btn_autospin = lv_btn_create(screen_main);
     lv_obj_set_size(btn_autospin, 90, 35);
     lv_obj_align(btn_autospin, LV_ALIGN_BOTTOM_RIGHT, -10, -40);
-    lv_obj_set_style_bg_color(btn_autospin, lv_palette_main(LV_PALETTE_BLUE), 0);
+    lv_obj_set_style_bg_color(btn_autospin,
+                              lv_palette_main(autospin_enabled ? LV_PALETTE_BLUE : LV_PALETTE_RED), 0);
     lv_obj_add_event_cb(btn_autospin, btn_autospin_event_cb, LV_EVENT_CLICKED, NULL);
     
     lv_obj_t *label_as = lv_label_create(btn_autospin);
-    lv_label_set_text(label_as, "Spin: ON");
+    lv_label_set_text(label_as, autospin_enabled ? "Spin: ON" : "Spin: OFF");
     lv_obj_center(label_as);
     
     btn_settings = lv_btn_create(screen_main);
@@ -137,17 +207,197 @@ static void create_main_screen(void) {
     lv_obj_center(label_set);
 }
 
+static void set_counter_color(lv_color_t color) {
+    lv_obj_set_style_text_color(label_pokemon_count, color, 0);
+    for (int i = 0; i < COUNTER_CELLS && counter_cell[i]; i++) {
+        lv_obj_set_style_img_recolor(counter_cell[i], color, 0);
+    }
+}
+
+/* Catch: the counter flashes yellow and hops. Flee: it flashes red and
+ * shakes with a decaying swing. Spin: the stops line flashes blue. Each
+ * accent fades out over the animation and every offset is back to zero at
+ * UI_ANIM_END, so a cancelled animation leaves nothing behind. Only the
+ * counter and the stops label change, so a frame redraws those two boxes
+ * and the few pixels of travel around the counter. */
+static void anim_frame_cb(ui_anim_kind_t kind, int32_t t) {
+    lv_obj_t *counter = render_mode == UI_RENDER_CACHED ? counter_box : label_pokemon_count;
+    lv_opa_t accent = (lv_opa_t)(LV_OPA_COVER - t * LV_OPA_COVER / UI_ANIM_END);
+    int32_t s;
+    switch (kind) {
+        case UI_ANIM_CATCH:
+            set_counter_color(lv_color_mix(lv_color_hex(COLOR_CATCH), lv_color_hex(COLOR_COUNTER), accent));
+            s = lv_trigo_sin((int16_t)(t * 180 / UI_ANIM_END));
+            lv_obj_set_style_translate_y(counter, (lv_coord_t)(-(ANIM_HOP_PX * s) >> LV_TRIGO_SHIFT), 0);
+            break;
+        case UI_ANIM_FLEE:
+            set_counter_color(lv_color_mix(lv_color_hex(COLOR_FLEE), lv_color_hex(COLOR_COUNTER), accent));
+            s = lv_trigo_sin((int16_t)(t * ANIM_SHAKES * 360 / UI_ANIM_END % 360));
+            lv_obj_set_style_translate_x(counter,
+                                         (lv_coord_t)((ANIM_SHAKE_PX * (UI_ANIM_END - t) / UI_ANIM_END * s) >> LV_TRIGO_SHIFT), 0);
+            break;
+        case UI_ANIM_SPIN:
+            lv_obj_set_style_text_color(label_stops_count,
+                                        lv_color_mix(lv_color_hex(COLOR_SPIN), lv_color_hex(COLOR_STOPS), accent), 0);
+            break;
+        default:
+            break;
+    }
+}
+
+/* Only cells whose digit changed get a new source, so 41 -> 42 invalidates
+ * one cell. The group is re-centred only when the digit count changes. */
+static void set_counter_cells(const char *text) {
+    size_t len = strlen(text);
+    if (len > COUNTER_CELLS) {
+        text += len - COUNTER_CELLS;
+        len = COUNTER_CELLS;
+    }
+    bool relayout = len != cell_count;
+    lv_coord_t x0 = (lv_coord_t)((COUNTER_CELLS - len) * digit_w / 2);
+    for (size_t i = 0; i < COUNTER_CELLS; i++) {
+        if (i >= len) {
+            if (relayout) {
+                lv_obj_add_flag(counter_cell[i], LV_OBJ_FLAG_HIDDEN);
+                cell_digit[i] = -1;
+            }
+            continue;
+        }
+        int8_t d = (int8_t)(text[i] - '0');
+        if (relayout) {
+            lv_obj_set_x(counter_cell[i], x0 + (lv_coord_t)i * digit_w);
+            lv_obj_clear_flag(counter_cell[i], LV_OBJ_FLAG_HIDDEN);
+        }
+        if (d != cell_digit[i]) {
+            lv_img_set_src(counter_cell[i], &digit_img[d]);
+            cell_digit[i] = d;
+        }
+    }
+    cell_count = (uint8_t)len;
+}
+
+/* The cached layer for the main screen: the arc track as a pre-rasterised
+ * ring behind an arc that only draws its indicator, and the catch counter
+ * as a row of digit cells. The digits and, when the arc still has the
+ * geometry and colours it was converted with, the ring come from flash
+ * (ui_assets.c); otherwise they are rasterised into the heap on first use,
+ * and if memory is short the screen stays in direct mode. */
+static bool build_cached_layer(void) {
+    if (counter_box) {
+        return true;
+    }
+    lv_obj_update_layout(arc_progress);
+    lv_coord_t pad_l = lv_obj_get_style_pad_left(arc_progress, LV_PART_MAIN);
+    lv_coord_t pad_r = lv_obj_get_style_pad_right(arc_progress, LV_PART_MAIN);
+    lv_coord_t pad_t = lv_obj_get_style_pad_top(arc_progress, LV_PART_MAIN);
+    lv_coord_t pad_b = lv_obj_get_style_pad_bottom(arc_progress, LV_PART_MAIN);
+    lv_coord_t r = LV_MIN(lv_obj_get_width(arc_progress) - pad_l - pad_r,
+                          lv_obj_get_height(arc_progress) - pad_t - pad_b) / 2;
+    lv_coord_t arc_w = lv_obj_get_style_arc_width(arc_progress, LV_PART_MAIN);
+    lv_color_t track = lv_obj_get_style_arc_color(arc_progress, LV_PART_MAIN);
+    lv_opa_t track_opa = lv_obj_get_style_arc_opa(arc_progress, LV_PART_MAIN);
+    bool ring_in_flash = flash_images && r == UI_IMG_RING_RADIUS && arc_w == UI_IMG_RING_WIDTH &&
+                         track_opa == LV_OPA_COVER && track.full == lv_color_hex(UI_IMG_RING_FG).full &&
+                         lv_obj_get_style_bg_color(screen_main, 0).full == lv_color_hex(UI_IMG_RING_BG).full;
+    if (!ring_in_flash && !ui_cache_build_ring(&ring_img, r, arc_w)) {
+        return false;
+    }
+    if (flash_images) {
+        digit_img = ui_img_digits;
+        digit_w = UI_IMG_DIGITS_CELL_W;
+        digit_h = UI_IMG_DIGITS_CELL_H;
+    } else if (ui_cache_build_digits(&glyphs, &ui_font_16)) {
+        digit_img = glyphs.digit;
+        digit_w = glyphs.cell_w;
+        digit_h = glyphs.cell_h;
+    } else {
+        return false;
+    }
+
+    /* The flash ring is already blended onto the screen background, so it
+     * is opaque and drawn as a plain copy; the heap one is an alpha mask
+     * drawn in the track colour. */
+    arc_track = lv_img_create(screen_main);
+    lv_obj_set_pos(arc_track, lv_obj_get_x(arc_progress) + pad_l, lv_obj_get_y(arc_progress) + pad_t);
+    if (ring_in_flash) {
+        lv_img_set_src(arc_track, &ui_img_ring);
+    } else {
+        lv_img_set_src(arc_track, &ring_img);
+        lv_obj_set_style_img_recolor(arc_track, track, 0);
+        lv_obj_set_style_img_recolor_opa(arc_track, LV_OPA_COVER, 0);
+        lv_obj_set_style_img_opa(arc_track, track_opa, 0);
+    }
+    lv_obj_clear_flag(arc_track, LV_OBJ_FLAG_CLICKABLE);
+    lv_obj_move_background(arc_track);
+
+    counter_box = lv_obj_create(screen_main);
+    lv_obj_remove_style_all(counter_box);
+    lv_obj_set_size(counter_box, COUNTER_CELLS * digit_w, digit_h);
+    lv_obj_align(counter_box, LV_ALIGN_CENTER, 0, -20);
+    lv_obj_clear_flag(counter_box, LV_OBJ_FLAG_SCROLLABLE);
+    lv_obj_set_ext_click_area(counter_box, 20);
+    lv_obj_add_event_cb(counter_box, label_count_event_cb, LV_EVENT_CLICKED, NULL);
+    for (int i = 0; i < COUNTER_CELLS; i++) {
+        counter_cell[i] = lv_img_create(counter_box);
+        lv_obj_set_style_img_recolor(counter_cell[i], lv_obj_get_style_text_color(label_pokemon_count, 0), 0);
+        lv_obj_set_style_img_recolor_opa(counter_cell[i], LV_OPA_COVER, 0);
+        lv_obj_clear_flag(counter_cell[i], LV_OBJ_FLAG_CLICKABLE);
+        lv_obj_add_flag(counter_cell[i], LV_OBJ_FLAG_HIDDEN);
+        cell_digit[i] = -1;
+    }
+    ESP_LOGI(TAG, "Cached layer: ring from %s, digits from %s, %u bytes heap", ring_in_flash ? "flash" : "heap",
+             digit_img == ui_img_digits ? "flash" : "heap", (unsigned)ui_cache_bytes());
+    return true;
+}
+
+/* Takes effect when the cached layer is built, so call it before ui_init(). */
+void ui_set_flash_images(bool enabled) {
+    flash_images = enabled;
+}
+
+/* Runs in the LVGL task. */
+void ui_set_render_mode(ui_render_mode_t mode) {
+    ui_anim_cancel();
+    if (mode == UI_RENDER_CACHED && !build_cached_layer()) {
+        ESP_LOGW(TAG, "Cached render mode unavailable, staying direct");
+        mode = UI_RENDER_DIRECT;
+    }
+    if (mode == render_mode) {
+        return;
+    }
+    render_mode = mode;
+    if (mode == UI_RENDER_CACHED) {
+        lv_obj_set_style_arc_opa(arc_progress, LV_OPA_TRANSP, LV_PART_MAIN);
+        lv_obj_clear_flag(arc_track, LV_OBJ_FLAG_HIDDEN);
+        lv_obj_add_flag(label_pokemon_count, LV_OBJ_FLAG_HIDDEN);
+        lv_obj_clear_flag(counter_box, LV_OBJ_FLAG_HIDDEN);
+        cell_count = 0;
+        set_counter_cells(lv_label_get_text(label_pokemon_count));
+    } else {
+        lv_obj_remove_local_style_prop(arc_progress, LV_STYLE_ARC_OPA, LV_PART_MAIN);
+        if (arc_track) {
+            lv_obj_add_flag(arc_track, LV_OBJ_FLAG_HIDDEN);
+            lv_obj_add_flag(counter_box, LV_OBJ_FLAG_HIDDEN);
+        }
+        lv_obj_clear_flag(label_pokemon_count, LV_OBJ_FLAG_HIDDEN);
+    }
+}
+
+ui_render_mode_t ui_get_render_mode(void) {
+    return render_mode;
+}
+
 static void create_settings_screen(void) {
     screen_settings = lv_obj_create(NULL);
     lv_obj_set_style_bg_color(screen_settings, lv_color_hex(0x001122), 0);
     
     lv_obj_t *title = lv_label_create(screen_settings);
     lv_label_set_text(title, "Settings");
-    lv_obj_set_style_text_font(title, &lv_font_montserrat_16, 0);
+    lv_obj_set_style_text_font(title, &ui_font_16, 0);
     lv_obj_align(title, LV_ALIGN_TOP_MID, 0, 20);
     
     lv_obj_t *info = lv_label_create(screen_settings);
-    lv_label_set_text(info, "WiFi AP Mode:\nHold button\non boot");
+    lv_label_set_text(info, "WiFi AP Mode:\nHold button 2 s\nin first 5 s");
     lv_obj_align(info, LV_ALIGN_CENTER, 0, 0);
     lv_obj_set_style_text_align(info, LV_TEXT_ALIGN_CENTER, 0);
     
@@ -161,53 +411,345 @@ static void create_settings_screen(void) {
     lv_obj_center(label_back);
 }
 
+/* Bar i of the chart is minute bucket i of the history ring, and the chart
+ * runs in circular mode, so a new catch changes one y point and LVGL only
+ * invalidates that column. The content width is a multiple of the bucket
+ * count with no column gap, which keeps the column LVGL invalidates exactly
+ * on the bar it draws. The thin marker shows where "now" is in the ring. */
+static void place_marker(void) {
+    lv_coord_t x = (lv_coord_t)(stats_history_current_minute() * (STATS_CHART_W / STATS_MINUTE_BUCKETS));
+    lv_obj_align_to(marker_now, chart_minutes, LV_ALIGN_OUT_BOTTOM_LEFT, x, 2);
+}
+
+/* With full set every bucket is reloaded, for a freshly built chart. */
+static void apply_history(bool full) {
+    stats_dirty_t dirty;
+    if (!stats_history_take_dirty(&dirty) && !full) {
+        return;
+    }
+    if (full) {
+        dirty.minutes = ~0ULL;
+    }
+
+    stats_bucket_t bucket;
+    lv_coord_t peak = chart_max;
+    for (uint32_t i = 0; i < STATS_MINUTE_BUCKETS; i++) {
+        if (!(dirty.minutes & (1ULL << i))) {
+            continue;
+        }
+        stats_history_get_minute(i, &bucket);
+        lv_coord_t v = (lv_coord_t)bucket.count[STATS_EV_CAUGHT];
+        if (v > peak) {
+            peak = v;
+        }
+        if (series_caught->y_points[i] != v) {
+            lv_chart_set_value_by_id(chart_minutes, series_caught, (uint16_t)i, v);
+        }
+    }
+    /* Rescaling redraws every bar, so the range only grows, in steps. */
+    if (peak > chart_max) {
+        chart_max = (lv_coord_t)((peak + 3) & ~3);
+        lv_chart_set_range(chart_minutes, LV_CHART_AXIS_PRIMARY_Y, 0, chart_max);
+    }
+    place_marker();
+
+    char buf[48];
+    stats_summary_t sum;
+    stats_history_get_summary(&sum);
+    snprintf(buf, sizeof(buf), "1h  C %lu  S %lu  F %lu",
+             (unsigned long)sum.last_hour[STATS_EV_CAUGHT], (unsigned long)sum.last_hour[STATS_EV_SPUN],
+             (unsigned long)sum.last_hour[STATS_EV_FLED]);
+    if (strcmp(lv_label_get_text(label_hour), buf) != 0) {
+        lv_label_set_text(label_hour, buf);
+    }
+    snprintf(buf, sizeof(buf), "24h  C %lu  S %lu  D %lu",
+             (unsigned long)sum.last_day[STATS_EV_CAUGHT], (unsigned long)sum.last_day[STATS_EV_SPUN],
+             (unsigned long)sum.last_day[STATS_EV_DROP]);
+    if (strcmp(lv_label_get_text(label_day), buf) != 0) {
+        lv_label_set_text(label_day, buf);
+    }
+}
+
+/* One entry per account seen since boot, "*" marking the ones connected
+ * now: caught / spun, and "-" after the number when that account has
+ * auto-catch turned off. */
+static void apply_accounts(void) {
+    pgp_account_t acc[PGP_LINK_MAX];
+    uint8_t n = accounts_cb ? accounts_cb(acc, PGP_LINK_MAX) : 0;
+    char buf[24 * PGP_LINK_MAX + 1];
+    size_t len = 0;
+    buf[0] = '\0';
+    for (uint8_t i = 0; i < n && len < sizeof(buf); i++) {
+        len += (size_t)snprintf(buf + len, sizeof(buf) - len, "%s%s%u%s %lu/%lu", i ? "  " : "",
+                                acc[i].connected ? "*" : "", acc[i].slot + 1, acc[i].allow_catch ? "" : "-",
+                                (unsigned long)acc[i].caught, (unsigned long)acc[i].spun);
+    }
+    if (strcmp(lv_label_get_text(label_accounts), buf) != 0) {
+        lv_label_set_text(label_accounts, buf);
+    }
+}
+
+/* Rolls the history over at each minute boundary so idle minutes show up
+ * as empty bars, then sleeps until the next one. */
+static void history_timer_cb(lv_timer_t *timer) {
+    stats_history_advance(esp_timer_get_time());
+    apply_history(false);
+    int64_t left_us = stats_history_next_minute_us() - esp_timer_get_time();
+    lv_timer_set_period(timer, left_us > 1000 ? (uint32_t)(left_us / 1000) : 1);
+}
+
 static void create_stats_screen(void) {
     screen_stats = lv_obj_create(NULL);
     lv_obj_set_style_bg_color(screen_stats, lv_color_hex(0x112200), 0);
     
     lv_obj_t *title = lv_label_create(screen_stats);
     lv_label_set_text(title, "Statistics");
-    lv_obj_set_style_text_font(title, &lv_font_montserrat_16, 0);
+    lv_obj_set_style_text_font(title, &ui_font_16, 0);
     lv_obj_align(title, LV_ALIGN_TOP_MID, 0, 20);
+
+    label_accounts = lv_label_create(screen_stats);
+    lv_label_set_text(label_accounts, "");
+    lv_obj_set_style_text_font(label_accounts, &ui_font_12, 0);
+    lv_obj_set_width(label_accounts, 180);
+    lv_label_set_long_mode(label_accounts, LV_LABEL_LONG_DOT);
+    lv_obj_set_style_text_align(label_accounts, LV_TEXT_ALIGN_CENTER, 0);
+    lv_obj_align(label_accounts, LV_ALIGN_TOP_MID, 0, 42);
+
+    chart_minutes = lv_chart_create(screen_stats);
+    lv_obj_set_size(chart_minutes, STATS_CHART_W, STATS_CHART_H);
+    lv_obj_align(chart_minutes, LV_ALIGN_CENTER, 0, -25);
+    lv_obj_set_style_pad_all(chart_minutes, 0, 0);
+    lv_obj_set_style_pad_column(chart_minutes, 0, 0);
+    lv_obj_set_style_border_width(chart_minutes, 0, 0);
+    lv_obj_set_style_radius(chart_minutes, 0, 0);
+    lv_obj_set_style_bg_color(chart_minutes, lv_color_hex(0x0A1400), 0);
+    lv_obj_set_style_radius(chart_minutes, 0, LV_PART_ITEMS);
+    lv_obj_clear_flag(chart_minutes, LV_OBJ_FLAG_CLICKABLE | LV_OBJ_FLAG_SCROLLABLE);
+    lv_chart_set_type(chart_minutes, LV_CHART_TYPE_BAR);
+    lv_chart_set_update_mode(chart_minutes, LV_CHART_UPDATE_MODE_CIRCULAR);
+    lv_chart_set_div_line_count(chart_minutes, 0, 0);
+    lv_chart_set_point_count(chart_minutes, STATS_MINUTE_BUCKETS);
+    lv_chart_set_range(chart_minutes, LV_CHART_AXIS_PRIMARY_Y, 0, chart_max);
+    series_caught = lv_chart_add_series(chart_minutes, lv_color_hex(0xFFCC00), LV_CHART_AXIS_PRIMARY_Y);
+    lv_chart_set_all_value(chart_minutes, series_caught, 0);
+
+    marker_now = lv_obj_create(screen_stats);
+    lv_obj_remove_style_all(marker_now);
+    lv_obj_set_size(marker_now, STATS_CHART_W / STATS_MINUTE_BUCKETS, 4);
+    lv_obj_set_style_bg_color(marker_now, lv_color_hex(0xFFFFFF), 0);
+    lv_obj_set_style_bg_opa(marker_now, LV_OPA_COVER, 0);
+    place_marker();
+
+    label_hour = lv_label_create(screen_stats);
+    lv_label_set_text(label_hour, "");
+    lv_obj_set_style_text_font(label_hour, &ui_font_12, 0);
+    lv_obj_align(label_hour, LV_ALIGN_CENTER, 0, 25);
+
+    label_day = lv_label_create(screen_stats);
+    lv_label_set_text(label_day, "");
+    lv_obj_set_style_text_font(label_day, &ui_font_12, 0);
+    lv_obj_align(label_day, LV_ALIGN_CENTER, 0, 42);
+
+    lv_obj_t *btn_back = lv_btn_create(screen_stats);
+    lv_obj_set_size(btn_back, 80, 35);
+    lv_obj_align(btn_back, LV_ALIGN_BOTTOM_MID, 0, -20);
+    lv_obj_add_event_cb(btn_back, btn_back_event_cb, LV_EVENT_CLICKED, NULL);
+
+    lv_obj_t *label_back = lv_label_create(btn_back);
+    lv_label_set_text(label_back, "Back");
+    lv_obj_center(label_back);
+
+    stats_history_advance(esp_timer_get_time());
+    apply_history(true);
+    apply_accounts();
+    history_timer = lv_timer_create(history_timer_cb, 1000, NULL);
+    history_timer_cb(history_timer);
 }
 
+/* Screens are built the first time they are shown. Only the main screen
+ * is built at boot, which keeps the others out of the first frame and out
+ * of the LVGL pool until someone opens them. */
 void ui_init(void) {
     ESP_LOGI(TAG, "Initializing UI");
-    create_main_screen();
-    create_settings_screen();
-    create_stats_screen();
-    lv_disp_load_scr(screen_main);
+    ui_anim_init(anim_frame_cb);
+    ui_switch_screen(UI_SCREEN_MAIN);
+#if CONFIG_PGPEMU_UI_CACHED_RENDER
+    ui_set_render_mode(UI_RENDER_CACHED);
+#endif
 }
 
-void ui_update_status(bool connected, bool catching, bool spinning) {
-    if (connected) {
-        lv_label_set_text(label_status, "Connected");
-        lv_obj_set_style_text_color(label_status, lv_color_hex(0x00FF00), 0);
-    } else {
-        lv_label_set_text(label_status, "Disconnected");
-        lv_obj_set_style_text_color(label_status, lv_color_hex(0xFF9900), 0);
+/* The ui_update_* calls below may come from any task. They only post into
+ * the per-source mailbox and wake the LVGL task, which applies the coalesced
+ * result in ui_apply_pending(). */
+void ui_update_status(ui_src_t src, bool connected, bool catching, bool spinning) {
+    TRACE_BEGIN(update);
+    ui_queue_post(src, UI_FIELD_CONNECTED, connected);
+    lvgl_sched_notify(LVGL_SCHED_EVT_UI);
+    TRACE_END(update, TRACE_EV_UI_UPDATE, src);
+}
+
+void ui_update_stats(ui_src_t src, uint32_t pokemon_caught, uint32_t stops_spun) {
+    TRACE_BEGIN(update);
+    ui_queue_post(src, UI_FIELD_CAUGHT, pokemon_caught);
+    ui_queue_post(src, UI_FIELD_SPUN, stops_spun);
+    lvgl_sched_notify(LVGL_SCHED_EVT_UI);
+    TRACE_END(update, TRACE_EV_UI_UPDATE, src);
+}
+
+void ui_update_battery(ui_src_t src, uint8_t percent) {
+    TRACE_BEGIN(update);
+    ui_queue_post(src, UI_FIELD_BATTERY, percent);
+    lvgl_sched_notify(LVGL_SCHED_EVT_UI);
+    TRACE_END(update, TRACE_EV_UI_UPDATE, src);
+}
+
+void ui_update_connection_status(ui_src_t src, const char* status_text) {
+    TRACE_BEGIN(update);
+    ui_queue_post_text(src, status_text);
+    lvgl_sched_notify(LVGL_SCHED_EVT_UI);
+    TRACE_END(update, TRACE_EV_UI_UPDATE, src);
+}
+
+/* The sequence number makes a repeat of the same kind a change, so back
+ * to back catches each restart the animation. */
+static void post_anim(ui_src_t src, ui_anim_kind_t kind) {
+    TRACE_BEGIN(update);
+    uint32_t seq = atomic_fetch_add(&anim_seq, 1) + 1;
+    ui_queue_post(src, UI_FIELD_CATCH_ANIM, (seq << 2) | kind);
+    lvgl_sched_notify(LVGL_SCHED_EVT_UI);
+    TRACE_END(update, TRACE_EV_UI_UPDATE, src);
+}
+
+void ui_show_catch_animation(ui_src_t src, bool success) {
+    post_anim(src, success ? UI_ANIM_CATCH : UI_ANIM_FLEE);
+}
+
+void ui_show_spin_animation(ui_src_t src) {
+    post_anim(src, UI_ANIM_SPIN);
+}
+
+/* Tells the stats screen that stats_history has new data. */
+void ui_notify_history(ui_src_t src) {
+    uint32_t seq = atomic_fetch_add(&history_seq, 1) + 1;
+    ui_queue_post(src, UI_FIELD_HISTORY, seq);
+    lvgl_sched_notify(LVGL_SCHED_EVT_UI);
+}
+
+/* Tells the stats screen that an account's counters or links changed. */
+void ui_notify_accounts(ui_src_t src) {
+    uint32_t seq = atomic_fetch_add(&accounts_seq, 1) + 1;
+    ui_queue_post(src, UI_FIELD_ACCOUNTS, seq);
+    lvgl_sched_notify(LVGL_SCHED_EVT_UI);
+}
+
+/* Settings changed outside the touch screen, from the portal. The sequence
+ * number makes the post a change even when the toggles were flipped back
+ * by hand in between. */
+void ui_update_settings(ui_src_t src, bool autocatch, bool autospin) {
+    uint32_t seq = atomic_fetch_add(&settings_seq, 1) + 1;
+    ui_queue_post(src, UI_FIELD_SETTINGS, (seq << 2) | (autospin << 1) | autocatch);
+    lvgl_sched_notify(LVGL_SCHED_EVT_UI);
+}
+
+static bool field_changed(const ui_queue_batch_t *batch, ui_field_t field) {
+    if (!(batch->mask & (1UL << field))) {
+        return false;
     }
+    if ((shown_valid & (1UL << field)) && shown[field] == batch->value[field]) {
+        return false;
+    }
+    shown[field] = batch->value[field];
+    shown_valid |= 1UL << field;
+    return true;
 }
 
-void ui_update_stats(uint32_t pokemon_caught, uint32_t stops_spun, uint32_t battery_percent) {
+/* Runs in the LVGL task. Only labels whose value differs from what is
+ * currently on screen are touched, so unchanged fields cost no redraw. */
+void ui_apply_pending(void) {
+    ui_queue_batch_t batch;
+    TRACE_BEGIN(apply);
+    if (!ui_queue_drain(&batch)) {
+        return;
+    }
+
     char buf[32];
-    snprintf(buf, sizeof(buf), "%lu", (unsigned long)pokemon_caught);
-    lv_label_set_text(label_pokemon_count, buf);
-    snprintf(buf, sizeof(buf), "Stops: %lu", (unsigned long)stops_spun);
-    lv_label_set_text(label_stops_count, buf);
-    snprintf(buf, sizeof(buf), "%lu%%", (unsigned long)battery_percent);
-    lv_label_set_text(label_battery, buf);
-    lv_arc_set_value(arc_progress, pokemon_caught % 100);
+    uint32_t applied = 0;
+
+    if (field_changed(&batch, UI_FIELD_CAUGHT)) {
+        snprintf(buf, sizeof(buf), "%lu", (unsigned long)shown[UI_FIELD_CAUGHT]);
+        lv_label_set_text(label_pokemon_count, buf);
+        if (render_mode == UI_RENDER_CACHED) {
+            set_counter_cells(buf);
+        }
+        lv_arc_set_value(arc_progress, shown[UI_FIELD_CAUGHT] % 100);
+        applied++;
+    }
+    if (field_changed(&batch, UI_FIELD_SPUN)) {
+        snprintf(buf, sizeof(buf), "Stops: %lu", (unsigned long)shown[UI_FIELD_SPUN]);
+        lv_label_set_text(label_stops_count, buf);
+        applied++;
+    }
+    if (field_changed(&batch, UI_FIELD_BATTERY)) {
+        snprintf(buf, sizeof(buf), "%lu%%", (unsigned long)shown[UI_FIELD_BATTERY]);
+        lv_label_set_text(label_battery, buf);
+        applied++;
+    }
+    if (field_changed(&batch, UI_FIELD_CONNECTED)) {
+        if (shown[UI_FIELD_CONNECTED]) {
+            lv_label_set_text(label_status, "Connected");
+            lv_obj_set_style_text_color(label_status, lv_color_hex(0x00FF00), 0);
+        } else {
+            lv_label_set_text(label_status, "Disconnected");
+            lv_obj_set_style_text_color(label_status, lv_color_hex(0xFF9900), 0);
+        }
+        applied++;
+    }
+    if (batch.mask & (1UL << UI_FIELD_STATUS_TEXT)) {
+        lv_label_set_text(label_status, batch.text);
+        shown_valid &= ~(1UL << UI_FIELD_CONNECTED);
+        applied++;
+    }
+    if (field_changed(&batch, UI_FIELD_CATCH_ANIM) && current_screen == UI_SCREEN_MAIN) {
+        ui_anim_play((ui_anim_kind_t)(shown[UI_FIELD_CATCH_ANIM] & 3));
+        applied++;
+    }
+    if (field_changed(&batch, UI_FIELD_HISTORY) && screen_stats) {
+        apply_history(false);
+        applied++;
+    }
+    if (field_changed(&batch, UI_FIELD_ACCOUNTS) && screen_stats) {
+        apply_accounts();
+        applied++;
+    }
+    if (field_changed(&batch, UI_FIELD_SETTINGS)) {
+        autocatch_enabled = shown[UI_FIELD_SETTINGS] & 1;
+        autospin_enabled = (shown[UI_FIELD_SETTINGS] >> 1) & 1;
+        show_autocatch();
+        show_autospin();
+        if (settings_cb) {
+            settings_cb(autocatch_enabled, autospin_enabled);
+        }
+        applied++;
+    }
+
+    ui_queue_note_applied(applied);
+    TRACE_END(apply, TRACE_EV_UI_APPLY, applied);
 }
 
-void ui_update_connection_status(const char* status_text) {
-    lv_label_set_text(label_status, status_text);
+/* Call before ui_init() so the toggles are built in their stored state. */
+void ui_set_settings(bool autocatch, bool autospin) {
+    autocatch_enabled = autocatch;
+    autospin_enabled = autospin;
 }
 
-void ui_show_catch_animation(bool success) {
-    if (success) {
-        lv_obj_set_style_text_color(label_pokemon_count, lv_color_hex(0xFFFF00), 0);
-    }
+void ui_set_settings_cb(ui_settings_cb_t cb) {
+    settings_cb = cb;
+}
+
+/* The stats screen pulls the per-account list through this when it is
+ * built and after each ui_notify_accounts(). */
+void ui_set_accounts_cb(ui_accounts_cb_t cb) {
+    accounts_cb = cb;
 }
 
 bool ui_get_autocatch_enabled(void) {
@@ -218,17 +760,194 @@ bool ui_get_autospin_enabled(void) {
     return autospin_enabled;
 }
 
-void ui_switch_screen(ui_screen_t screen) {
-    current_screen = screen;
+ui_screen_t ui_get_screen(void) {
+    return current_screen;
+}
+
+static lv_obj_t *build_screen(ui_screen_t screen) {
     switch (screen) {
+        case UI_SCREEN_SETTINGS:
+            if (!screen_settings) {
+                create_settings_screen();
+            }
+            return screen_settings;
+        case UI_SCREEN_STATS:
+            if (!screen_stats) {
+                create_stats_screen();
+            }
+            return screen_stats;
         case UI_SCREEN_MAIN:
-            lv_disp_load_scr(screen_main);
-            break;
+        default:
+            if (!screen_main) {
+                create_main_screen();
+            }
+            return screen_main;
+    }
+}
+
+#if CONFIG_PGPEMU_UI_FREE_HIDDEN_SCREENS
+/* The main screen holds the cached layer and is never freed. Everything the
+ * other two show lives outside LVGL (stats_history, the account table, the
+ * settings flags), so they are rebuilt from scratch on the next visit. LVGL
+ * v8 allows deleting an object from its own event callback, which is how
+ * the Back buttons get here. */
+static void free_screen(ui_screen_t screen) {
+    switch (screen) {
         case UI_SCREEN_SETTINGS:
-            lv_disp_load_scr(screen_settings);
+            if (screen_settings) {
+                lv_obj_del(screen_settings);
+                screen_settings = NULL;
+            }
             break;
         case UI_SCREEN_STATS:
-            lv_disp_load_scr(screen_stats);
+            if (screen_stats) {
+                lv_timer_del(history_timer);
+                lv_obj_del(screen_stats);
+                history_timer = NULL;
+                screen_stats = NULL;
+                chart_minutes = NULL;
+                series_caught = NULL;
+                marker_now = NULL;
+                label_hour = NULL;
+                label_day = NULL;
+                label_accounts = NULL;
+            }
+            break;
+        default:
+            break;
+    }
+}
+#endif
+
+void ui_switch_screen(ui_screen_t screen) {
+    ui_screen_t prev = current_screen;
+    if (screen != UI_SCREEN_MAIN) {
+        ui_anim_cancel();
+    }
+    lv_disp_load_scr(build_screen(screen));
+    current_screen = screen;
+#if CONFIG_PGPEMU_UI_FREE_HIDDEN_SCREENS
+    if (prev != screen) {
+        free_screen(prev);
+    }
+#else
+    (void)prev;
+#endif
+    ui_mem_stats_t mem;
+    ui_get_mem_stats(&mem);
+    ESP_LOGD(TAG, "Screen %d: %u screens built, LVGL heap %lu used, %lu peak", (int)screen,
+             (unsigned)mem.screens, (unsigned long)mem.used, (unsigned long)mem.peak);
+}
+
+/* The panel keeps showing the old screen in its GRAM until new pixels are
+ * pushed, so a wipe needs no second frame buffer: the new screen is loaded
+ * with its full-screen invalidation dropped, then repainted band by band
+ * from the edge the finger moved away from. Each animation step sends only
+ * the band between the previous edge and the new one, one screen's worth
+ * of SPI traffic for the whole transition. */
+static void wipe_exec_cb(void *var, int32_t pos) {
+    (void)var;
+    if (pos <= wipe_done) {
+        return;
+    }
+    lv_coord_t w = lv_disp_get_hor_res(NULL);
+    lv_coord_t h = lv_disp_get_ver_res(NULL);
+    lv_area_t band = { 0, 0, (lv_coord_t)(w - 1), (lv_coord_t)(h - 1) };
+    switch (wipe_dir) {
+        case SWIPE_LEFT:
+            band.x1 = (lv_coord_t)(w - pos);
+            band.x2 = (lv_coord_t)(w - 1 - wipe_done);
             break;
+        case SWIPE_RIGHT:
+            band.x1 = (lv_coord_t)wipe_done;
+            band.x2 = (lv_coord_t)(pos - 1);
+            break;
+        case SWIPE_UP:
+            band.y1 = (lv_coord_t)(h - pos);
+            band.y2 = (lv_coord_t)(h - 1 - wipe_done);
+            break;
+        default:
+            band.y1 = (lv_coord_t)wipe_done;
+            band.y2 = (lv_coord_t)(pos - 1);
+            break;
+    }
+    wipe_done = pos;
+    lv_obj_invalidate_area(lv_scr_act(), &band);
+}
+
+static void start_wipe(swipe_dir_t dir) {
+    lv_disp_t *disp = lv_disp_get_default();
+    disp->inv_p = 0;
+    lv_anim_del(&wipe_done, NULL);
+    wipe_dir = dir;
+    wipe_done = 0;
+
+    lv_anim_t a;
+    lv_anim_init(&a);
+    lv_anim_set_var(&a, &wipe_done);
+    lv_anim_set_exec_cb(&a, wipe_exec_cb);
+    lv_anim_set_values(&a, 0, dir == SWIPE_LEFT || dir == SWIPE_RIGHT ? lv_disp_get_hor_res(disp)
+                                                                       : lv_disp_get_ver_res(disp));
+    lv_anim_set_time(&a, CONFIG_PGPEMU_UI_WIPE_MS);
+    lv_anim_set_path_cb(&a, lv_anim_path_ease_out);
+    lv_anim_start(&a);
+}
+
+/* Swipe navigation, called from the touch read in the LVGL task. Left and
+ * right page through the screens in the order the button's double click
+ * uses, up opens settings and down goes home. The target screen is laid
+ * out before it is loaded so that no widget invalidates itself ahead of the
+ * wipe edge. */
+void ui_navigate(swipe_dir_t dir, int64_t lift_us) {
+    ui_screen_t target = current_screen;
+    switch (dir) {
+        case SWIPE_LEFT:
+            target = (ui_screen_t)((current_screen + 1) % UI_SCREEN_COUNT);
+            break;
+        case SWIPE_RIGHT:
+            target = (ui_screen_t)((current_screen + UI_SCREEN_COUNT - 1) % UI_SCREEN_COUNT);
+            break;
+        case SWIPE_UP:
+            target = UI_SCREEN_SETTINGS;
+            break;
+        case SWIPE_DOWN:
+            target = UI_SCREEN_MAIN;
+            break;
+        default:
+            break;
+    }
+    if (target == current_screen) {
+        return;
+    }
+    lv_obj_update_layout(build_screen(target));
+    ui_switch_screen(target);
+    start_wipe(dir);
+
+    uint32_t latency = (uint32_t)(esp_timer_get_time() - lift_us);
+    nav_stats.swipes++;
+    nav_stats.latency_us_last = latency;
+    if (latency > nav_stats.latency_us_max) {
+        nav_stats.latency_us_max = latency;
     }
+    if (latency > CONFIG_PGPEMU_SWIPE_LATENCY_MS * 1000U) {
+        nav_stats.over_target++;
+        ESP_LOGW(TAG, "Swipe to screen %d took %lu us from lift", (int)target, (unsigned long)latency);
+    }
+}
+
+void ui_get_nav_stats(ui_nav_stats_t *out) {
+    *out = nav_stats;
+}
+
+/* Runs in the LVGL task, or before it starts: the monitor walks the pool. */
+void ui_get_mem_stats(ui_mem_stats_t *out) {
+    memset(out, 0, sizeof(*out));
+    out->screens = (uint8_t)((screen_main != NULL) + (screen_settings != NULL) + (screen_stats != NULL));
+#if LV_MEM_CUSTOM == 0
+    lv_mem_monitor_t mon;
+    lv_mem_monitor(&mon);
+    out->total = mon.total_size;
+    out->used = mon.total_size - mon.free_size;
+    out->peak = mon.max_used;
+#endif
 }
\ No newline at end of file
@@ -2,13 +2,47 @@
 #define DISPLAY_UI_H
 #include "lvgl.h"
 #include <stdbool.h>
+#include "ui_queue.h"
+#include "swipe.h"
+#include "pgp_link.h"
 void ui_init(void);
-void ui_update_status(bool connected, bool catching, bool spinning);
-void ui_update_stats(uint32_t pokemon_caught, uint32_t stops_spun, uint32_t battery_percent);
-void ui_update_connection_status(const char* status_text);
-void ui_show_catch_animation(bool success);
+void ui_update_status(ui_src_t src, bool connected, bool catching, bool spinning);
+void ui_update_stats(ui_src_t src, uint32_t pokemon_caught, uint32_t stops_spun);
+void ui_update_battery(ui_src_t src, uint8_t percent);
+void ui_update_connection_status(ui_src_t src, const char* status_text);
+void ui_show_catch_animation(ui_src_t src, bool success);
+void ui_show_spin_animation(ui_src_t src);
+void ui_notify_history(ui_src_t src);
+typedef uint8_t (*ui_accounts_cb_t)(pgp_account_t *out, uint8_t max);
+void ui_set_accounts_cb(ui_accounts_cb_t cb);
+void ui_notify_accounts(ui_src_t src);
+void ui_apply_pending(void);
+typedef void (*ui_settings_cb_t)(bool autocatch, bool autospin);
+void ui_set_settings(bool autocatch, bool autospin);
+void ui_set_settings_cb(ui_settings_cb_t cb);
+void ui_update_settings(ui_src_t src, bool autocatch, bool autospin);
 bool ui_get_autocatch_enabled(void);
 bool ui_get_autospin_enabled(void);
 typedef enum { UI_SCREEN_MAIN, UI_SCREEN_SETTINGS, UI_SCREEN_STATS } ui_screen_t;
 void ui_switch_screen(ui_screen_t screen);
+ui_screen_t ui_get_screen(void);
+typedef enum { UI_RENDER_DIRECT, UI_RENDER_CACHED } ui_render_mode_t;
+void ui_set_render_mode(ui_render_mode_t mode);
+ui_render_mode_t ui_get_render_mode(void);
+void ui_set_flash_images(bool enabled);
+typedef struct {
+    uint32_t used;
+    uint32_t peak;
+    uint32_t total;
+    uint8_t screens;
+} ui_mem_stats_t;
+void ui_get_mem_stats(ui_mem_stats_t *out);
+typedef struct {
+    uint32_t swipes;
+    uint32_t latency_us_last;
+    uint32_t latency_us_max;
+    uint32_t over_target;
+} ui_nav_stats_t;
+void ui_navigate(swipe_dir_t dir, int64_t lift_us);
+void ui_get_nav_stats(ui_nav_stats_t *out);
 #endif
@@ -0,0 +1,500 @@
+/* Append-only event journal in the "journal" partition.
+ *
+ * The partition is a ring of 4 KB sectors. Each sector opens with a 32-byte
+ * header holding the sequence number of its first record and a checkpoint
+ * of every counter at that point, followed by 254 fixed 16-byte records.
+ * A record is programmed once into erased flash and never rewritten; its
+ * CRC catches one torn by power loss, and sequence numbers order the rest.
+ *
+ * Boot reads the sector headers, takes the newest valid one and replays
+ * only that sector's records on top of its checkpoint, so recovery reads
+ * at most one sector however much the journal holds. A full sector hands
+ * over to the next, the oldest, which is erased and opened with a fresh
+ * checkpoint. Sectors are used strictly in turn, so every one sees the same
+ * number of erases.
+ *
+ * journal_append() only queues the event in RAM; the journal task writes
+ * queued events in one program per batch and erases the next sector once
+ * the current one is half full, so neither the append nor a sector change
+ * waits on a 25 ms erase. */
+#include "journal.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_system.h"
+#include "esp_partition.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "mem_report.h"
+#include <stddef.h>
+#include <string.h>
+
+static const char *TAG = "JOURNAL";
+
+#define JOURNAL_PARTITION   "journal"
+#define JOURNAL_PART_TYPE   0x40
+#define JOURNAL_SECTOR      4096
+#define JOURNAL_MAX_SECTORS 64
+#define JOURNAL_MAGIC       0x314e524aUL    /* "JRN1" */
+#define JOURNAL_QUEUE_LEN   32
+#define JOURNAL_SCAN_LEN    32
+#define JOURNAL_PRINT_LEN   8
+#define JOURNAL_TASK_STACK  2560
+
+typedef struct {
+    uint32_t magic;
+    uint32_t first_seq;
+    journal_counters_t base;
+    uint16_t reserved;
+    uint16_t crc;
+} journal_header_t;
+
+#define JOURNAL_RECORDS ((uint32_t)((JOURNAL_SECTOR - sizeof(journal_header_t)) / sizeof(journal_record_t)))
+
+_Static_assert(sizeof(journal_record_t) == 16, "journal records are 16 bytes on flash");
+_Static_assert(sizeof(journal_header_t) == 32, "journal sector headers are 32 bytes on flash");
+
+static const char *const event_names[JOURNAL_EV_COUNT] = {
+    [JOURNAL_EV_BOOT] = "boot",
+    [JOURNAL_EV_CAUGHT] = "caught",
+    [JOURNAL_EV_FLED] = "fled",
+    [JOURNAL_EV_SPUN] = "spun",
+    [JOURNAL_EV_CONNECT] = "connect",
+    [JOURNAL_EV_DISCONNECT] = "disconnect",
+};
+
+/* lock covers the queue and the live counters and is all an append takes;
+ * io_lock covers the flash and the write position. */
+static const esp_partition_t *part = NULL;
+static SemaphoreHandle_t lock = NULL;
+static SemaphoreHandle_t io_lock = NULL;
+static TaskHandle_t journal_task_handle = NULL;
+static journal_record_t queue[JOURNAL_QUEUE_LEN];
+static uint32_t queue_head;
+static uint32_t queue_count;
+static journal_record_t batch[JOURNAL_QUEUE_LEN];
+static journal_record_t scan_buf[JOURNAL_SCAN_LEN];
+static journal_counters_t live;
+static journal_counters_t durable;
+static uint32_t sectors;
+static uint32_t sector;
+static uint32_t head;
+static uint32_t next_seq;
+static bool next_erased;
+static journal_stats_t stats;
+MEM_TASK_STORAGE(journal_task_mem, JOURNAL_TASK_STACK);
+
+/* CRC-16/CCITT-FALSE, bitwise: a record is 14 bytes, a table would cost
+ * more flash than the loop costs time. */
+static uint16_t crc16(const void *data, size_t len) {
+    const uint8_t *p = data;
+    uint16_t crc = 0xffff;
+    while (len--) {
+        crc ^= (uint16_t)(*p++ << 8);
+        for (int i = 0; i < 8; i++) {
+            crc = crc & 0x8000 ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+static bool is_blank(const void *data, size_t len) {
+    const uint8_t *p = data;
+    for (size_t i = 0; i < len; i++) {
+        if (p[i] != 0xff) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool header_valid(const journal_header_t *h) {
+    return h->magic == JOURNAL_MAGIC && h->crc == crc16(h, offsetof(journal_header_t, crc));
+}
+
+static bool record_valid(const journal_record_t *r) {
+    return r->crc == crc16(r, offsetof(journal_record_t, crc));
+}
+
+static size_t sector_addr(uint32_t s) {
+    return (size_t)s * JOURNAL_SECTOR;
+}
+
+static size_t record_addr(uint32_t s, uint32_t i) {
+    return sector_addr(s) + sizeof(journal_header_t) + i * sizeof(journal_record_t);
+}
+
+static void count_event(journal_counters_t *c, uint8_t type) {
+    switch (type) {
+        case JOURNAL_EV_BOOT: c->boots++; break;
+        case JOURNAL_EV_CAUGHT: c->caught++; break;
+        case JOURNAL_EV_FLED: c->fled++; break;
+        case JOURNAL_EV_SPUN: c->spun++; break;
+        case JOURNAL_EV_CONNECT: c->connects++; break;
+        default: break;
+    }
+}
+
+const char *journal_event_name(journal_event_t type) {
+    return (unsigned)type < JOURNAL_EV_COUNT ? event_names[type] : "?";
+}
+
+static bool sector_erased(uint32_t s) {
+    for (size_t off = 0; off < JOURNAL_SECTOR; off += sizeof(scan_buf)) {
+        if (esp_partition_read(part, sector_addr(s) + off, scan_buf, sizeof(scan_buf)) != ESP_OK ||
+            !is_blank(scan_buf, sizeof(scan_buf))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Reading a sector back costs well under a millisecond; erasing it costs
+ * tens, so a sector that is already blank is left alone. */
+static esp_err_t prepare_sector(uint32_t s, bool known_erased) {
+    if (known_erased || sector_erased(s)) {
+        return ESP_OK;
+    }
+    esp_err_t err = esp_partition_erase_range(part, sector_addr(s), JOURNAL_SECTOR);
+    if (err == ESP_OK) {
+        stats.erases++;
+    }
+    return err;
+}
+
+/* The checkpoint is what is on flash so far, not what is queued: replay
+ * adds the records that follow it. */
+static esp_err_t open_sector(uint32_t s) {
+    journal_header_t h = {
+        .magic = JOURNAL_MAGIC,
+        .first_seq = next_seq,
+        .base = durable,
+        .reserved = 0xffff,
+    };
+    h.crc = crc16(&h, offsetof(journal_header_t, crc));
+    esp_err_t err = esp_partition_write(part, sector_addr(s), &h, sizeof(h));
+    if (err == ESP_OK) {
+        sector = s;
+        head = 0;
+        next_erased = false;
+    }
+    return err;
+}
+
+static esp_err_t roll(void) {
+    uint32_t next = (sector + 1) % sectors;
+    esp_err_t err = prepare_sector(next, next_erased);
+    if (err == ESP_OK) {
+        err = open_sector(next);
+    }
+    if (err == ESP_OK) {
+        stats.rolls++;
+    }
+    return err;
+}
+
+static esp_err_t scan_read(size_t addr, void *dst, size_t len) {
+    stats.scan_reads++;
+    stats.scan_bytes += len;
+    return esp_partition_read(part, addr, dst, len);
+}
+
+/* Rebuilds the counters from the newest checkpoint and the records after
+ * it. A record that fails its CRC or goes back in sequence was torn by a
+ * power cut; it is skipped and writing resumes after the last slot used. */
+static esp_err_t recover(const journal_counters_t *seed) {
+    journal_header_t h, newest;
+    int found = -1;
+    for (uint32_t s = 0; s < sectors; s++) {
+        esp_err_t err = scan_read(sector_addr(s), &h, sizeof(h));
+        if (err != ESP_OK) {
+            return err;
+        }
+        if (header_valid(&h) && (found < 0 || h.first_seq > newest.first_seq)) {
+            newest = h;
+            found = (int)s;
+        }
+    }
+    next_erased = false;
+    if (found < 0) {
+        ESP_LOGW(TAG, "No valid sector, starting a new journal");
+        durable = *seed;
+        next_seq = 1;
+        esp_err_t err = prepare_sector(0, false);
+        if (err == ESP_OK) {
+            err = open_sector(0);
+        }
+        return err;
+    }
+
+    sector = (uint32_t)found;
+    durable = newest.base;
+    next_seq = newest.first_seq;
+    head = JOURNAL_RECORDS;
+    for (uint32_t i = 0; i < JOURNAL_RECORDS && head == JOURNAL_RECORDS; i += JOURNAL_SCAN_LEN) {
+        uint32_t n = JOURNAL_RECORDS - i < JOURNAL_SCAN_LEN ? JOURNAL_RECORDS - i : JOURNAL_SCAN_LEN;
+        esp_err_t err = scan_read(record_addr(sector, i), scan_buf, n * sizeof(journal_record_t));
+        if (err != ESP_OK) {
+            return err;
+        }
+        for (uint32_t j = 0; j < n; j++) {
+            const journal_record_t *r = &scan_buf[j];
+            if (is_blank(r, sizeof(*r))) {
+                head = i + j;
+                break;
+            }
+            if (record_valid(r) && r->seq >= next_seq) {
+                count_event(&durable, r->type);
+                next_seq = r->seq + 1;
+                stats.replayed++;
+            } else {
+                stats.torn++;
+            }
+        }
+    }
+    return ESP_OK;
+}
+
+void journal_append(journal_event_t type, uint8_t slot, uint16_t arg) {
+    if (lock == NULL) {
+        return;
+    }
+    journal_record_t r = {
+        .time_s = (uint32_t)(esp_timer_get_time() / 1000000),
+        .type = (uint8_t)type,
+        .slot = slot,
+        .arg = arg,
+    };
+    xSemaphoreTake(lock, portMAX_DELAY);
+    count_event(&live, r.type);
+    r.boot = (uint16_t)live.boots;
+    stats.appended++;
+    if (part != NULL && queue_count == JOURNAL_QUEUE_LEN) {
+        stats.dropped++;
+    } else if (part != NULL) {
+        queue[(queue_head + queue_count) % JOURNAL_QUEUE_LEN] = r;
+        queue_count++;
+        if (queue_count > stats.queue_max) {
+            stats.queue_max = queue_count;
+        }
+    }
+    xSemaphoreGive(lock);
+    if (journal_task_handle) {
+        xTaskNotify(journal_task_handle, 1, eSetBits);
+    }
+}
+
+/* Writes everything queued, rolling to the next sector where one fills,
+ * then erases the sector after the current one if it is half used and
+ * that has not been done yet. Records of a failed write are counted as
+ * lost; their slots are not reused, as they may hold part of a record.
+ * Returns true when anything was written. */
+bool journal_service(void) {
+    if (part == NULL) {
+        return false;
+    }
+    xSemaphoreTake(io_lock, portMAX_DELAY);
+    xSemaphoreTake(lock, portMAX_DELAY);
+    uint32_t n = queue_count;
+    for (uint32_t i = 0; i < n; i++) {
+        batch[i] = queue[(queue_head + i) % JOURNAL_QUEUE_LEN];
+    }
+    queue_head = (queue_head + n) % JOURNAL_QUEUE_LEN;
+    queue_count = 0;
+    xSemaphoreGive(lock);
+
+    int64_t t0 = esp_timer_get_time();
+    for (uint32_t done = 0; done < n;) {
+        if (head == JOURNAL_RECORDS && roll() != ESP_OK) {
+            stats.write_errors++;
+            stats.lost += n - done;
+            break;
+        }
+        uint32_t chunk = n - done < JOURNAL_RECORDS - head ? n - done : JOURNAL_RECORDS - head;
+        for (uint32_t i = 0; i < chunk; i++) {
+            journal_record_t *r = &batch[done + i];
+            r->seq = next_seq + i;
+            r->crc = crc16(r, offsetof(journal_record_t, crc));
+        }
+        esp_err_t err = esp_partition_write(part, record_addr(sector, head), &batch[done],
+                                            chunk * sizeof(journal_record_t));
+        head += chunk;
+        next_seq += chunk;
+        if (err == ESP_OK) {
+            for (uint32_t i = 0; i < chunk; i++) {
+                count_event(&durable, batch[done + i].type);
+            }
+            stats.written += chunk;
+            stats.last_seq = next_seq - 1;
+        } else {
+            stats.write_errors++;
+            stats.lost += chunk;
+        }
+        done += chunk;
+    }
+    if (n) {
+        uint32_t us = (uint32_t)(esp_timer_get_time() - t0);
+        stats.batches++;
+        if (us > stats.write_us_max) {
+            stats.write_us_max = us;
+        }
+    }
+
+    if (head >= JOURNAL_RECORDS / 2 && !next_erased && prepare_sector((sector + 1) % sectors, false) == ESP_OK) {
+        next_erased = true;
+        stats.preerases++;
+    }
+    xSemaphoreGive(io_lock);
+    return n > 0;
+}
+
+static void journal_task(void *arg) {
+    uint32_t bits;
+    while (1) {
+        xTaskNotifyWait(0, UINT32_MAX, &bits, portMAX_DELAY);
+        journal_service();
+    }
+}
+
+static void journal_shutdown(void) {
+    journal_service();
+}
+
+/* Without the partition, or if it cannot be read, events are still counted
+ * in RAM from the seed but nothing is kept. */
+esp_err_t journal_init(const journal_counters_t *seed) {
+    if (lock == NULL) {
+        lock = xSemaphoreCreateMutex();
+        io_lock = xSemaphoreCreateMutex();
+        if (lock == NULL || io_lock == NULL) {
+            lock = NULL;
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    part = NULL;
+    queue_head = 0;
+    queue_count = 0;
+    memset(&stats, 0, sizeof(stats));
+    live = *seed;
+    durable = *seed;
+
+    const esp_partition_t *p = esp_partition_find_first((esp_partition_type_t)JOURNAL_PART_TYPE,
+                                                        ESP_PARTITION_SUBTYPE_ANY, JOURNAL_PARTITION);
+    if (p == NULL) {
+        ESP_LOGW(TAG, "No %s partition, events are not kept", JOURNAL_PARTITION);
+        return ESP_ERR_NOT_FOUND;
+    }
+    sectors = p->size / JOURNAL_SECTOR;
+    if (sectors > JOURNAL_MAX_SECTORS) {
+        sectors = JOURNAL_MAX_SECTORS;
+    }
+    if (sectors < 2) {
+        ESP_LOGE(TAG, "Partition too small: %lu bytes", (unsigned long)p->size);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    part = p;
+
+    int64_t t0 = esp_timer_get_time();
+    esp_err_t err = recover(seed);
+    stats.scan_us = (uint32_t)(esp_timer_get_time() - t0);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Recovery failed: %s", esp_err_to_name(err));
+        part = NULL;
+        return err;
+    }
+    live = durable;
+    stats.last_seq = next_seq - 1;
+
+    if (journal_task_handle == NULL) {
+        journal_task_handle = mem_task_create(journal_task, "journal", JOURNAL_TASK_STACK, NULL, 2,
+                                              MEM_TASK_BUFS(journal_task_mem));
+        esp_register_shutdown_handler(journal_shutdown);
+    }
+    ESP_LOGI(TAG, "Sector %lu record %lu, seq %lu: %lu caught, %lu spun, %lu boots (%lu reads, %lu us)",
+             (unsigned long)sector, (unsigned long)head, (unsigned long)stats.last_seq,
+             (unsigned long)durable.caught, (unsigned long)durable.spun, (unsigned long)durable.boots,
+             (unsigned long)stats.scan_reads, (unsigned long)stats.scan_us);
+    return ESP_OK;
+}
+
+/* Counts every event appended, including ones still queued. */
+void journal_get_counters(journal_counters_t *counters) {
+    if (lock == NULL) {
+        memset(counters, 0, sizeof(*counters));
+        return;
+    }
+    xSemaphoreTake(lock, portMAX_DELAY);
+    *counters = live;
+    xSemaphoreGive(lock);
+}
+
+void journal_get_stats(journal_stats_t *out) {
+    if (io_lock == NULL) {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+    xSemaphoreTake(io_lock, portMAX_DELAY);
+    xSemaphoreTake(lock, portMAX_DELAY);
+    *out = stats;
+    xSemaphoreGive(lock);
+    out->sectors = part ? sectors : 0;
+    out->sector = sector;
+    out->head = head;
+    xSemaphoreGive(io_lock);
+}
+
+/* CSV export, oldest first, of the last count records on flash (0 for all
+ * of them); events still queued are not included. Sectors are walked in
+ * sequence order from their headers. The flash lock is held per read, not
+ * for the whole export, so a slow console does not hold up the writer; a
+ * sector recycled meanwhile just ends its part of the listing early. */
+void journal_print(FILE *out, uint32_t count) {
+    fprintf(out, "seq,boot,time_s,event,slot,arg\n");
+    if (part == NULL) {
+        return;
+    }
+    uint32_t order[JOURNAL_MAX_SECTORS];
+    uint32_t first_seq[JOURNAL_MAX_SECTORS];
+    uint32_t n = 0;
+    uint32_t last;
+    journal_header_t h;
+
+    xSemaphoreTake(io_lock, portMAX_DELAY);
+    last = stats.last_seq;
+    for (uint32_t s = 0; s < sectors; s++) {
+        if (esp_partition_read(part, sector_addr(s), &h, sizeof(h)) != ESP_OK || !header_valid(&h)) {
+            continue;
+        }
+        uint32_t k = n++;
+        for (; k > 0 && first_seq[k - 1] > h.first_seq; k--) {
+            order[k] = order[k - 1];
+            first_seq[k] = first_seq[k - 1];
+        }
+        order[k] = s;
+        first_seq[k] = h.first_seq;
+    }
+    xSemaphoreGive(io_lock);
+
+    uint32_t from = count && last >= count ? last - count + 1 : 1;
+    journal_record_t recs[JOURNAL_PRINT_LEN];
+    for (uint32_t k = 0; k < n; k++) {
+        if (k + 1 < n && first_seq[k + 1] <= from) {
+            continue;
+        }
+        bool end = false;
+        for (uint32_t i = 0; i < JOURNAL_RECORDS && !end; i += JOURNAL_PRINT_LEN) {
+            uint32_t m = JOURNAL_RECORDS - i < JOURNAL_PRINT_LEN ? JOURNAL_RECORDS - i : JOURNAL_PRINT_LEN;
+            xSemaphoreTake(io_lock, portMAX_DELAY);
+            esp_err_t err = esp_partition_read(part, record_addr(order[k], i), recs, m * sizeof(recs[0]));
+            xSemaphoreGive(io_lock);
+            for (uint32_t j = 0; j < m && !end; j++) {
+                const journal_record_t *r = &recs[j];
+                end = err != ESP_OK || is_blank(r, sizeof(*r));
+                if (!end && record_valid(r) && r->seq >= from && r->seq <= last) {
+                    fprintf(out, "%lu,%u,%lu,%s,%u,%u\n", (unsigned long)r->seq, r->boot, (unsigned long)r->time_s,
+                            journal_event_name((journal_event_t)r->type), r->slot, r->arg);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "esp_err.h"
+typedef enum {
+    JOURNAL_EV_BOOT = 0,
+    JOURNAL_EV_CAUGHT,
+    JOURNAL_EV_FLED,
+    JOURNAL_EV_SPUN,
+    JOURNAL_EV_CONNECT,
+    JOURNAL_EV_DISCONNECT,
+    JOURNAL_EV_COUNT
+} journal_event_t;
+typedef struct {
+    uint32_t caught;
+    uint32_t fled;
+    uint32_t spun;
+    uint32_t connects;
+    uint32_t boots;
+} journal_counters_t;
+typedef struct {
+    uint32_t seq;
+    uint32_t time_s;
+    uint16_t boot;
+    uint8_t type;
+    uint8_t slot;
+    uint16_t arg;
+    uint16_t crc;
+} journal_record_t;
+typedef struct {
+    uint32_t appended;
+    uint32_t written;
+    uint32_t dropped;
+    uint32_t lost;
+    uint32_t write_errors;
+    uint32_t batches;
+    uint32_t queue_max;
+    uint32_t write_us_max;
+    uint32_t rolls;
+    uint32_t erases;
+    uint32_t preerases;
+    uint32_t sectors;
+    uint32_t sector;
+    uint32_t head;
+    uint32_t last_seq;
+    uint32_t replayed;
+    uint32_t torn;
+    uint32_t scan_reads;
+    uint32_t scan_bytes;
+    uint32_t scan_us;
+} journal_stats_t;
+esp_err_t journal_init(const journal_counters_t *seed);
+void journal_append(journal_event_t type, uint8_t slot, uint16_t arg);
+bool journal_service(void);
+void journal_get_counters(journal_counters_t *counters);
+void journal_get_stats(journal_stats_t *stats);
+void journal_print(FILE *out, uint32_t count);
+const char *journal_event_name(journal_event_t type);
+#endif
@@ -0,0 +1,494 @@
+#include "lcd_flush.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "esp_lcd_panel_ops.h"
+#include "trace.h"
+#include "boot_time.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Pixels the SPI setup of one extra window (CASET/RASET/RAMWR plus the
+ * transaction overhead) is roughly worth at 40 MHz. Two dirty areas are
+ * merged when their bounding box costs less than flushing them apart. */
+#define LCD_FLUSH_WINDOW_COST_PX    256
+
+/* The GC9A01 wants RGB565 MSB first. When LVGL renders native-endian pixels
+ * the bytes are swapped here rather than in the draw loop. */
+#define LCD_FLUSH_SWAP_BYTES        (LV_COLOR_DEPTH == 16 && !LV_COLOR_16_SWAP)
+
+/* Largest round panel the span table covers, and the most windows one
+ * clipped area may be split into before it is sent whole instead. */
+#define LCD_FLUSH_ROUND_MAX         240
+#define LCD_FLUSH_CLIP_MAX_WINDOWS  16
+
+static esp_lcd_panel_handle_t panel_handle = NULL;
+static lcd_flush_stats_t stats;
+static int64_t flush_start_us;
+static uint16_t flush_rows;
+static void *swapped_buf = NULL;
+static void *volatile inflight_buf = NULL;
+static lv_timer_cb_t lvgl_refr_timer_cb = NULL;
+
+/* Row bands of the frame buffer handed to the panel by one direct-mode
+ * flush; bands_pending counts the transfers still in flight. */
+typedef struct {
+    lv_coord_t y1;
+    lv_coord_t y2;
+} band_t;
+static band_t bands[LV_INV_BUF_SIZE];
+static uint8_t band_count;
+static volatile uint8_t bands_pending;
+#if LCD_FLUSH_SWAP_BYTES
+static lv_color_t *swapped_fb;
+#endif
+
+/* Visible columns of each row of a round panel, widened to even/odd edges
+ * like the rounder so every clipped window stays word aligned. round_rows is
+ * 0 when the panel is not round or clipping is off. */
+static uint8_t span_x1[LCD_FLUSH_ROUND_MAX];
+static uint8_t span_x2[LCD_FLUSH_ROUND_MAX];
+static uint16_t round_rows;
+#if CONFIG_PGPEMU_LCD_ROUND_CLIP
+static bool round_clip = true;
+#else
+static bool round_clip = false;
+#endif
+
+/* Windows one clipped area is sent as, in row order. */
+typedef struct {
+    lv_coord_t x1;
+    lv_coord_t x2;
+    lv_coord_t y1;
+    lv_coord_t y2;
+} clip_win_t;
+static clip_win_t clip_wins[LCD_FLUSH_CLIP_MAX_WINDOWS];
+
+#if LCD_FLUSH_SWAP_BYTES
+/* Two pixels per 32-bit word; draw buffers are word aligned and the rounder
+ * keeps every window an even number of pixels wide, so the tail is rare. */
+static void IRAM_ATTR swap_rgb565(lv_color_t *px, uint32_t count) {
+    uint32_t *w = (uint32_t *)px;
+    uint32_t words = count / 2;
+    for (uint32_t i = 0; i < words; i++) {
+        uint32_t v = w[i];
+        w[i] = ((v & 0x00FF00FFu) << 8) | ((v >> 8) & 0x00FF00FFu);
+    }
+    if (count & 1) {
+        uint16_t *h = (uint16_t *)px;
+        h[count - 1] = (uint16_t)((h[count - 1] << 8) | (h[count - 1] >> 8));
+    }
+}
+
+static void swap_timed(lv_color_t *px, uint32_t count) {
+    int64_t t0 = esp_timer_get_time();
+    swap_rgb565(px, count);
+    stats.swap_us += (uint64_t)(esp_timer_get_time() - t0);
+}
+
+/* LVGL calls wait_cb while the other draw buffer is still being sent. The
+ * buffer it is about to flush is already fully rendered at that point, so its
+ * byte swap is done here, overlapped with the in-flight DMA, and skipped later
+ * in the flush callback. Only valid with two partial buffers: with a single
+ * buffer LVGL waits before rendering, not before flushing. */
+static void lcd_flush_wait_cb(lv_disp_drv_t *drv) {
+    lv_disp_draw_buf_t *db = drv->draw_buf;
+    lv_draw_ctx_t *ctx = drv->draw_ctx;
+    if (db->buf1 && db->buf2 && ctx && ctx->buf && ctx->buf != inflight_buf && ctx->buf != swapped_buf) {
+        swap_timed(ctx->buf, lv_area_get_size(ctx->buf_area));
+        swapped_buf = ctx->buf;
+        stats.swaps_overlapped++;
+    }
+}
+#endif
+
+/* Keeps windows an even number of pixels wide so the swap above works on
+ * whole words and neighbouring areas line up for merging. */
+static void lcd_flush_rounder_cb(lv_disp_drv_t *drv, lv_area_t *area) {
+    area->x1 &= ~1;
+    area->x2 |= 1;
+    if (area->x2 >= drv->hor_res) {
+        area->x2 = drv->hor_res - 1;
+    }
+}
+
+/* Sorted, merged row ranges of the areas LVGL is refreshing. */
+static uint8_t collect_bands(const lv_disp_t *disp) {
+    uint8_t n = 0;
+    for (int i = 0; i < disp->inv_p; i++) {
+        if (disp->inv_area_joined[i]) {
+            continue;
+        }
+        band_t b = { disp->inv_areas[i].y1, disp->inv_areas[i].y2 };
+        int j = n++;
+        while (j > 0 && bands[j - 1].y1 > b.y1) {
+            bands[j] = bands[j - 1];
+            j--;
+        }
+        bands[j] = b;
+    }
+    uint8_t merged = 0;
+    for (uint8_t i = 0; i < n; i++) {
+        if (merged && bands[i].y1 <= bands[merged - 1].y2 + 1) {
+            if (bands[i].y2 > bands[merged - 1].y2) {
+                bands[merged - 1].y2 = bands[i].y2;
+            }
+        } else {
+            bands[merged++] = bands[i];
+        }
+    }
+    return merged;
+}
+
+/* Direct mode renders into one full-frame buffer at screen coordinates and
+ * calls flush_cb once per dirty area, always with the whole screen as the
+ * area. Nothing is sent until the last call; then every dirty area is
+ * widened to full rows, which are contiguous in the frame buffer, so each
+ * merged band goes to the panel as one window with no copy. */
+static void flush_direct(lv_disp_drv_t *drv, lv_color_t *fb) {
+    if (!lv_disp_flush_is_last(drv)) {
+        lv_disp_flush_ready(drv);
+        return;
+    }
+    band_count = collect_bands(lv_disp_get_default());
+    if (band_count == 0) {
+        lv_disp_flush_ready(drv);
+        return;
+    }
+
+    lv_coord_t w = drv->hor_res;
+    bands_pending = band_count;
+    inflight_buf = fb;
+    flush_start_us = esp_timer_get_time();
+    flush_rows = 0;
+    stats.flushes++;
+    stats.last_px = 0;
+    for (uint8_t i = 0; i < band_count; i++) {
+        lv_color_t *rows = fb + (size_t)bands[i].y1 * w;
+        uint32_t px = (uint32_t)(bands[i].y2 - bands[i].y1 + 1) * w;
+#if LCD_FLUSH_SWAP_BYTES
+        swap_timed(rows, px);
+#endif
+        stats.last_px += px;
+        flush_rows += (uint16_t)(bands[i].y2 - bands[i].y1 + 1);
+    }
+#if LCD_FLUSH_SWAP_BYTES
+    swapped_fb = fb;
+#endif
+    stats.last_bytes = stats.last_px * sizeof(lv_color_t);
+    stats.pixels += stats.last_px;
+    stats.bytes += stats.last_bytes;
+    stats.windows += band_count;
+    for (uint8_t i = 0; i < band_count; i++) {
+        esp_lcd_panel_draw_bitmap(panel_handle, 0, bands[i].y1, w, bands[i].y2 + 1,
+                                  fb + (size_t)bands[i].y1 * w);
+    }
+}
+
+/* The bands were swapped in place for the panel, but LVGL keeps drawing
+ * into the same buffer and only repaints what is dirty next time, so they
+ * are put back to native order before it renders again. */
+static void restore_direct(void) {
+#if LCD_FLUSH_SWAP_BYTES
+    if (swapped_fb == NULL) {
+        return;
+    }
+    lcd_flush_wait_idle();
+    lv_coord_t w = lv_disp_get_default()->driver->hor_res;
+    for (uint8_t i = 0; i < band_count; i++) {
+        swap_timed(swapped_fb + (size_t)bands[i].y1 * w, (uint32_t)(bands[i].y2 - bands[i].y1 + 1) * w);
+    }
+    swapped_fb = NULL;
+#endif
+}
+
+/* A pixel is kept when any part of it lies inside the circle inscribed in
+ * the d x d panel. Coordinates are doubled so the centre sits on a whole
+ * number; everything stays integer. */
+static void build_span_table(uint16_t d) {
+    int32_t r2 = (int32_t)d * d;
+    for (uint16_t y = 0; y < d; y++) {
+        int32_t dy = abs(2 * y + 1 - d) - 1;
+        uint16_t x = 0;
+        while (x < d / 2) {
+            int32_t dx = abs(2 * x + 1 - d) - 1;
+            if (dx * dx + dy * dy < r2) {
+                break;
+            }
+            x++;
+        }
+        x &= ~1;
+        span_x1[y] = (uint8_t)x;
+        span_x2[y] = (uint8_t)((d - 1 - x) | 1);
+    }
+    round_rows = d;
+}
+
+/* Splits an area into row groups, each sent as the tightest window around
+ * the visible spans of its rows. A shortest-path pass over the rows picks
+ * the grouping: a new window pays off only when the corner pixels it drops
+ * outweigh LCD_FLUSH_WINDOW_COST_PX, so wide flat bands near the middle
+ * stay whole and the steep top and bottom caps get trimmed row groups.
+ * Returns the number of windows, 0 when nothing of the area is visible, or
+ * -1 when it is best sent as it is. */
+static int plan_clip(const lv_area_t *area) {
+    static uint32_t cost[LCD_FLUSH_ROUND_MAX + 1];
+    static int16_t from[LCD_FLUSH_ROUND_MAX + 1];
+    static int16_t row_x1[LCD_FLUSH_ROUND_MAX], row_x2[LCD_FLUSH_ROUND_MAX];
+    int16_t h = (int16_t)lv_area_get_height(area);
+    uint32_t w = (uint32_t)lv_area_get_width(area);
+    if (area->y2 >= round_rows || area->x2 >= round_rows) {
+        return -1;
+    }
+
+    bool inside = true;
+    for (int16_t r = 0; r < h; r++) {
+        lv_coord_t y = area->y1 + r;
+        row_x1[r] = LV_MAX(area->x1, span_x1[y]);
+        row_x2[r] = LV_MIN(area->x2, span_x2[y]);
+        inside &= row_x1[r] == area->x1 && row_x2[r] == area->x2;
+    }
+    if (inside) {
+        return -1;
+    }
+
+    /* cost[i]: pixels plus window overhead to send rows 0..i-1; from[i] is
+     * the first row of the last window, or -1 when row i-1 is skipped. */
+    cost[0] = 0;
+    for (int16_t i = 1; i <= h; i++) {
+        cost[i] = UINT32_MAX;
+        if (row_x1[i - 1] > row_x2[i - 1]) {
+            cost[i] = cost[i - 1];
+            from[i] = -1;
+        }
+        int16_t x1 = INT16_MAX, x2 = -1;
+        for (int16_t j = i - 1; j >= 0; j--) {
+            if (row_x1[j] <= row_x2[j]) {
+                x1 = LV_MIN(x1, row_x1[j]);
+                x2 = LV_MAX(x2, row_x2[j]);
+            }
+            if (x2 < x1) {
+                continue;
+            }
+            uint32_t c = cost[j] + (uint32_t)(i - j) * (uint32_t)(x2 - x1 + 1) + LCD_FLUSH_WINDOW_COST_PX;
+            if (c < cost[i]) {
+                cost[i] = c;
+                from[i] = j;
+            }
+        }
+    }
+    if (cost[h] >= h * w + LCD_FLUSH_WINDOW_COST_PX) {
+        return -1;
+    }
+
+    int n = 0;
+    for (int16_t i = h; i > 0;) {
+        if (from[i] < 0) {
+            i--;
+            continue;
+        }
+        if (n == LCD_FLUSH_CLIP_MAX_WINDOWS) {
+            return -1;
+        }
+        int16_t j = from[i];
+        clip_win_t *cw = &clip_wins[n++];
+        cw->x1 = INT16_MAX;
+        cw->x2 = -1;
+        for (int16_t r = j; r < i; r++) {
+            if (row_x1[r] <= row_x2[r]) {
+                cw->x1 = LV_MIN(cw->x1, row_x1[r]);
+                cw->x2 = LV_MAX(cw->x2, row_x2[r]);
+            }
+        }
+        cw->y1 = area->y1 + j;
+        cw->y2 = area->y1 + i - 1;
+        i = j;
+    }
+    for (int a = 0, b = n - 1; a < b; a++, b--) {
+        clip_win_t t = clip_wins[a];
+        clip_wins[a] = clip_wins[b];
+        clip_wins[b] = t;
+    }
+    return n;
+}
+
+/* Packs the windows' pixels to the front of the draw buffer, each window's
+ * rows back to back as draw_bitmap expects. Windows run top to bottom and
+ * are never wider than the area, so the write position never passes the
+ * read position and one forward pass of memmove is safe. */
+static uint32_t compact_clip(const lv_area_t *area, lv_color_t *buf, int n) {
+    lv_coord_t stride = lv_area_get_width(area);
+    lv_color_t *dst = buf;
+    for (int i = 0; i < n; i++) {
+        const clip_win_t *cw = &clip_wins[i];
+        lv_coord_t cw_w = cw->x2 - cw->x1 + 1;
+        for (lv_coord_t y = cw->y1; y <= cw->y2; y++) {
+            const lv_color_t *src = buf + (size_t)(y - area->y1) * stride + (cw->x1 - area->x1);
+            if (dst != src) {
+                memmove(dst, src, (size_t)cw_w * sizeof(lv_color_t));
+            }
+            dst += cw_w;
+        }
+    }
+    return (uint32_t)(dst - buf);
+}
+
+static void lcd_flush_cb(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_map) {
+    if (drv->direct_mode) {
+        flush_direct(drv, color_map);
+        return;
+    }
+    uint32_t area_px = lv_area_get_size(area);
+    int wins = (round_clip && round_rows) ? plan_clip(area) : -1;
+    uint32_t px = wins >= 0 ? compact_clip(area, color_map, wins) : area_px;
+    if (wins == 0) {
+        stats.clipped_px += area_px;
+        lv_disp_flush_ready(drv);
+        return;
+    }
+
+#if LCD_FLUSH_SWAP_BYTES
+    if (color_map == swapped_buf) {
+        swapped_buf = NULL;
+    } else {
+        swap_timed(color_map, px);
+    }
+#endif
+
+    stats.flushes++;
+    stats.last_px = px;
+    stats.last_bytes = px * sizeof(lv_color_t);
+    stats.pixels += px;
+    stats.bytes += stats.last_bytes;
+    stats.clipped_px += area_px - px;
+    stats.windows += wins > 0 ? wins : 1;
+    flush_rows = (uint16_t)lv_area_get_height(area);
+    flush_start_us = esp_timer_get_time();
+    inflight_buf = color_map;
+
+    if (wins < 0) {
+        esp_lcd_panel_draw_bitmap(panel_handle, area->x1, area->y1, area->x2 + 1, area->y2 + 1, color_map);
+        return;
+    }
+    bands_pending = (uint8_t)wins;
+    const lv_color_t *p = color_map;
+    for (int i = 0; i < wins; i++) {
+        const clip_win_t *cw = &clip_wins[i];
+        esp_lcd_panel_draw_bitmap(panel_handle, cw->x1, cw->y1, cw->x2 + 1, cw->y2 + 1, p);
+        p += (size_t)(cw->x2 - cw->x1 + 1) * (cw->y2 - cw->y1 + 1);
+    }
+}
+
+bool IRAM_ATTR lcd_flush_trans_done(esp_lcd_panel_io_handle_t panel_io, esp_lcd_panel_io_event_data_t *edata,
+                                    void *user_ctx) {
+    lv_disp_drv_t *drv = (lv_disp_drv_t *)user_ctx;
+    if (bands_pending > 0 && --bands_pending > 0) {
+        return false;
+    }
+    uint32_t us = (uint32_t)(esp_timer_get_time() - flush_start_us);
+    stats.last_us = us;
+    stats.total_us += us;
+    if (us > stats.max_us) {
+        stats.max_us = us;
+    }
+    inflight_buf = NULL;
+    boot_time_mark(BOOT_STAGE_FIRST_FLUSH);
+    TRACE_SPAN(TRACE_EV_LCD_FLUSH, flush_start_us, flush_rows);
+    lv_disp_flush_ready(drv);
+    return false;
+}
+
+static bool mergeable(const lv_area_t *a, const lv_area_t *b, lv_area_t *out) {
+    /* Only areas that overlap or touch are candidates. */
+    if (a->x1 > b->x2 + 1 || b->x1 > a->x2 + 1 || a->y1 > b->y2 + 1 || b->y1 > a->y2 + 1) {
+        return false;
+    }
+    _lv_area_join(out, a, b);
+    return lv_area_get_size(out) <= lv_area_get_size(a) + lv_area_get_size(b) + LCD_FLUSH_WINDOW_COST_PX;
+}
+
+/* Folds adjacent dirty areas into one window before LVGL renders them.
+ * LVGL's own join only fires when the union is strictly smaller than the
+ * parts, which leaves e.g. the label and arc strips of one update as separate
+ * SPI windows. */
+void lcd_flush_merge_dirty(lv_disp_t *disp) {
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int i = 0; i < disp->inv_p && !changed; i++) {
+            if (disp->inv_area_joined[i]) {
+                continue;
+            }
+            for (int j = i + 1; j < disp->inv_p; j++) {
+                lv_area_t joined;
+                if (disp->inv_area_joined[j] || !mergeable(&disp->inv_areas[i], &disp->inv_areas[j], &joined)) {
+                    continue;
+                }
+                disp->inv_areas[i] = joined;
+                memmove(&disp->inv_areas[j], &disp->inv_areas[j + 1], (disp->inv_p - j - 1) * sizeof(lv_area_t));
+                memmove(&disp->inv_area_joined[j], &disp->inv_area_joined[j + 1], disp->inv_p - j - 1);
+                disp->inv_p--;
+                stats.areas_merged++;
+                changed = true;
+                break;
+            }
+        }
+    }
+}
+
+static void lcd_flush_refr_timer(lv_timer_t *timer) {
+    lv_disp_t *disp = timer->user_data;
+    lcd_flush_merge_dirty(disp);
+    restore_direct();
+    lvgl_refr_timer_cb(timer);
+}
+
+void lcd_flush_attach(lv_disp_drv_t *drv, esp_lcd_panel_handle_t panel) {
+    panel_handle = panel;
+    drv->flush_cb = lcd_flush_cb;
+    drv->rounder_cb = lcd_flush_rounder_cb;
+#if LCD_FLUSH_SWAP_BYTES
+    drv->wait_cb = lcd_flush_wait_cb;
+#endif
+    round_rows = 0;
+    if (drv->hor_res == drv->ver_res && drv->ver_res <= LCD_FLUSH_ROUND_MAX) {
+        build_span_table((uint16_t)drv->ver_res);
+    }
+}
+
+/* Direct mode keeps sending full-width bands: trimming them would need a
+ * copy of the frame buffer, which LVGL keeps drawing into. */
+void lcd_flush_set_round_clip(bool enable) {
+    round_clip = enable;
+}
+
+/* Runs the merge pass in front of every refresh LVGL schedules itself. */
+void lcd_flush_install_refr_hook(lv_disp_t *disp) {
+    lvgl_refr_timer_cb = disp->refr_timer->timer_cb;
+    disp->refr_timer->timer_cb = lcd_flush_refr_timer;
+}
+
+void lcd_flush_refresh_now(void) {
+    lv_disp_t *disp = lv_disp_get_default();
+    lcd_flush_merge_dirty(disp);
+    restore_direct();
+    lv_refr_now(disp);
+}
+
+/* Blocks until the last area handed to the panel has left the SPI queue,
+ * so panel commands cannot land in the middle of a frame. */
+void lcd_flush_wait_idle(void) {
+    while (inflight_buf != NULL) {
+        vTaskDelay(1);
+    }
+}
+
+void lcd_flush_get_stats(lcd_flush_stats_t *out) {
+    *out = stats;
+}
+
+void lcd_flush_reset_stats(void) {
+    memset(&stats, 0, sizeof(stats));
+}
@@ -0,0 +1,32 @@
+#ifndef LCD_FLUSH_H
+#define LCD_FLUSH_H
+#include <stdbool.h>
+#include <stdint.h>
+#include "lvgl.h"
+#include "esp_lcd_panel_io.h"
+#include "esp_lcd_types.h"
+typedef struct {
+    uint32_t flushes;
+    uint64_t bytes;
+    uint64_t pixels;
+    uint32_t last_bytes;
+    uint32_t last_px;
+    uint32_t last_us;
+    uint32_t max_us;
+    uint64_t total_us;
+    uint64_t swap_us;
+    uint32_t swaps_overlapped;
+    uint32_t areas_merged;
+    uint64_t clipped_px;
+    uint32_t windows;
+} lcd_flush_stats_t;
+void lcd_flush_attach(lv_disp_drv_t *drv, esp_lcd_panel_handle_t panel);
+void lcd_flush_set_round_clip(bool enable);
+void lcd_flush_install_refr_hook(lv_disp_t *disp);
+bool lcd_flush_trans_done(esp_lcd_panel_io_handle_t panel_io, esp_lcd_panel_io_event_data_t *edata, void *user_ctx);
+void lcd_flush_merge_dirty(lv_disp_t *disp);
+void lcd_flush_refresh_now(void);
+void lcd_flush_wait_idle(void);
+void lcd_flush_get_stats(lcd_flush_stats_t *stats);
+void lcd_flush_reset_stats(void);
+#endif
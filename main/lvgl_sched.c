@@ -0,0 +1,150 @@
+#include "lvgl_sched.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "lvgl.h"
+#include "trace.h"
+#include "sdkconfig.h"
+#if CONFIG_PM_ENABLE
+#include "esp_pm.h"
+#endif
+
+static const char *TAG = "LVGL_SCHED";
+
+static TaskHandle_t sched_task = NULL;
+static lvgl_sched_event_cb_t event_cb = NULL;
+static lvgl_sched_stats_t stats;
+static int64_t last_tick_us = -1;
+static int64_t window_start_us;
+static uint32_t window_wakeups;
+static volatile bool suspended;
+
+void lvgl_sched_set_event_cb(lvgl_sched_event_cb_t cb) {
+    event_cb = cb;
+}
+
+/* LVGL's tick is advanced from esp_timer_get_time() on every wakeup instead of
+ * by a periodic timer, so a static screen costs no interrupts at all. The
+ * sub-millisecond remainder is carried over to keep the tick from drifting. */
+static void advance_tick(int64_t now_us) {
+    if (last_tick_us < 0) {
+        last_tick_us = now_us;
+        window_start_us = now_us;
+        return;
+    }
+    int64_t elapsed_ms = (now_us - last_tick_us) / 1000;
+    if (elapsed_ms > 0) {
+        lv_tick_inc((uint32_t)elapsed_ms);
+        last_tick_us += elapsed_ms * 1000;
+    }
+}
+
+static void account_wakeup(int64_t now_us, uint32_t events) {
+    stats.wakeups++;
+    if (events) {
+        stats.wakeups_event++;
+    } else {
+        stats.wakeups_timeout++;
+    }
+    window_wakeups++;
+    if (now_us - window_start_us >= 1000000) {
+        stats.wakeups_per_sec = (uint32_t)((uint64_t)window_wakeups * 1000000 / (uint64_t)(now_us - window_start_us));
+        window_wakeups = 0;
+        window_start_us = now_us;
+        ESP_LOGD(TAG, "%lu wakeups/s, last sleep %lu ms",
+                 (unsigned long)stats.wakeups_per_sec, (unsigned long)stats.last_sleep_ms);
+    }
+}
+
+uint32_t lvgl_sched_step(uint32_t events) {
+    int64_t now = esp_timer_get_time();
+    advance_tick(now);
+    account_wakeup(now, events);
+
+    if (events && event_cb) {
+        event_cb(events);
+    }
+    /* While the display is dark nothing is rendered or read; the task only
+     * wakes for posted events until the power manager resumes it. */
+    if (suspended) {
+        stats.last_sleep_ms = LVGL_SCHED_SLEEP_FOREVER;
+        return LVGL_SCHED_SLEEP_FOREVER;
+    }
+
+    TRACE_BEGIN(handler);
+    uint32_t next_ms = lv_timer_handler();
+    TRACE_END(handler, TRACE_EV_LVGL_HANDLER, next_ms);
+
+    uint32_t handler_us = (uint32_t)(esp_timer_get_time() - now);
+    stats.handler_us_total += handler_us;
+    if (handler_us > stats.handler_us_max) {
+        stats.handler_us_max = handler_us;
+    }
+
+    if (next_ms == LV_NO_TIMER_READY || next_ms > LVGL_SCHED_MAX_SLEEP_MS) {
+        next_ms = LVGL_SCHED_MAX_SLEEP_MS;
+    } else if (next_ms == 0) {
+        next_ms = 1;
+    }
+    stats.last_sleep_ms = next_ms;
+    return next_ms;
+}
+
+/* With esp_pm the CPU drops to XTAL between wakeups; each step holds the
+ * clock at maximum so rendering and the overlapped byte swap run at full
+ * speed. The SPI driver keeps APB up for DMA still in flight afterwards. */
+void lvgl_sched_task(void *arg) {
+#if CONFIG_PM_ENABLE
+    esp_pm_lock_handle_t pm_lock = NULL;
+    esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "lvgl", &pm_lock);
+#endif
+    sched_task = xTaskGetCurrentTaskHandle();
+    /* Pick up whatever was posted before the task existed. */
+    uint32_t events = LVGL_SCHED_EVT_UI;
+
+    ESP_LOGI(TAG, "LVGL scheduler started");
+    while (1) {
+#if CONFIG_PM_ENABLE
+        if (pm_lock) {
+            esp_pm_lock_acquire(pm_lock);
+        }
+#endif
+        uint32_t sleep_ms = lvgl_sched_step(events);
+#if CONFIG_PM_ENABLE
+        if (pm_lock) {
+            esp_pm_lock_release(pm_lock);
+        }
+#endif
+        events = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &events,
+                        sleep_ms == LVGL_SCHED_SLEEP_FOREVER ? portMAX_DELAY : pdMS_TO_TICKS(sleep_ms));
+    }
+}
+
+void lvgl_sched_notify(uint32_t events) {
+    if (sched_task) {
+        xTaskNotify(sched_task, events, eSetBits);
+    }
+}
+
+void IRAM_ATTR lvgl_sched_notify_from_isr(uint32_t events) {
+    if (sched_task) {
+        BaseType_t woken = pdFALSE;
+        xTaskNotifyFromISR(sched_task, events, eSetBits, &woken);
+        portYIELD_FROM_ISR(woken);
+    }
+}
+
+/* Called from the LVGL task itself, normally from the event callback. */
+void lvgl_sched_suspend(bool suspend) {
+    suspended = suspend;
+}
+
+bool lvgl_sched_is_suspended(void) {
+    return suspended;
+}
+
+void lvgl_sched_get_stats(lvgl_sched_stats_t *out) {
+    *out = stats;
+}
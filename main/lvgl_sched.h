@@ -0,0 +1,29 @@
+#ifndef LVGL_SCHED_H
+#define LVGL_SCHED_H
+#include <stdbool.h>
+#include <stdint.h>
+#define LVGL_SCHED_EVT_UI       (1UL << 0)
+#define LVGL_SCHED_EVT_TOUCH    (1UL << 1)
+#define LVGL_SCHED_EVT_BUTTON   (1UL << 2)
+#define LVGL_SCHED_EVT_POWER    (1UL << 3)
+#define LVGL_SCHED_MAX_SLEEP_MS 1000
+#define LVGL_SCHED_SLEEP_FOREVER UINT32_MAX
+typedef void (*lvgl_sched_event_cb_t)(uint32_t events);
+typedef struct {
+    uint32_t wakeups;
+    uint32_t wakeups_event;
+    uint32_t wakeups_timeout;
+    uint32_t wakeups_per_sec;
+    uint32_t last_sleep_ms;
+    uint32_t handler_us_max;
+    uint64_t handler_us_total;
+} lvgl_sched_stats_t;
+void lvgl_sched_set_event_cb(lvgl_sched_event_cb_t cb);
+uint32_t lvgl_sched_step(uint32_t events);
+void lvgl_sched_task(void *arg);
+void lvgl_sched_notify(uint32_t events);
+void lvgl_sched_notify_from_isr(uint32_t events);
+void lvgl_sched_suspend(bool suspend);
+bool lvgl_sched_is_suspended(void);
+void lvgl_sched_get_stats(lvgl_sched_stats_t *stats);
+#endif
@@ -6,224 +6,146 @@
 #include "freertos/semphr.h"
 #include "esp_log.h"
 #include "esp_system.h"
+#include "esp_timer.h"
 #include "nvs_flash.h"
 #include "driver/gpio.h"
-#include "driver/spi_master.h"
-#include "esp_lcd_panel_io.h"
-#include "esp_lcd_panel_vendor.h"
-#include "esp_lcd_panel_ops.h"
+#include <stdatomic.h>
 
 #include "lvgl.h"
-#include "cst816_touch.h"
+#include "display_port.h"
 #include "display_ui.h"
+#include "lvgl_sched.h"
+#include "console.h"
+#include "button.h"
+#include "pgpemu.h"
+#include "persist.h"
+#include "journal.h"
+#include "stats_history.h"
+#include "power.h"
+#include "boot_time.h"
+#include "mem_report.h"
+#include "battery.h"
+#include "pgp_ble.h"
+#include "portal.h"
+#include "wifi_portal.h"
 
 static const char *TAG = "PGPEMU";
 
-#define LCD_HOST        SPI2_HOST
-#define LCD_PIXEL_CLK   40000000
-#define LCD_BK_LIGHT    GPIO_NUM_3
-#define LCD_PIN_MOSI    GPIO_NUM_7
-#define LCD_PIN_CLK     GPIO_NUM_6
-#define LCD_PIN_CS      GPIO_NUM_10
-#define LCD_PIN_DC      GPIO_NUM_2
-#define LCD_PIN_RST     GPIO_NUM_NC
-
-#define TOUCH_I2C_PORT  I2C_NUM_0
-#define TOUCH_PIN_SDA   GPIO_NUM_4
-#define TOUCH_PIN_SCL   GPIO_NUM_5
-
 #define BUTTON_PIN      GPIO_NUM_9
+#define FIRST_FRAME_WAIT_MS 1000
 
-#define LCD_H_RES       240
-#define LCD_V_RES       240
+#define LVGL_TASK_STACK     4096
+#define BUTTON_TASK_STACK   3584    /* wifi_portal_start() runs here */
+#define PGPEMU_TASK_STACK   4096
 
-static lv_disp_draw_buf_t disp_buf;
-static lv_disp_drv_t disp_drv;
-static lv_color_t *buf1;
-static lv_color_t *buf2;
-static esp_lcd_panel_handle_t panel_handle = NULL;
+MEM_TASK_STORAGE(lvgl_task_mem, LVGL_TASK_STACK);
+MEM_TASK_STORAGE(button_task_mem, BUTTON_TASK_STACK);
+MEM_TASK_STORAGE(pgpemu_task_mem, PGPEMU_TASK_STACK);
 
-static uint32_t pokemon_caught = 0;
-static uint32_t pokestops_spun = 0;
-static bool device_connected = false;
 
-static void lv_tick_task(void *arg) {
-    (void) arg;
-    lv_tick_inc(10);
-}
+typedef enum { NAV_NONE, NAV_NEXT, NAV_HOME } nav_request_t;
+static atomic_int nav_request = NAV_NONE;
 
-static bool notify_lvgl_flush_ready(esp_lcd_panel_io_handle_t panel_io, 
-                                   esp_lcd_panel_io_event_data_t *edata, 
-                                   void *user_ctx) {
-    lv_disp_drv_t *disp_driver = (lv_disp_drv_t *)user_ctx;
-    lv_disp_flush_ready(disp_driver);
-    return false;
+static void request_nav(nav_request_t nav) {
+    atomic_store(&nav_request, nav);
+    lvgl_sched_notify(LVGL_SCHED_EVT_BUTTON);
 }
 
-static void lvgl_flush_cb(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_map) {
-    int offsetx1 = area->x1;
-    int offsetx2 = area->x2;
-    int offsety1 = area->y1;
-    int offsety2 = area->y2;
-    
-    esp_lcd_panel_draw_bitmap(panel_handle, offsetx1, offsety1, 
-                             offsetx2 + 1, offsety2 + 1, color_map);
-}
+/* Blocks on the button event queue, so it costs nothing between presses.
+ * Click is the PGP button (a manual press when connected, re-advertise
+ * otherwise), double click pages through the screens, long press goes back
+ * to the main screen. */
+static void button_task(void *arg) {
+    button_event_t evt;
 
-static void lvgl_touch_cb(lv_indev_drv_t *drv, lv_indev_data_t *data) {
-    cst816_touch_data_t touch_data;
-    
-    if (cst816_read_touch(&touch_data) == ESP_OK && touch_data.touched) {
-        data->point.x = touch_data.x;
-        data->point.y = touch_data.y;
-        data->state = LV_INDEV_STATE_PR;
-    } else {
-        data->state = LV_INDEV_STATE_REL;
+    while (1) {
+        if (!button_get_event(&evt, portMAX_DELAY)) {
+            continue;
+        }
+        power_activity(POWER_SRC_BUTTON);
+        switch (evt.type) {
+            case BUTTON_EVT_CLICK:
+                ESP_LOGI(TAG, "Button click");
+                pgpemu_button_click();
+                break;
+            case BUTTON_EVT_DOUBLE_CLICK:
+                ESP_LOGI(TAG, "Button double click");
+                request_nav(NAV_NEXT);
+                break;
+            case BUTTON_EVT_LONG_PRESS:
+                ESP_LOGI(TAG, "Button long press (%lu ms)", (unsigned long)evt.held_ms);
+                request_nav(NAV_HOME);
+                break;
+            case BUTTON_EVT_BOOT_HOLD: {
+                ESP_LOGI(TAG, "Button held after boot, WiFi AP mode requested");
+                /* PGP emulation only pauses for an AP that can come up. */
+                esp_err_t err = wifi_portal_check();
+                if (err == ESP_OK) {
+                    pgpemu_set_paused(true);
+                    err = wifi_portal_start();
+                    if (err != ESP_OK) {
+                        pgpemu_set_paused(false);
+                    }
+                }
+                if (err == ESP_OK) {
+                    ui_update_connection_status(UI_SRC_BUTTON, "WiFi AP Mode");
+                } else if (err == ESP_ERR_INVALID_ARG) {
+                    ui_update_connection_status(UI_SRC_BUTTON, "Set AP password");
+                } else {
+                    ui_update_connection_status(UI_SRC_BUTTON, "WiFi AP error");
+                }
+                break;
+            }
+        }
     }
 }
 
-static void init_lcd(void) {
-    ESP_LOGI(TAG, "Initialize LCD");
-    
-    gpio_set_direction(LCD_BK_LIGHT, GPIO_MODE_OUTPUT);
-    gpio_set_level(LCD_BK_LIGHT, 1);
-    
-    spi_bus_config_t buscfg = {
-        .mosi_io_num = LCD_PIN_MOSI,
-        .miso_io_num = GPIO_NUM_NC,
-        .sclk_io_num = LCD_PIN_CLK,
-        .quadwp_io_num = GPIO_NUM_NC,
-        .quadhd_io_num = GPIO_NUM_NC,
-        .max_transfer_sz = LCD_H_RES * LCD_V_RES * sizeof(uint16_t),
-    };
-    ESP_ERROR_CHECK(spi_bus_initialize(LCD_HOST, &buscfg, SPI_DMA_CH_AUTO));
-    
-    esp_lcd_panel_io_handle_t io_handle = NULL;
-    esp_lcd_panel_io_spi_config_t io_config = {
-        .dc_gpio_num = LCD_PIN_DC,
-        .cs_gpio_num = LCD_PIN_CS,
-        .pclk_hz = LCD_PIXEL_CLK,
-        .lcd_cmd_bits = 8,
-        .lcd_param_bits = 8,
-        .spi_mode = 0,
-        .trans_queue_depth = 10,
-        .on_color_trans_done = notify_lvgl_flush_ready,
-        .user_ctx = &disp_drv,
-    };
-    ESP_ERROR_CHECK(esp_lcd_new_panel_io_spi((esp_lcd_spi_bus_handle_t)LCD_HOST, &io_config, &io_handle));
-    
-    esp_lcd_panel_dev_config_t panel_config = {
-        .reset_gpio_num = LCD_PIN_RST,
-        .rgb_endian = LCD_RGB_ENDIAN_RGB,
-        .bits_per_pixel = 16,
-    };
-    ESP_ERROR_CHECK(esp_lcd_new_panel_gc9a01(io_handle, &panel_config, &panel_handle));
-    
-    ESP_ERROR_CHECK(esp_lcd_panel_reset(panel_handle));
-    ESP_ERROR_CHECK(esp_lcd_panel_init(panel_handle));
-    ESP_ERROR_CHECK(esp_lcd_panel_disp_on_off(panel_handle, true));
-    
-    ESP_LOGI(TAG, "LCD initialized");
+static void on_touch_activity(void) {
+    power_activity(POWER_SRC_TOUCH);
 }
 
-static void init_lvgl(void) {
-    ESP_LOGI(TAG, "Initialize LVGL");
-    
-    lv_init();
-    
-    size_t buf_size = LCD_H_RES * 40 * sizeof(lv_color_t);
-    buf1 = heap_caps_malloc(buf_size, MALLOC_CAP_DMA);
-    buf2 = heap_caps_malloc(buf_size, MALLOC_CAP_DMA);
-    assert(buf1 && buf2);
-    
-    lv_disp_draw_buf_init(&disp_buf, buf1, buf2, LCD_H_RES * 40);
-    
-    lv_disp_drv_init(&disp_drv);
-    disp_drv.hor_res = LCD_H_RES;
-    disp_drv.ver_res = LCD_V_RES;
-    disp_drv.flush_cb = lvgl_flush_cb;
-    disp_drv.draw_buf = &disp_buf;
-    lv_disp_drv_register(&disp_drv);
-    
-    const esp_timer_create_args_t periodic_timer_args = {
-        .callback = lv_tick_task,
-        .name = "lv_tick"
-    };
-    esp_timer_handle_t periodic_timer;
-    ESP_ERROR_CHECK(esp_timer_create(&periodic_timer_args, &periodic_timer));
-    ESP_ERROR_CHECK(esp_timer_start_periodic(periodic_timer, 10 * 1000));
-    
-    ESP_LOGI(TAG, "LVGL initialized");
+/* Called from the battery sample timer when the charge moved by a percent. */
+static void on_battery(uint8_t percent) {
+    ui_update_battery(UI_SRC_BATTERY, percent);
+    pgp_ble_set_battery(percent);
 }
 
-static void init_touch(void) {
-    ESP_LOGI(TAG, "Initialize touch");
-    
-    ESP_ERROR_CHECK(cst816_init(TOUCH_I2C_PORT, TOUCH_PIN_SDA, TOUCH_PIN_SCL));
-    
-    static lv_indev_drv_t indev_drv;
-    lv_indev_drv_init(&indev_drv);
-    indev_drv.type = LV_INDEV_TYPE_POINTER;
-    indev_drv.read_cb = lvgl_touch_cb;
-    lv_indev_drv_register(&indev_drv);
-    
-    ESP_LOGI(TAG, "Touch initialized");
+#if CONFIG_PGPEMU_MEM_REPORT_S > 0
+/* Runs in the LVGL task, the only place the LVGL pool may be walked. */
+static void mem_report_timer_cb(lv_timer_t *timer) {
+    ui_mem_stats_t mem;
+    ui_get_mem_stats(&mem);
+    mem_report_note_lvgl(mem.used, mem.peak, mem.total);
+    mem_report_log();
 }
+#endif
 
-static void button_task(void *arg) {
-    gpio_config_t io_conf = {
-        .intr_type = GPIO_INTR_DISABLE,
-        .mode = GPIO_MODE_INPUT,
-        .pin_bit_mask = (1ULL << BUTTON_PIN),
-        .pull_down_en = 0,
-        .pull_up_en = 1,
-    };
-    gpio_config(&io_conf);
-    
-    while (1) {
-        if (gpio_get_level(BUTTON_PIN) == 0) {
-            ESP_LOGI(TAG, "Button pressed");
-            device_connected = !device_connected;
-            ui_update_status(device_connected, false, false);
-            vTaskDelay(pdMS_TO_TICKS(500));
-        }
-        vTaskDelay(pdMS_TO_TICKS(50));
+static void on_lvgl_events(uint32_t events) {
+    if (events & LVGL_SCHED_EVT_POWER) {
+        power_service();
     }
-}
-
-static void lvgl_task(void *arg) {
-    while (1) {
-        vTaskDelay(pdMS_TO_TICKS(10));
-        lv_task_handler();
+    if (events & LVGL_SCHED_EVT_TOUCH) {
+        display_port_touch_event();
     }
-}
-
-static void pgpemu_task(void *arg) {
-    uint32_t last_update = 0;
-    
-    while (1) {
-        if (device_connected && ui_get_autocatch_enabled()) {
-            if (xTaskGetTickCount() - last_update > pdMS_TO_TICKS(5000)) {
-                pokemon_caught++;
-                ui_update_stats(pokemon_caught, pokestops_spun, 95);
-                ui_show_catch_animation(true);
-                last_update = xTaskGetTickCount();
-                ESP_LOGI(TAG, "Caught Pokemon! Total: %lu", (unsigned long)pokemon_caught);
-            }
-        }
-        
-        if (device_connected && ui_get_autospin_enabled()) {
-            if (xTaskGetTickCount() % pdMS_TO_TICKS(7000) == 0) {
-                pokestops_spun++;
-                ui_update_stats(pokemon_caught, pokestops_spun, 94);
-            }
+    if (events & LVGL_SCHED_EVT_UI) {
+        ui_apply_pending();
+    }
+    if (events & LVGL_SCHED_EVT_BUTTON) {
+        switch (atomic_exchange(&nav_request, NAV_NONE)) {
+            case NAV_NEXT:
+                ui_switch_screen((ui_get_screen() + 1) % (UI_SCREEN_STATS + 1));
+                break;
+            case NAV_HOME:
+                ui_switch_screen(UI_SCREEN_MAIN);
+                break;
+            default:
+                break;
         }
-        
-        vTaskDelay(pdMS_TO_TICKS(100));
     }
 }
 
 void app_main(void) {
+    boot_time_mark(BOOT_STAGE_APP_MAIN);
     ESP_LOGI(TAG, "PGPemu Display starting...");
     
     esp_err_t ret = nvs_flash_init();
@@ -232,21 +154,97 @@ void app_main(void) {
         ret = nvs_flash_init();
     }
     ESP_ERROR_CHECK(ret);
+
+    button_config_t button_cfg = BUTTON_CONFIG_DEFAULT(BUTTON_PIN);
+    ESP_ERROR_CHECK(button_init(&button_cfg));
     
-    init_lcd();
-    init_lvgl();
-    init_touch();
-    
+    persist_config_t persist_cfg = PERSIST_CONFIG_DEFAULT();
+    if (persist_init(&persist_cfg) != ESP_OK) {
+        ESP_LOGW(TAG, "Running without persisted state");
+    }
+    persist_state_t saved;
+    persist_get(&saved);
+
+    /* The settings partition has the counters as of its last batch, the
+     * journal every event up to the last one written; after a power cut the
+     * journal is ahead and the settings catch up from it. */
+    const journal_counters_t seed = { .caught = saved.caught, .spun = saved.spun };
+    if (journal_init(&seed) != ESP_OK) {
+        ESP_LOGW(TAG, "Running without the event journal");
+    }
+    journal_counters_t jc;
+    journal_get_counters(&jc);
+    if (jc.caught > saved.caught || jc.spun > saved.spun) {
+        ESP_LOGW(TAG, "Counters recovered from the journal: %lu caught, %lu spun",
+                 (unsigned long)jc.caught, (unsigned long)jc.spun);
+        persist_set_counters(jc.caught > saved.caught ? jc.caught : saved.caught,
+                             jc.spun > saved.spun ? jc.spun : saved.spun);
+        persist_get(&saved);
+    }
+    journal_append(JOURNAL_EV_BOOT, 0, (uint16_t)esp_reset_reason());
+    stats_history_init(esp_timer_get_time());
+    ESP_LOGI(TAG, "Stats history: %u bytes", (unsigned)stats_history_footprint());
+    boot_time_mark(BOOT_STAGE_NVS);
+
+    display_port_init();
+    display_port_init_touch();
+    display_port_set_activity_cb(on_touch_activity);
+    display_port_set_swipe_cb(ui_navigate);
+    power_config_t power_cfg = POWER_CONFIG_DEFAULT();
+    power_cfg.dim_ms = saved.dim_s * 1000;
+    power_cfg.off_ms = saved.off_s * 1000;
+    ESP_ERROR_CHECK(power_init(&power_cfg));
+    boot_time_mark(BOOT_STAGE_DISPLAY);
+    
+    ui_set_settings(saved.autocatch, saved.autospin);
+    ui_set_settings_cb(persist_set_flags);
+    ui_set_accounts_cb(pgpemu_get_accounts);
+    portal_set_pgp_cbs(pgpemu_get_stats, pgpemu_get_accounts);
     ui_init();
-    ui_update_stats(0, 0, 100);
-    ui_update_status(false, false, false);
-    
+    ui_update_stats(UI_SRC_SYSTEM, saved.caught, saved.spun);
+    ui_update_status(UI_SRC_SYSTEM, false, false, false);
+    battery_set_cb(on_battery);
+    ret = battery_init();
+    if (ret != ESP_OK && ret != ESP_ERR_NOT_SUPPORTED) {
+        ESP_LOGW(TAG, "Running without battery telemetry");
+    }
+    boot_time_mark(BOOT_STAGE_UI);
+
+    /* The LVGL task is not running yet, so the pool can be walked here. */
+    ui_mem_stats_t mem;
+    ui_get_mem_stats(&mem);
+    ESP_LOGI(TAG, "LVGL heap after UI init: %lu used, %lu peak of %lu",
+             (unsigned long)mem.used, (unsigned long)mem.peak, (unsigned long)mem.total);
+    mem_report_note_lvgl(mem.used, mem.peak, mem.total);
+#if CONFIG_PGPEMU_MEM_REPORT_S > 0
+    lv_timer_create(mem_report_timer_cb, CONFIG_PGPEMU_MEM_REPORT_S * 1000U, NULL);
+#endif
+    
+    lvgl_sched_set_event_cb(on_lvgl_events);
+
+    if (pgpemu_init() != ESP_OK) {
+        ESP_LOGE(TAG, "BLE unavailable, PGP emulation disabled");
+        ui_update_connection_status(UI_SRC_SYSTEM, "BLE error");
+    }
+    boot_time_mark(BOOT_STAGE_BLE);
+
     ESP_LOGI(TAG, "Creating tasks...");
     
-    xTaskCreate(lvgl_task, "lvgl", 4096, NULL, 5, NULL);
-    xTaskCreate(button_task, "button", 2048, NULL, 5, NULL);
-    xTaskCreate(pgpemu_task, "pgpemu", 4096, NULL, 5, NULL);
+    mem_task_create(lvgl_sched_task, "lvgl", LVGL_TASK_STACK, NULL, 5, MEM_TASK_BUFS(lvgl_task_mem));
+    mem_task_create(button_task, "button", BUTTON_TASK_STACK, NULL, 5, MEM_TASK_BUFS(button_task_mem));
+    mem_task_create(pgpemu_task, "pgpemu", PGPEMU_TASK_STACK, NULL, 6, MEM_TASK_BUFS(pgpemu_task_mem));
+    boot_time_mark(BOOT_STAGE_TASKS);
+
+    if (console_init() != ESP_OK) {
+        ESP_LOGW(TAG, "Console unavailable");
+    }
     
     ESP_LOGI(TAG, "PGPemu Display ready!");
+
+    /* The first frame goes out from the LVGL task; wait for it so the boot
+     * report covers the whole path to pixels on the panel. */
+    for (int waited = 0; waited < FIRST_FRAME_WAIT_MS && boot_time_us(BOOT_STAGE_FIRST_FLUSH) == 0; waited += 10) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    boot_time_report();
 }
-'@ | Out-File -FilePath "main\main.c" -Encoding UTF8
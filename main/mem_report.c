@@ -0,0 +1,103 @@
+#include "mem_report.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include <string.h>
+
+static const char *TAG = "MEM";
+
+static mem_task_info_t tasks[MEM_REPORT_MAX_TASKS];
+static uint8_t task_count;
+static uint32_t lvgl_used, lvgl_peak, lvgl_total;
+static int64_t lvgl_sampled_us;
+
+/* Creates a task from the caller's static stack and TCB when both are
+ * given (MEM_TASK_BUFS() yields NULLs unless PGPEMU_STATIC_ALLOC is set),
+ * from the heap otherwise, and registers it for the stack report. Stack
+ * sizes are in bytes, as everywhere in ESP-IDF. */
+TaskHandle_t mem_task_create(TaskFunction_t fn, const char *name, uint32_t stack_bytes, void *arg,
+                             UBaseType_t priority, StackType_t *stack, StaticTask_t *tcb) {
+    TaskHandle_t handle = NULL;
+    bool is_static = stack && tcb;
+    if (is_static) {
+        handle = xTaskCreateStatic(fn, name, stack_bytes, arg, priority, stack, tcb);
+    } else if (xTaskCreate(fn, name, stack_bytes, arg, priority, &handle) != pdPASS) {
+        handle = NULL;
+    }
+    if (handle == NULL) {
+        ESP_LOGE(TAG, "Task %s (%lu bytes) not created", name, (unsigned long)stack_bytes);
+        return NULL;
+    }
+    if (task_count < MEM_REPORT_MAX_TASKS) {
+        tasks[task_count++] = (mem_task_info_t){
+            .name = name,
+            .handle = handle,
+            .stack_bytes = stack_bytes,
+            .is_static = is_static,
+        };
+    }
+    return handle;
+}
+
+/* lv_mem_monitor() walks the LVGL pool and may only run in the LVGL task,
+ * so that task samples it and other tasks read the copy. */
+void mem_report_note_lvgl(uint32_t used, uint32_t peak, uint32_t total) {
+    lvgl_used = used;
+    lvgl_peak = peak;
+    lvgl_total = total;
+    lvgl_sampled_us = esp_timer_get_time();
+}
+
+void mem_report_get(mem_report_t *out) {
+    memset(out, 0, sizeof(*out));
+    for (uint8_t i = 0; i < task_count; i++) {
+        out->tasks[i] = tasks[i];
+        out->tasks[i].stack_free_min = (uint32_t)uxTaskGetStackHighWaterMark(tasks[i].handle);
+    }
+    out->task_count = task_count;
+    out->internal_free = (uint32_t)heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    out->internal_free_min = (uint32_t)heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL);
+    out->internal_largest = (uint32_t)heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL);
+    out->dma_free = (uint32_t)heap_caps_get_free_size(MALLOC_CAP_DMA);
+    out->dma_largest = (uint32_t)heap_caps_get_largest_free_block(MALLOC_CAP_DMA);
+    out->lvgl_used = lvgl_used;
+    out->lvgl_peak = lvgl_peak;
+    out->lvgl_total = lvgl_total;
+    out->lvgl_sampled_us = lvgl_sampled_us;
+}
+
+void mem_report_print(FILE *out) {
+    mem_report_t r;
+    mem_report_get(&r);
+    for (uint8_t i = 0; i < r.task_count; i++) {
+        const mem_task_info_t *t = &r.tasks[i];
+        fprintf(out, "task %-8s stack %5lu, peak use %5lu, free min %5lu (%s)\n", t->name,
+                (unsigned long)t->stack_bytes, (unsigned long)(t->stack_bytes - t->stack_free_min),
+                (unsigned long)t->stack_free_min, t->is_static ? "static" : "heap");
+    }
+    fprintf(out, "internal: %lu free, %lu min free, %lu largest block\n", (unsigned long)r.internal_free,
+            (unsigned long)r.internal_free_min, (unsigned long)r.internal_largest);
+    fprintf(out, "dma: %lu free, %lu largest block\n", (unsigned long)r.dma_free,
+            (unsigned long)r.dma_largest);
+    fprintf(out, "lvgl: %lu used, %lu peak of %lu (sampled %lld s ago)\n", (unsigned long)r.lvgl_used,
+            (unsigned long)r.lvgl_peak, (unsigned long)r.lvgl_total,
+            (long long)((esp_timer_get_time() - r.lvgl_sampled_us) / 1000000));
+}
+
+/* The periodic one-line form; the stack with the least headroom is the one
+ * worth a look. */
+void mem_report_log(void) {
+    mem_report_t r;
+    mem_report_get(&r);
+    const mem_task_info_t *tight = NULL;
+    for (uint8_t i = 0; i < r.task_count; i++) {
+        if (!tight || r.tasks[i].stack_free_min < tight->stack_free_min) {
+            tight = &r.tasks[i];
+        }
+    }
+    ESP_LOGI(TAG, "heap %lu free (min %lu, block %lu), dma block %lu, lvgl %lu/%lu peak %lu, "
+             "tightest stack %s %lu free", (unsigned long)r.internal_free, (unsigned long)r.internal_free_min,
+             (unsigned long)r.internal_largest, (unsigned long)r.dma_largest, (unsigned long)r.lvgl_used,
+             (unsigned long)r.lvgl_total, (unsigned long)r.lvgl_peak, tight ? tight->name : "-",
+             tight ? (unsigned long)tight->stack_free_min : 0UL);
+}
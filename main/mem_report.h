@@ -0,0 +1,45 @@
+#ifndef MEM_REPORT_H
+#define MEM_REPORT_H
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+#define MEM_REPORT_MAX_TASKS 8
+typedef struct {
+    const char *name;
+    TaskHandle_t handle;
+    uint32_t stack_bytes;
+    uint32_t stack_free_min;
+    bool is_static;
+} mem_task_info_t;
+typedef struct {
+    mem_task_info_t tasks[MEM_REPORT_MAX_TASKS];
+    uint8_t task_count;
+    uint32_t internal_free;
+    uint32_t internal_free_min;
+    uint32_t internal_largest;
+    uint32_t dma_free;
+    uint32_t dma_largest;
+    uint32_t lvgl_used;
+    uint32_t lvgl_peak;
+    uint32_t lvgl_total;
+    int64_t lvgl_sampled_us;
+} mem_report_t;
+#if CONFIG_PGPEMU_STATIC_ALLOC
+#define MEM_TASK_STORAGE(name, bytes) \
+    static StackType_t name##_stack[bytes]; \
+    static StaticTask_t name##_tcb
+#define MEM_TASK_BUFS(name) name##_stack, &name##_tcb
+#else
+#define MEM_TASK_STORAGE(name, bytes) extern char name##_stack_unused
+#define MEM_TASK_BUFS(name) NULL, NULL
+#endif
+TaskHandle_t mem_task_create(TaskFunction_t fn, const char *name, uint32_t stack_bytes, void *arg,
+                             UBaseType_t priority, StackType_t *stack, StaticTask_t *tcb);
+void mem_report_note_lvgl(uint32_t used, uint32_t peak, uint32_t total);
+void mem_report_get(mem_report_t *out);
+void mem_report_print(FILE *out);
+void mem_report_log(void);
+#endif
@@ -0,0 +1,279 @@
+#include "persist.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_system.h"
+#include "nvs.h"
+#include "nvs_flash.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "mem_report.h"
+#include <stdatomic.h>
+
+static const char *TAG = "PERSIST";
+
+#define PERSIST_PARTITION   "settings"
+#define PERSIST_NAMESPACE   "pgpemu"
+#define PERSIST_TASK_STACK  2560
+
+static persist_config_t cfg;
+static nvs_handle_t handle;
+static bool opened = false;
+static SemaphoreHandle_t lock = NULL;
+static persist_state_t live;
+static persist_state_t stored;
+static uint32_t pending_changes;
+static atomic_bool flush_requested;
+static esp_timer_handle_t flush_timer = NULL;
+static TaskHandle_t persist_task_handle = NULL;
+static persist_stats_t stats;
+MEM_TASK_STORAGE(persist_task_mem, PERSIST_TASK_STACK);
+
+static void load(void) {
+    uint32_t v32;
+    uint8_t v8;
+
+    live.caught = nvs_get_u32(handle, "caught", &v32) == ESP_OK ? v32 : 0;
+    live.spun = nvs_get_u32(handle, "spun", &v32) == ESP_OK ? v32 : 0;
+    live.autocatch = nvs_get_u8(handle, "autocatch", &v8) == ESP_OK ? v8 != 0 : true;
+    live.autospin = nvs_get_u8(handle, "autospin", &v8) == ESP_OK ? v8 != 0 : true;
+    live.dim_s = nvs_get_u32(handle, "dim_s", &v32) == ESP_OK ? v32 : CONFIG_PGPEMU_DIM_TIMEOUT_S;
+    live.off_s = nvs_get_u32(handle, "off_s", &v32) == ESP_OK ? v32 : CONFIG_PGPEMU_SLEEP_TIMEOUT_S;
+    stored = live;
+}
+
+void persist_request_flush(void) {
+    atomic_store(&flush_requested, true);
+    if (persist_task_handle) {
+        xTaskNotify(persist_task_handle, 1, eSetBits);
+    }
+}
+
+static void flush_timer_cb(void *arg) {
+    persist_request_flush();
+}
+
+/* Counts one logical change. The first change of a batch arms the period
+ * timer; reaching batch_changes flushes straight away. Either way the NVS
+ * write happens in the persist task, never in the caller. */
+static void arm_flush_timer(void) {
+    if (cfg.period_ms && flush_timer && !esp_timer_is_active(flush_timer)) {
+        esp_timer_start_once(flush_timer, (uint64_t)cfg.period_ms * 1000);
+    }
+}
+
+static void note_change_locked(void) {
+    stats.changes++;
+    pending_changes++;
+    if (pending_changes >= cfg.batch_changes) {
+        persist_request_flush();
+    } else if (pending_changes == 1) {
+        arm_flush_timer();
+    }
+}
+
+void persist_set_counters(uint32_t caught, uint32_t spun) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    if (caught != live.caught || spun != live.spun) {
+        live.caught = caught;
+        live.spun = spun;
+        note_change_locked();
+    }
+    xSemaphoreGive(lock);
+}
+
+/* Settings are toggled by hand and rarely; they and the display timeouts
+ * skip the batch so a reboot right after changing one does not lose it. */
+void persist_set_flags(bool autocatch, bool autospin) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    bool changed = autocatch != live.autocatch || autospin != live.autospin;
+    live.autocatch = autocatch;
+    live.autospin = autospin;
+    if (changed) {
+        stats.changes++;
+        pending_changes++;
+    }
+    xSemaphoreGive(lock);
+    if (changed) {
+        persist_request_flush();
+    }
+}
+
+void persist_set_timeouts(uint32_t dim_s, uint32_t off_s) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    bool changed = dim_s != live.dim_s || off_s != live.off_s;
+    live.dim_s = dim_s;
+    live.off_s = off_s;
+    if (changed) {
+        stats.changes++;
+        pending_changes++;
+    }
+    xSemaphoreGive(lock);
+    if (changed) {
+        persist_request_flush();
+    }
+}
+
+void persist_get(persist_state_t *state) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    *state = live;
+    xSemaphoreGive(lock);
+}
+
+/* Retires the changes a flush wrote. Whatever is still pending, a failed
+ * batch or changes made while it was written, gets the period timer again
+ * since note_change_locked() only arms it for the first change. */
+static void finish_batch(uint32_t batch, bool written) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    if (written) {
+        pending_changes -= batch;
+    }
+    bool left = pending_changes > 0;
+    xSemaphoreGive(lock);
+    if (left) {
+        arm_flush_timer();
+    }
+}
+
+/* Writes only the keys that differ from what is already on flash, then
+ * commits. NVS appends a 32-byte entry per set, so skipping unchanged keys
+ * is what keeps a batch down to one or two entries. */
+esp_err_t persist_flush(void) {
+    if (!opened) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreTake(lock, portMAX_DELAY);
+    persist_state_t snap = live;
+    uint32_t batch = pending_changes;
+    xSemaphoreGive(lock);
+    if (flush_timer) {
+        esp_timer_stop(flush_timer);
+    }
+
+    int64_t t0 = esp_timer_get_time();
+    esp_err_t err = ESP_OK;
+    uint32_t keys = 0;
+
+    if (err == ESP_OK && snap.caught != stored.caught) {
+        err = nvs_set_u32(handle, "caught", snap.caught);
+        keys++;
+    }
+    if (err == ESP_OK && snap.spun != stored.spun) {
+        err = nvs_set_u32(handle, "spun", snap.spun);
+        keys++;
+    }
+    if (err == ESP_OK && snap.autocatch != stored.autocatch) {
+        err = nvs_set_u8(handle, "autocatch", snap.autocatch);
+        keys++;
+    }
+    if (err == ESP_OK && snap.autospin != stored.autospin) {
+        err = nvs_set_u8(handle, "autospin", snap.autospin);
+        keys++;
+    }
+    if (err == ESP_OK && snap.dim_s != stored.dim_s) {
+        err = nvs_set_u32(handle, "dim_s", snap.dim_s);
+        keys++;
+    }
+    if (err == ESP_OK && snap.off_s != stored.off_s) {
+        err = nvs_set_u32(handle, "off_s", snap.off_s);
+        keys++;
+    }
+    if (keys == 0) {
+        finish_batch(batch, true);
+        return ESP_OK;
+    }
+    if (err == ESP_OK) {
+        err = nvs_commit(handle);
+    }
+
+    uint32_t us = (uint32_t)(esp_timer_get_time() - t0);
+    if (err != ESP_OK) {
+        stats.errors++;
+        ESP_LOGE(TAG, "Flush failed: %s", esp_err_to_name(err));
+        finish_batch(batch, false);
+        return err;
+    }
+    stored = snap;
+    finish_batch(batch, true);
+    stats.commits++;
+    stats.keys_written += keys;
+    stats.commit_us_last = us;
+    stats.commit_us_total += us;
+    if (us > stats.commit_us_max) {
+        stats.commit_us_max = us;
+    }
+    ESP_LOGD(TAG, "Flushed %lu keys in %lu us", (unsigned long)keys, (unsigned long)us);
+    return ESP_OK;
+}
+
+/* Runs a requested flush, if any. Returns true when one was pending. */
+bool persist_service(void) {
+    if (!atomic_exchange(&flush_requested, false)) {
+        return false;
+    }
+    persist_flush();
+    return true;
+}
+
+static void persist_task(void *arg) {
+    uint32_t bits;
+    while (1) {
+        xTaskNotifyWait(0, UINT32_MAX, &bits, portMAX_DELAY);
+        persist_service();
+    }
+}
+
+static void persist_shutdown(void) {
+    persist_flush();
+}
+
+esp_err_t persist_init(const persist_config_t *config) {
+    cfg = *config;
+    if (cfg.batch_changes == 0) {
+        cfg.batch_changes = 1;
+    }
+    lock = xSemaphoreCreateMutex();
+    if (lock == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t err = nvs_flash_init_partition(PERSIST_PARTITION);
+    if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        ESP_LOGW(TAG, "Erasing %s partition", PERSIST_PARTITION);
+        ESP_ERROR_CHECK(nvs_flash_erase_partition(PERSIST_PARTITION));
+        err = nvs_flash_init_partition(PERSIST_PARTITION);
+    }
+    if (err == ESP_OK) {
+        err = nvs_open_from_partition(PERSIST_PARTITION, PERSIST_NAMESPACE, NVS_READWRITE, &handle);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Settings partition unavailable: %s", esp_err_to_name(err));
+        live = (persist_state_t){
+            .autocatch = true,
+            .autospin = true,
+            .dim_s = CONFIG_PGPEMU_DIM_TIMEOUT_S,
+            .off_s = CONFIG_PGPEMU_SLEEP_TIMEOUT_S,
+        };
+        stored = live;
+        return err;
+    }
+    opened = true;
+    load();
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = flush_timer_cb,
+        .name = "persist",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &flush_timer));
+    persist_task_handle = mem_task_create(persist_task, "persist", PERSIST_TASK_STACK, NULL, 2,
+                                          MEM_TASK_BUFS(persist_task_mem));
+    esp_register_shutdown_handler(persist_shutdown);
+
+    ESP_LOGI(TAG, "Loaded: %lu caught, %lu spun, catch %s, spin %s", (unsigned long)live.caught,
+             (unsigned long)live.spun, live.autocatch ? "on" : "off", live.autospin ? "on" : "off");
+    return ESP_OK;
+}
+
+void persist_get_stats(persist_stats_t *out) {
+    *out = stats;
+}
@@ -0,0 +1,41 @@
+#ifndef PERSIST_H
+#define PERSIST_H
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+typedef struct {
+    uint32_t caught;
+    uint32_t spun;
+    bool autocatch;
+    bool autospin;
+    uint32_t dim_s;
+    uint32_t off_s;
+} persist_state_t;
+typedef struct {
+    uint32_t batch_changes;
+    uint32_t period_ms;
+} persist_config_t;
+typedef struct {
+    uint32_t changes;
+    uint32_t commits;
+    uint32_t keys_written;
+    uint32_t commit_us_last;
+    uint32_t commit_us_max;
+    uint64_t commit_us_total;
+    uint32_t errors;
+} persist_stats_t;
+#define PERSIST_CONFIG_DEFAULT() { \
+    .batch_changes = CONFIG_PGPEMU_PERSIST_BATCH, \
+    .period_ms = CONFIG_PGPEMU_PERSIST_PERIOD_S * 1000, \
+}
+esp_err_t persist_init(const persist_config_t *config);
+void persist_get(persist_state_t *state);
+void persist_set_counters(uint32_t caught, uint32_t spun);
+void persist_set_flags(bool autocatch, bool autospin);
+void persist_set_timeouts(uint32_t dim_s, uint32_t off_s);
+void persist_request_flush(void);
+bool persist_service(void);
+esp_err_t persist_flush(void);
+void persist_get_stats(persist_stats_t *stats);
+#endif
@@ -0,0 +1,473 @@
+#include "pgp_ble.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_bt.h"
+#include "esp_bt_main.h"
+#include "esp_gap_ble_api.h"
+#include "esp_gatts_api.h"
+#include "esp_gatt_common_api.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "sdkconfig.h"
+#include <string.h>
+
+static const char *TAG = "PGP_BLE";
+
+#define PGP_DEVICE_NAME     "Pokemon GO Plus"
+#define PGP_APP_ID          0
+#define PGP_BLE_MAX_PEERS   CONFIG_PGPEMU_MAX_LINKS
+
+/* 128-bit UUIDs, little endian as Bluedroid wants them. The layout is the
+ * one a real Pokemon GO Plus advertises, as dumped in the original pgpemu
+ * project (yohanes/pgpemu):
+ *   device control  21c50462-67cb-63a3-5c4c-82b5b9939aeb
+ *     LED/vibrate   ...9aec (write)
+ *     button        ...9aed (notify)
+ *   certificate     bbe87709-5b89-4433-ab7f-8b8eef0d8e37
+ *     central->SFIDA  ...8e38 (write)
+ *     SFIDA commands  ...8e39 (notify)
+ *     SFIDA->central  ...8e3a (read) */
+static const uint8_t uuid_ctrl_svc[16] = {
+    0xeb, 0x9a, 0x93, 0xb9, 0xb5, 0x82, 0x4c, 0x5c, 0xa3, 0x63, 0xcb, 0x67, 0x62, 0x04, 0xc5, 0x21 };
+static const uint8_t uuid_led[16] = {
+    0xec, 0x9a, 0x93, 0xb9, 0xb5, 0x82, 0x4c, 0x5c, 0xa3, 0x63, 0xcb, 0x67, 0x62, 0x04, 0xc5, 0x21 };
+static const uint8_t uuid_button[16] = {
+    0xed, 0x9a, 0x93, 0xb9, 0xb5, 0x82, 0x4c, 0x5c, 0xa3, 0x63, 0xcb, 0x67, 0x62, 0x04, 0xc5, 0x21 };
+static const uint8_t uuid_cert_svc[16] = {
+    0x37, 0x8e, 0x0d, 0xef, 0x8e, 0x8b, 0x7f, 0xab, 0x33, 0x44, 0x89, 0x5b, 0x09, 0x77, 0xe8, 0xbb };
+static const uint8_t uuid_cert_c2s[16] = {
+    0x38, 0x8e, 0x0d, 0xef, 0x8e, 0x8b, 0x7f, 0xab, 0x33, 0x44, 0x89, 0x5b, 0x09, 0x77, 0xe8, 0xbb };
+static const uint8_t uuid_cert_cmd[16] = {
+    0x39, 0x8e, 0x0d, 0xef, 0x8e, 0x8b, 0x7f, 0xab, 0x33, 0x44, 0x89, 0x5b, 0x09, 0x77, 0xe8, 0xbb };
+static const uint8_t uuid_cert_s2c[16] = {
+    0x3a, 0x8e, 0x0d, 0xef, 0x8e, 0x8b, 0x7f, 0xab, 0x33, 0x44, 0x89, 0x5b, 0x09, 0x77, 0xe8, 0xbb };
+
+static const uint16_t uuid_primary_svc = ESP_GATT_UUID_PRI_SERVICE;
+static const uint16_t uuid_char_decl = ESP_GATT_UUID_CHAR_DECLARE;
+static const uint16_t uuid_cccd = ESP_GATT_UUID_CHAR_CLIENT_CONFIG;
+static const uint16_t uuid_battery_svc = ESP_GATT_UUID_BATTERY_SERVICE_SVC;
+static const uint16_t uuid_battery_level = ESP_GATT_UUID_BATTERY_LEVEL;
+
+static const uint8_t prop_write = ESP_GATT_CHAR_PROP_BIT_WRITE;
+static const uint8_t prop_read_notify = ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_NOTIFY;
+static const uint8_t prop_notify = ESP_GATT_CHAR_PROP_BIT_NOTIFY;
+static const uint8_t prop_read = ESP_GATT_CHAR_PROP_BIT_READ;
+
+enum {
+    CTRL_IDX_SVC,
+    CTRL_IDX_LED_CHAR,
+    CTRL_IDX_LED_VAL,
+    CTRL_IDX_BTN_CHAR,
+    CTRL_IDX_BTN_VAL,
+    CTRL_IDX_BTN_CCCD,
+    CTRL_IDX_COUNT,
+};
+
+enum {
+    CERT_IDX_SVC,
+    CERT_IDX_C2S_CHAR,
+    CERT_IDX_C2S_VAL,
+    CERT_IDX_CMD_CHAR,
+    CERT_IDX_CMD_VAL,
+    CERT_IDX_CMD_CCCD,
+    CERT_IDX_S2C_CHAR,
+    CERT_IDX_S2C_VAL,
+    CERT_IDX_COUNT,
+};
+
+enum {
+    BAT_IDX_SVC,
+    BAT_IDX_LEVEL_CHAR,
+    BAT_IDX_LEVEL_VAL,
+    BAT_IDX_LEVEL_CCCD,
+    BAT_IDX_COUNT,
+};
+
+static uint8_t led_value[PGP_LED_MAX_LEN];
+static uint8_t button_value[2];
+static uint8_t cert_value[20];
+static uint8_t battery_level = 100;
+static uint8_t cccd_default[2];
+
+#define ATTR(uuid_len, uuid, perm, max, len, val) \
+    { { ESP_GATT_AUTO_RSP }, { (uuid_len), (uint8_t *)(uuid), (perm), (max), (len), (uint8_t *)(val) } }
+
+static const esp_gatts_attr_db_t ctrl_db[CTRL_IDX_COUNT] = {
+    [CTRL_IDX_SVC] = ATTR(ESP_UUID_LEN_16, &uuid_primary_svc, ESP_GATT_PERM_READ,
+                          sizeof(uuid_ctrl_svc), sizeof(uuid_ctrl_svc), uuid_ctrl_svc),
+    [CTRL_IDX_LED_CHAR] = ATTR(ESP_UUID_LEN_16, &uuid_char_decl, ESP_GATT_PERM_READ, 1, 1, &prop_write),
+    [CTRL_IDX_LED_VAL] = ATTR(ESP_UUID_LEN_128, uuid_led, ESP_GATT_PERM_WRITE,
+                              sizeof(led_value), 0, led_value),
+    [CTRL_IDX_BTN_CHAR] = ATTR(ESP_UUID_LEN_16, &uuid_char_decl, ESP_GATT_PERM_READ, 1, 1, &prop_read_notify),
+    [CTRL_IDX_BTN_VAL] = ATTR(ESP_UUID_LEN_128, uuid_button, ESP_GATT_PERM_READ,
+                              sizeof(button_value), sizeof(button_value), button_value),
+    [CTRL_IDX_BTN_CCCD] = ATTR(ESP_UUID_LEN_16, &uuid_cccd, ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE,
+                               2, 2, cccd_default),
+};
+
+static const esp_gatts_attr_db_t cert_db[CERT_IDX_COUNT] = {
+    [CERT_IDX_SVC] = ATTR(ESP_UUID_LEN_16, &uuid_primary_svc, ESP_GATT_PERM_READ,
+                          sizeof(uuid_cert_svc), sizeof(uuid_cert_svc), uuid_cert_svc),
+    [CERT_IDX_C2S_CHAR] = ATTR(ESP_UUID_LEN_16, &uuid_char_decl, ESP_GATT_PERM_READ, 1, 1, &prop_write),
+    [CERT_IDX_C2S_VAL] = ATTR(ESP_UUID_LEN_128, uuid_cert_c2s, ESP_GATT_PERM_WRITE,
+                              sizeof(cert_value), 0, cert_value),
+    [CERT_IDX_CMD_CHAR] = ATTR(ESP_UUID_LEN_16, &uuid_char_decl, ESP_GATT_PERM_READ, 1, 1, &prop_notify),
+    [CERT_IDX_CMD_VAL] = ATTR(ESP_UUID_LEN_128, uuid_cert_cmd, ESP_GATT_PERM_READ,
+                              sizeof(cert_value), 0, cert_value),
+    [CERT_IDX_CMD_CCCD] = ATTR(ESP_UUID_LEN_16, &uuid_cccd, ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE,
+                               2, 2, cccd_default),
+    [CERT_IDX_S2C_CHAR] = ATTR(ESP_UUID_LEN_16, &uuid_char_decl, ESP_GATT_PERM_READ, 1, 1, &prop_read),
+    [CERT_IDX_S2C_VAL] = ATTR(ESP_UUID_LEN_128, uuid_cert_s2c, ESP_GATT_PERM_READ,
+                              sizeof(cert_value), 0, cert_value),
+};
+
+static const esp_gatts_attr_db_t battery_db[BAT_IDX_COUNT] = {
+    [BAT_IDX_SVC] = ATTR(ESP_UUID_LEN_16, &uuid_primary_svc, ESP_GATT_PERM_READ,
+                         sizeof(uuid_battery_svc), sizeof(uuid_battery_svc), &uuid_battery_svc),
+    [BAT_IDX_LEVEL_CHAR] = ATTR(ESP_UUID_LEN_16, &uuid_char_decl, ESP_GATT_PERM_READ, 1, 1, &prop_read_notify),
+    [BAT_IDX_LEVEL_VAL] = ATTR(ESP_UUID_LEN_16, &uuid_battery_level, ESP_GATT_PERM_READ, 1, 1, &battery_level),
+    [BAT_IDX_LEVEL_CCCD] = ATTR(ESP_UUID_LEN_16, &uuid_cccd, ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE,
+                                2, 2, cccd_default),
+};
+
+static uint16_t ctrl_handles[CTRL_IDX_COUNT];
+static uint16_t cert_handles[CERT_IDX_COUNT];
+static uint16_t battery_handles[BAT_IDX_COUNT];
+
+/* One entry per connected central. Notification enables are per client,
+ * so each phone has to turn on button notifications itself. The BT task
+ * adds and removes entries while the pgpemu task and the battery timer
+ * walk them, so every access goes through peers_lock. */
+typedef struct {
+    bool used;
+    uint16_t conn_id;
+    esp_bd_addr_t bda;
+    bool button_notify;
+    bool battery_notify;
+} pgp_peer_t;
+
+static pgp_ble_evt_cb_t evt_cb = NULL;
+static esp_gatt_if_t gatts_if_app = ESP_GATT_IF_NONE;
+static SemaphoreHandle_t peers_lock = NULL;
+static pgp_peer_t peers[PGP_BLE_MAX_PEERS];
+static uint8_t peer_count;
+static bool advertising = false;
+static uint8_t adv_config_pending;
+
+#define ADV_CONFIG_FLAG     (1 << 0)
+#define SCAN_RSP_FLAG       (1 << 1)
+
+static esp_ble_adv_params_t adv_params = {
+    .adv_int_min = 0x20,
+    .adv_int_max = 0x40,
+    .adv_type = ADV_TYPE_IND,
+    .own_addr_type = BLE_ADDR_TYPE_PUBLIC,
+    .channel_map = ADV_CHNL_ALL,
+    .adv_filter_policy = ADV_FILTER_ALLOW_SCAN_ANY_CON_ANY,
+};
+
+static esp_ble_adv_data_t adv_data = {
+    .set_scan_rsp = false,
+    .include_name = true,
+    .include_txpower = false,
+    .appearance = 0x00,
+    .flag = ESP_BLE_ADV_FLAG_GEN_DISC | ESP_BLE_ADV_FLAG_BREDR_NOT_SPT,
+};
+
+static esp_ble_adv_data_t scan_rsp_data = {
+    .set_scan_rsp = true,
+    .include_name = false,
+    .service_uuid_len = sizeof(uuid_ctrl_svc),
+    .p_service_uuid = (uint8_t *)uuid_ctrl_svc,
+    .flag = ESP_BLE_ADV_FLAG_GEN_DISC | ESP_BLE_ADV_FLAG_BREDR_NOT_SPT,
+};
+
+static void post(pgp_ble_evt_type_t type, uint16_t conn_id, const uint8_t *data, uint16_t len) {
+    if (evt_cb == NULL) {
+        return;
+    }
+    pgp_ble_evt_t evt = {
+        .type = type,
+        .conn_id = conn_id,
+        .time_us = esp_timer_get_time(),
+    };
+    if (data) {
+        evt.len = len < sizeof(evt.data) ? len : sizeof(evt.data);
+        memcpy(evt.data, data, evt.len);
+    }
+    evt_cb(&evt);
+}
+
+static pgp_peer_t *find_peer(uint16_t conn_id) {
+    for (int i = 0; i < PGP_BLE_MAX_PEERS; i++) {
+        if (peers[i].used && peers[i].conn_id == conn_id) {
+            return &peers[i];
+        }
+    }
+    return NULL;
+}
+
+static pgp_peer_t *add_peer(uint16_t conn_id, const esp_bd_addr_t bda) {
+    for (int i = 0; i < PGP_BLE_MAX_PEERS; i++) {
+        if (!peers[i].used) {
+            peers[i] = (pgp_peer_t){ .used = true, .conn_id = conn_id };
+            memcpy(peers[i].bda, bda, sizeof(esp_bd_addr_t));
+            peer_count++;
+            return &peers[i];
+        }
+    }
+    return NULL;
+}
+
+static void remove_peer(pgp_peer_t *peer) {
+    peer->used = false;
+    peer_count--;
+}
+
+static void gap_event_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param) {
+    switch (event) {
+        case ESP_GAP_BLE_ADV_DATA_SET_COMPLETE_EVT:
+            adv_config_pending &= ~ADV_CONFIG_FLAG;
+            if (adv_config_pending == 0) {
+                pgp_ble_start_advertising();
+            }
+            break;
+        case ESP_GAP_BLE_SCAN_RSP_DATA_SET_COMPLETE_EVT:
+            adv_config_pending &= ~SCAN_RSP_FLAG;
+            if (adv_config_pending == 0) {
+                pgp_ble_start_advertising();
+            }
+            break;
+        case ESP_GAP_BLE_ADV_START_COMPLETE_EVT:
+            advertising = param->adv_start_cmpl.status == ESP_BT_STATUS_SUCCESS;
+            if (!advertising) {
+                ESP_LOGE(TAG, "Advertising start failed: %d", param->adv_start_cmpl.status);
+            }
+            break;
+        case ESP_GAP_BLE_ADV_STOP_COMPLETE_EVT:
+            advertising = false;
+            break;
+        default:
+            break;
+    }
+}
+
+static void handle_write(esp_ble_gatts_cb_param_t *param) {
+    uint16_t h = param->write.handle;
+
+    if (h == ctrl_handles[CTRL_IDX_LED_VAL]) {
+        post(PGP_BLE_EVT_LED, param->write.conn_id, param->write.value, param->write.len);
+    } else if ((h == ctrl_handles[CTRL_IDX_BTN_CCCD] || h == battery_handles[BAT_IDX_LEVEL_CCCD]) &&
+               param->write.len == 2) {
+        xSemaphoreTake(peers_lock, portMAX_DELAY);
+        pgp_peer_t *peer = find_peer(param->write.conn_id);
+        if (peer && h == ctrl_handles[CTRL_IDX_BTN_CCCD]) {
+            peer->button_notify = param->write.value[0] & 0x01;
+        } else if (peer) {
+            peer->battery_notify = param->write.value[0] & 0x01;
+        }
+        xSemaphoreGive(peers_lock);
+    } else if (h == cert_handles[CERT_IDX_C2S_VAL]) {
+        post(PGP_BLE_EVT_CERT, param->write.conn_id, param->write.value, param->write.len);
+    }
+}
+
+static void store_handles(esp_ble_gatts_cb_param_t *param) {
+    const struct gatts_add_attr_tab_evt_param *tab = &param->add_attr_tab;
+    uint16_t *dst = NULL;
+    size_t count = 0;
+
+    if (tab->status != ESP_GATT_OK) {
+        ESP_LOGE(TAG, "Attribute table create failed: 0x%x", tab->status);
+        return;
+    }
+    if (tab->svc_inst_id == 0) {
+        dst = ctrl_handles;
+        count = CTRL_IDX_COUNT;
+    } else if (tab->svc_inst_id == 1) {
+        dst = cert_handles;
+        count = CERT_IDX_COUNT;
+    } else {
+        dst = battery_handles;
+        count = BAT_IDX_COUNT;
+    }
+    if (tab->num_handle != count) {
+        ESP_LOGE(TAG, "Attribute table %d: %d handles, expected %d", tab->svc_inst_id, tab->num_handle, (int)count);
+        return;
+    }
+    memcpy(dst, tab->handles, count * sizeof(uint16_t));
+    esp_ble_gatts_start_service(dst[0]);
+}
+
+static void gatts_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t *param) {
+    switch (event) {
+        case ESP_GATTS_REG_EVT:
+            if (param->reg.status != ESP_GATT_OK) {
+                ESP_LOGE(TAG, "App register failed: %d", param->reg.status);
+                return;
+            }
+            gatts_if_app = gatts_if;
+            esp_ble_gap_set_device_name(PGP_DEVICE_NAME);
+            adv_config_pending = ADV_CONFIG_FLAG | SCAN_RSP_FLAG;
+            esp_ble_gap_config_adv_data(&adv_data);
+            esp_ble_gap_config_adv_data(&scan_rsp_data);
+            esp_ble_gatts_create_attr_tab(ctrl_db, gatts_if, CTRL_IDX_COUNT, 0);
+            esp_ble_gatts_create_attr_tab(cert_db, gatts_if, CERT_IDX_COUNT, 1);
+            esp_ble_gatts_create_attr_tab(battery_db, gatts_if, BAT_IDX_COUNT, 2);
+            break;
+        case ESP_GATTS_CREAT_ATTR_TAB_EVT:
+            store_handles(param);
+            break;
+        case ESP_GATTS_CONNECT_EVT: {
+            /* Advertising stops on every connection; it is restarted below
+             * while there is room for another phone. */
+            advertising = false;
+            xSemaphoreTake(peers_lock, portMAX_DELAY);
+            pgp_peer_t *peer = add_peer(param->connect.conn_id, param->connect.remote_bda);
+            xSemaphoreGive(peers_lock);
+            if (peer == NULL) {
+                ESP_LOGW(TAG, "No room for conn %u", param->connect.conn_id);
+                esp_ble_gap_disconnect(param->connect.remote_bda);
+                break;
+            }
+            /* Short interval so LED writes and button notifications are not
+             * held back by the link: 7.5-15 ms, no slave latency. */
+            esp_ble_conn_update_params_t conn_params = {
+                .min_int = 0x06,
+                .max_int = 0x0C,
+                .latency = 0,
+                .timeout = 400,
+            };
+            memcpy(conn_params.bda, param->connect.remote_bda, sizeof(esp_bd_addr_t));
+            esp_ble_gap_update_conn_params(&conn_params);
+            post(PGP_BLE_EVT_CONNECTED, param->connect.conn_id, param->connect.remote_bda,
+                 sizeof(esp_bd_addr_t));
+            pgp_ble_start_advertising();
+            break;
+        }
+        case ESP_GATTS_DISCONNECT_EVT: {
+            /* A peer dropped with pgp_ble_disconnect() is already gone and
+             * was never served, so only its slot comes back here. */
+            xSemaphoreTake(peers_lock, portMAX_DELAY);
+            pgp_peer_t *peer = find_peer(param->disconnect.conn_id);
+            if (peer) {
+                remove_peer(peer);
+            }
+            xSemaphoreGive(peers_lock);
+            if (peer) {
+                post(PGP_BLE_EVT_DISCONNECTED, param->disconnect.conn_id, NULL, 0);
+            }
+            pgp_ble_start_advertising();
+            break;
+        }
+        case ESP_GATTS_WRITE_EVT:
+            if (!param->write.is_prep) {
+                handle_write(param);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+esp_err_t pgp_ble_init(pgp_ble_evt_cb_t cb) {
+    evt_cb = cb;
+    peers_lock = xSemaphoreCreateMutex();
+    if (peers_lock == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_bt_controller_config_t bt_cfg = BT_CONTROLLER_INIT_CONFIG_DEFAULT();
+    esp_err_t err = esp_bt_controller_init(&bt_cfg);
+    if (err == ESP_OK) {
+        err = esp_bt_controller_enable(ESP_BT_MODE_BLE);
+    }
+    if (err == ESP_OK) {
+        err = esp_bluedroid_init();
+    }
+    if (err == ESP_OK) {
+        err = esp_bluedroid_enable();
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Bluetooth init failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    ESP_ERROR_CHECK(esp_ble_gap_register_callback(gap_event_handler));
+    ESP_ERROR_CHECK(esp_ble_gatts_register_callback(gatts_event_handler));
+    ESP_ERROR_CHECK(esp_ble_gatts_app_register(PGP_APP_ID));
+    esp_ble_gatt_set_local_mtu(128);
+
+    ESP_LOGI(TAG, "BLE initialized");
+    return ESP_OK;
+}
+
+esp_err_t pgp_ble_start_advertising(void) {
+    if (peer_count >= PGP_BLE_MAX_PEERS || advertising) {
+        return ESP_OK;
+    }
+    return esp_ble_gap_start_advertising(&adv_params);
+}
+
+/* One press of the PGP button, as the real accessory reports it. */
+esp_err_t pgp_ble_send_button(uint16_t conn_id) {
+    static const uint8_t press[2] = { 0x03, 0x00 };
+    xSemaphoreTake(peers_lock, portMAX_DELAY);
+    const pgp_peer_t *peer = find_peer(conn_id);
+    bool notify = peer != NULL && peer->button_notify;
+    xSemaphoreGive(peers_lock);
+    if (!notify) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return esp_ble_gatts_send_indicate(gatts_if_app, conn_id, ctrl_handles[CTRL_IDX_BTN_VAL],
+                                       sizeof(press), (uint8_t *)press, false);
+}
+
+esp_err_t pgp_ble_set_battery(uint8_t percent) {
+    battery_level = percent;
+    if (battery_handles[BAT_IDX_LEVEL_VAL] == 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_ble_gatts_set_attr_value(battery_handles[BAT_IDX_LEVEL_VAL], 1, &battery_level);
+
+    /* Runs in the esp_timer task. The notifications go out after the lock
+     * is dropped so the BT task is never kept waiting on a queue post. */
+    uint16_t conn_ids[PGP_BLE_MAX_PEERS];
+    int n = 0;
+    xSemaphoreTake(peers_lock, portMAX_DELAY);
+    for (int i = 0; i < PGP_BLE_MAX_PEERS; i++) {
+        if (peers[i].used && peers[i].battery_notify) {
+            conn_ids[n++] = peers[i].conn_id;
+        }
+    }
+    xSemaphoreGive(peers_lock);
+
+    esp_err_t err = ESP_OK;
+    for (int i = 0; i < n; i++) {
+        esp_err_t e = esp_ble_gatts_send_indicate(gatts_if_app, conn_ids[i], battery_handles[BAT_IDX_LEVEL_VAL], 1,
+                                                  &battery_level, false);
+        err = err == ESP_OK ? e : err;
+    }
+    return err;
+}
+
+/* Drops a central the link table refused. It leaves the peer list at once,
+ * so its slot is free and it gets no notifications while the link closes. */
+esp_err_t pgp_ble_disconnect(uint16_t conn_id) {
+    esp_bd_addr_t bda;
+    xSemaphoreTake(peers_lock, portMAX_DELAY);
+    pgp_peer_t *peer = find_peer(conn_id);
+    if (peer) {
+        memcpy(bda, peer->bda, sizeof(esp_bd_addr_t));
+        remove_peer(peer);
+    }
+    xSemaphoreGive(peers_lock);
+    if (peer == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    return esp_ble_gap_disconnect(bda);
+}
+
+bool pgp_ble_is_advertising(void) {
+    return advertising;
+}
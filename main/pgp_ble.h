@@ -0,0 +1,27 @@
+#ifndef PGP_BLE_H
+#define PGP_BLE_H
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "pgp_proto.h"
+typedef enum {
+    PGP_BLE_EVT_CONNECTED = 0,
+    PGP_BLE_EVT_DISCONNECTED,
+    PGP_BLE_EVT_LED,
+    PGP_BLE_EVT_CERT,
+} pgp_ble_evt_type_t;
+typedef struct {
+    pgp_ble_evt_type_t type;
+    uint16_t conn_id;
+    uint16_t len;
+    int64_t time_us;
+    uint8_t data[PGP_LED_MAX_LEN];
+} pgp_ble_evt_t;
+typedef void (*pgp_ble_evt_cb_t)(const pgp_ble_evt_t *evt);
+esp_err_t pgp_ble_init(pgp_ble_evt_cb_t cb);
+esp_err_t pgp_ble_start_advertising(void);
+esp_err_t pgp_ble_send_button(uint16_t conn_id);
+esp_err_t pgp_ble_set_battery(uint8_t percent);
+esp_err_t pgp_ble_disconnect(uint16_t conn_id);
+bool pgp_ble_is_advertising(void);
+#endif
@@ -0,0 +1,216 @@
+#include "pgp_link.h"
+#include <string.h>
+
+/* The table of PGP links the emulator serves at once, one pgp_conn_t
+ * state machine per phone. A link is an account slot keyed by the
+ * central's address: a phone that reconnects gets its slot, flags and
+ * counters back, and a new address takes a free slot or recycles the one
+ * that has been disconnected longest.
+ *
+ * Without bonding a phone that rotates its private address shows up as a
+ * new account; the slot it left is the first to be recycled.
+ *
+ * Presses are sent one at a time, at least press_gap_us apart, since they
+ * share the controller's notification buffers. When several are due the
+ * one that has waited longest goes first, so a link flooding encounters
+ * delays another by at most a gap per busy link and never starves it. */
+
+void pgp_links_init(pgp_links_t *t, uint32_t press_delay_ms, uint32_t press_gap_us) {
+    memset(t, 0, sizeof(*t));
+    t->press_delay_ms = press_delay_ms;
+    t->press_gap_us = press_gap_us;
+    t->last_press_us = INT64_MIN / 2;
+    t->autocatch = true;
+    t->autospin = true;
+}
+
+/* The settings screen toggles, applied on top of each account's own flags. */
+void pgp_links_set_flags(pgp_links_t *t, bool autocatch, bool autospin) {
+    t->autocatch = autocatch;
+    t->autospin = autospin;
+}
+
+bool pgp_links_set_account_flags(pgp_links_t *t, int index, bool allow_catch, bool allow_spin) {
+    if (index < 0 || index >= PGP_LINK_MAX || !t->link[index].used) {
+        return false;
+    }
+    t->link[index].allow_catch = allow_catch;
+    t->link[index].allow_spin = allow_spin;
+    return true;
+}
+
+static int find_addr(const pgp_links_t *t, const uint8_t *addr) {
+    for (int i = 0; i < PGP_LINK_MAX; i++) {
+        if (t->link[i].used && memcmp(t->link[i].addr, addr, PGP_LINK_ADDR_LEN) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int take_slot(pgp_links_t *t) {
+    int oldest = -1;
+    for (int i = 0; i < PGP_LINK_MAX; i++) {
+        const pgp_link_t *l = &t->link[i];
+        if (!l->used) {
+            return i;
+        }
+        if (!l->connected && (oldest < 0 || l->seen_us < t->link[oldest].seen_us)) {
+            oldest = i;
+        }
+    }
+    if (oldest >= 0) {
+        t->stats.recycled++;
+        t->link[oldest].used = false;
+    }
+    return oldest;
+}
+
+/* Returns the account slot for the new link, or -1 when every slot holds a
+ * live link. */
+int pgp_links_connect(pgp_links_t *t, uint16_t conn_id, const uint8_t *addr, int64_t now_us) {
+    int i = find_addr(t, addr);
+    if (i < 0) {
+        i = take_slot(t);
+    }
+    if (i < 0) {
+        t->stats.refused++;
+        return -1;
+    }
+    pgp_link_t *l = &t->link[i];
+    if (!l->used) {
+        memset(l, 0, sizeof(*l));
+        l->used = true;
+        l->allow_catch = true;
+        l->allow_spin = true;
+        memcpy(l->addr, addr, PGP_LINK_ADDR_LEN);
+        pgp_conn_init(&l->conn, t->press_delay_ms);
+    } else {
+        pgp_stats_t keep = l->conn.stats;
+        pgp_conn_init(&l->conn, t->press_delay_ms);
+        l->conn.stats = keep;
+    }
+    l->connected = true;
+    l->conn_id = conn_id;
+    l->seen_us = now_us;
+    t->stats.connects++;
+    return i;
+}
+
+int pgp_links_find(const pgp_links_t *t, uint16_t conn_id) {
+    for (int i = 0; i < PGP_LINK_MAX; i++) {
+        if (t->link[i].connected && t->link[i].conn_id == conn_id) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int pgp_links_disconnect(pgp_links_t *t, uint16_t conn_id, int64_t now_us) {
+    int i = pgp_links_find(t, conn_id);
+    if (i >= 0) {
+        t->link[i].connected = false;
+        t->link[i].seen_us = now_us;
+        pgp_conn_cancel_press(&t->link[i].conn);
+    }
+    return i;
+}
+
+uint8_t pgp_links_connected(const pgp_links_t *t) {
+    uint8_t n = 0;
+    for (int i = 0; i < PGP_LINK_MAX; i++) {
+        n += t->link[i].connected;
+    }
+    return n;
+}
+
+pgp_result_t pgp_links_on_led(pgp_links_t *t, int index, const uint8_t *data, size_t len, int64_t now_us) {
+    if (index < 0 || index >= PGP_LINK_MAX || !t->link[index].connected) {
+        return PGP_RESULT_NONE;
+    }
+    pgp_link_t *l = &t->link[index];
+    l->conn.autocatch = t->autocatch && l->allow_catch;
+    l->conn.autospin = t->autospin && l->allow_spin;
+    l->seen_us = now_us;
+    return pgp_conn_on_led(&l->conn, data, len, now_us);
+}
+
+/* Returns the link whose press should be sent now, or -1. */
+int pgp_links_poll(pgp_links_t *t, int64_t now_us) {
+    int due = -1;
+    for (int i = 0; i < PGP_LINK_MAX; i++) {
+        pgp_link_t *l = &t->link[i];
+        if (!l->connected || !pgp_conn_poll(&l->conn, now_us)) {
+            continue;
+        }
+        if (due < 0 || l->conn.press_due_us < t->link[due].conn.press_due_us) {
+            due = i;
+        }
+    }
+    if (due < 0 || now_us - t->last_press_us < (int64_t)t->press_gap_us) {
+        return -1;
+    }
+    return due;
+}
+
+void pgp_links_press_sent(pgp_links_t *t, int index, int64_t now_us) {
+    pgp_conn_t *c = &t->link[index].conn;
+    int64_t late = now_us - c->press_due_us;
+    if (late > 0) {
+        t->stats.deferred++;
+        if (late > t->stats.defer_us_max) {
+            t->stats.defer_us_max = (uint32_t)late;
+        }
+    }
+    pgp_conn_press_sent(c, now_us);
+    t->last_press_us = now_us;
+    t->stats.presses++;
+}
+
+void pgp_links_cancel_press(pgp_links_t *t, int index) {
+    pgp_conn_cancel_press(&t->link[index].conn);
+}
+
+/* The earliest press or result timeout over all live links, with presses
+ * held back to the press gap. */
+int64_t pgp_links_next_deadline(const pgp_links_t *t) {
+    int64_t press = PGP_NO_DEADLINE, other = PGP_NO_DEADLINE;
+    for (int i = 0; i < PGP_LINK_MAX; i++) {
+        const pgp_link_t *l = &t->link[i];
+        if (!l->connected) {
+            continue;
+        }
+        int64_t d = pgp_conn_next_deadline(&l->conn);
+        if (l->conn.state == PGP_ST_PRESS_PENDING) {
+            press = d < press ? d : press;
+        } else {
+            other = d < other ? d : other;
+        }
+    }
+    if (press != PGP_NO_DEADLINE && press < t->last_press_us + (int64_t)t->press_gap_us) {
+        press = t->last_press_us + (int64_t)t->press_gap_us;
+    }
+    return press < other ? press : other;
+}
+
+uint8_t pgp_links_snapshot(const pgp_links_t *t, pgp_account_t *out, uint8_t max) {
+    uint8_t n = 0;
+    for (int i = 0; i < PGP_LINK_MAX && n < max; i++) {
+        const pgp_link_t *l = &t->link[i];
+        if (!l->used) {
+            continue;
+        }
+        pgp_account_t *a = &out[n++];
+        a->slot = (uint8_t)i;
+        memcpy(a->addr, l->addr, PGP_LINK_ADDR_LEN);
+        a->connected = l->connected;
+        a->allow_catch = l->allow_catch;
+        a->allow_spin = l->allow_spin;
+        a->caught = l->conn.stats.caught;
+        a->fled = l->conn.stats.fled;
+        a->spun = l->conn.stats.spun;
+        a->presses = l->conn.stats.presses;
+        a->latency_us_max = l->conn.stats.latency_us_max;
+    }
+    return n;
+}
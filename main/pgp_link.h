@@ -0,0 +1,62 @@
+#ifndef PGP_LINK_H
+#define PGP_LINK_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "pgp_proto.h"
+#include "sdkconfig.h"
+#define PGP_LINK_MAX        CONFIG_PGPEMU_MAX_LINKS
+#define PGP_LINK_ADDR_LEN   6
+typedef struct {
+    bool used;
+    bool connected;
+    bool allow_catch;
+    bool allow_spin;
+    uint8_t addr[PGP_LINK_ADDR_LEN];
+    uint16_t conn_id;
+    int64_t seen_us;
+    pgp_conn_t conn;
+} pgp_link_t;
+typedef struct {
+    uint32_t connects;
+    uint32_t refused;
+    uint32_t recycled;
+    uint32_t presses;
+    uint32_t deferred;
+    uint32_t defer_us_max;
+} pgp_link_stats_t;
+typedef struct {
+    pgp_link_t link[PGP_LINK_MAX];
+    uint32_t press_delay_ms;
+    uint32_t press_gap_us;
+    int64_t last_press_us;
+    bool autocatch;
+    bool autospin;
+    pgp_link_stats_t stats;
+} pgp_links_t;
+typedef struct {
+    uint8_t slot;
+    uint8_t addr[PGP_LINK_ADDR_LEN];
+    bool connected;
+    bool allow_catch;
+    bool allow_spin;
+    uint32_t caught;
+    uint32_t fled;
+    uint32_t spun;
+    uint32_t presses;
+    uint32_t latency_us_max;
+} pgp_account_t;
+void pgp_links_init(pgp_links_t *t, uint32_t press_delay_ms, uint32_t press_gap_us);
+void pgp_links_set_flags(pgp_links_t *t, bool autocatch, bool autospin);
+bool pgp_links_set_account_flags(pgp_links_t *t, int index, bool allow_catch, bool allow_spin);
+int pgp_links_connect(pgp_links_t *t, uint16_t conn_id, const uint8_t *addr, int64_t now_us);
+int pgp_links_disconnect(pgp_links_t *t, uint16_t conn_id, int64_t now_us);
+int pgp_links_find(const pgp_links_t *t, uint16_t conn_id);
+uint8_t pgp_links_connected(const pgp_links_t *t);
+pgp_result_t pgp_links_on_led(pgp_links_t *t, int index, const uint8_t *data, size_t len, int64_t now_us);
+int pgp_links_poll(pgp_links_t *t, int64_t now_us);
+void pgp_links_press_sent(pgp_links_t *t, int index, int64_t now_us);
+void pgp_links_cancel_press(pgp_links_t *t, int index);
+int64_t pgp_links_next_deadline(const pgp_links_t *t);
+uint8_t pgp_links_snapshot(const pgp_links_t *t, pgp_account_t *out, uint8_t max);
+#endif
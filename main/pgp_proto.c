@@ -0,0 +1,213 @@
+#include "pgp_proto.h"
+#include <string.h>
+
+/* How long to wait for the result pattern after a press before the press is
+ * written off and the connection goes back to idle. */
+#define PGP_RESULT_TIMEOUT_US   (15 * 1000000LL)
+
+/* The app writes LED commands as a 3-byte header, one byte holding
+ * priority (bits 7..5) and pattern count (bits 4..0), then three bytes per
+ * pattern: duration in 50 ms units, green<<4 | red, and vibrate<<7 | blue
+ * with each colour channel 4 bits wide. */
+bool pgp_led_parse(const uint8_t *data, size_t len, pgp_led_t *led) {
+    if (len < 4) {
+        return false;
+    }
+    led->priority = data[3] >> 5;
+    led->count = data[3] & 0x1F;
+    if (len < 4 + 3 * (size_t)led->count) {
+        return false;
+    }
+    const uint8_t *p = &data[4];
+    for (int i = 0; i < led->count; i++, p += 3) {
+        led->patterns[i].duration = p[0];
+        led->patterns[i].red = p[1] & 0x0F;
+        led->patterns[i].green = p[1] >> 4;
+        led->patterns[i].blue = p[2] & 0x0F;
+        led->patterns[i].vibrate = (p[2] & 0x80) != 0;
+    }
+    return true;
+}
+
+/* Reduces one lit pattern to a colour class: bit 0 red, bit 1 green,
+ * bit 2 blue. */
+static uint8_t colour_bits(const pgp_led_pattern_t *p) {
+    return (p->red ? 1 : 0) | (p->green ? 2 : 0) | (p->blue ? 4 : 0);
+}
+
+/* The same heuristics the PGP itself is documented to use: green blinks for
+ * a Pokemon, yellow for a new species, blue for a Pokestop, white while the
+ * ball shakes, a multi-colour sequence on success and red when it fled or
+ * the bag or ball stock is full. */
+pgp_led_kind_t pgp_led_classify(const pgp_led_t *led) {
+    uint8_t seen = 0;
+    int distinct = 0;
+    uint8_t classes[8] = { 0 };
+
+    for (int i = 0; i < led->count; i++) {
+        uint8_t c = colour_bits(&led->patterns[i]);
+        if (c == 0) {
+            continue;
+        }
+        if (!classes[c]) {
+            classes[c] = 1;
+            distinct++;
+        }
+        seen |= c;
+    }
+
+    if (distinct == 0) {
+        return PGP_LED_OFF;
+    }
+    if (distinct >= 3) {
+        return PGP_LED_SUCCESS;
+    }
+    if (distinct == 1) {
+        switch (seen) {
+            case 1: return PGP_LED_RED;
+            case 2: return PGP_LED_POKEMON;
+            case 3: return PGP_LED_NEW_POKEMON;
+            case 4: return PGP_LED_POKESTOP;
+            case 7: return PGP_LED_SHAKE;
+            default: return PGP_LED_UNKNOWN;
+        }
+    }
+    /* Two colours: a yellow/green mix is still an encounter. */
+    if ((seen & ~3) == 0) {
+        return PGP_LED_NEW_POKEMON;
+    }
+    return PGP_LED_UNKNOWN;
+}
+
+const char *pgp_led_kind_name(pgp_led_kind_t kind) {
+    static const char *const names[] = {
+        [PGP_LED_OFF] = "off",
+        [PGP_LED_POKEMON] = "pokemon",
+        [PGP_LED_NEW_POKEMON] = "new_pokemon",
+        [PGP_LED_POKESTOP] = "pokestop",
+        [PGP_LED_SHAKE] = "shake",
+        [PGP_LED_SUCCESS] = "success",
+        [PGP_LED_RED] = "red",
+        [PGP_LED_UNKNOWN] = "unknown",
+    };
+    return kind <= PGP_LED_UNKNOWN ? names[kind] : "?";
+}
+
+void pgp_conn_init(pgp_conn_t *conn, uint32_t press_delay_ms) {
+    memset(conn, 0, sizeof(*conn));
+    conn->press_delay_ms = press_delay_ms;
+    conn->autocatch = true;
+    conn->autospin = true;
+    conn->press_due_us = PGP_NO_DEADLINE;
+    conn->result_deadline_us = PGP_NO_DEADLINE;
+}
+
+static bool wants_press(const pgp_conn_t *conn, pgp_led_kind_t kind) {
+    switch (kind) {
+        case PGP_LED_POKEMON:
+        case PGP_LED_NEW_POKEMON:
+            return conn->autocatch;
+        case PGP_LED_POKESTOP:
+            return conn->autospin;
+        default:
+            return false;
+    }
+}
+
+static pgp_result_t finish(pgp_conn_t *conn, pgp_led_kind_t kind) {
+    bool stop = conn->target == PGP_LED_POKESTOP;
+    pgp_result_t result = PGP_RESULT_NONE;
+
+    if (kind == PGP_LED_SUCCESS) {
+        result = stop ? PGP_RESULT_SPUN : PGP_RESULT_CAUGHT;
+    } else if (kind == PGP_LED_RED) {
+        result = stop ? PGP_RESULT_FAILED : PGP_RESULT_FLED;
+    }
+    switch (result) {
+        case PGP_RESULT_CAUGHT: conn->stats.caught++; break;
+        case PGP_RESULT_FLED: conn->stats.fled++; break;
+        case PGP_RESULT_SPUN: conn->stats.spun++; break;
+        case PGP_RESULT_FAILED: conn->stats.failed++; break;
+        default: break;
+    }
+    if (result != PGP_RESULT_NONE) {
+        conn->state = PGP_ST_IDLE;
+        conn->result_deadline_us = PGP_NO_DEADLINE;
+    }
+    return result;
+}
+
+/* Feeds one LED characteristic write. Encounters schedule a press
+ * press_delay_ms out; result patterns after a press are counted and
+ * returned so the caller can update the display. */
+pgp_result_t pgp_conn_on_led(pgp_conn_t *conn, const uint8_t *data, size_t len, int64_t now_us) {
+    pgp_led_t led;
+    conn->stats.led_writes++;
+    if (!pgp_led_parse(data, len, &led)) {
+        conn->stats.ignored++;
+        return PGP_RESULT_NONE;
+    }
+    pgp_led_kind_t kind = pgp_led_classify(&led);
+
+    if (conn->state == PGP_ST_AWAIT_RESULT) {
+        if (kind == PGP_LED_SHAKE || kind == PGP_LED_OFF) {
+            return PGP_RESULT_NONE;
+        }
+        pgp_result_t result = finish(conn, kind);
+        if (result != PGP_RESULT_NONE) {
+            return result;
+        }
+        /* Anything else means the app moved on; treat it as a fresh
+         * notification below. */
+        conn->state = PGP_ST_IDLE;
+    }
+
+    if (conn->state == PGP_ST_IDLE && wants_press(conn, kind)) {
+        conn->state = PGP_ST_PRESS_PENDING;
+        conn->target = kind;
+        conn->led_time_us = now_us;
+        conn->press_due_us = now_us + (int64_t)conn->press_delay_ms * 1000;
+    } else if (kind != PGP_LED_OFF) {
+        conn->stats.ignored++;
+    }
+    return PGP_RESULT_NONE;
+}
+
+/* Returns true when the scheduled press is due; the caller sends the button
+ * notification and then reports it with pgp_conn_press_sent(). */
+bool pgp_conn_poll(pgp_conn_t *conn, int64_t now_us) {
+    if (conn->state == PGP_ST_AWAIT_RESULT && now_us >= conn->result_deadline_us) {
+        conn->state = PGP_ST_IDLE;
+        conn->result_deadline_us = PGP_NO_DEADLINE;
+    }
+    return conn->state == PGP_ST_PRESS_PENDING && now_us >= conn->press_due_us;
+}
+
+void pgp_conn_press_sent(pgp_conn_t *conn, int64_t now_us) {
+    uint32_t latency = (uint32_t)(now_us - conn->led_time_us);
+    conn->stats.presses++;
+    conn->stats.latency_us_last = latency;
+    conn->stats.latency_us_total += latency;
+    if (latency > conn->stats.latency_us_max) {
+        conn->stats.latency_us_max = latency;
+    }
+    conn->state = PGP_ST_AWAIT_RESULT;
+    conn->press_due_us = PGP_NO_DEADLINE;
+    conn->result_deadline_us = now_us + PGP_RESULT_TIMEOUT_US;
+}
+
+/* The notification could not be sent (link gone or notifications off);
+ * drop the press instead of retrying into a stale encounter. */
+void pgp_conn_cancel_press(pgp_conn_t *conn) {
+    if (conn->state == PGP_ST_PRESS_PENDING) {
+        conn->state = PGP_ST_IDLE;
+        conn->press_due_us = PGP_NO_DEADLINE;
+    }
+}
+
+int64_t pgp_conn_next_deadline(const pgp_conn_t *conn) {
+    if (conn->state == PGP_ST_PRESS_PENDING) {
+        return conn->press_due_us;
+    }
+    return conn->result_deadline_us;
+}
@@ -0,0 +1,75 @@
+#ifndef PGP_PROTO_H
+#define PGP_PROTO_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#define PGP_LED_MAX_PATTERNS    31
+#define PGP_LED_MAX_LEN         (4 + 3 * PGP_LED_MAX_PATTERNS)
+#define PGP_NO_DEADLINE         INT64_MAX
+typedef enum {
+    PGP_LED_OFF = 0,
+    PGP_LED_POKEMON,
+    PGP_LED_NEW_POKEMON,
+    PGP_LED_POKESTOP,
+    PGP_LED_SHAKE,
+    PGP_LED_SUCCESS,
+    PGP_LED_RED,
+    PGP_LED_UNKNOWN,
+} pgp_led_kind_t;
+typedef struct {
+    uint8_t duration;
+    uint8_t red;
+    uint8_t green;
+    uint8_t blue;
+    bool vibrate;
+} pgp_led_pattern_t;
+typedef struct {
+    uint8_t priority;
+    uint8_t count;
+    pgp_led_pattern_t patterns[PGP_LED_MAX_PATTERNS];
+} pgp_led_t;
+typedef enum {
+    PGP_ST_IDLE = 0,
+    PGP_ST_PRESS_PENDING,
+    PGP_ST_AWAIT_RESULT,
+} pgp_state_t;
+typedef enum {
+    PGP_RESULT_NONE = 0,
+    PGP_RESULT_CAUGHT,
+    PGP_RESULT_FLED,
+    PGP_RESULT_SPUN,
+    PGP_RESULT_FAILED,
+} pgp_result_t;
+typedef struct {
+    uint32_t led_writes;
+    uint32_t presses;
+    uint32_t caught;
+    uint32_t fled;
+    uint32_t spun;
+    uint32_t failed;
+    uint32_t ignored;
+    uint32_t latency_us_last;
+    uint32_t latency_us_max;
+    uint64_t latency_us_total;
+} pgp_stats_t;
+typedef struct {
+    pgp_state_t state;
+    pgp_led_kind_t target;
+    int64_t led_time_us;
+    int64_t press_due_us;
+    int64_t result_deadline_us;
+    uint32_t press_delay_ms;
+    bool autocatch;
+    bool autospin;
+    pgp_stats_t stats;
+} pgp_conn_t;
+bool pgp_led_parse(const uint8_t *data, size_t len, pgp_led_t *led);
+pgp_led_kind_t pgp_led_classify(const pgp_led_t *led);
+const char *pgp_led_kind_name(pgp_led_kind_t kind);
+void pgp_conn_init(pgp_conn_t *conn, uint32_t press_delay_ms);
+pgp_result_t pgp_conn_on_led(pgp_conn_t *conn, const uint8_t *data, size_t len, int64_t now_us);
+bool pgp_conn_poll(pgp_conn_t *conn, int64_t now_us);
+void pgp_conn_press_sent(pgp_conn_t *conn, int64_t now_us);
+void pgp_conn_cancel_press(pgp_conn_t *conn);
+int64_t pgp_conn_next_deadline(const pgp_conn_t *conn);
+#endif
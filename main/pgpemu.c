@@ -0,0 +1,282 @@
+#include "pgpemu.h"
+#include "pgp_ble.h"
+#include "display_ui.h"
+#include "persist.h"
+#include "journal.h"
+#include "stats_history.h"
+#include "power.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "sdkconfig.h"
+#if CONFIG_PM_ENABLE
+#include "esp_pm.h"
+#endif
+
+static const char *TAG = "PGP";
+
+#define PGPEMU_QUEUE_LEN    8
+#define PGPEMU_EVT_CLICK    0x100
+#define PGPEMU_PRESS_GAP_MS 20
+
+/* Every phone gets its own slot in the link table; the totals shown on the
+ * main screen and persisted are the sum over all of them. The lock covers
+ * the table, which the console and the LVGL task read through
+ * pgpemu_get_accounts(). */
+static QueueHandle_t evt_queue = NULL;
+static SemaphoreHandle_t links_lock = NULL;
+static pgp_links_t links;
+static pgp_stats_t totals;
+static int last_led_link = -1;
+static volatile bool paused = false;
+#if CONFIG_PM_ENABLE
+static esp_pm_lock_handle_t pm_lock = NULL;
+#endif
+
+static void on_ble_event(const pgp_ble_evt_t *evt) {
+    if (xQueueSend(evt_queue, evt, 0) != pdTRUE) {
+        ESP_LOGW(TAG, "Event queue full, dropped type %d", evt->type);
+    }
+}
+
+static void record_history(stats_event_t event, int64_t time_us) {
+    stats_history_record(event, time_us);
+    ui_notify_history(UI_SRC_PGPEMU);
+}
+
+/* Outcomes go to the journal with the latency of the press behind them. */
+static void journal_outcome(journal_event_t type, int slot) {
+    uint32_t ms = links.link[slot].conn.stats.latency_us_last / 1000;
+    journal_append(type, (uint8_t)slot, (uint16_t)(ms > UINT16_MAX ? UINT16_MAX : ms));
+}
+
+static void publish_stats(void) {
+    persist_set_counters(totals.caught, totals.spun);
+    ui_update_stats(UI_SRC_PGPEMU, totals.caught, totals.spun);
+    ui_notify_accounts(UI_SRC_PGPEMU);
+}
+
+static void publish_links(void) {
+    ui_update_status(UI_SRC_PGPEMU, pgp_links_connected(&links) > 0, false, false);
+    ui_notify_accounts(UI_SRC_PGPEMU);
+}
+
+static void handle_event(const pgp_ble_evt_t *evt) {
+    switch ((int)evt->type) {
+        case PGP_BLE_EVT_CONNECTED: {
+            int slot = pgp_links_connect(&links, evt->conn_id, evt->data, evt->time_us);
+            power_activity(POWER_SRC_BLE);
+            if (slot < 0) {
+                ESP_LOGW(TAG, "Conn %u: every account slot is in use, disconnecting", evt->conn_id);
+                pgp_ble_disconnect(evt->conn_id);
+                break;
+            }
+            journal_append(JOURNAL_EV_CONNECT, (uint8_t)slot, pgp_links_connected(&links));
+            publish_links();
+            ESP_LOGI(TAG, "Connected (conn %u, account %d, %u link(s))", evt->conn_id, slot + 1,
+                     pgp_links_connected(&links));
+            break;
+        }
+        case PGP_BLE_EVT_DISCONNECTED: {
+            int slot = pgp_links_disconnect(&links, evt->conn_id, evt->time_us);
+            if (slot >= 0) {
+                record_history(STATS_EV_DROP, evt->time_us);
+                journal_append(JOURNAL_EV_DISCONNECT, (uint8_t)slot, pgp_links_connected(&links));
+            }
+            if (slot == last_led_link) {
+                last_led_link = -1;
+            }
+            power_activity(POWER_SRC_BLE);
+            publish_links();
+            persist_request_flush();
+            ESP_LOGI(TAG, "Disconnected (conn %u, account %d)", evt->conn_id, slot + 1);
+            break;
+        }
+        case PGP_BLE_EVT_LED: {
+            int slot = pgp_links_find(&links, evt->conn_id);
+            if (paused || slot < 0) {
+                break;
+            }
+            last_led_link = slot;
+            pgp_links_set_flags(&links, ui_get_autocatch_enabled(), ui_get_autospin_enabled());
+            switch (pgp_links_on_led(&links, slot, evt->data, evt->len, evt->time_us)) {
+                case PGP_RESULT_CAUGHT:
+                    totals.caught++;
+                    ESP_LOGI(TAG, "Account %d caught a Pokemon! Total: %lu", slot + 1, (unsigned long)totals.caught);
+                    journal_outcome(JOURNAL_EV_CAUGHT, slot);
+                    publish_stats();
+                    record_history(STATS_EV_CAUGHT, evt->time_us);
+                    ui_show_catch_animation(UI_SRC_PGPEMU, true);
+                    break;
+                case PGP_RESULT_FLED:
+                    totals.fled++;
+                    ESP_LOGI(TAG, "Account %d: Pokemon fled", slot + 1);
+                    journal_outcome(JOURNAL_EV_FLED, slot);
+                    ui_notify_accounts(UI_SRC_PGPEMU);
+                    record_history(STATS_EV_FLED, evt->time_us);
+                    ui_show_catch_animation(UI_SRC_PGPEMU, false);
+                    break;
+                case PGP_RESULT_SPUN:
+                    totals.spun++;
+                    ESP_LOGI(TAG, "Account %d spun a Pokestop! Total: %lu", slot + 1, (unsigned long)totals.spun);
+                    journal_outcome(JOURNAL_EV_SPUN, slot);
+                    publish_stats();
+                    record_history(STATS_EV_SPUN, evt->time_us);
+                    ui_show_spin_animation(UI_SRC_PGPEMU);
+                    break;
+                case PGP_RESULT_FAILED:
+                    totals.failed++;
+                    break;
+                default:
+                    break;
+            }
+            break;
+        }
+        case PGP_BLE_EVT_CERT:
+            /* The app opens with a certificate exchange that needs the
+             * per-device key material of a real PGP; nothing here can
+             * answer it, so it is only logged. */
+            ESP_LOGW(TAG, "Cert write (%u bytes) ignored: no device keys provisioned", evt->len);
+            break;
+        case PGPEMU_EVT_CLICK: {
+            /* A manual press goes to the phone that wrote the LED last. */
+            int slot = last_led_link;
+            for (int i = 0; slot < 0 && i < PGP_LINK_MAX; i++) {
+                slot = links.link[i].connected ? i : -1;
+            }
+            if (slot >= 0) {
+                pgp_ble_send_button(links.link[slot].conn_id);
+            } else {
+                pgp_ble_start_advertising();
+            }
+            break;
+        }
+    }
+}
+
+/* Sleeps on the event queue until either a BLE event arrives or the next
+ * scheduled press is due, so press timing is set by the deadline rather
+ * than a polling interval. */
+void pgpemu_task(void *arg) {
+    pgp_ble_evt_t evt;
+
+    while (1) {
+        TickType_t wait = portMAX_DELAY;
+        xSemaphoreTake(links_lock, portMAX_DELAY);
+        int64_t deadline = pgp_links_next_deadline(&links);
+        xSemaphoreGive(links_lock);
+        if (deadline != PGP_NO_DEADLINE) {
+            int64_t left_us = deadline - esp_timer_get_time();
+            wait = left_us > 0 ? pdMS_TO_TICKS((left_us + 999) / 1000) : 0;
+        }
+
+        bool got = xQueueReceive(evt_queue, &evt, wait) == pdTRUE;
+#if CONFIG_PM_ENABLE
+        esp_pm_lock_acquire(pm_lock);
+#endif
+        xSemaphoreTake(links_lock, portMAX_DELAY);
+        if (got) {
+            handle_event(&evt);
+        }
+
+        int slot;
+        while ((slot = pgp_links_poll(&links, esp_timer_get_time())) >= 0) {
+            pgp_conn_t *conn = &links.link[slot].conn;
+            if (pgp_ble_send_button(links.link[slot].conn_id) == ESP_OK) {
+                pgp_links_press_sent(&links, slot, esp_timer_get_time());
+                ESP_LOGD(TAG, "Account %d pressed %s, %lu us after LED", slot + 1,
+                         pgp_led_kind_name(conn->target), (unsigned long)conn->stats.latency_us_last);
+            } else {
+                pgp_links_cancel_press(&links, slot);
+            }
+        }
+        xSemaphoreGive(links_lock);
+#if CONFIG_PM_ENABLE
+        esp_pm_lock_release(pm_lock);
+#endif
+    }
+}
+
+esp_err_t pgpemu_init(void) {
+    evt_queue = xQueueCreate(PGPEMU_QUEUE_LEN, sizeof(pgp_ble_evt_t));
+    links_lock = xSemaphoreCreateMutex();
+    if (evt_queue == NULL || links_lock == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    pgp_links_init(&links, CONFIG_PGPEMU_PRESS_DELAY_MS, PGPEMU_PRESS_GAP_MS * 1000);
+#if CONFIG_PM_ENABLE
+    /* Held only while an event or a due press is handled, so press timing
+     * does not depend on where DFS left the clock. */
+    if (esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "pgpemu", &pm_lock) != ESP_OK) {
+        return ESP_ERR_NO_MEM;
+    }
+#endif
+
+    /* Counters carry on from the stored totals; fled is only kept by the
+     * journal. */
+    persist_state_t saved;
+    persist_get(&saved);
+    journal_counters_t jc;
+    journal_get_counters(&jc);
+    totals.caught = saved.caught;
+    totals.spun = saved.spun;
+    totals.fled = jc.fled;
+
+    return pgp_ble_init(on_ble_event);
+}
+
+void pgpemu_button_click(void) {
+    pgp_ble_evt_t evt = { .type = PGPEMU_EVT_CLICK };
+    xQueueSend(evt_queue, &evt, 0);
+}
+
+void pgpemu_set_paused(bool p) {
+    paused = p;
+}
+
+/* Totals over every account; the latency figures are the worst link's. */
+void pgpemu_get_stats(pgp_stats_t *stats) {
+    xSemaphoreTake(links_lock, portMAX_DELAY);
+    *stats = totals;
+    for (int i = 0; i < PGP_LINK_MAX; i++) {
+        const pgp_stats_t *s = &links.link[i].conn.stats;
+        stats->led_writes += s->led_writes;
+        stats->presses += s->presses;
+        stats->ignored += s->ignored;
+        stats->latency_us_total += s->latency_us_total;
+        if (s->latency_us_max > stats->latency_us_max) {
+            stats->latency_us_max = s->latency_us_max;
+        }
+    }
+    xSemaphoreGive(links_lock);
+}
+
+uint8_t pgpemu_get_accounts(pgp_account_t *out, uint8_t max) {
+    if (links_lock == NULL) {
+        return 0;
+    }
+    xSemaphoreTake(links_lock, portMAX_DELAY);
+    uint8_t n = pgp_links_snapshot(&links, out, max);
+    xSemaphoreGive(links_lock);
+    return n;
+}
+
+esp_err_t pgpemu_set_account_flags(uint8_t slot, bool allow_catch, bool allow_spin) {
+    xSemaphoreTake(links_lock, portMAX_DELAY);
+    bool ok = pgp_links_set_account_flags(&links, slot, allow_catch, allow_spin);
+    xSemaphoreGive(links_lock);
+    if (!ok) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    ui_notify_accounts(UI_SRC_CONSOLE);
+    return ESP_OK;
+}
+
+void pgpemu_get_link_stats(pgp_link_stats_t *stats) {
+    xSemaphoreTake(links_lock, portMAX_DELAY);
+    *stats = links.stats;
+    xSemaphoreGive(links_lock);
+}
@@ -0,0 +1,14 @@
+#ifndef PGPEMU_H
+#define PGPEMU_H
+#include <stdbool.h>
+#include "esp_err.h"
+#include "pgp_link.h"
+esp_err_t pgpemu_init(void);
+void pgpemu_task(void *arg);
+void pgpemu_button_click(void);
+void pgpemu_set_paused(bool paused);
+void pgpemu_get_stats(pgp_stats_t *stats);
+uint8_t pgpemu_get_accounts(pgp_account_t *out, uint8_t max);
+esp_err_t pgpemu_set_account_flags(uint8_t slot, bool allow_catch, bool allow_spin);
+void pgpemu_get_link_stats(pgp_link_stats_t *stats);
+#endif
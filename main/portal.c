@@ -0,0 +1,379 @@
+#include "portal.h"
+#include "display_ui.h"
+#include "power.h"
+#include "lvgl_sched.h"
+#include "lcd_flush.h"
+#include "ui_anim.h"
+#include "stats_history.h"
+#include "mem_report.h"
+#include "battery.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "PORTAL";
+
+/* The request handlers of the configuration portal, without the transport.
+ * Every response is formatted into a buffer the caller owns, normally one
+ * static buffer per server task, so serving a request allocates nothing;
+ * a response that does not fit becomes a fixed 500 instead of a larger
+ * buffer. wifi_portal.c serves these over esp_http_server on the soft-AP
+ * and host/bench/portal_bench.c over a local socket. */
+
+#define PORTAL_DIM_MAX_S    3600
+#define PORTAL_OFF_MAX_S    86400
+
+static portal_pgp_stats_cb_t pgp_stats_cb = NULL;
+static portal_accounts_cb_t accounts_cb = NULL;
+static portal_stats_t stats;
+
+static const char index_html[] =
+    "<!doctype html><meta name=viewport content=\"width=device-width\"><title>PGPemu</title>"
+    "<h3>PGPemu</h3><form id=f>"
+    "<label><input type=checkbox name=autocatch> Catch</label> "
+    "<label><input type=checkbox name=autospin> Spin</label><br>"
+    "Dim after <input name=dim_s size=4> s, off after <input name=off_s size=5> s "
+    "<button>Save</button></form><pre id=s></pre><pre id=m></pre><script>"
+    "const $=i=>document.getElementById(i),f=$('f');"
+    "function show(j){for(const k in j){const e=f.elements[k];"
+    "if(e)e.type=='checkbox'?e.checked=j[k]:e.value=j[k];}}"
+    "fetch('/api/settings').then(r=>r.json()).then(show);"
+    "f.onsubmit=ev=>{ev.preventDefault();const b=new URLSearchParams();"
+    "for(const e of f.elements)if(e.name)b.append(e.name,e.type=='checkbox'?+e.checked:e.value);"
+    "fetch('/api/settings',{method:'POST',body:b}).then(r=>r.json()).then(show);};"
+    "fetch('/api/stats').then(r=>r.text()).then(t=>$('s').textContent=t);"
+    "new EventSource('/api/metrics/stream').onmessage=ev=>$('m').textContent=ev.data;"
+    "</script>";
+
+static const char overflow_json[] = "{\"error\":\"response too large\"}";
+
+typedef struct {
+    char *buf;
+    size_t cap;
+    size_t len;
+    bool overflow;
+} json_buf_t;
+
+static void put(json_buf_t *w, const char *fmt, ...) {
+    if (w->overflow) {
+        return;
+    }
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(w->buf + w->len, w->cap - w->len, fmt, ap);
+    va_end(ap);
+    if (n < 0 || (size_t)n >= w->cap - w->len) {
+        w->overflow = true;
+        return;
+    }
+    w->len += (size_t)n;
+}
+
+void portal_set_pgp_cbs(portal_pgp_stats_cb_t stats_fn, portal_accounts_cb_t accounts_fn) {
+    pgp_stats_cb = stats_fn;
+    accounts_cb = accounts_fn;
+}
+
+const char *portal_status_line(uint16_t status) {
+    switch (status) {
+        case 200: return "200 OK";
+        case 400: return "400 Bad Request";
+        case 404: return "404 Not Found";
+        case 405: return "405 Method Not Allowed";
+        case 413: return "413 Payload Too Large";
+        case 503: return "503 Service Unavailable";
+        default: return "500 Internal Server Error";
+    }
+}
+
+static bool parse_flag(const char *v, size_t n, bool *out) {
+    if ((n == 1 && v[0] == '1') || (n == 2 && memcmp(v, "on", 2) == 0) || (n == 4 && memcmp(v, "true", 4) == 0)) {
+        *out = true;
+        return true;
+    }
+    if ((n == 1 && v[0] == '0') || (n == 3 && memcmp(v, "off", 3) == 0) || (n == 5 && memcmp(v, "false", 5) == 0)) {
+        *out = false;
+        return true;
+    }
+    return false;
+}
+
+static bool parse_seconds(const char *v, size_t n, uint32_t max, uint32_t *out) {
+    uint32_t x = 0;
+    if (n == 0 || n > 5) {
+        return false;
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (v[i] < '0' || v[i] > '9') {
+            return false;
+        }
+        x = x * 10 + (uint32_t)(v[i] - '0');
+    }
+    if (x == 0 || x > max) {
+        return false;
+    }
+    *out = x;
+    return true;
+}
+
+static bool key_is(const char *k, size_t n, const char *name) {
+    return strlen(name) == n && memcmp(k, name, n) == 0;
+}
+
+/* Applies an application/x-www-form-urlencoded body such as
+ * "autocatch=1&dim_s=30" on top of *settings. Keys left out keep their
+ * value; an unknown key or a bad value rejects the whole body and leaves
+ * *settings untouched. Values are plain digits and words, so there is
+ * nothing to percent-decode. */
+bool portal_parse_settings(const char *body, size_t len, persist_state_t *settings, const char **error) {
+    persist_state_t next = *settings;
+    const char *p = body, *end = body + len;
+    while (p < end) {
+        const char *amp = memchr(p, '&', (size_t)(end - p));
+        const char *pair_end = amp ? amp : end;
+        const char *eq = memchr(p, '=', (size_t)(pair_end - p));
+        if (eq == NULL) {
+            *error = "expected key=value";
+            return false;
+        }
+        size_t kn = (size_t)(eq - p), vn = (size_t)(pair_end - eq - 1);
+        const char *v = eq + 1;
+        bool ok;
+        if (key_is(p, kn, "autocatch")) {
+            ok = parse_flag(v, vn, &next.autocatch);
+        } else if (key_is(p, kn, "autospin")) {
+            ok = parse_flag(v, vn, &next.autospin);
+        } else if (key_is(p, kn, "dim_s")) {
+            ok = parse_seconds(v, vn, PORTAL_DIM_MAX_S, &next.dim_s);
+        } else if (key_is(p, kn, "off_s")) {
+            ok = parse_seconds(v, vn, PORTAL_OFF_MAX_S, &next.off_s);
+        } else {
+            *error = "unknown setting";
+            return false;
+        }
+        if (!ok) {
+            *error = "bad value";
+            return false;
+        }
+        p = pair_end + 1;
+    }
+    if (next.off_s < next.dim_s) {
+        *error = "off_s below dim_s";
+        return false;
+    }
+    *settings = next;
+    return true;
+}
+
+static void put_settings(json_buf_t *w, const persist_state_t *s) {
+    put(w, "{\"autocatch\":%s,\"autospin\":%s,\"dim_s\":%lu,\"off_s\":%lu}", s->autocatch ? "true" : "false",
+        s->autospin ? "true" : "false", (unsigned long)s->dim_s, (unsigned long)s->off_s);
+}
+
+/* The new values go to the same places the touch screen and the boot path
+ * feed: the toggles through the UI mailbox, which also persists them from
+ * the LVGL task, and the timeouts to the power policy. Persisting here as
+ * well keeps a GET right after the POST consistent. */
+static void apply_settings(const persist_state_t *s) {
+    persist_set_flags(s->autocatch, s->autospin);
+    persist_set_timeouts(s->dim_s, s->off_s);
+    ui_update_settings(UI_SRC_PORTAL, s->autocatch, s->autospin);
+    power_set_timeouts(s->dim_s * 1000, s->off_s * 1000);
+    stats.settings_writes++;
+    ESP_LOGI(TAG, "Settings: catch %s, spin %s, dim %lu s, off %lu s", s->autocatch ? "on" : "off",
+             s->autospin ? "on" : "off", (unsigned long)s->dim_s, (unsigned long)s->off_s);
+}
+
+static void put_counts(json_buf_t *w, const uint32_t *c) {
+    put(w, "{\"caught\":%lu,\"fled\":%lu,\"spun\":%lu,\"drops\":%lu}", (unsigned long)c[STATS_EV_CAUGHT],
+        (unsigned long)c[STATS_EV_FLED], (unsigned long)c[STATS_EV_SPUN], (unsigned long)c[STATS_EV_DROP]);
+}
+
+static void put_stats(json_buf_t *w) {
+    persist_state_t ps;
+    persist_get(&ps);
+    stats_summary_t hs;
+    stats_history_get_summary(&hs);
+    put(w, "{\"caught\":%lu,\"spun\":%lu,\"hour\":", (unsigned long)ps.caught, (unsigned long)ps.spun);
+    put_counts(w, hs.last_hour);
+    put(w, ",\"day\":");
+    put_counts(w, hs.last_day);
+    put(w, ",\"accounts\":[");
+    pgp_account_t acc[PGP_LINK_MAX];
+    uint8_t n = accounts_cb ? accounts_cb(acc, PGP_LINK_MAX) : 0;
+    for (uint8_t i = 0; i < n; i++) {
+        const pgp_account_t *a = &acc[i];
+        put(w, "%s{\"slot\":%u,\"addr\":\"%02x:%02x:%02x:%02x:%02x:%02x\",\"connected\":%s,\"catch\":%s,"
+            "\"spin\":%s,\"caught\":%lu,\"fled\":%lu,\"spun\":%lu,\"presses\":%lu,\"latency_us_max\":%lu}",
+            i ? "," : "", a->slot + 1, a->addr[0], a->addr[1], a->addr[2], a->addr[3], a->addr[4], a->addr[5],
+            a->connected ? "true" : "false", a->allow_catch ? "true" : "false", a->allow_spin ? "true" : "false",
+            (unsigned long)a->caught, (unsigned long)a->fled, (unsigned long)a->spun, (unsigned long)a->presses,
+            (unsigned long)a->latency_us_max);
+    }
+    put(w, "]}");
+}
+
+/* One snapshot of the counters the console perf command prints: frame
+ * and flush times, BLE press latency, heap and the portal itself. */
+static void put_metrics(json_buf_t *w) {
+    lvgl_sched_stats_t ss;
+    lcd_flush_stats_t fs;
+    ui_anim_stats_t as;
+    mem_report_t mem;
+    battery_state_t bs;
+    pgp_stats_t pgp = { 0 };
+    pgp_account_t acc[PGP_LINK_MAX];
+    lvgl_sched_get_stats(&ss);
+    lcd_flush_get_stats(&fs);
+    ui_anim_get_stats(&as);
+    mem_report_get(&mem);
+    battery_get(&bs);
+    if (pgp_stats_cb) {
+        pgp_stats_cb(&pgp);
+    }
+    uint8_t n = accounts_cb ? accounts_cb(acc, PGP_LINK_MAX) : 0, links = 0;
+    for (uint8_t i = 0; i < n; i++) {
+        links += acc[i].connected;
+    }
+
+    put(w, "{\"uptime_ms\":%llu,\"frame\":{\"wakeups_per_s\":%lu,\"handler_us_max\":%lu,\"flushes\":%lu,"
+        "\"flush_us_last\":%lu,\"flush_us_max\":%lu,\"anim_fps\":%lu,\"anim_late\":%lu},",
+        (unsigned long long)(esp_timer_get_time() / 1000), (unsigned long)ss.wakeups_per_sec,
+        (unsigned long)ss.handler_us_max, (unsigned long)fs.flushes, (unsigned long)fs.last_us,
+        (unsigned long)fs.max_us, (unsigned long)as.fps_last, (unsigned long)as.late_frames);
+    put(w, "\"ble\":{\"links\":%u,\"presses\":%lu,\"latency_us_last\":%lu,\"latency_us_avg\":%lu,"
+        "\"latency_us_max\":%lu},", links, (unsigned long)pgp.presses, (unsigned long)pgp.latency_us_last,
+        (unsigned long)(pgp.presses ? pgp.latency_us_total / pgp.presses : 0), (unsigned long)pgp.latency_us_max);
+    put(w, "\"heap\":{\"free\":%lu,\"free_min\":%lu,\"largest\":%lu,\"dma_free\":%lu,\"lvgl_used\":%lu,"
+        "\"lvgl_peak\":%lu},", (unsigned long)mem.internal_free, (unsigned long)mem.internal_free_min,
+        (unsigned long)mem.internal_largest, (unsigned long)mem.dma_free, (unsigned long)mem.lvgl_used,
+        (unsigned long)mem.lvgl_peak);
+    put(w, "\"power\":\"%s\",", power_state_name(power_get_state()));
+    if (bs.samples) {
+        put(w, "\"battery\":%u,", bs.percent);
+    }
+    put(w, "\"portal\":{\"requests\":%lu,\"events\":%lu,\"build_us_max\":%lu}}", (unsigned long)stats.requests,
+        (unsigned long)stats.events, (unsigned long)stats.build_us_max);
+}
+
+static void finish(json_buf_t *w, portal_resp_t *resp, uint16_t status) {
+    if (w->overflow) {
+        stats.overflows++;
+        ESP_LOGW(TAG, "Response over %u bytes", (unsigned)w->cap);
+        resp->status = 500;
+        resp->body = overflow_json;
+        resp->len = sizeof(overflow_json) - 1;
+        return;
+    }
+    resp->status = status;
+    resp->body = w->buf;
+    resp->len = w->len;
+}
+
+static void fail(json_buf_t *w, portal_resp_t *resp, uint16_t status, const char *error) {
+    w->len = 0;
+    put(w, "{\"error\":\"%s\"}", error);
+    finish(w, resp, status);
+}
+
+static bool path_is(const char *path, size_t n, const char *name) {
+    return strlen(name) == n && memcmp(path, name, n) == 0;
+}
+
+/* Routes one request. The query string is ignored. For the metrics stream
+ * only resp->stream is set; the transport then sends
+ * portal_metrics_event() frames for as long as the client stays. */
+void portal_handle(portal_method_t method, const char *uri, const char *body, size_t body_len, char *buf,
+                   size_t cap, portal_resp_t *resp) {
+    int64_t start = esp_timer_get_time();
+    json_buf_t w = { .buf = buf, .cap = cap };
+    size_t n = strcspn(uri, "?");
+    memset(resp, 0, sizeof(*resp));
+    resp->type = "application/json";
+    stats.requests++;
+
+    if (path_is(uri, n, "/") || path_is(uri, n, "/index.html")) {
+        if (method != PORTAL_GET) {
+            fail(&w, resp, 405, "method not allowed");
+        } else {
+            resp->status = 200;
+            resp->type = "text/html";
+            resp->body = index_html;
+            resp->len = sizeof(index_html) - 1;
+        }
+    } else if (path_is(uri, n, "/api/settings")) {
+        persist_state_t s;
+        persist_get(&s);
+        const char *error = NULL;
+        if (method == PORTAL_GET) {
+            put_settings(&w, &s);
+            finish(&w, resp, 200);
+        } else if (method != PORTAL_POST) {
+            fail(&w, resp, 405, "method not allowed");
+        } else if (body_len > PORTAL_BODY_MAX || (body == NULL && body_len > 0)) {
+            fail(&w, resp, 413, "body too large");
+        } else if (!portal_parse_settings(body, body_len, &s, &error)) {
+            fail(&w, resp, 400, error);
+        } else {
+            apply_settings(&s);
+            put_settings(&w, &s);
+            finish(&w, resp, 200);
+        }
+    } else if (path_is(uri, n, "/api/stats")) {
+        if (method != PORTAL_GET) {
+            fail(&w, resp, 405, "method not allowed");
+        } else {
+            put_stats(&w);
+            finish(&w, resp, 200);
+        }
+    } else if (path_is(uri, n, "/api/metrics")) {
+        if (method != PORTAL_GET) {
+            fail(&w, resp, 405, "method not allowed");
+        } else {
+            put_metrics(&w);
+            finish(&w, resp, 200);
+        }
+    } else if (path_is(uri, n, "/api/metrics/stream")) {
+        if (method != PORTAL_GET) {
+            fail(&w, resp, 405, "method not allowed");
+        } else {
+            resp->status = 200;
+            resp->type = "text/event-stream";
+            resp->stream = true;
+        }
+    } else {
+        fail(&w, resp, 404, "not found");
+    }
+
+    if (resp->status >= 400) {
+        stats.errors++;
+    }
+    if (resp->len > stats.resp_bytes_max) {
+        stats.resp_bytes_max = (uint32_t)resp->len;
+    }
+    stats.build_us_last = (uint32_t)(esp_timer_get_time() - start);
+    if (stats.build_us_last > stats.build_us_max) {
+        stats.build_us_max = stats.build_us_last;
+    }
+}
+
+/* One server-sent event carrying a metrics snapshot. Returns its length,
+ * or 0 when it did not fit. */
+size_t portal_metrics_event(char *buf, size_t cap) {
+    json_buf_t w = { .buf = buf, .cap = cap };
+    put(&w, "data: ");
+    put_metrics(&w);
+    put(&w, "\n\n");
+    if (w.overflow) {
+        stats.overflows++;
+        return 0;
+    }
+    stats.events++;
+    return w.len;
+}
+
+void portal_get_stats(portal_stats_t *out) {
+    *out = stats;
+}
@@ -0,0 +1,38 @@
+#ifndef PORTAL_H
+#define PORTAL_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "pgp_link.h"
+#include "persist.h"
+#define PORTAL_RESP_MAX     2048
+#define PORTAL_EVENT_MAX    768
+#define PORTAL_BODY_MAX     256
+typedef enum { PORTAL_GET = 0, PORTAL_POST, PORTAL_OTHER } portal_method_t;
+typedef struct {
+    uint16_t status;
+    const char *type;
+    const char *body;
+    size_t len;
+    bool stream;
+} portal_resp_t;
+typedef struct {
+    uint32_t requests;
+    uint32_t errors;
+    uint32_t overflows;
+    uint32_t settings_writes;
+    uint32_t events;
+    uint32_t resp_bytes_max;
+    uint32_t build_us_last;
+    uint32_t build_us_max;
+} portal_stats_t;
+typedef void (*portal_pgp_stats_cb_t)(pgp_stats_t *out);
+typedef uint8_t (*portal_accounts_cb_t)(pgp_account_t *out, uint8_t max);
+void portal_set_pgp_cbs(portal_pgp_stats_cb_t stats_cb, portal_accounts_cb_t accounts_cb);
+bool portal_parse_settings(const char *body, size_t len, persist_state_t *settings, const char **error);
+void portal_handle(portal_method_t method, const char *uri, const char *body, size_t body_len, char *buf,
+                   size_t cap, portal_resp_t *resp);
+size_t portal_metrics_event(char *buf, size_t cap);
+const char *portal_status_line(uint16_t status);
+void portal_get_stats(portal_stats_t *out);
+#endif
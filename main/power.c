@@ -0,0 +1,229 @@
+#include "power.h"
+#include "display_port.h"
+#include "lvgl_sched.h"
+#include "button.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <stdatomic.h>
+#if CONFIG_PM_ENABLE
+#include "esp_pm.h"
+#endif
+
+static const char *TAG = "POWER";
+
+/* Idle policy for the display. Any task reports activity with
+ * power_activity(), which is a timestamp store while the screen is lit and
+ * a wakeup of the LVGL task while it is dim or dark. The transitions
+ * themselves run in the LVGL task from power_service(), so backlight,
+ * panel and touch commands never race a flush, and the one-shot timer only
+ * ever fires at the next timeout instead of polling. */
+static power_config_t cfg;
+static volatile power_state_t state = POWER_STATE_ACTIVE;
+static atomic_int_fast64_t last_activity_us;
+static atomic_uint pending_wakes;
+static atomic_uint_fast64_t pending_timeouts;
+static esp_timer_handle_t idle_timer = NULL;
+static int64_t state_since_us;
+static power_stats_t stats;
+
+#if CONFIG_PM_ENABLE
+/* Automatic light sleep is only allowed while the display is off. The
+ * LEDC backlight PWM runs from a clock that stops in light sleep and the
+ * touch INT edge interrupt cannot wake the chip, so a lit screen holds
+ * this lock and gets frequency scaling only. */
+static esp_pm_lock_handle_t lit_lock = NULL;
+static bool lit_released;
+
+static void configure_pm(void) {
+    esp_pm_config_t pm_cfg = {
+        .max_freq_mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ,
+        .min_freq_mhz = CONFIG_XTAL_FREQ,
+        .light_sleep_enable = true,
+    };
+    esp_err_t ret = esp_pm_configure(&pm_cfg);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "esp_pm_configure failed (%s), running at fixed clock", esp_err_to_name(ret));
+        return;
+    }
+    ESP_ERROR_CHECK(esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "display_lit", &lit_lock));
+    esp_pm_lock_acquire(lit_lock);
+    ESP_LOGI(TAG, "DFS %d-%d MHz, light sleep while display is off", pm_cfg.min_freq_mhz, pm_cfg.max_freq_mhz);
+}
+
+static void allow_light_sleep(bool allow) {
+    if (lit_lock == NULL) {
+        return;
+    }
+    /* Only undo what the allow step did: if the button could not be armed
+     * the lock was never released and must not be taken a second time. */
+    if (allow && !lit_released) {
+        if (button_set_wakeup(true) != ESP_OK) {
+            ESP_LOGW(TAG, "Button wakeup unavailable, staying out of light sleep");
+            return;
+        }
+        esp_pm_lock_release(lit_lock);
+        lit_released = true;
+    } else if (!allow && lit_released) {
+        esp_pm_lock_acquire(lit_lock);
+        button_set_wakeup(false);
+        lit_released = false;
+    }
+}
+#else
+static void configure_pm(void) {
+}
+
+static void allow_light_sleep(bool allow) {
+}
+#endif
+
+static const char *const state_names[POWER_STATE_COUNT] = { "active", "dim", "off" };
+
+static void idle_timer_cb(void *arg) {
+    lvgl_sched_notify(LVGL_SCHED_EVT_POWER);
+}
+
+esp_err_t power_init(const power_config_t *config) {
+    cfg = *config;
+    if (cfg.off_ms < cfg.dim_ms) {
+        cfg.off_ms = cfg.dim_ms;
+    }
+    const esp_timer_create_args_t args = {
+        .callback = idle_timer_cb,
+        .name = "power_idle",
+    };
+    esp_err_t ret = esp_timer_create(&args, &idle_timer);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    configure_pm();
+    state_since_us = esp_timer_get_time();
+    atomic_store(&last_activity_us, state_since_us);
+    display_port_set_backlight(cfg.bright_percent, 0, false);
+    ESP_LOGI(TAG, "Dim after %lu s, off after %lu s", (unsigned long)(cfg.dim_ms / 1000),
+             (unsigned long)(cfg.off_ms / 1000));
+    return esp_timer_start_once(idle_timer, (uint64_t)cfg.dim_ms * 1000);
+}
+
+/* New timeouts from the settings portal. They are packed into one word so
+ * power_service() never sees a dim time from one request and an off time
+ * from another, and take effect from the last activity. */
+void power_set_timeouts(uint32_t dim_ms, uint32_t off_ms) {
+    if (off_ms < dim_ms) {
+        off_ms = dim_ms;
+    }
+    atomic_store(&pending_timeouts, ((uint64_t)dim_ms << 32) | off_ms | (1ULL << 63));
+    lvgl_sched_notify(LVGL_SCHED_EVT_POWER);
+}
+
+void power_activity(power_src_t src) {
+    atomic_store_explicit(&last_activity_us, esp_timer_get_time(), memory_order_relaxed);
+    if (state != POWER_STATE_ACTIVE) {
+        atomic_fetch_or(&pending_wakes, 1U << src);
+        lvgl_sched_notify(LVGL_SCHED_EVT_POWER);
+    }
+}
+
+static void enter(power_state_t next, int64_t now) {
+    stats.residency_us[state] += (uint64_t)(now - state_since_us);
+    stats.entries[next]++;
+
+    if (state == POWER_STATE_OFF) {
+        allow_light_sleep(false);
+        if (display_port_touch_sleep(false) != ESP_OK) {
+            ESP_LOGW(TAG, "Touch controller did not answer after wake");
+        }
+        display_port_panel_sleep(false);
+        lvgl_sched_suspend(false);
+    }
+
+    switch (next) {
+        case POWER_STATE_ACTIVE:
+            display_port_set_backlight(cfg.bright_percent, cfg.fade_ms / 2, false);
+            break;
+        case POWER_STATE_DIM:
+            display_port_set_backlight(cfg.dim_percent, cfg.fade_ms, false);
+            break;
+        case POWER_STATE_OFF:
+            display_port_set_backlight(0, cfg.fade_ms, true);
+            display_port_panel_sleep(true);
+            if (display_port_touch_sleep(true) == ESP_OK) {
+                stats.touch_sleeps++;
+            }
+            lvgl_sched_suspend(true);
+            allow_light_sleep(true);
+            break;
+        default:
+            break;
+    }
+
+    ESP_LOGD(TAG, "%s -> %s", state_names[state], state_names[next]);
+    if (state == POWER_STATE_OFF) {
+        uint32_t us = (uint32_t)(esp_timer_get_time() - now);
+        stats.wake_us_last = us;
+        if (us > stats.wake_us_max) {
+            stats.wake_us_max = us;
+        }
+    }
+    state = next;
+    state_since_us = now;
+}
+
+/* Runs in the LVGL task on LVGL_SCHED_EVT_POWER. */
+void power_service(void) {
+    unsigned wakes = atomic_exchange(&pending_wakes, 0);
+    uint64_t timeouts = atomic_exchange(&pending_timeouts, 0);
+    if (timeouts) {
+        cfg.dim_ms = (uint32_t)(timeouts >> 32) & 0x7fffffff;
+        cfg.off_ms = (uint32_t)timeouts;
+        ESP_LOGI(TAG, "Dim after %lu s, off after %lu s", (unsigned long)(cfg.dim_ms / 1000),
+                 (unsigned long)(cfg.off_ms / 1000));
+    }
+    int64_t now = esp_timer_get_time();
+    int64_t seen_us = atomic_load_explicit(&last_activity_us, memory_order_relaxed);
+    int64_t idle_us = now - seen_us;
+
+    power_state_t next = POWER_STATE_ACTIVE;
+    int64_t next_check_us = (int64_t)cfg.dim_ms * 1000 - idle_us;
+    if (idle_us >= (int64_t)cfg.off_ms * 1000) {
+        next = POWER_STATE_OFF;
+        next_check_us = -1;
+    } else if (idle_us >= (int64_t)cfg.dim_ms * 1000) {
+        next = POWER_STATE_DIM;
+        next_check_us = (int64_t)cfg.off_ms * 1000 - idle_us;
+    }
+
+    if (next != state) {
+        if (next == POWER_STATE_ACTIVE) {
+            for (int i = 0; i < POWER_SRC_COUNT; i++) {
+                if (wakes & (1U << i)) {
+                    stats.wakes[i]++;
+                }
+            }
+        }
+        enter(next, now);
+        /* Activity reported while the state was changing saw the old
+         * state and did not ask for a wake; go round once more. */
+        if (atomic_load_explicit(&last_activity_us, memory_order_relaxed) != seen_us) {
+            lvgl_sched_notify(LVGL_SCHED_EVT_POWER);
+        }
+    }
+
+    esp_timer_stop(idle_timer);
+    if (next_check_us >= 0) {
+        esp_timer_start_once(idle_timer, (uint64_t)next_check_us + 1000);
+    }
+}
+
+power_state_t power_get_state(void) {
+    return state;
+}
+
+const char *power_state_name(power_state_t s) {
+    return s < POWER_STATE_COUNT ? state_names[s] : "?";
+}
+
+void power_get_stats(power_stats_t *out) {
+    *out = stats;
+    out->residency_us[state] += (uint64_t)(esp_timer_get_time() - state_since_us);
+}
@@ -0,0 +1,38 @@
+#ifndef POWER_H
+#define POWER_H
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+typedef enum { POWER_STATE_ACTIVE = 0, POWER_STATE_DIM, POWER_STATE_OFF, POWER_STATE_COUNT } power_state_t;
+typedef enum { POWER_SRC_TOUCH = 0, POWER_SRC_BUTTON, POWER_SRC_BLE, POWER_SRC_COUNT } power_src_t;
+typedef struct {
+    uint32_t dim_ms;
+    uint32_t off_ms;
+    uint8_t bright_percent;
+    uint8_t dim_percent;
+    uint32_t fade_ms;
+} power_config_t;
+typedef struct {
+    uint64_t residency_us[POWER_STATE_COUNT];
+    uint32_t entries[POWER_STATE_COUNT];
+    uint32_t wakes[POWER_SRC_COUNT];
+    uint32_t touch_sleeps;
+    uint32_t wake_us_last;
+    uint32_t wake_us_max;
+} power_stats_t;
+#define POWER_CONFIG_DEFAULT() { \
+    .dim_ms = CONFIG_PGPEMU_DIM_TIMEOUT_S * 1000, \
+    .off_ms = CONFIG_PGPEMU_SLEEP_TIMEOUT_S * 1000, \
+    .bright_percent = CONFIG_PGPEMU_BACKLIGHT_PERCENT, \
+    .dim_percent = CONFIG_PGPEMU_BACKLIGHT_DIM_PERCENT, \
+    .fade_ms = 400, \
+}
+esp_err_t power_init(const power_config_t *config);
+void power_set_timeouts(uint32_t dim_ms, uint32_t off_ms);
+void power_activity(power_src_t src);
+void power_service(void);
+power_state_t power_get_state(void);
+const char *power_state_name(power_state_t state);
+void power_get_stats(power_stats_t *stats);
+#endif
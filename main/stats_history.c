@@ -0,0 +1,142 @@
+#include "stats_history.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <string.h>
+
+#define US_PER_MINUTE   60000000LL
+
+/* Two rings indexed by absolute minute and hour since boot modulo their
+ * length, so a bucket never moves once written and the chart can map bucket
+ * i to bar i. Window totals are kept alongside and adjusted as buckets are
+ * filled and recycled, so reading an aggregate never walks a ring. */
+typedef struct {
+    stats_bucket_t minute[STATS_MINUTE_BUCKETS];
+    stats_bucket_t hour[STATS_HOUR_BUCKETS];
+    uint32_t last_hour[STATS_EV_COUNT];
+    uint32_t last_day[STATS_EV_COUNT];
+    int64_t origin_us;
+    uint32_t now_minute;
+    stats_dirty_t dirty;
+} stats_store_t;
+
+static stats_store_t store;
+static SemaphoreHandle_t lock = NULL;
+
+static void recycle_minute(uint32_t idx) {
+    stats_bucket_t *b = &store.minute[idx];
+    for (int e = 0; e < STATS_EV_COUNT; e++) {
+        store.last_hour[e] -= b->count[e];
+    }
+    memset(b, 0, sizeof(*b));
+    store.dirty.minutes |= 1ULL << idx;
+}
+
+static void recycle_hour(uint32_t idx) {
+    stats_bucket_t *b = &store.hour[idx];
+    for (int e = 0; e < STATS_EV_COUNT; e++) {
+        store.last_day[e] -= b->count[e];
+    }
+    memset(b, 0, sizeof(*b));
+    store.dirty.hours |= 1UL << idx;
+}
+
+/* Moves the write position to the minute containing now_us, clearing every
+ * bucket skipped over. A gap longer than a ring clears the ring once, so
+ * the cost is bounded by the ring size however long the device idled. */
+static void advance_locked(int64_t now_us) {
+    uint32_t minute = (uint32_t)((now_us - store.origin_us) / US_PER_MINUTE);
+    if (minute <= store.now_minute) {
+        return;
+    }
+    uint32_t steps = minute - store.now_minute;
+    uint32_t n = steps < STATS_MINUTE_BUCKETS ? steps : STATS_MINUTE_BUCKETS;
+    for (uint32_t i = 1; i <= n; i++) {
+        recycle_minute((store.now_minute + steps - n + i) % STATS_MINUTE_BUCKETS);
+    }
+
+    uint32_t old_hour = store.now_minute / 60;
+    uint32_t new_hour = minute / 60;
+    if (new_hour > old_hour) {
+        uint32_t hsteps = new_hour - old_hour;
+        uint32_t hn = hsteps < STATS_HOUR_BUCKETS ? hsteps : STATS_HOUR_BUCKETS;
+        for (uint32_t i = 1; i <= hn; i++) {
+            recycle_hour((old_hour + hsteps - hn + i) % STATS_HOUR_BUCKETS);
+        }
+    }
+    store.now_minute = minute;
+}
+
+void stats_history_init(int64_t now_us) {
+    if (lock == NULL) {
+        lock = xSemaphoreCreateMutex();
+    }
+    memset(&store, 0, sizeof(store));
+    store.origin_us = now_us;
+    store.dirty.minutes = (1ULL << STATS_MINUTE_BUCKETS) - 1;
+    store.dirty.hours = (1UL << STATS_HOUR_BUCKETS) - 1;
+}
+
+void stats_history_record(stats_event_t event, int64_t now_us) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    advance_locked(now_us);
+    uint32_t m = store.now_minute % STATS_MINUTE_BUCKETS;
+    uint32_t h = (store.now_minute / 60) % STATS_HOUR_BUCKETS;
+    if (store.minute[m].count[event] < UINT16_MAX) {
+        store.minute[m].count[event]++;
+        store.last_hour[event]++;
+    }
+    if (store.hour[h].count[event] < UINT16_MAX) {
+        store.hour[h].count[event]++;
+        store.last_day[event]++;
+    }
+    store.dirty.minutes |= 1ULL << m;
+    store.dirty.hours |= 1UL << h;
+    xSemaphoreGive(lock);
+}
+
+void stats_history_advance(int64_t now_us) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    advance_locked(now_us);
+    xSemaphoreGive(lock);
+}
+
+uint32_t stats_history_current_minute(void) {
+    return store.now_minute % STATS_MINUTE_BUCKETS;
+}
+
+int64_t stats_history_next_minute_us(void) {
+    return store.origin_us + ((int64_t)store.now_minute + 1) * US_PER_MINUTE;
+}
+
+void stats_history_get_minute(uint32_t index, stats_bucket_t *bucket) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    *bucket = store.minute[index % STATS_MINUTE_BUCKETS];
+    xSemaphoreGive(lock);
+}
+
+void stats_history_get_hour(uint32_t index, stats_bucket_t *bucket) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    *bucket = store.hour[index % STATS_HOUR_BUCKETS];
+    xSemaphoreGive(lock);
+}
+
+void stats_history_get_summary(stats_summary_t *summary) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    memcpy(summary->last_hour, store.last_hour, sizeof(summary->last_hour));
+    memcpy(summary->last_day, store.last_day, sizeof(summary->last_day));
+    xSemaphoreGive(lock);
+}
+
+/* Hands the set of buckets changed since the last call to the UI and
+ * clears it. Returns false when nothing changed. */
+bool stats_history_take_dirty(stats_dirty_t *dirty) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    *dirty = store.dirty;
+    memset(&store.dirty, 0, sizeof(store.dirty));
+    xSemaphoreGive(lock);
+    return dirty->minutes || dirty->hours;
+}
+
+size_t stats_history_footprint(void) {
+    return sizeof(store);
+}
@@ -0,0 +1,36 @@
+#ifndef STATS_HISTORY_H
+#define STATS_HISTORY_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#define STATS_MINUTE_BUCKETS    60
+#define STATS_HOUR_BUCKETS      24
+typedef enum {
+    STATS_EV_CAUGHT = 0,
+    STATS_EV_FLED,
+    STATS_EV_SPUN,
+    STATS_EV_DROP,
+    STATS_EV_COUNT
+} stats_event_t;
+typedef struct {
+    uint16_t count[STATS_EV_COUNT];
+} stats_bucket_t;
+typedef struct {
+    uint32_t last_hour[STATS_EV_COUNT];
+    uint32_t last_day[STATS_EV_COUNT];
+} stats_summary_t;
+typedef struct {
+    uint64_t minutes;
+    uint32_t hours;
+} stats_dirty_t;
+void stats_history_init(int64_t now_us);
+void stats_history_record(stats_event_t event, int64_t now_us);
+void stats_history_advance(int64_t now_us);
+uint32_t stats_history_current_minute(void);
+int64_t stats_history_next_minute_us(void);
+void stats_history_get_minute(uint32_t index, stats_bucket_t *bucket);
+void stats_history_get_hour(uint32_t index, stats_bucket_t *bucket);
+void stats_history_get_summary(stats_summary_t *summary);
+bool stats_history_take_dirty(stats_dirty_t *dirty);
+size_t stats_history_footprint(void);
+#endif
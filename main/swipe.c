@@ -0,0 +1,97 @@
+#include "swipe.h"
+#include <stdbool.h>
+#include <stdlib.h>
+
+/* Turns the touch samples of one contact into a swipe direction at lift.
+ * The controller's own gesture register wins when it reported a swipe;
+ * otherwise the start and end points are compared, which also covers parts
+ * whose firmware has gesture reporting disabled. Runs in the LVGL task. */
+
+static swipe_config_t cfg = SWIPE_CONFIG_DEFAULT();
+static bool tracking;
+static int x0, y0, x1, y1;
+static int64_t t0_us;
+static swipe_dir_t hw_dir;
+static swipe_stats_t stats;
+
+void swipe_init(const swipe_config_t *config) {
+    cfg = *config;
+    tracking = false;
+    hw_dir = SWIPE_NONE;
+}
+
+static swipe_dir_t from_gesture(cst816_gesture_t g) {
+    switch (g) {
+        case GESTURE_SWIPE_UP:
+            return SWIPE_UP;
+        case GESTURE_SWIPE_DOWN:
+            return SWIPE_DOWN;
+        case GESTURE_SWIPE_LEFT:
+            return SWIPE_LEFT;
+        case GESTURE_SWIPE_RIGHT:
+            return SWIPE_RIGHT;
+        default:
+            return SWIPE_NONE;
+    }
+}
+
+/* A swipe must be quick, long enough and clearly along one axis; anything
+ * else is left to LVGL as a tap or drag. */
+static swipe_dir_t classify(int dx, int dy, int64_t dt_us) {
+    int adx = abs(dx), ady = abs(dy);
+    if (dt_us > (int64_t)cfg.max_ms * 1000) {
+        return SWIPE_NONE;
+    }
+    if (adx >= cfg.min_px && adx >= 2 * ady) {
+        return dx < 0 ? SWIPE_LEFT : SWIPE_RIGHT;
+    }
+    if (ady >= cfg.min_px && ady >= 2 * adx) {
+        return dy < 0 ? SWIPE_UP : SWIPE_DOWN;
+    }
+    return SWIPE_NONE;
+}
+
+swipe_dir_t swipe_feed(const cst816_sample_t *sample) {
+    const cst816_touch_data_t *d = &sample->data;
+
+    if (d->touched && !tracking) {
+        /* The controller clears the gesture register when a new contact
+         * starts; a code still present in the touch-down report belongs to
+         * the previous one. */
+        tracking = true;
+        hw_dir = SWIPE_NONE;
+        x0 = x1 = d->x;
+        y0 = y1 = d->y;
+        t0_us = sample->irq_time_us;
+        return SWIPE_NONE;
+    }
+    if (!tracking) {
+        return SWIPE_NONE;
+    }
+    swipe_dir_t g = from_gesture(d->gesture);
+    if (g != SWIPE_NONE) {
+        hw_dir = g;
+    }
+    if (d->touched) {
+        x1 = d->x;
+        y1 = d->y;
+        return SWIPE_NONE;
+    }
+
+    tracking = false;
+    if (hw_dir != SWIPE_NONE) {
+        stats.hw++;
+        return hw_dir;
+    }
+    swipe_dir_t dir = classify(x1 - x0, y1 - y0, sample->irq_time_us - t0_us);
+    if (dir != SWIPE_NONE) {
+        stats.sw++;
+    } else {
+        stats.taps++;
+    }
+    return dir;
+}
+
+void swipe_get_stats(swipe_stats_t *out) {
+    *out = stats;
+}
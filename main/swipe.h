@@ -0,0 +1,22 @@
+#ifndef SWIPE_H
+#define SWIPE_H
+#include <stdint.h>
+#include "cst816_touch.h"
+typedef enum { SWIPE_NONE = 0, SWIPE_LEFT, SWIPE_RIGHT, SWIPE_UP, SWIPE_DOWN } swipe_dir_t;
+typedef struct {
+    uint16_t min_px;
+    uint32_t max_ms;
+} swipe_config_t;
+#define SWIPE_CONFIG_DEFAULT() { \
+    .min_px = 50, \
+    .max_ms = 600, \
+}
+typedef struct {
+    uint32_t hw;
+    uint32_t sw;
+    uint32_t taps;
+} swipe_stats_t;
+void swipe_init(const swipe_config_t *config);
+swipe_dir_t swipe_feed(const cst816_sample_t *sample);
+void swipe_get_stats(swipe_stats_t *stats);
+#endif
@@ -0,0 +1,116 @@
+#include "trace.h"
+
+#if CONFIG_PGPEMU_TRACE
+#include "esp_attr.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define TRACE_RING_SIZE     CONFIG_PGPEMU_TRACE_RING_SIZE
+#define TRACE_RING_MASK     (TRACE_RING_SIZE - 1)
+#define TRACE_MAX_TASKS     8
+#define TRACE_TASK_ISR      0
+
+_Static_assert((TRACE_RING_SIZE & TRACE_RING_MASK) == 0, "trace ring size must be a power of two");
+
+static const char *const event_names[TRACE_EV_COUNT] = {
+    [TRACE_EV_LVGL_HANDLER] = "lv_timer_handler",
+    [TRACE_EV_LCD_FLUSH] = "lcd_flush",
+    [TRACE_EV_TOUCH_READ] = "cst816_read",
+    [TRACE_EV_UI_UPDATE] = "ui_update",
+    [TRACE_EV_UI_APPLY] = "ui_apply",
+};
+
+static trace_rec_t ring[TRACE_RING_SIZE];
+static atomic_uint head;
+static atomic_bool frozen;
+static _Atomic(TaskHandle_t) tasks[TRACE_MAX_TASKS];
+
+/* Small per-task ids keep a record at 12 bytes. Slot 0 stands for interrupt
+ * context; a task claims the next free slot the first time it records and
+ * shares the last one if more than TRACE_MAX_TASKS - 1 tasks show up. */
+static uint8_t IRAM_ATTR task_id(void) {
+    if (xPortInIsrContext()) {
+        return TRACE_TASK_ISR;
+    }
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    for (uint8_t i = 1; i < TRACE_MAX_TASKS; i++) {
+        TaskHandle_t t = atomic_load(&tasks[i]);
+        if (t == self) {
+            return i;
+        }
+        if (t == NULL) {
+            TaskHandle_t expected = NULL;
+            if (atomic_compare_exchange_strong(&tasks[i], &expected, self) || expected == self) {
+                return i;
+            }
+        }
+    }
+    return TRACE_MAX_TASKS - 1;
+}
+
+/* Lock-free for any number of writers, tasks or ISRs: each claims a slot with
+ * one fetch_add and the oldest record is overwritten once the ring wraps. */
+void IRAM_ATTR trace_record(trace_event_t event, uint32_t start_us, uint16_t arg) {
+    if (atomic_load_explicit(&frozen, memory_order_relaxed)) {
+        return;
+    }
+    uint32_t now = (uint32_t)esp_timer_get_time();
+    uint32_t slot = atomic_fetch_add_explicit(&head, 1, memory_order_relaxed) & TRACE_RING_MASK;
+    ring[slot].ts_us = start_us;
+    ring[slot].dur_us = now - start_us;
+    ring[slot].task = task_id();
+    ring[slot].event = (uint8_t)event;
+    ring[slot].arg = arg;
+}
+
+/* Copies the ring out oldest first. Recording is frozen for the copy, so a
+ * writer that was mid-record when the freeze hit can leave one torn entry. */
+size_t trace_snapshot(trace_rec_t *out, size_t max) {
+    atomic_store(&frozen, true);
+    uint32_t end = atomic_load(&head);
+    uint32_t count = end < TRACE_RING_SIZE ? end : TRACE_RING_SIZE;
+    if (count > max) {
+        count = max;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        out[i] = ring[(end - count + i) & TRACE_RING_MASK];
+    }
+    atomic_store(&frozen, false);
+    return count;
+}
+
+void trace_clear(void) {
+    atomic_store(&frozen, true);
+    atomic_store(&head, 0);
+    memset(ring, 0, sizeof(ring));
+    atomic_store(&frozen, false);
+}
+
+/* Line format read by host/tools/trace2chrome.py:
+ *   task <id> <name> / event <id> <name> / rec <ts> <dur> <task> <event> <arg>
+ * framed by "trace begin" and "trace end <count> <total>". */
+void trace_dump(FILE *out) {
+    static trace_rec_t copy[TRACE_RING_SIZE];
+    size_t count = trace_snapshot(copy, TRACE_RING_SIZE);
+
+    fprintf(out, "trace begin\n");
+    fprintf(out, "task %d isr\n", TRACE_TASK_ISR);
+    for (int i = 1; i < TRACE_MAX_TASKS; i++) {
+        TaskHandle_t t = atomic_load(&tasks[i]);
+        if (t) {
+            fprintf(out, "task %d %s\n", i, pcTaskGetName(t));
+        }
+    }
+    for (int i = 0; i < TRACE_EV_COUNT; i++) {
+        fprintf(out, "event %d %s\n", i, event_names[i]);
+    }
+    for (size_t i = 0; i < count; i++) {
+        fprintf(out, "rec %lu %lu %u %u %u\n", (unsigned long)copy[i].ts_us, (unsigned long)copy[i].dur_us,
+                copy[i].task, copy[i].event, copy[i].arg);
+    }
+    fprintf(out, "trace end %u %lu\n", (unsigned)count, (unsigned long)atomic_load(&head));
+}
+#endif
@@ -0,0 +1,35 @@
+#ifndef TRACE_H
+#define TRACE_H
+#include <stdint.h>
+#include <stdio.h>
+#include "sdkconfig.h"
+typedef enum {
+    TRACE_EV_LVGL_HANDLER = 0,
+    TRACE_EV_LCD_FLUSH,
+    TRACE_EV_TOUCH_READ,
+    TRACE_EV_UI_UPDATE,
+    TRACE_EV_UI_APPLY,
+    TRACE_EV_COUNT
+} trace_event_t;
+typedef struct {
+    uint32_t ts_us;
+    uint32_t dur_us;
+    uint8_t task;
+    uint8_t event;
+    uint16_t arg;
+} trace_rec_t;
+#if CONFIG_PGPEMU_TRACE
+#include "esp_timer.h"
+void trace_record(trace_event_t event, uint32_t start_us, uint16_t arg);
+size_t trace_snapshot(trace_rec_t *out, size_t max);
+void trace_dump(FILE *out);
+void trace_clear(void);
+#define TRACE_BEGIN(name)               uint32_t trace_t0_##name = (uint32_t)esp_timer_get_time()
+#define TRACE_END(name, event, arg)     trace_record((event), trace_t0_##name, (uint16_t)(arg))
+#define TRACE_SPAN(event, start_us, arg) trace_record((event), (uint32_t)(start_us), (uint16_t)(arg))
+#else
+#define TRACE_BEGIN(name)               do { } while (0)
+#define TRACE_END(name, event, arg)     do { } while (0)
+#define TRACE_SPAN(event, start_us, arg) do { } while (0)
+#endif
+#endif
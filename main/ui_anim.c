@@ -0,0 +1,153 @@
+#include "ui_anim.h"
+#include "lvgl.h"
+#include "lvgl_sched.h"
+#include "sdkconfig.h"
+#include "esp_log.h"
+#include <string.h>
+
+static const char *TAG = "UI_ANIM";
+
+/* Frame period for the configured cap. */
+#define FRAME_MS        (1000 / CONFIG_PGPEMU_UI_ANIM_FPS)
+
+/* Event animations driven by lv_anim in the LVGL task. lv_anim advances
+ * every display refresh; the exec callback below drops the ticks that come
+ * before the next frame is due. The due time steps by whole frame periods
+ * rather than from the last drawn frame, so refresh ticks that do not
+ * divide the period still average out at the cap. An animation never costs
+ * more renders than that and the single core keeps its slack for BLE. The
+ * owner's frame callback maps progress 0..UI_ANIM_END to widget changes
+ * and must only touch its fixed set of widgets, which keeps every frame's
+ * invalidation to the same small box. Progress UI_ANIM_END is the rest
+ * state and is always delivered, whether the animation ran out or was cut
+ * short by the next one. */
+static const uint16_t duration_ms[] = {
+    [UI_ANIM_CATCH] = 700,
+    [UI_ANIM_FLEE] = 600,
+    [UI_ANIM_SPIN] = 500,
+};
+
+static ui_anim_frame_cb_t frame_cb;
+static ui_anim_kind_t running;
+static int32_t anim_var;
+static uint32_t start_ms;
+static uint32_t last_frame_ms;
+static uint32_t frame_due_ms;
+static uint32_t run_frames;
+static uint64_t start_busy_us;
+static ui_anim_stats_t stats;
+
+static uint64_t lvgl_busy_us(void) {
+    lvgl_sched_stats_t ss;
+    lvgl_sched_get_stats(&ss);
+    return ss.handler_us_total;
+}
+
+static void deliver(int32_t progress) {
+    uint32_t now = lv_tick_get();
+    if (run_frames > 0) {
+        uint32_t gap = now - last_frame_ms;
+        if (gap > stats.gap_ms_max) {
+            stats.gap_ms_max = gap;
+        }
+        if (gap > 2 * FRAME_MS) {
+            stats.late_frames++;
+        }
+    }
+    last_frame_ms = now;
+    frame_due_ms += FRAME_MS;
+    if ((int32_t)(now - frame_due_ms) >= FRAME_MS) {
+        frame_due_ms = now + FRAME_MS;
+    }
+    run_frames++;
+    stats.frames++;
+    frame_cb(running, progress);
+}
+
+static void exec_cb(void *var, int32_t progress) {
+    (void)var;
+    if (progress < UI_ANIM_END && (int32_t)(lv_tick_get() - frame_due_ms) < 0) {
+        stats.frames_capped++;
+        return;
+    }
+    deliver(progress);
+}
+
+static void finish(void) {
+    uint32_t elapsed = lv_tick_elaps(start_ms);
+    if (elapsed > 0 && run_frames > 1) {
+        stats.fps_last = (run_frames - 1) * 1000 / elapsed;
+        stats.cpu_pct_last = (uint32_t)((lvgl_busy_us() - start_busy_us) / 10 / elapsed);
+    }
+    running = UI_ANIM_NONE;
+}
+
+static void ready_cb(lv_anim_t *a) {
+    (void)a;
+    if (running == UI_ANIM_NONE) {
+        return;
+    }
+    stats.completed++;
+    finish();
+}
+
+void ui_anim_init(ui_anim_frame_cb_t cb) {
+    frame_cb = cb;
+}
+
+/* Cuts a running animation short and leaves its widgets at rest. */
+void ui_anim_cancel(void) {
+    if (running == UI_ANIM_NONE) {
+        return;
+    }
+    lv_anim_del(&anim_var, NULL);
+    stats.cancelled++;
+    frame_cb(running, UI_ANIM_END);
+    finish();
+}
+
+/* Runs in the LVGL task. A new event replaces whatever is playing. */
+void ui_anim_play(ui_anim_kind_t kind) {
+    if (frame_cb == NULL || kind == UI_ANIM_NONE || kind > UI_ANIM_SPIN) {
+        return;
+    }
+    ui_anim_cancel();
+    running = kind;
+    run_frames = 0;
+    start_ms = lv_tick_get();
+    frame_due_ms = start_ms;
+    start_busy_us = lvgl_busy_us();
+    stats.started++;
+    ESP_LOGD(TAG, "Playing %s", ui_anim_kind_name(kind));
+
+    lv_anim_t a;
+    lv_anim_init(&a);
+    lv_anim_set_var(&a, &anim_var);
+    lv_anim_set_exec_cb(&a, exec_cb);
+    lv_anim_set_values(&a, 0, UI_ANIM_END);
+    lv_anim_set_time(&a, duration_ms[kind]);
+    lv_anim_set_ready_cb(&a, ready_cb);
+    lv_anim_start(&a);
+}
+
+bool ui_anim_running(void) {
+    return running != UI_ANIM_NONE;
+}
+
+const char *ui_anim_kind_name(ui_anim_kind_t kind) {
+    static const char *const names[] = {
+        [UI_ANIM_NONE] = "none",
+        [UI_ANIM_CATCH] = "catch",
+        [UI_ANIM_FLEE] = "flee",
+        [UI_ANIM_SPIN] = "spin",
+    };
+    return kind <= UI_ANIM_SPIN ? names[kind] : "?";
+}
+
+void ui_anim_get_stats(ui_anim_stats_t *out) {
+    *out = stats;
+}
+
+void ui_anim_reset_stats(void) {
+    memset(&stats, 0, sizeof(stats));
+}
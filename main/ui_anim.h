@@ -0,0 +1,26 @@
+#ifndef UI_ANIM_H
+#define UI_ANIM_H
+#include <stdbool.h>
+#include <stdint.h>
+#define UI_ANIM_END     1024
+typedef enum { UI_ANIM_NONE = 0, UI_ANIM_CATCH, UI_ANIM_FLEE, UI_ANIM_SPIN } ui_anim_kind_t;
+typedef void (*ui_anim_frame_cb_t)(ui_anim_kind_t kind, int32_t progress);
+typedef struct {
+    uint32_t started;
+    uint32_t completed;
+    uint32_t cancelled;
+    uint32_t frames;
+    uint32_t frames_capped;
+    uint32_t late_frames;
+    uint32_t gap_ms_max;
+    uint32_t fps_last;
+    uint32_t cpu_pct_last;
+} ui_anim_stats_t;
+void ui_anim_init(ui_anim_frame_cb_t cb);
+void ui_anim_play(ui_anim_kind_t kind);
+void ui_anim_cancel(void);
+bool ui_anim_running(void);
+const char *ui_anim_kind_name(ui_anim_kind_t kind);
+void ui_anim_get_stats(ui_anim_stats_t *out);
+void ui_anim_reset_stats(void);
+#endif
@@ -0,0 +1,111 @@
+#include "ui_cache.h"
+#include "esp_log.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "UI_CACHE";
+
+/* Pre-rasterised A4 images for the parts of the main screen that redraw on
+ * every counter change. LVGL draws alpha-only images in their img_recolor
+ * colour, so one bitmap serves any colour and each pixel costs 4 bits. */
+static size_t cache_bytes;
+
+static uint8_t *alloc_a4(lv_img_dsc_t *img, lv_coord_t w, lv_coord_t h) {
+    size_t stride = ((size_t)w + 1) / 2;
+    uint8_t *data = calloc(stride * (size_t)h, 1);
+    if (data == NULL) {
+        return NULL;
+    }
+    memset(img, 0, sizeof(*img));
+    img->header.cf = LV_IMG_CF_ALPHA_4BIT;
+    img->header.w = (uint32_t)w;
+    img->header.h = (uint32_t)h;
+    img->data_size = (uint32_t)(stride * (size_t)h);
+    img->data = data;
+    cache_bytes += img->data_size;
+    return data;
+}
+
+/* Rows of an A4 image are byte aligned, first pixel in the high nibble. */
+static void put_a4(uint8_t *data, lv_coord_t w, lv_coord_t x, lv_coord_t y, uint8_t a) {
+    uint8_t *p = &data[(size_t)y * (((size_t)w + 1) / 2) + (size_t)x / 2];
+    *p |= (x & 1) ? a : (uint8_t)(a << 4);
+}
+
+/* Glyph bitmaps in LVGL fonts are packed without row padding at the
+ * font's bpp; each digit is unpacked once into a fixed-size cell laid out
+ * the way the label would place it, so swapping a cell's source never
+ * moves its neighbours. */
+bool ui_cache_build_digits(ui_glyph_cache_t *cache, const lv_font_t *font) {
+    lv_font_glyph_dsc_t g;
+    lv_coord_t cell_w = 0;
+    for (uint32_t d = 0; d < UI_CACHE_DIGITS; d++) {
+        if (!lv_font_get_glyph_dsc(font, &g, '0' + d, 0)) {
+            return false;
+        }
+        if (g.adv_w > cell_w) {
+            cell_w = g.adv_w;
+        }
+    }
+    cache->cell_w = cell_w;
+    cache->cell_h = lv_font_get_line_height(font);
+
+    for (uint32_t d = 0; d < UI_CACHE_DIGITS; d++) {
+        lv_font_get_glyph_dsc(font, &g, '0' + d, 0);
+        const uint8_t *bitmap = lv_font_get_glyph_bitmap(font, '0' + d);
+        uint8_t *data = alloc_a4(&cache->digit[d], cache->cell_w, cache->cell_h);
+        if (data == NULL || bitmap == NULL) {
+            return false;
+        }
+        lv_coord_t x0 = (cache->cell_w - g.adv_w) / 2 + g.ofs_x;
+        lv_coord_t y0 = cache->cell_h - font->base_line - g.box_h - g.ofs_y;
+        uint32_t mask = (1U << g.bpp) - 1;
+        uint32_t bit = 0;
+        for (lv_coord_t y = 0; y < g.box_h; y++) {
+            for (lv_coord_t x = 0; x < g.box_w; x++, bit += g.bpp) {
+                uint32_t v = (bitmap[bit / 8] >> (8 - g.bpp - bit % 8)) & mask;
+                uint8_t a = g.bpp == 8 ? (uint8_t)(v >> 4) : (uint8_t)(v * 15 / mask);
+                lv_coord_t px = x0 + x, py = y0 + y;
+                if (a && px >= 0 && px < cache->cell_w && py >= 0 && py < cache->cell_h) {
+                    put_a4(data, cache->cell_w, px, py, a);
+                }
+            }
+        }
+    }
+    return true;
+}
+
+/* Full ring of the given outer radius and width, anti-aliased over one
+ * pixel on both edges, centred in a 2r x 2r image the way lv_arc centres
+ * its track. */
+bool ui_cache_build_ring(lv_img_dsc_t *img, lv_coord_t radius, lv_coord_t width) {
+    lv_coord_t size = radius * 2;
+    uint8_t *data = alloc_a4(img, size, size);
+    if (data == NULL) {
+        ESP_LOGW(TAG, "No memory for %dx%d ring", size, size);
+        return false;
+    }
+    float outer = (float)radius;
+    float inner = (float)(radius - width);
+    for (lv_coord_t y = 0; y < size; y++) {
+        float dy = (float)y + 0.5f - outer;
+        for (lv_coord_t x = 0; x < size; x++) {
+            float dx = (float)x + 0.5f - outer;
+            float d = sqrtf(dx * dx + dy * dy);
+            float cov = fminf(outer - d + 0.5f, d - inner + 0.5f);
+            if (cov <= 0.0f) {
+                continue;
+            }
+            uint8_t a = cov >= 1.0f ? 15 : (uint8_t)(cov * 15.0f + 0.5f);
+            if (a) {
+                put_a4(data, size, x, y, a);
+            }
+        }
+    }
+    return true;
+}
+
+size_t ui_cache_bytes(void) {
+    return cache_bytes;
+}
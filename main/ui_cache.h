@@ -0,0 +1,15 @@
+#ifndef UI_CACHE_H
+#define UI_CACHE_H
+#include <stdbool.h>
+#include <stddef.h>
+#include "lvgl.h"
+#define UI_CACHE_DIGITS 10
+typedef struct {
+    lv_img_dsc_t digit[UI_CACHE_DIGITS];
+    lv_coord_t cell_w;
+    lv_coord_t cell_h;
+} ui_glyph_cache_t;
+bool ui_cache_build_digits(ui_glyph_cache_t *cache, const lv_font_t *font);
+bool ui_cache_build_ring(lv_img_dsc_t *img, lv_coord_t radius, lv_coord_t width);
+size_t ui_cache_bytes(void);
+#endif
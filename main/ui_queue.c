@@ -0,0 +1,91 @@
+#include "ui_queue.h"
+#include <stdatomic.h>
+#include <stddef.h>
+
+/* One mailbox per producer. Only the owning source writes value/seq/text, the
+ * LVGL task is the only reader, and the pending mask is the hand-off: a field
+ * is published by setting its bit after the value is stored, and claimed by
+ * swapping the whole mask to zero. Posting the same field twice before a drain
+ * simply overwrites it, so updates coalesce instead of queueing up.
+ *
+ * A post that races with a drain can be observed with its value but without
+ * its bit cleared; the bit stays set and the (identical) value is picked up
+ * again on the next drain, where the display diff discards it. */
+typedef struct {
+    atomic_uint_fast32_t pending;
+    atomic_uint_fast32_t value[UI_FIELD_COUNT];
+    atomic_uint_fast32_t seq[UI_FIELD_COUNT];
+    _Atomic(const char *) text;
+} ui_mailbox_t;
+
+static ui_mailbox_t mailboxes[UI_SRC_COUNT];
+static atomic_uint_fast32_t post_seq;
+static atomic_uint_fast32_t submitted;
+static uint32_t drained;
+static uint32_t applied;
+
+static void publish(ui_mailbox_t *mb, ui_field_t field) {
+    atomic_store_explicit(&mb->seq[field], atomic_fetch_add_explicit(&post_seq, 1, memory_order_relaxed) + 1,
+                          memory_order_relaxed);
+    atomic_fetch_or_explicit(&mb->pending, 1UL << field, memory_order_release);
+    atomic_fetch_add_explicit(&submitted, 1, memory_order_relaxed);
+}
+
+void ui_queue_post(ui_src_t src, ui_field_t field, uint32_t value) {
+    if (src >= UI_SRC_COUNT || field >= UI_FIELD_COUNT || field == UI_FIELD_STATUS_TEXT) {
+        return;
+    }
+    ui_mailbox_t *mb = &mailboxes[src];
+    atomic_store_explicit(&mb->value[field], value, memory_order_relaxed);
+    publish(mb, field);
+}
+
+/* The text is not copied, it must have static storage duration. */
+void ui_queue_post_text(ui_src_t src, const char *text) {
+    if (src >= UI_SRC_COUNT || text == NULL) {
+        return;
+    }
+    ui_mailbox_t *mb = &mailboxes[src];
+    atomic_store_explicit(&mb->text, text, memory_order_relaxed);
+    publish(mb, UI_FIELD_STATUS_TEXT);
+}
+
+/* Merges every mailbox into one batch. When two sources posted the same
+ * field, the later post (higher sequence number) wins. */
+bool ui_queue_drain(ui_queue_batch_t *batch) {
+    uint32_t best_seq[UI_FIELD_COUNT] = { 0 };
+    batch->mask = 0;
+    batch->text = NULL;
+
+    for (int s = 0; s < UI_SRC_COUNT; s++) {
+        ui_mailbox_t *mb = &mailboxes[s];
+        uint32_t mask = (uint32_t)atomic_exchange_explicit(&mb->pending, 0, memory_order_acquire);
+        while (mask) {
+            int f = __builtin_ctz(mask);
+            mask &= mask - 1;
+            uint32_t seq = (uint32_t)atomic_load_explicit(&mb->seq[f], memory_order_relaxed);
+            if ((batch->mask & (1UL << f)) && (int32_t)(seq - best_seq[f]) < 0) {
+                continue;
+            }
+            best_seq[f] = seq;
+            batch->mask |= 1UL << f;
+            if (f == UI_FIELD_STATUS_TEXT) {
+                batch->text = atomic_load_explicit(&mb->text, memory_order_relaxed);
+            } else {
+                batch->value[f] = (uint32_t)atomic_load_explicit(&mb->value[f], memory_order_relaxed);
+            }
+            drained++;
+        }
+    }
+    return batch->mask != 0;
+}
+
+void ui_queue_note_applied(uint32_t count) {
+    applied += count;
+}
+
+void ui_queue_get_stats(ui_queue_stats_t *stats) {
+    stats->submitted = (uint32_t)atomic_load_explicit(&submitted, memory_order_relaxed);
+    stats->drained = drained;
+    stats->applied = applied;
+}
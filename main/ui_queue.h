@@ -0,0 +1,33 @@
+#ifndef UI_QUEUE_H
+#define UI_QUEUE_H
+#include <stdbool.h>
+#include <stdint.h>
+typedef enum { UI_SRC_SYSTEM = 0, UI_SRC_PGPEMU, UI_SRC_BUTTON, UI_SRC_PORTAL, UI_SRC_CONSOLE, UI_SRC_BATTERY, UI_SRC_COUNT } ui_src_t;
+typedef enum {
+    UI_FIELD_CAUGHT = 0,
+    UI_FIELD_SPUN,
+    UI_FIELD_BATTERY,
+    UI_FIELD_CONNECTED,
+    UI_FIELD_CATCH_ANIM,
+    UI_FIELD_HISTORY,
+    UI_FIELD_ACCOUNTS,
+    UI_FIELD_SETTINGS,
+    UI_FIELD_STATUS_TEXT,
+    UI_FIELD_COUNT
+} ui_field_t;
+typedef struct {
+    uint32_t mask;
+    uint32_t value[UI_FIELD_COUNT];
+    const char *text;
+} ui_queue_batch_t;
+typedef struct {
+    uint32_t submitted;
+    uint32_t drained;
+    uint32_t applied;
+} ui_queue_stats_t;
+void ui_queue_post(ui_src_t src, ui_field_t field, uint32_t value);
+void ui_queue_post_text(ui_src_t src, const char *text);
+bool ui_queue_drain(ui_queue_batch_t *batch);
+void ui_queue_note_applied(uint32_t count);
+void ui_queue_get_stats(ui_queue_stats_t *stats);
+#endif
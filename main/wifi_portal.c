@@ -0,0 +1,241 @@
+#include "wifi_portal.h"
+#include "portal.h"
+#include "mem_report.h"
+#include "esp_log.h"
+#include "sdkconfig.h"
+#include <stdatomic.h>
+#include <string.h>
+#if CONFIG_PGPEMU_PORTAL
+#include "esp_wifi.h"
+#include "esp_netif.h"
+#include "esp_event.h"
+#include "esp_http_server.h"
+#endif
+
+static const char *TAG = "WIFI_PORTAL";
+
+static bool running = false;
+
+bool wifi_portal_running(void) {
+    return running;
+}
+
+#if CONFIG_PGPEMU_PORTAL
+/* Soft-AP and esp_http_server around the portal handlers. The server task
+ * handles one request at a time, so a single response buffer and a single
+ * body buffer serve every request. The metrics stream would hold that
+ * task for as long as the client listens; it is handed off as an async
+ * request to its own task instead, one stream at a time, with its own
+ * event buffer. */
+
+#define STREAM_TASK_STACK   3072
+#define PORTAL_MAX_SOCKETS  4
+#define PORTAL_PASSWORD_MIN 8   /* WPA2-PSK passphrase limits */
+#define PORTAL_PASSWORD_MAX 63
+
+static char resp_buf[PORTAL_RESP_MAX];
+static char body_buf[PORTAL_BODY_MAX];
+static char event_buf[PORTAL_EVENT_MAX];
+static httpd_handle_t server = NULL;
+static TaskHandle_t stream_task_handle = NULL;
+static httpd_req_t *stream_req = NULL;
+static atomic_bool streaming;
+
+/* Soft-AP bring-up steps that have succeeded. None of them can be undone
+ * cheaply and several refuse a second call, so a retry after a partial
+ * failure picks up at the first step that did not complete. */
+static bool netif_ready = false;
+static esp_netif_t *ap_netif = NULL;
+static bool wifi_ready = false;
+static bool ap_started = false;
+MEM_TASK_STORAGE(stream_task_mem, STREAM_TASK_STACK);
+
+static void stream_task(void *arg) {
+    uint32_t bits;
+    while (1) {
+        xTaskNotifyWait(0, UINT32_MAX, &bits, portMAX_DELAY);
+        httpd_req_t *req = stream_req;
+        httpd_resp_set_type(req, "text/event-stream");
+        httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+        while (1) {
+            size_t n = portal_metrics_event(event_buf, sizeof(event_buf));
+            if (n == 0 || httpd_resp_send_chunk(req, event_buf, n) != ESP_OK) {
+                break;
+            }
+            vTaskDelay(pdMS_TO_TICKS(CONFIG_PGPEMU_PORTAL_STREAM_MS));
+        }
+        httpd_resp_send_chunk(req, NULL, 0);
+        httpd_req_async_handler_complete(req);
+        stream_req = NULL;
+        atomic_store(&streaming, false);
+        ESP_LOGI(TAG, "Metrics stream closed");
+    }
+}
+
+static esp_err_t start_stream(httpd_req_t *req) {
+    if (atomic_exchange(&streaming, true)) {
+        httpd_resp_set_status(req, portal_status_line(503));
+        httpd_resp_set_type(req, "application/json");
+        return httpd_resp_sendstr(req, "{\"error\":\"stream busy\"}");
+    }
+    httpd_req_t *copy = NULL;
+    esp_err_t err = httpd_req_async_handler_begin(req, &copy);
+    if (err != ESP_OK) {
+        atomic_store(&streaming, false);
+        return err;
+    }
+    stream_req = copy;
+    xTaskNotify(stream_task_handle, 1, eSetBits);
+    return ESP_OK;
+}
+
+/* Runs in the httpd task for every GET and POST. A body over
+ * PORTAL_BODY_MAX is left unread; portal_handle() answers 413 from the
+ * length alone and the server drops the rest. */
+static esp_err_t http_handler(httpd_req_t *req) {
+    portal_method_t method = req->method == HTTP_GET ? PORTAL_GET : req->method == HTTP_POST ? PORTAL_POST
+                                                                                            : PORTAL_OTHER;
+    size_t body_len = req->content_len;
+    const char *body = NULL;
+    if (body_len > 0 && body_len <= PORTAL_BODY_MAX) {
+        size_t got = 0;
+        while (got < body_len) {
+            int r = httpd_req_recv(req, body_buf + got, body_len - got);
+            if (r == HTTPD_SOCK_ERR_TIMEOUT) {
+                continue;
+            }
+            if (r <= 0) {
+                return ESP_FAIL;
+            }
+            got += (size_t)r;
+        }
+        body = body_buf;
+    }
+    portal_resp_t resp;
+    portal_handle(method, req->uri, body, body_len, resp_buf, sizeof(resp_buf), &resp);
+    if (resp.stream) {
+        return start_stream(req);
+    }
+    httpd_resp_set_status(req, portal_status_line(resp.status));
+    httpd_resp_set_type(req, resp.type);
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    return httpd_resp_send(req, resp.body, resp.len);
+}
+
+static esp_err_t start_ap(void) {
+    esp_err_t err;
+    if (!netif_ready) {
+        err = esp_netif_init();
+        if (err == ESP_OK) {
+            err = esp_event_loop_create_default();
+            if (err == ESP_ERR_INVALID_STATE) {
+                err = ESP_OK;
+            }
+        }
+        if (err != ESP_OK) {
+            return err;
+        }
+        netif_ready = true;
+    }
+    if (ap_netif == NULL) {
+        ap_netif = esp_netif_create_default_wifi_ap();
+        if (ap_netif == NULL) {
+            return ESP_FAIL;
+        }
+    }
+    if (!wifi_ready) {
+        wifi_init_config_t init_cfg = WIFI_INIT_CONFIG_DEFAULT();
+        err = esp_wifi_init(&init_cfg);
+        if (err != ESP_OK) {
+            return err;
+        }
+        wifi_ready = true;
+    }
+    if (ap_started) {
+        return ESP_OK;
+    }
+
+    wifi_config_t ap_cfg = {
+        .ap = {
+            .channel = CONFIG_PGPEMU_PORTAL_CHANNEL,
+            .max_connection = 2,
+            .authmode = WIFI_AUTH_WPA2_PSK,
+        },
+    };
+    size_t ssid_len = strnlen(CONFIG_PGPEMU_PORTAL_SSID, sizeof(ap_cfg.ap.ssid));
+    memcpy(ap_cfg.ap.ssid, CONFIG_PGPEMU_PORTAL_SSID, ssid_len);
+    ap_cfg.ap.ssid_len = (uint8_t)ssid_len;
+    size_t pass_len = strnlen(CONFIG_PGPEMU_PORTAL_PASSWORD, sizeof(ap_cfg.ap.password) - 1);
+    memcpy(ap_cfg.ap.password, CONFIG_PGPEMU_PORTAL_PASSWORD, pass_len);
+
+    err = esp_wifi_set_mode(WIFI_MODE_AP);
+    if (err == ESP_OK) {
+        err = esp_wifi_set_config(WIFI_IF_AP, &ap_cfg);
+    }
+    if (err == ESP_OK) {
+        err = esp_wifi_start();
+    }
+    ap_started = (err == ESP_OK);
+    return err;
+}
+
+/* Whether wifi_portal_start() can work at all, so the caller can decide
+ * before pausing anything. The AP never comes up open: the portal can
+ * change settings. */
+esp_err_t wifi_portal_check(void) {
+    size_t pass_len = strlen(CONFIG_PGPEMU_PORTAL_PASSWORD);
+    if (pass_len < PORTAL_PASSWORD_MIN || pass_len > PORTAL_PASSWORD_MAX) {
+        ESP_LOGE(TAG, "Portal password must be %d-%d characters, not starting the AP", PORTAL_PASSWORD_MIN,
+                 PORTAL_PASSWORD_MAX);
+        return ESP_ERR_INVALID_ARG;
+    }
+    return ESP_OK;
+}
+
+esp_err_t wifi_portal_start(void) {
+    if (running) {
+        return ESP_OK;
+    }
+    esp_err_t err = wifi_portal_check();
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = start_ap();
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Soft-AP failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.server_port = CONFIG_PGPEMU_PORTAL_PORT;
+    config.uri_match_fn = httpd_uri_match_wildcard;
+    config.max_open_sockets = PORTAL_MAX_SOCKETS;
+    config.lru_purge_enable = true;
+    err = httpd_start(&server, &config);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "HTTP server failed: %s", esp_err_to_name(err));
+        return err;
+    }
+    const httpd_uri_t get_uri = { .uri = "/*", .method = HTTP_GET, .handler = http_handler };
+    const httpd_uri_t post_uri = { .uri = "/*", .method = HTTP_POST, .handler = http_handler };
+    httpd_register_uri_handler(server, &get_uri);
+    httpd_register_uri_handler(server, &post_uri);
+    if (stream_task_handle == NULL) {
+        stream_task_handle = mem_task_create(stream_task, "portal_stream", STREAM_TASK_STACK, NULL, 3,
+                                             MEM_TASK_BUFS(stream_task_mem));
+    }
+
+    running = true;
+    ESP_LOGI(TAG, "SSID \"%s\", http://192.168.4.1:%d/", CONFIG_PGPEMU_PORTAL_SSID, CONFIG_PGPEMU_PORTAL_PORT);
+    return ESP_OK;
+}
+#else
+esp_err_t wifi_portal_check(void) {
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t wifi_portal_start(void) {
+    ESP_LOGI(TAG, "Configuration portal not configured");
+    return ESP_ERR_NOT_SUPPORTED;
+}
+#endif
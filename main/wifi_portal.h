@@ -0,0 +1,8 @@
+#ifndef WIFI_PORTAL_H
+#define WIFI_PORTAL_H
+#include <stdbool.h>
+#include "esp_err.h"
+esp_err_t wifi_portal_check(void);
+esp_err_t wifi_portal_start(void);
+bool wifi_portal_running(void);
+#endif